@@ -56,7 +56,7 @@ namespace rl {
 
         SDL3::SDL_GL_SetSwapInterval(0);
 
-        m_vg_renderer = std::make_unique<NVGRenderer>();
+        m_vg_renderer = std::make_unique<NVGRenderer>(m_gl_renderer->state_cache());
         m_gui_canvas = std::make_unique<ui::Canvas>(
             this, static_cast<ds::rect<f32>>(m_window_rect),
             m_mouse, m_keyboard, m_vg_renderer);
@@ -8,6 +8,7 @@
 #include "core/assert.hpp"
 #include "core/main_window.hpp"
 #include "core/renderer.hpp"
+#include "gfx/gl/state_cache.hpp"
 #include "gfx/nvg_renderer.hpp"
 #include "utils/io.hpp"
 #include "utils/logging.hpp"
@@ -45,15 +46,22 @@ namespace rl {
     }
 
     OpenGLRenderer::OpenGLRenderer(MainWindow& window)
-        : m_sdl_glcontext{ detail::create_opengl_context(window.sdl_handle()) } {
+        : m_sdl_glcontext{ detail::create_opengl_context(window.sdl_handle()) }
+        , m_state_cache{ std::make_unique<gl::StateCache>() } {
         if (m_sdl_glcontext != nullptr) {
             sdl_assert(m_sdl_glcontext != nullptr, "failed to create renderer");
             const ds::dims<i32> viewport{ window.get_render_size() };
-            glViewport(0, 0, viewport.width, viewport.height);
+            m_state_cache->viewport(0, 0, viewport.width, viewport.height);
         }
     }
 
+    OpenGLRenderer::~OpenGLRenderer() = default;
+
     bool OpenGLRenderer::clear() const {
+        // the scissor test and write masks also apply to glClear()
+        m_state_cache->disable(GL_SCISSOR_TEST);
+        m_state_cache->color_mask(true, true, true, true);
+        m_state_cache->stencil_mask(0xffffffff);
         glClearColor(m_bg_color.r, m_bg_color.g, m_bg_color.b, m_bg_color.a);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         return true;
@@ -69,6 +77,10 @@ namespace rl {
         return m_sdl_glcontext;
     }
 
+    gl::StateCache& OpenGLRenderer::state_cache() const {
+        return *m_state_cache;
+    }
+
     ds::dims<i32> OpenGLRenderer::get_output_size() const {
         debug_assert("not implemented");
         return ds::dims<i32>{ 0, 0 };
@@ -93,25 +105,25 @@ namespace rl {
     }
 
     ds::rect<f32> OpenGLRenderer::get_viewport() const {
-        std::array buff{ 0, 0, 0, 0 };
-        glGetIntegerv(GL_VIEWPORT, buff.data());
-        debug_assert(buff[2] > 0 && buff[3] > 0, "failed to get viewport");
+        const ds::rect<i32> viewport{ m_state_cache->viewport() };
+        debug_assert(viewport.size.width > 0 && viewport.size.height > 0,
+                     "failed to get viewport");
 
         return ds::rect<f32>{
             ds::point<f32>{
-                static_cast<f32>(buff[0]),
-                static_cast<f32>(buff[1]),
+                static_cast<f32>(viewport.pt.x),
+                static_cast<f32>(viewport.pt.y),
             },
             ds::dims<f32>{
-                static_cast<f32>(buff[2]),
-                static_cast<f32>(buff[3]),
+                static_cast<f32>(viewport.size.width),
+                static_cast<f32>(viewport.size.height),
             },
         };
     }
 
     bool OpenGLRenderer::set_viewport(const ds::rect<i32>& rect) const {
         debug_assert(!rect.is_empty(), "invalid viewport rect being set");
-        glViewport(rect.pt.x, rect.pt.y, rect.size.width, rect.size.height);
+        m_state_cache->viewport(rect.pt.x, rect.pt.y, rect.size.width, rect.size.height);
         return !rect.is_empty();
     }
 }
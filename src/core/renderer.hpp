@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <bitset>
+#include <memory>
 
 #include "ds/dims.hpp"
 #include "ds/rect.hpp"
@@ -12,6 +13,10 @@ SDL_C_LIB_END
 
 struct NVGLUframebuffer;
 
+namespace rl::gl {
+    class StateCache;
+}
+
 namespace rl {
     class MainWindow;
 
@@ -37,8 +42,11 @@ namespace rl {
     public:
         explicit OpenGLRenderer(
             MainWindow& window);
+        ~OpenGLRenderer();
 
         [[nodiscard]] SDL3::SDL_GLContext gl_context() const;
+        // GL state shared by everything rendering to this context
+        [[nodiscard]] gl::StateCache& state_cache() const;
         [[nodiscard]] ds::dims<i32> get_output_size() const;
         [[nodiscard]] ds::rect<f32> get_viewport() const;
 
@@ -53,5 +61,6 @@ namespace rl {
         // TODO: move to style configs
         constexpr static ds::color m_bg_color{ rl::Colors::Background };
         SDL3::SDL_GLContext m_sdl_glcontext{ nullptr };
+        std::unique_ptr<gl::StateCache> m_state_cache{};
     };
 }
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <utility>
+
+#include "gfx/font_warmup.hpp"
+#include "gfx/vg/nanovg.hpp"
+
+namespace rl::text {
+    FontWarmup::Config FontWarmup::theme_config(const ui::Theme& theme, const f32 pixel_ratio) {
+        Config config{};
+        config.scale = pixel_ratio;
+
+        constexpr Range ascii{ 0x20, 0x7e };
+        for (const font::id font : { font::style::Sans, font::style::SansBold,
+                                     font::style::Mono })
+            config.glyphs.push_back({ font, { ascii } });
+
+        GlyphSet icons{ font::style::Icons, {} };
+        for (const ui::Icon::ID icon : {
+                 theme.check_box_icon,
+                 theme.message_information_icon,
+                 theme.message_question_icon,
+                 theme.message_warning_icon,
+                 theme.message_alt_button_icon,
+                 theme.message_primary_button_icon,
+                 theme.popup_chevron_right_icon,
+                 theme.popup_chevron_left_icon,
+                 theme.text_box_up_icon,
+                 theme.text_box_down_icon,
+             })
+            icons.ranges.push_back({ static_cast<u32>(icon), static_cast<u32>(icon) });
+        config.glyphs.push_back(std::move(icons));
+
+        config.sizes = {
+            theme.standard_font_size,
+            theme.tooltip_font_size,
+            theme.text_box_font_size,
+            theme.form_group_font_size,
+            theme.form_widget_font_size,
+            theme.label_font_size,
+            theme.button_font_size,
+            theme.dialog_title_font_size,
+            theme.check_box_font_size,
+        };
+        std::ranges::sort(config.sizes);
+        const auto dupes{ std::ranges::unique(config.sizes) };
+        config.sizes.erase(dupes.begin(), dupes.end());
+
+        return config;
+    }
+
+    FontWarmup::FontWarmup(nvg::Context* context, const font::Map& fonts, const Config& config)
+        : m_context{ context } {
+        // distance field glyphs are the same at every size, one is enough
+        const u64 nsizes{ context->params.sdf_text ? std::min<u64>(config.sizes.size(), 1)
+                                                   : config.sizes.size() };
+
+        for (const GlyphSet& set : config.glyphs) {
+            const auto font{ fonts.find(set.font.hash) };
+            if (font == fonts.end())
+                continue;
+
+            std::vector<u32> codepoints{};
+            for (const Range& range : set.ranges)
+                for (u32 c = range.first; c <= range.last; ++c)
+                    codepoints.push_back(c);
+
+            for (u64 i = 0; i < nsizes; ++i) {
+                nvg::font::GlyphStaging* staging{ nvg::create_glyph_staging(context) };
+                if (staging == nullptr)
+                    continue;
+
+                m_batches.push_back({
+                    .staging = staging,
+                    .font = font->second,
+                    .size = config.sizes[i] * config.scale,
+                    .codepoints = codepoints,
+                });
+            }
+        }
+
+        m_thread = std::jthread{ [this](const std::stop_token& stop) {
+            this->run(stop);
+        } };
+    }
+
+    FontWarmup::~FontWarmup() {
+        if (m_thread.joinable()) {
+            m_thread.request_stop();
+            m_thread.join();
+        }
+
+        for (const Batch& batch : m_batches)
+            nvg::font::delete_staging(batch.staging);
+        for (nvg::font::GlyphStaging* staging : m_staged)
+            nvg::font::delete_staging(staging);
+    }
+
+    void FontWarmup::run(const std::stop_token& stop) {
+        for (Batch& batch : m_batches) {
+            for (const u32 codepoint : batch.codepoints) {
+                if (stop.stop_requested())
+                    return;
+                nvg::font::stage_glyph(batch.staging, std::to_underlying(batch.font), codepoint,
+                                       batch.size, 0.0f);
+            }
+
+            std::scoped_lock lock{ m_staged_lock };
+            m_staged.push_back(std::exchange(batch.staging, nullptr));
+        }
+
+        m_done = true;
+    }
+
+    i32 FontWarmup::update() {
+        std::vector<nvg::font::GlyphStaging*> staged{};
+        {
+            std::scoped_lock lock{ m_staged_lock };
+            staged.swap(m_staged);
+        }
+
+        i32 added{ 0 };
+        for (nvg::font::GlyphStaging* staging : staged) {
+            added += nvg::add_staged_glyphs(m_context, staging);
+            nvg::font::delete_staging(staging);
+        }
+
+        return added;
+    }
+
+    bool FontWarmup::finished() const {
+        std::scoped_lock lock{ m_staged_lock };
+        return m_done && m_staged.empty();
+    }
+}
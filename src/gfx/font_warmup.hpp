@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gfx/text.hpp"
+#include "gfx/vg/fontstash.hpp"
+#include "ui/theme.hpp"
+#include "utils/numeric.hpp"
+
+namespace rl::nvg {
+    struct Context;
+}
+
+namespace rl::text {
+    // Rasterizes the glyphs the UI is going to draw on a background thread, so the first frame
+    // showing them doesn't have to. Every font and size is staged as a batch of its own and the
+    // render thread copies the finished batches into the glyph atlas in update(). Staging only
+    // reads the font data, so frames can keep being drawn meanwhile (e.g. a loading screen).
+    class FontWarmup {
+    public:
+        // inclusive range of codepoints
+        struct Range {
+            u32 first{ 0 };
+            u32 last{ 0 };
+        };
+
+        struct GlyphSet {
+            font::id font{};
+            std::vector<Range> ranges{};
+        };
+
+        struct Config {
+            std::vector<GlyphSet> glyphs{};
+            std::vector<f32> sizes{};
+            // device pixels per unit of font size, the font scale times the pixel ratio
+            f32 scale{ 1.0f };
+        };
+
+        // Printable ASCII in the text fonts and the icons the theme itself draws (check boxes,
+        // message boxes, popups and text box spinners), at the theme's font sizes rasterized
+        // for the given device pixel ratio.
+        static Config theme_config(const ui::Theme& theme, f32 pixel_ratio);
+
+        // Snapshots the fonts and starts staging, the context must outlive the warmup.
+        FontWarmup(nvg::Context* context, const font::Map& fonts, const Config& config);
+        ~FontWarmup();
+
+        FontWarmup(const FontWarmup&) = delete;
+        FontWarmup& operator=(const FontWarmup&) = delete;
+
+        // Adds the batches staged since the last call to the atlas, on the render thread.
+        // Returns the number of glyphs added.
+        i32 update();
+
+        [[nodiscard]] bool finished() const;
+
+    private:
+        struct Batch {
+            nvg::font::GlyphStaging* staging{ nullptr };
+            font::handle font{ font::InvalidHandle };
+            f32 size{ 0.0f };
+            std::vector<u32> codepoints{};
+        };
+
+        void run(const std::stop_token& stop);
+
+    private:
+        nvg::Context* m_context{ nullptr };
+        // only touched by the worker until it's joined
+        std::vector<Batch> m_batches{};
+        // batches handed over to the render thread
+        std::vector<nvg::font::GlyphStaging*> m_staged{};
+        mutable std::mutex m_staged_lock{};
+        std::atomic<bool> m_done{ false };
+        std::jthread m_thread{};
+    };
+}
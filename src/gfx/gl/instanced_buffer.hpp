@@ -10,13 +10,14 @@
 #include "ds/rect.hpp"
 #include "ds/vector2d.hpp"
 #include "gfx/gl/shader.hpp"
+#include "gfx/gl/state_cache.hpp"
 #include "utils/numeric.hpp"
 #include "utils/time.hpp"
 
 namespace rl::gl {
 
     // const std::unique_ptr<rl::OpenGLRenderer>& renderer{ m_main_window->glrenderer() };
-    // gl::InstancedVertexBuffer vbo{ renderer->get_viewport() };
+    // gl::InstancedVertexBuffer vbo{ renderer->get_viewport(), renderer->state_cache() };
     // vbo.bind_buffers();
     //
     // while (!this->should_exit()) {
@@ -39,7 +40,8 @@ namespace rl::gl {
             return "InstancedVertexBuffer";
         }
 
-        explicit InstancedVertexBuffer(const ds::rect<f32>& viewport_rect) {
+        explicit InstancedVertexBuffer(const ds::rect<f32>& viewport_rect, StateCache& state_cache)
+            : m_state{ &state_cache } {
             // create vertex array object
             glGenVertexArrays(1, &m_vao_id);
 
@@ -51,6 +53,8 @@ namespace rl::gl {
             // compile shaders
             [[maybe_unused]] const bool shaders_valid = m_shader.compile();
             debug_assert(shaders_valid, "Failed to compile shaders");
+            // compiling leaves the program bound behind the cache's back
+            m_state->invalidate();
 
             m_rect_colors_data.reserve(m_rect_count);
             m_rect_positions_data.reserve(m_rect_count);
@@ -113,10 +117,12 @@ namespace rl::gl {
 
         ~InstancedVertexBuffer() {
             // cleanup when everything leaves scope
-            glDeleteVertexArrays(1, &m_vao_id);
-            glDeleteBuffers(1, &m_vbo_positions_id);
-            glDeleteBuffers(1, &m_vbo_colors_id);
-            glDeleteBuffers(1, &m_vbo_id);
+            m_state->delete_vertex_array(m_vao_id);
+            m_state->delete_buffer(m_vbo_positions_id);
+            m_state->delete_buffer(m_vbo_colors_id);
+            m_state->delete_buffer(m_vbo_id);
+            // m_shader deletes the program once this returns
+            m_state->use_program(0);
         }
 
         void set_draw_mode(const DrawMode mode = DrawMode::Fill) const {
@@ -135,11 +141,11 @@ namespace rl::gl {
 
         void bind_buffers() const {
             // bind the VAO vertex array
-            glBindVertexArray(m_vao_id);
+            m_state->bind_vertex_array(m_vao_id);
 
             {
                 // bind the VBO vertex buffer
-                glBindBuffer(GL_ARRAY_BUFFER, m_vbo_id);
+                m_state->bind_buffer(GL_ARRAY_BUFFER, m_vbo_id);
                 // define info about the VBO vertex buffer, targeting GL_ARRAY_BUFFER
                 glBufferData(GL_ARRAY_BUFFER, sizeof(f32) * 3 * m_rect_vertex_buffer_data.size(),
                              m_rect_vertex_buffer_data.data(), GL_STATIC_DRAW);
@@ -156,7 +162,7 @@ namespace rl::gl {
             }
 
             {
-                glBindBuffer(GL_ARRAY_BUFFER, m_vbo_colors_id);
+                m_state->bind_buffer(GL_ARRAY_BUFFER, m_vbo_colors_id);
                 // define info about the VBO vertex buffer, targeting GL_ARRAY_BUFFER
                 glBufferData(GL_ARRAY_BUFFER, sizeof(f32) * 4 * m_rect_colors_data.size(),
                              m_rect_colors_data.data(), GL_STATIC_DRAW);
@@ -173,7 +179,7 @@ namespace rl::gl {
             }
 
             {
-                glBindBuffer(GL_ARRAY_BUFFER, m_vbo_positions_id);
+                m_state->bind_buffer(GL_ARRAY_BUFFER, m_vbo_positions_id);
                 // define info about the VBO vertex buffer, targeting GL_ARRAY_BUFFER
                 glBufferData(GL_ARRAY_BUFFER, sizeof(f32) * 3 * m_rect_positions_data.size(),
                              m_rect_positions_data.data(), GL_DYNAMIC_DRAW);
@@ -193,11 +199,14 @@ namespace rl::gl {
         }
 
         void draw_triangles() const {
-            glBindBuffer(GL_ARRAY_BUFFER, m_vbo_positions_id);
+            // the divisors are part of the VAO's state
+            m_state->bind_vertex_array(m_vao_id);
+
+            m_state->bind_buffer(GL_ARRAY_BUFFER, m_vbo_positions_id);
             glBufferData(GL_ARRAY_BUFFER, m_rect_positions_data.size() * 3 * sizeof(f32),
                          m_rect_positions_data.data(), GL_STREAM_DRAW);
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_vbo_colors_id);
+            m_state->bind_buffer(GL_ARRAY_BUFFER, m_vbo_colors_id);
             glBufferData(GL_ARRAY_BUFFER, m_rect_colors_data.size() * 4 * sizeof(f32),
                          m_rect_colors_data.data(), GL_STREAM_DRAW);
 
@@ -205,16 +214,20 @@ namespace rl::gl {
             glVertexAttribDivisor(1, 1);  // rect colors: one per quad (its center) -> 1
             glVertexAttribDivisor(2, 1);  // rect positions: one per quad (its center) -> 1
 
-            m_shader.set_active();
+            m_state->use_program(m_shader.id());
+            m_shader.set_transform();
+
+            // whatever the vector renderer left enabled would clip or cull the quads
+            m_state->disable(GL_SCISSOR_TEST);
+            m_state->disable(GL_STENCIL_TEST);
+            m_state->disable(GL_CULL_FACE);
 
-            glBindVertexArray(m_vao_id);
             glDrawArraysInstanced(GL_TRIANGLES, 0,
                                   static_cast<i32>(m_rect_vertex_buffer_data.size()), m_rect_count);
-
-            glBindVertexArray(0);
         }
 
     private:
+        StateCache* m_state{ nullptr };
         rl::Timer<f32> m_timer{};
         DrawMode m_draw_mode{ DrawMode::Fill };
         Shader m_shader{ "instanced_vertex_shader.glsl", "instanced_fragment_shader.glsl" };
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "ds/rect.hpp"
+#include "utils/numeric.hpp"
+
+namespace rl::gl {
+
+    // Shadow copy of the OpenGL pipeline state shared by everything rendering into the same
+    // context. State changes matching the shadowed state never reach the driver, and reading
+    // state back (the viewport) never has to round trip through it. Anything changing tracked
+    // state without going through the cache has to call invalidate() afterwards.
+    class StateCache {
+    public:
+        struct Stats {
+            // state changes requested through the cache
+            u64 calls{ 0 };
+            // requests dropped because the state was already set
+            u64 redundant{ 0 };
+        };
+
+        // texture units and indexed uniform buffer bindings tracked, the rest pass through
+        constexpr static u32 TextureUnitCount{ 8 };
+        constexpr static u32 UniformBindingCount{ 4 };
+
+    public:
+        StateCache() {
+            this->invalidate();
+        }
+
+        // Forgets all of the shadowed state, the next request for each of them is always sent.
+        void invalidate() {
+            m_program = Unknown;
+            m_vertex_array = Unknown;
+            m_buffers.fill(Unknown);
+            m_uniform_ranges.fill(BufferRange{ Unknown, 0, 0 });
+            m_active_texture = Unknown;
+            for (auto& unit : m_textures)
+                unit.fill(Unknown);
+            m_caps.fill(-1);
+            m_blend = { Unknown, Unknown, Unknown, Unknown };
+            m_stencil_mask_valid = false;
+            m_stencil_func_valid = false;
+            m_stencil_op.fill({ Unknown, Unknown, Unknown });
+            m_color_mask.fill(-1);
+            m_front_face = Unknown;
+            m_cull_face = Unknown;
+            m_scissor.fill(-1);
+            m_viewport.fill(-1);
+        }
+
+        const Stats& stats() const {
+            return m_stats;
+        }
+
+        void reset_stats() {
+            m_stats = Stats{};
+        }
+
+        void use_program(const GLuint program) {
+            if (this->changed(m_program != program)) {
+                m_program = program;
+                glUseProgram(program);
+            }
+        }
+
+        void bind_vertex_array(const GLuint vertex_array) {
+            if (this->changed(m_vertex_array != vertex_array)) {
+                m_vertex_array = vertex_array;
+                glBindVertexArray(vertex_array);
+            }
+        }
+
+        // GL_ELEMENT_ARRAY_BUFFER is part of the vertex array's state and never cached.
+        void bind_buffer(const GLenum target, const GLuint buffer) {
+            const i32 idx{ buffer_index(target) };
+            if (idx < 0) {
+                glBindBuffer(target, buffer);
+                return;
+            }
+
+            if (this->changed(m_buffers[idx] != buffer)) {
+                m_buffers[idx] = buffer;
+                glBindBuffer(target, buffer);
+            }
+        }
+
+        // Also binds the buffer to the target's generic binding point, same as GL does.
+        void bind_buffer_range(const GLenum target, const GLuint index, const GLuint buffer,
+                               const GLintptr offset, const GLsizeiptr size) {
+            if (target != GL_UNIFORM_BUFFER || index >= UniformBindingCount) {
+                glBindBufferRange(target, index, buffer, offset, size);
+                if (const i32 idx{ buffer_index(target) }; idx >= 0)
+                    m_buffers[idx] = buffer;
+                return;
+            }
+
+            const BufferRange range{ buffer, offset, size };
+            if (this->changed(m_uniform_ranges[index] != range)) {
+                m_uniform_ranges[index] = range;
+                m_buffers[buffer_index(target)] = buffer;
+                glBindBufferRange(target, index, buffer, offset, size);
+            }
+        }
+
+        void active_texture(const GLenum unit) {
+            if (this->changed(m_active_texture != unit)) {
+                m_active_texture = unit;
+                glActiveTexture(unit);
+            }
+        }
+
+        // Binds the texture to the active texture unit.
+        void bind_texture(const GLenum target, const GLuint texture) {
+            const i32 idx{ texture_index(target) };
+            const u32 unit{ m_active_texture - GL_TEXTURE0 };
+            if (idx < 0 || unit >= TextureUnitCount) {
+                glBindTexture(target, texture);
+                return;
+            }
+
+            if (this->changed(m_textures[unit][idx] != texture)) {
+                m_textures[unit][idx] = texture;
+                glBindTexture(target, texture);
+            }
+        }
+
+        void enable(const GLenum cap) {
+            this->set_capability(cap, true);
+        }
+
+        void disable(const GLenum cap) {
+            this->set_capability(cap, false);
+        }
+
+        void blend_func_separate(const GLenum src_rgb, const GLenum dst_rgb, const GLenum src_alpha,
+                                 const GLenum dst_alpha) {
+            const std::array<GLenum, 4> blend{ src_rgb, dst_rgb, src_alpha, dst_alpha };
+            if (this->changed(m_blend != blend)) {
+                m_blend = blend;
+                glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+            }
+        }
+
+        void stencil_mask(const GLuint mask) {
+            if (this->changed(!m_stencil_mask_valid || m_stencil_mask != mask)) {
+                m_stencil_mask_valid = true;
+                m_stencil_mask = mask;
+                glStencilMask(mask);
+            }
+        }
+
+        void stencil_func(const GLenum func, const GLint ref, const GLuint mask) {
+            if (this->changed(!m_stencil_func_valid || m_stencil_func != func ||
+                              m_stencil_func_ref != ref || m_stencil_func_mask != mask)) {
+                m_stencil_func_valid = true;
+                m_stencil_func = func;
+                m_stencil_func_ref = ref;
+                m_stencil_func_mask = mask;
+                glStencilFunc(func, ref, mask);
+            }
+        }
+
+        void stencil_op(const GLenum sfail, const GLenum dpfail, const GLenum dppass) {
+            const std::array<GLenum, 3> op{ sfail, dpfail, dppass };
+            if (this->changed(m_stencil_op[0] != op || m_stencil_op[1] != op)) {
+                m_stencil_op.fill(op);
+                glStencilOp(sfail, dpfail, dppass);
+            }
+        }
+
+        void stencil_op_separate(const GLenum face, const GLenum sfail, const GLenum dpfail,
+                                 const GLenum dppass) {
+            const std::array<GLenum, 3> op{ sfail, dpfail, dppass };
+            const bool front{ face == GL_FRONT || face == GL_FRONT_AND_BACK };
+            const bool back{ face == GL_BACK || face == GL_FRONT_AND_BACK };
+            if (this->changed((front && m_stencil_op[0] != op) || (back && m_stencil_op[1] != op))) {
+                if (front)
+                    m_stencil_op[0] = op;
+                if (back)
+                    m_stencil_op[1] = op;
+                glStencilOpSeparate(face, sfail, dpfail, dppass);
+            }
+        }
+
+        void color_mask(const bool r, const bool g, const bool b, const bool a) {
+            const std::array<i8, 4> mask{ r, g, b, a };
+            if (this->changed(m_color_mask != mask)) {
+                m_color_mask = mask;
+                glColorMask(r, g, b, a);
+            }
+        }
+
+        void front_face(const GLenum mode) {
+            if (this->changed(m_front_face != mode)) {
+                m_front_face = mode;
+                glFrontFace(mode);
+            }
+        }
+
+        void cull_face(const GLenum mode) {
+            if (this->changed(m_cull_face != mode)) {
+                m_cull_face = mode;
+                glCullFace(mode);
+            }
+        }
+
+        void scissor(const GLint x, const GLint y, const GLsizei w, const GLsizei h) {
+            const std::array<GLint, 4> rect{ x, y, w, h };
+            if (this->changed(m_scissor != rect)) {
+                m_scissor = rect;
+                glScissor(x, y, w, h);
+            }
+        }
+
+        void viewport(const GLint x, const GLint y, const GLsizei w, const GLsizei h) {
+            const std::array<GLint, 4> rect{ x, y, w, h };
+            if (this->changed(m_viewport != rect)) {
+                m_viewport = rect;
+                glViewport(x, y, w, h);
+            }
+        }
+
+        // Only queries the driver if the viewport was never set through the cache.
+        ds::rect<i32> viewport() {
+            if (m_viewport[2] < 0)
+                glGetIntegerv(GL_VIEWPORT, m_viewport.data());
+
+            return ds::rect<i32>{
+                ds::point<i32>{ m_viewport[0], m_viewport[1] },
+                ds::dims<i32>{ m_viewport[2], m_viewport[3] },
+            };
+        }
+
+        // Deleting objects implicitly unbinds them, and their names may be handed out again
+        // right away, so bindings of deleted objects are forgotten along with them.
+        void delete_program(const GLuint program) {
+            if (m_program == program)
+                m_program = Unknown;
+            glDeleteProgram(program);
+        }
+
+        void delete_vertex_array(const GLuint vertex_array) {
+            if (m_vertex_array == vertex_array)
+                m_vertex_array = Unknown;
+            glDeleteVertexArrays(1, &vertex_array);
+        }
+
+        void delete_buffer(const GLuint buffer) {
+            std::replace(m_buffers.begin(), m_buffers.end(), buffer, Unknown);
+            for (BufferRange& range : m_uniform_ranges)
+                if (range.buffer == buffer)
+                    range.buffer = Unknown;
+            glDeleteBuffers(1, &buffer);
+        }
+
+        void delete_texture(const GLuint texture) {
+            for (auto& unit : m_textures)
+                std::replace(unit.begin(), unit.end(), texture, Unknown);
+            glDeleteTextures(1, &texture);
+        }
+
+    private:
+        struct BufferRange {
+            GLuint buffer{ 0 };
+            GLintptr offset{ 0 };
+            GLsizeiptr size{ 0 };
+
+            bool operator==(const BufferRange&) const = default;
+        };
+
+        constexpr static GLuint Unknown{ std::numeric_limits<GLuint>::max() };
+
+        static i32 buffer_index(const GLenum target) {
+            switch (target) {
+                case GL_ARRAY_BUFFER:
+                    return 0;
+                case GL_UNIFORM_BUFFER:
+                    return 1;
+                case GL_PIXEL_UNPACK_BUFFER:
+                    return 2;
+                default:
+                    return -1;
+            }
+        }
+
+        static i32 texture_index(const GLenum target) {
+            switch (target) {
+                case GL_TEXTURE_2D:
+                    return 0;
+                case GL_TEXTURE_2D_ARRAY:
+                    return 1;
+                default:
+                    return -1;
+            }
+        }
+
+        static i32 capability_index(const GLenum cap) {
+            switch (cap) {
+                case GL_BLEND:
+                    return 0;
+                case GL_CULL_FACE:
+                    return 1;
+                case GL_DEPTH_TEST:
+                    return 2;
+                case GL_STENCIL_TEST:
+                    return 3;
+                case GL_SCISSOR_TEST:
+                    return 4;
+                default:
+                    return -1;
+            }
+        }
+
+        void set_capability(const GLenum cap, const bool enabled) {
+            const i32 idx{ capability_index(cap) };
+            if (idx >= 0 && !this->changed(m_caps[idx] != static_cast<i8>(enabled)))
+                return;
+
+            if (idx >= 0)
+                m_caps[idx] = static_cast<i8>(enabled);
+            if (enabled)
+                glEnable(cap);
+            else
+                glDisable(cap);
+        }
+
+        bool changed(const bool differs) {
+            ++m_stats.calls;
+            if (!differs)
+                ++m_stats.redundant;
+            return differs;
+        }
+
+    private:
+        Stats m_stats{};
+
+        GLuint m_program{ Unknown };
+        GLuint m_vertex_array{ Unknown };
+        std::array<GLuint, 3> m_buffers{};
+        std::array<BufferRange, UniformBindingCount> m_uniform_ranges{};
+        GLenum m_active_texture{ Unknown };
+        std::array<std::array<GLuint, 2>, TextureUnitCount> m_textures{};
+
+        // -1 until the capability is first set
+        std::array<i8, 5> m_caps{};
+        std::array<GLenum, 4> m_blend{};
+
+        bool m_stencil_mask_valid{ false };
+        bool m_stencil_func_valid{ false };
+        GLuint m_stencil_mask{ 0 };
+        GLenum m_stencil_func{ 0 };
+        GLint m_stencil_func_ref{ 0 };
+        GLuint m_stencil_func_mask{ 0 };
+        // front and back face operations
+        std::array<std::array<GLenum, 3>, 2> m_stencil_op{};
+        std::array<i8, 4> m_color_mask{};
+
+        GLenum m_front_face{ Unknown };
+        GLenum m_cull_face{ Unknown };
+        std::array<GLint, 4> m_scissor{};
+        std::array<GLint, 4> m_viewport{};
+    };
+}
@@ -17,7 +17,8 @@
 
 namespace rl {
     namespace {
-        nvg::Context* create_nvg_context(bool& stencil_buf, bool& depth_buf, bool& float_buf) {
+        nvg::Context* create_nvg_context(gl::StateCache& state_cache, bool& stencil_buf,
+                                         bool& depth_buf, bool& float_buf) {
             constexpr u8 float_mode{ 0 };
             i32 depth_bits{ 0 };
             i32 stencil_bits{ 0 };
@@ -40,14 +41,15 @@ namespace rl {
                 //| nvg::gl::CreateFlags::Debug
             };
 
-            nvg::Context* nvg_context{ nvg::gl::create_gl_context(nvg_flags) };
+            nvg::Context* nvg_context{ nvg::gl::create_gl_context(nvg_flags, &state_cache) };
             debug_assert(nvg_context != nullptr, "Failed to create NVG context");
             return nvg_context;
         };
     }
 
-    NVGRenderer::NVGRenderer()
-        : m_nvg_context{ create_nvg_context(m_stencil_buffer, m_depth_buffer, m_float_buffer) } {
+    NVGRenderer::NVGRenderer(gl::StateCache& state_cache)
+        : m_nvg_context{ create_nvg_context(state_cache, m_stencil_buffer, m_depth_buffer,
+                                            m_float_buffer) } {
         this->load_fonts({
             text::font::Data{
                 text::font::style::Sans,
@@ -88,6 +90,16 @@ namespace rl {
         nvg::begin_frame(
             m_nvg_context.get(), render_size.width,
             render_size.height, pixel_ratio);
+
+        // glyphs are rasterized at the device pixel ratio, restage them if it changed
+        if (pixel_ratio != m_pixel_ratio) {
+            m_pixel_ratio = pixel_ratio;
+            this->warmup_fonts();
+        }
+
+        // hand the glyphs the warmup staged since the last frame over to the atlas
+        if (m_font_warmup != nullptr)
+            m_font_warmup->update();
     }
 
     void NVGRenderer::end_frame() const {
@@ -142,15 +154,39 @@ namespace rl {
                                     line.end.y, inner_color, outer_gradient_color);
     }
 
-    text::font::handle NVGRenderer::load_font(const std::string_view& font_name,
+    text::font::handle NVGRenderer::load_font(const text::font::id& font,
                                               const std::basic_string_view<u8>& font_ttf) const {
         // Creates font by loading it from the specified memory chunk.
         // Returns handle to the font.
-        const text::font::handle fh{ nvg::create_font_mem(m_nvg_context.get(), font_name, font_ttf) };
-        debug_assert(fh != text::font::InvalidHandle, "failed to load font: {}", font_name);
+        const text::font::handle fh{ nvg::create_font_mem(m_nvg_context.get(), font.name,
+                                                          font_ttf) };
+        debug_assert(fh != text::font::InvalidHandle, "failed to load font: {}", font.name);
         return fh;
     }
 
+    text::font::handle NVGRenderer::font_handle(const text::font::id font) const {
+        const auto fh{ m_font_map.find(font.hash) };
+        if (fh == m_font_map.end())
+            return text::font::InvalidHandle;
+        return fh->second;
+    }
+
+    void NVGRenderer::resolve_fonts(ui::Theme& theme) const {
+        theme.font_handles = {
+            .sans = this->font_handle(text::font::style::Sans),
+            .sans_bold = this->font_handle(text::font::style::SansBold),
+            .icons = this->font_handle(text::font::style::Icons),
+            .mono = this->font_handle(text::font::style::Mono),
+            .tooltip = this->font_handle(theme.tooltip_font),
+            .form_group = this->font_handle(theme.form_group_font),
+            .label = this->font_handle(theme.label_font),
+            .button = this->font_handle(theme.button_font),
+            .dialog_title = this->font_handle(theme.dialog_title_font),
+            .checkbox_text = this->font_handle(theme.checkbox_text_font),
+            .checkbox_icon = this->font_handle(theme.checkbox_icon_font),
+        };
+    }
+
     void NVGRenderer::flush(const ds::dims<f32>& viewport, const f32 pixel_ratio) const {
         // Flush all queued up NanoVG rendering commands
         const nvg::Params* params{ nvg::internal_params(m_nvg_context.get()) };
@@ -159,12 +195,26 @@ namespace rl {
     }
 
     void NVGRenderer::load_fonts(const std::vector<text::font::Data>& fonts) {
-        for (auto&& [font_name, font_ttf] : fonts) {
-            text::font::handle fh{ this->load_font(
-                std::forward<decltype(font_name)>(font_name),
-                std::forward<decltype(font_ttf)>(font_ttf)) };
-            m_font_map[font_name] = std::move(fh);
+        for (auto&& [font, font_ttf] : fonts) {
+            const text::font::handle fh{ this->load_font(font, font_ttf) };
+            m_font_map[font.hash] = fh;
         }
+
+        m_default_font = this->font_handle(text::Properties{}.font);
+
+        // measurements are taken from a snapshot of the fonts, it has to include the new ones
+        m_text_measurer = std::make_unique<text::TextMeasurer>(m_nvg_context.get());
+
+        // pre-rasterize the glyphs the UI draws while the first frames are shown,
+        // any warmup that's still running is stopped and restarted with every font
+        this->warmup_fonts();
+    }
+
+    void NVGRenderer::warmup_fonts() const {
+        m_font_warmup.reset();
+        m_font_warmup = std::make_unique<text::FontWarmup>(
+            m_nvg_context.get(), m_font_map,
+            text::FontWarmup::theme_config(ui::Theme{}, m_pixel_ratio));
     }
 
     void NVGRenderer::set_fill_paint_style(const nvg::PaintStyle& paint_style) const {
@@ -176,10 +226,10 @@ namespace rl {
         nvg::fill(m_nvg_context.get());
     }
 
-    void NVGRenderer::set_text_properties(const std::string_view font_name, const f32 font_size,
+    void NVGRenderer::set_text_properties(const text::font::handle font, const f32 font_size,
                                           const Align alignment, const ds::color<f32>& text_color) const {
-        if (!font_name.empty())
-            nvg::set_font_face(m_nvg_context.get(), font_name);
+        if (font != text::font::InvalidHandle)
+            nvg::set_font_face(m_nvg_context.get(), font);
         if (font_size > 0.0f)
             nvg::set_font_size(m_nvg_context.get(), font_size);
         if (alignment != Align::None)
@@ -198,15 +248,15 @@ namespace rl {
         nvg::draw_text(m_nvg_context.get(), pos, std::move(text));
     }
 
-    ds::dims<f32> NVGRenderer::get_text_size(const std::string&) const {
-        debug_assert("not implemented");
-        return ds::dims<f32>::zero();
+    ds::dims<f32> NVGRenderer::get_text_size(const std::string& text) const {
+        const text::Properties defaults{};
+        return this->get_text_size(text, m_default_font, defaults.font_size, defaults.alignment);
     }
 
     ds::rect<f32> NVGRenderer::get_text_box_rect(
-        const std::string& text, ds::point<f32> pos, std::string_view font_name,
+        const std::string& text, ds::point<f32> pos, const text::font::handle font,
         const f32 font_size, const f32 fold_width, const Align alignment) const {
-        this->set_text_properties(font_name, font_size, alignment);
+        this->set_text_properties(font, font_size, alignment);
         // Measures the specified multi-text string. Parameter bounds should be a pointer to
         // float[4], if the bounding box of the text should be returned. The bounds value are
         // [xmin,ymin, xmax,ymax] Measured values are returned in local coordinate space.
@@ -223,10 +273,10 @@ namespace rl {
     }
 
     ds::dims<f32> NVGRenderer::get_text_size(
-        const std::string& text, const std::string_view& font_name,
-        const f32 font_size, const Align alignment) const {
-        this->set_text_properties(font_name, font_size, alignment);
-        const f32 width{ nvg::text_bounds(m_nvg_context.get(), ds::point<f32>::zero(), text) };
+        const std::string& text, const text::font::handle font,
+        const f32 font_size, Align) const {
+        // the advance width is the same however the text is aligned
+        const f32 width{ this->get_text_width(text, font, font_size) };
 
         constexpr static f32 width_buffer{ 2.0f };
         return ds::dims{
@@ -235,6 +285,16 @@ namespace rl {
         };
     }
 
+    f32 NVGRenderer::get_text_width(const std::string_view text, const text::font::handle font,
+                                    const f32 font_size) const {
+        if (font == text::font::InvalidHandle || m_text_measurer == nullptr) {
+            debug_assert(font != text::font::InvalidHandle, "text measured with an invalid font");
+            return 0.0f;
+        }
+
+        return m_text_measurer->text_size(text, font, font_size, m_pixel_ratio).width;
+    }
+
     void NVGRenderer::draw_rect_outline(
         const ds::rect<f32>& rect, const f32 stroke_width,
         const ds::color<f32>& color, const Outline type) const {
@@ -269,4 +329,36 @@ namespace rl {
         nvg::rounded_rect(m_nvg_context.get(), rect.pt.x, rect.pt.y,
                           rect.size.width, rect.size.height, corner_radius);
     }
+
+    // The rounded rect primitives below don't build a path, they're drawn as signed distance
+    // field instances that the GL backend batches into a single instanced draw whenever they're
+    // submitted back to back, so they don't need to be wrapped in draw_path() calls.
+
+    void NVGRenderer::fill_rounded_rect(const ds::rect<f32>& rect, const f32 corner_radius,
+                                        const ds::color<f32>& color) const {
+        nvg::fill_color(m_nvg_context.get(), color);
+        nvg::fill_rounded_rect(m_nvg_context.get(), rect, corner_radius);
+    }
+
+    void NVGRenderer::fill_rounded_rect(const ds::rect<f32>& rect, const f32 corner_radius,
+                                        const nvg::PaintStyle& paint_style) const {
+        nvg::fill_paint(m_nvg_context.get(), paint_style);
+        nvg::fill_rounded_rect(m_nvg_context.get(), rect, corner_radius);
+    }
+
+    void NVGRenderer::stroke_rounded_rect(const ds::rect<f32>& rect, const f32 corner_radius,
+                                          const f32 stroke_width,
+                                          const ds::color<f32>& color) const {
+        nvg::stroke_width(m_nvg_context.get(), stroke_width);
+        nvg::stroke_color(m_nvg_context.get(), color);
+        nvg::stroke_rounded_rect(m_nvg_context.get(), rect, corner_radius);
+    }
+
+    void NVGRenderer::draw_box_shadow(const ds::rect<f32>& rect, const f32 corner_radius,
+                                      const f32 blur, const ds::color<f32>& color) const {
+        const nvg::PaintStyle shadow{ nvg::box_gradient(m_nvg_context.get(), rect, corner_radius,
+                                                        blur, color, Colors::Transparent) };
+        nvg::fill_paint(m_nvg_context.get(), shadow);
+        nvg::fill_rounded_rect(m_nvg_context.get(), rect.expanded(blur), corner_radius + blur);
+    }
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+
 #include "ds/rect.hpp"
+#include "gfx/font_warmup.hpp"
 #include "gfx/text.hpp"
+#include "gfx/text_measurer.hpp"
 #include "gfx/vg/nanovg.hpp"
 #include "ui/theme.hpp"
 #include "utils/numeric.hpp"
@@ -11,8 +15,12 @@ namespace rl {
         struct PaintStyle;
     }
 
+    namespace gl {
+        class StateCache;
+    }
+
     struct TextProperties {
-        std::string_view font{};
+        text::font::handle font{ text::font::InvalidHandle };
         Align align{ Align::None };
         ds::color<f32> color{ Colors::Transparent };
         f32 font_size{ -1.0f };
@@ -20,7 +28,7 @@ namespace rl {
 
     class NVGRenderer {
     public:
-        NVGRenderer();
+        explicit NVGRenderer(gl::StateCache& state_cache);
 
         [[nodiscard]] nvg::Context* context() const;
 
@@ -33,25 +41,34 @@ namespace rl {
             const ds::color<f32>& outer_gradient_color) const;
 
         [[nodiscard]] text::font::handle load_font(
-            const std::string_view& font_name,
+            const text::font::id& font,
             const std::basic_string_view<u8>& font_ttf) const;
 
+        // Resolves a font to the handle it was loaded as, InvalidHandle if it isn't loaded.
+        [[nodiscard]] text::font::handle font_handle(text::font::id font) const;
+        // Resolves the handles of every font the theme draws with, see Theme::FontHandles.
+        void resolve_fonts(ui::Theme& theme) const;
+
+        // Text measurement doesn't touch the nanovg context, it's safe to do from any thread.
         [[nodiscard]] ds::dims<f32> get_text_size(
             const std::string& text) const;
 
         [[nodiscard]] ds::dims<f32> get_text_size(
-            const std::string& text, const std::string_view& font_name,
+            const std::string& text, text::font::handle font,
             f32 font_size, Align alignment = Align::HCenter | Align::VMiddle) const;
 
+        [[nodiscard]] f32 get_text_width(
+            std::string_view text, text::font::handle font, f32 font_size) const;
+
         [[nodiscard]] ds::rect<f32> get_text_box_rect(
-            const std::string& text, ds::point<f32> pos, std::string_view font_name,
+            const std::string& text, ds::point<f32> pos, text::font::handle font,
             f32 font_size, f32 fold_width, Align alignment = Align::HLeft | Align::VTop) const;
 
         void set_fill_paint_style(const nvg::PaintStyle& paint_style) const;
         void fill_current_path(const nvg::PaintStyle& paint_style) const;
 
         void set_text_properties(const TextProperties& props) const;
-        void set_text_properties(std::string_view font_name,
+        void set_text_properties(text::font::handle font,
                                  f32 font_size = -1.0f,
                                  Align alignment = Align::None,
                                  const ds::color<f32>& text_color = Colors::Transparent) const;
@@ -59,6 +76,15 @@ namespace rl {
         void draw_text(std::string text, ds::point<f32> pos,
                        const TextProperties& props = {}) const;
         void draw_rounded_rect(const ds::rect<f32>& rect, f32 corner_radius) const;
+
+        void fill_rounded_rect(const ds::rect<f32>& rect, f32 corner_radius,
+                               const ds::color<f32>& color) const;
+        void fill_rounded_rect(const ds::rect<f32>& rect, f32 corner_radius,
+                               const nvg::PaintStyle& paint_style) const;
+        void stroke_rounded_rect(const ds::rect<f32>& rect, f32 corner_radius, f32 stroke_width,
+                                 const ds::color<f32>& color) const;
+        void draw_box_shadow(const ds::rect<f32>& rect, f32 corner_radius, f32 blur,
+                             const ds::color<f32>& color) const;
         void draw_rect_outline(const ds::rect<f32>& rect, f32 stroke_width,
                                const ds::color<f32>& color, Outline type) const;
 
@@ -97,11 +123,21 @@ namespace rl {
                 this->end_path();
         }
 
+    private:
+        void warmup_fonts() const;
+
     private:
         bool m_depth_buffer{ false };
         bool m_stencil_buffer{ false };
         bool m_float_buffer{ false };
         std::unique_ptr<nvg::Context> m_nvg_context{ nullptr };
         text::font::Map m_font_map{};
+        // handle of text::Properties' default font, resolved when fonts are loaded
+        text::font::handle m_default_font{ text::font::InvalidHandle };
+        std::unique_ptr<text::TextMeasurer> m_text_measurer{ nullptr };
+        // device pixel ratio of the last frame begun, text is measured and warmed up at it
+        mutable std::atomic<f32> m_pixel_ratio{ 1.0f };
+        // declared last so the worker is stopped before the context goes away
+        mutable std::unique_ptr<text::FontWarmup> m_font_warmup{ nullptr };
     };
 }
@@ -6,14 +6,35 @@
 
 #include "ds/color.hpp"
 #include "ds/vector2d.hpp"
+#include "utils/hash.hpp"
 #include "utils/numeric.hpp"
 #include "utils/properties.hpp"
 
 namespace rl::text {
     namespace font {
-        using handle = i32;
-        using Map = phmap::flat_hash_map<std::string_view, font::handle>;
-        using Data = std::pair<std::string_view, std::basic_string_view<u8>>;
+        // Index of a loaded font. Only the renderer hands these out, fonts are resolved to
+        // handles once when they're loaded instead of being looked up by name on every call.
+        enum class handle : i32 {};
+
+        // Identifies a font by its name, along with the name's hash computed at compile time.
+        // Fonts are registered and resolved by the hash, the name is only kept for loading.
+        struct id {
+            std::string_view name{};
+            u32 hash{ 0 };
+
+            constexpr bool operator==(const id& other) const {
+                return hash == other.hash;
+            }
+        };
+
+        template <auto& Name>
+        consteval id make_id() {
+            return id{ Name, rl::hash<Name>::fnv() };
+        }
+
+        // id hash -> handle
+        using Map = phmap::flat_hash_map<u32, font::handle>;
+        using Data = std::pair<font::id, std::basic_string_view<u8>>;
 
         enum class Source {
             Memory,
@@ -23,14 +44,26 @@ namespace rl::text {
         constexpr static inline f32 MaxValidSize{ 96.0f };
         constexpr static inline f32 MinValidSize{ 1.0f };
         constexpr static inline f32 InvalidSize{ -1.0f };
-        constexpr static inline i32 InvalidHandle{ -1 };
+        constexpr static inline handle InvalidHandle{ -1 };
 
-        namespace style {
+        namespace name {
             constexpr static inline std::string_view Sans{ "sans" };
             constexpr static inline std::string_view SansBold{ "sans_bold" };
             constexpr static inline std::string_view Icons{ "icons" };
             constexpr static inline std::string_view Mono{ "mono" };
         }
+
+        namespace style {
+            constexpr static inline id Sans{ make_id<name::Sans>() };
+            constexpr static inline id SansBold{ make_id<name::SansBold>() };
+            constexpr static inline id Icons{ make_id<name::Icons>() };
+            constexpr static inline id Mono{ make_id<name::Mono>() };
+
+            static_assert(Sans.hash != SansBold.hash && Sans.hash != Icons.hash &&
+                              Sans.hash != Mono.hash && SansBold.hash != Icons.hash &&
+                              SansBold.hash != Mono.hash && Icons.hash != Mono.hash,
+                          "font style names must hash to unique ids");
+        }
     };
 
     struct Properties {
@@ -38,7 +71,7 @@ namespace rl::text {
         f32 border_thickness{ 1.0f };
         f32 border_blur{ 2.0f };
 
-        std::string_view font{ font::style::SansBold };
+        font::id font{ font::style::SansBold };
 
         ds::color<f32> color{ Colors::White };
         ds::color<f32> border_color{ Colors::Transparent };
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <utility>
+
+#include "core/assert.hpp"
+#include "gfx/text_measurer.hpp"
+#include "gfx/vg/nanovg.hpp"
+
+namespace rl::text {
+    u64 TextMeasurer::KeyHash::operator()(const Key& key) const {
+        u64 hash{ std::hash<std::string_view>{}(key.text) };
+        for (const u64 v : { static_cast<u64>(key.font),
+                             static_cast<u64>(std::bit_cast<u32>(key.size)),
+                             static_cast<u64>(std::bit_cast<u32>(key.scale)) })
+            hash ^= v + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    TextMeasurer::TextMeasurer(const nvg::Context* context, const u64 capacity)
+        : m_metrics{ nvg::create_font_metrics(context) }
+        , m_shard_capacity{ std::max<u64>(capacity / ShardCount, 1) } {
+        debug_assert(m_metrics != nullptr, "failed to create font metrics");
+    }
+
+    TextMeasurer::~TextMeasurer() {
+        nvg::font::delete_metrics(m_metrics);
+    }
+
+    ds::dims<f32> TextMeasurer::text_size(const std::string_view text, const font::handle font,
+                                          const f32 size, const f32 scale) const {
+        if (m_metrics == nullptr || text.empty() || scale <= 0.0f)
+            return ds::dims<f32>::zero();
+
+        const Key key{ text, font, size, scale };
+        const u64 hash{ KeyHash{}(key) };
+        // the low bits pick the slot in the shard's index, use the high ones for the shard
+        Shard& shard{ m_shards[(hash >> 56) % ShardCount] };
+
+        {
+            std::scoped_lock lock{ shard.lock };
+            const auto found{ shard.index.find(key) };
+            if (found != shard.index.end()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+                return found->second->size;
+            }
+        }
+
+        // measured outside of the lock, the metrics are only ever read
+        f32 lineh{ 0.0f };
+        const f32 width{ nvg::font::measure_text(m_metrics, std::to_underlying(font), size * scale,
+                                                 0.0f, text.data(), text.data() + text.size(),
+                                                 &lineh) };
+        const ds::dims<f32> measured{ width / scale, lineh / scale };
+
+        std::scoped_lock lock{ shard.lock };
+        // another thread may have measured the same text meanwhile
+        if (shard.index.contains(key))
+            return measured;
+
+        if (shard.lru.size() >= m_shard_capacity) {
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+        }
+
+        Entry& entry{ shard.lru.emplace_front(std::string{ text }, key, measured) };
+        // the key refers to the entry's copy, list nodes never move
+        entry.key.text = entry.text;
+        shard.index.emplace(entry.key, shard.lru.begin());
+        return measured;
+    }
+
+    void TextMeasurer::clear() const {
+        for (Shard& shard : m_shards) {
+            std::scoped_lock lock{ shard.lock };
+            shard.index.clear();
+            shard.lru.clear();
+        }
+    }
+}
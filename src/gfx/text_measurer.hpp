@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "ds/dims.hpp"
+#include "gfx/text.hpp"
+#include "gfx/vg/fontstash.hpp"
+#include "utils/numeric.hpp"
+
+namespace rl::nvg {
+    struct Context;
+}
+
+namespace rl::text {
+    // Measures lines of text straight from the fonts' metrics, without going through the nanovg
+    // context and its state stack, so text can be measured from any thread. Measurements are
+    // cached in an LRU cache split into shards that are locked separately, threads measuring
+    // different strings rarely wait on each other.
+    class TextMeasurer {
+    public:
+        // Snapshots the loaded fonts, the context must outlive the measurer.
+        explicit TextMeasurer(const nvg::Context* context, u64 capacity = 4096);
+        ~TextMeasurer();
+
+        TextMeasurer(const TextMeasurer&) = delete;
+        TextMeasurer& operator=(const TextMeasurer&) = delete;
+
+        // Advance width and line height of a line of text, in local units. The scale is in
+        // device pixels per unit (the pixel ratio), the width is the one nvg::text_bounds()
+        // measures when the text is drawn at that scale.
+        [[nodiscard]] ds::dims<f32> text_size(std::string_view text, font::handle font, f32 size,
+                                              f32 scale = 1.0f) const;
+
+        void clear() const;
+
+    private:
+        struct Key {
+            std::string_view text{};
+            font::handle font{ font::InvalidHandle };
+            f32 size{ 0.0f };
+            f32 scale{ 0.0f };
+
+            bool operator==(const Key&) const = default;
+        };
+
+        struct KeyHash {
+            u64 operator()(const Key& key) const;
+        };
+
+        struct Entry {
+            // owns the text the entry's key refers to
+            std::string text{};
+            Key key{};
+            ds::dims<f32> size{};
+        };
+
+        struct Shard {
+            std::mutex lock{};
+            // most recently used first
+            std::list<Entry> lru{};
+            phmap::flat_hash_map<Key, std::list<Entry>::iterator, KeyHash> index{};
+        };
+
+        constexpr static u64 ShardCount{ 16 };
+
+    private:
+        nvg::font::FontMetrics* m_metrics{ nullptr };
+        u64 m_shard_capacity{ 0 };
+        mutable std::array<Shard, ShardCount> m_shards{};
+    };
+}
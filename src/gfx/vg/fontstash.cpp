@@ -1,6 +1,8 @@
-#include <array>
+#include <algorithm>
+#include <bit>
 #include <cstdint>
 #include <cstdio>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -8,11 +10,18 @@
 #include "gfx/vg/fontstash.hpp"
 #include "nanovg.hpp"
 #include "utils/conversions.hpp"
+#include "utils/utf8_simd.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FONS_SIMD_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define FONS_SIMD_SSE2 0
+#endif
 
 namespace rl::nvg::font {
     using namespace stb;
 
-    constexpr static i32 UTF8_ACCEPT{ 0 };
     constexpr static i32 APREC{ 16 };
     constexpr static i32 ZPREC{ 7 };
 
@@ -58,13 +67,13 @@ namespace rl::nvg::font {
         }
 
         i32 tt_get_glyph_index(const STTFontImpl* font, const i32 codepoint) {
-            return stbtt_find_glyph_index(&font->font, codepoint);
+            return glyph_index(font, static_cast<u32>(codepoint));
         }
 
         i32 tt_build_glyph_bitmap(const STTFontImpl* font, const i32 glyph, f32 /*size*/,
-                                  const f32 scale, i32* advance, i32* lsb, i32* x0, i32* y0,
-                                  i32* x1, i32* y1) {
-            stbtt_get_glyph_h_metrics(&font->font, glyph, advance, lsb);
+                                  const f32 scale, i32* advance, i32* x0, i32* y0, i32* x1,
+                                  i32* y1) {
+            *advance = glyph_advance(font, glyph);
             stbtt_get_glyph_bitmap_box(&font->font, glyph, scale, scale, x0, y0, x1, y1);
             return 1;
         }
@@ -76,53 +85,261 @@ namespace rl::nvg::font {
                                     scale_y, glyph);
         }
 
+        // Writes the glyph's distance field to output, the field covers the glyph's bitmap box
+        // grown by padding on every side. Empty glyphs (e.g. spaces) leave output untouched.
+        void tt_render_glyph_sdf(const STTFontImpl* font, u8* output, const i32 out_stride,
+                                 const f32 scale, const i32 padding, const i32 glyph) {
+            i32 w = 0;
+            i32 h = 0;
+            i32 xoff = 0;
+            i32 yoff = 0;
+            u8* sdf = stbtt_GetGlyphSDF(&font->font, scale, glyph, padding, SDF_ON_EDGE,
+                                        static_cast<f32>(SDF_ON_EDGE) / static_cast<f32>(padding),
+                                        &w, &h, &xoff, &yoff);
+            if (sdf == nullptr)
+                return;
+            for (i32 y = 0; y < h; ++y)
+                std::memcpy(&output[y * out_stride], &sdf[y * w], static_cast<u64>(w));
+            stbtt_free_sdf(sdf, font->font.userdata);
+        }
+
         i32 tt_get_glyph_kern_advance(const STTFontImpl* font, const i32 glyph1, const i32 glyph2) {
-            return stbtt_get_glyph_kern_advance(&font->font, glyph1, glyph2);
-        }
-
-        u32 decutf8(u32* state, u32* codep, const u32 byte) {
-            constexpr static std::array utf8d = std::to_array<u32>(
-                { // The first part of the table maps bytes to character classes that
-                  // to reduce the size of the transition table and create bitmasks.
-                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1,
-                  1, 1, 1, 1, 1, 1, 1, 1, 1, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 7, 7,
-                  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-                  7, 7, 7, 8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-                  2, 2, 2, 2, 2, 2, 2, 2, 10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3, 11, 6, 6,
-                  6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-
-                  // The second part is a transition table that maps a combination
-                  // of a state of the automaton and a character class to a state.
-                  0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72, 12, 12, 12, 12, 12, 12, 12, 12, 12,
-                  12, 12, 12, 12, 0, 12, 12, 12, 12, 12, 0, 12, 0, 12, 12, 12, 24, 12, 12, 12, 12,
-                  12, 24, 12, 24, 12, 12, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 24,
-                  12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 12, 12, 12, 12, 36, 12, 36,
-                  12, 12, 12, 36, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12, 12, 36, 12, 12, 12, 12,
-                  12, 12, 12, 12, 12, 12 });
-
-            const u32 type = utf8d[byte];
-
-            *codep = (*state != UTF8_ACCEPT) ? (byte & 0x3fu) | (*codep << 6)
-                                             : (0xff >> type) & (byte);
-
-            *state = utf8d[256 + *state + type];
-            return *state;
-        }
-
-        // Atlas based on Skyline Bin Packer by Jukka Jyl�nki
+            return glyph_kerning(font, glyph1, glyph2);
+        }
+
+        constexpr u32 MAX_CODEPOINT{ 0x10ffff };
+
+        u32 read_u16(const u8* p) {
+            return static_cast<u32>(p[0] << 8 | p[1]);
+        }
+
+        u32 read_u32(const u8* p) {
+            return static_cast<u32>(p[0]) << 24 | static_cast<u32>(p[1]) << 16 |
+                   static_cast<u32>(p[2]) << 8 | static_cast<u32>(p[3]);
+        }
+
+        // Calls fn(first, last) for the ranges of codepoints the font's cmap subtable covers,
+        // the ones that aren't in it can't have a glyph.
+        template <typename TFunc>
+        void for_each_cmap_range(const stbtt_fontinfo* info, TFunc&& fn) {
+            const u8* cmap = info->data + info->index_map;
+            switch (read_u16(cmap)) {
+                case 0: {
+                    const u32 bytes = read_u16(cmap + 2);
+                    if (bytes > 6)
+                        fn(0u, math::min(bytes - 7, 255u));
+                    break;
+                }
+                case 4: {
+                    const u32 nsegments = read_u16(cmap + 6) / 2;
+                    const u8* ends = cmap + 14;
+                    const u8* starts = ends + nsegments * 2 + 2;
+                    for (u32 i = 0; i < nsegments; ++i)
+                        fn(read_u16(starts + i * 2), read_u16(ends + i * 2));
+                    break;
+                }
+                case 6: {
+                    const u32 first = read_u16(cmap + 6);
+                    const u32 count = read_u16(cmap + 8);
+                    if (count > 0)
+                        fn(first, first + count - 1);
+                    break;
+                }
+                case 12:
+                case 13: {
+                    const u32 ngroups = read_u32(cmap + 12);
+                    for (u32 i = 0; i < ngroups; ++i)
+                        fn(read_u32(cmap + 16 + i * 12), read_u32(cmap + 16 + i * 12 + 4));
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        u32 kern_key(const i32 glyph1, const i32 glyph2) {
+            return static_cast<u32>(glyph1) << 16 | static_cast<u32>(glyph2 & 0xffff);
+        }
+
+        u32 kern_slot(const u32 key, const i32 capacity) {
+            return (key * 0x9e3779b1u >> 7) & static_cast<u32>(capacity - 1);
+        }
+
+        bool kern_covers(const FontTables& tables, const i32 glyph) {
+            return glyph > 0 && glyph < tables.nglyphs &&
+                   (tables.kern_covered[glyph >> 3] & (1 << (glyph & 7))) != 0;
+        }
+
+        i32 build_kern_table(FontTables* tables, const stbtt_kerningentry* pairs,
+                             const i32 npairs) {
+            i32 capacity = 16;
+            while (capacity < npairs * 2)
+                capacity *= 2;
+
+            tables->kern_keys = static_cast<u32*>(
+                std::calloc(static_cast<u64>(capacity), sizeof(u32)));
+            tables->kern_values = static_cast<i16*>(
+                std::calloc(static_cast<u64>(capacity), sizeof(i16)));
+            if (tables->kern_keys == nullptr || tables->kern_values == nullptr)
+                return 0;
+            tables->kern_capacity = capacity;
+
+            for (i32 i = 0; i < npairs; ++i) {
+                const u32 key = kern_key(pairs[i].glyph1, pairs[i].glyph2);
+                if (key == 0 || pairs[i].advance == 0)
+                    continue;
+
+                u32 slot = kern_slot(key, capacity);
+                while (tables->kern_keys[slot] != 0 && tables->kern_keys[slot] != key)
+                    slot = (slot + 1) & static_cast<u32>(capacity - 1);
+                tables->kern_keys[slot] = key;
+                tables->kern_values[slot] = static_cast<i16>(pairs[i].advance);
+            }
+
+            return 1;
+        }
+
+        // Builds the font's lookup tables, see FontTables. Tables that fail to
+        // allocate are left empty and their lookups go to the font data.
+        void build_font_tables(STTFontImpl* font) {
+            const stbtt_fontinfo* info = &font->font;
+            FontTables* tables = &font->tables;
+
+            tables->advances = static_cast<i32*>(
+                std::malloc(sizeof(i32) * static_cast<u64>(math::max(info->num_glyphs, 1))));
+            if (tables->advances != nullptr) {
+                for (i32 g = 0; g < info->num_glyphs; ++g) {
+                    i32 lsb;
+                    stbtt_get_glyph_h_metrics(info, g, &tables->advances[g], &lsb);
+                }
+                tables->nglyphs = info->num_glyphs;
+            }
+
+            u16* bmp = static_cast<u16*>(std::calloc(0x10000, sizeof(u16)));
+            i32 ctail = 0;
+            bool failed = bmp == nullptr;
+            for_each_cmap_range(info, [&](const u32 first, u32 last) {
+                last = math::min(last, MAX_CODEPOINT);
+                for (u32 c = first; !failed && c <= last; ++c) {
+                    const i32 g = stbtt_find_glyph_index(info, static_cast<i32>(c));
+                    if (g == 0)
+                        continue;
+                    if (c <= 0xffff) {
+                        bmp[c] = static_cast<u16>(g);
+                        continue;
+                    }
+                    if (tables->ntail + 1 > ctail) {
+                        ctail = ctail == 0 ? 64 : ctail * 2;
+                        const auto tail = static_cast<CmapEntry*>(std::realloc(
+                            tables->tail, sizeof(CmapEntry) * static_cast<u64>(ctail)));
+                        if (tail == nullptr) {
+                            failed = true;
+                            break;
+                        }
+                        tables->tail = tail;
+                    }
+                    tables->tail[tables->ntail++] = { c, g };
+                }
+            });
+            if (failed) {
+                std::free(bmp);
+                std::free(tables->tail);
+                tables->tail = nullptr;
+                tables->ntail = 0;
+            }
+            else {
+                std::sort(tables->tail, tables->tail + tables->ntail,
+                          [](const CmapEntry& a, const CmapEntry& b) {
+                              return a.codepoint < b.codepoint;
+                          });
+                tables->bmp = bmp;
+            }
+
+            // GPOS kerning takes precedence over the kern table, like in stbtt.
+            if (info->gpos != 0) {
+                constexpr i32 first = 0x20;
+                constexpr i32 count = 0x7f - first;
+                const auto pairs = static_cast<stbtt_kerningentry*>(
+                    std::malloc(sizeof(stbtt_kerningentry) * count * count));
+                if (pairs == nullptr)
+                    return;
+
+                i32 npairs = 0;
+                for (i32 a = 0; a < count; ++a) {
+                    const i32 ga = glyph_index(font, static_cast<u32>(first + a));
+                    for (i32 b = 0; b < count && ga != 0; ++b) {
+                        const i32 gb = glyph_index(font, static_cast<u32>(first + b));
+                        const i32 advance = gb != 0 ? stbtt_get_glyph_kern_advance(info, ga, gb)
+                                                    : 0;
+                        if (advance != 0)
+                            pairs[npairs++] = { ga, gb, advance };
+                    }
+                }
+                tables->kern_complete = false;
+                if (build_kern_table(tables, pairs, npairs) != 0) {
+                    tables->kern_covered = static_cast<u8*>(
+                        std::calloc(static_cast<u64>(info->num_glyphs + 7) / 8, sizeof(u8)));
+                    for (i32 a = 0; a < count && tables->kern_covered != nullptr; ++a) {
+                        const i32 g = glyph_index(font, static_cast<u32>(first + a));
+                        if (g != 0 && g < info->num_glyphs)
+                            tables->kern_covered[g >> 3] |= static_cast<u8>(1 << (g & 7));
+                    }
+                }
+                std::free(pairs);
+            }
+            else if (info->kern != 0) {
+                const i32 length = stbtt_GetKerningTableLength(info);
+                const auto pairs = static_cast<stbtt_kerningentry*>(std::malloc(
+                    sizeof(stbtt_kerningentry) * static_cast<u64>(math::max(length, 1))));
+                if (pairs != nullptr) {
+                    const i32 npairs = stbtt_GetKerningTable(info, pairs, length);
+                    tables->kern_complete = build_kern_table(tables, pairs, npairs) != 0;
+                    std::free(pairs);
+                }
+            }
+            else {
+                // nothing is kerned
+                tables->kern_complete = true;
+            }
+        }
+
+        void free_font_tables(FontTables* tables) {
+            std::free(tables->bmp);
+            std::free(tables->tail);
+            std::free(tables->advances);
+            std::free(tables->kern_keys);
+            std::free(tables->kern_values);
+            std::free(tables->kern_covered);
+            *tables = FontTables{};
+        }
+
+        // Atlas based on shelves, see Atlas.
+        void reset_dirty_rect(AtlasPage* page, const i32 w, const i32 h) {
+            page->dirty_rect[0] = w;
+            page->dirty_rect[1] = h;
+            page->dirty_rect[2] = 0;
+            page->dirty_rect[3] = 0;
+        }
+
+        void mark_dirty(AtlasPage* page, const i32 x0, const i32 y0, const i32 x1, const i32 y1) {
+            page->dirty_rect[0] = math::min(page->dirty_rect[0], x0);
+            page->dirty_rect[1] = math::min(page->dirty_rect[1], y0);
+            page->dirty_rect[2] = math::max(page->dirty_rect[2], x1);
+            page->dirty_rect[3] = math::max(page->dirty_rect[3], y1);
+        }
+
         void delete_atlas(Atlas* atlas) {
             if (atlas == nullptr)
                 return;
-            if (atlas->nodes != nullptr)
-                free(atlas->nodes);
+            for (const AtlasPage& page : atlas->pages)
+                if (page.data != nullptr)
+                    free(page.data);
+            if (atlas->shelves != nullptr)
+                free(atlas->shelves);
             free(atlas);
         }
 
-        Atlas* alloc_atlas(const i32 w, const i32 h, const i32 nnodes) {
+        Atlas* alloc_atlas(const i32 w, const i32 h, const i32 nshelves) {
             // Allocate memory for the font font_ctx.
             const auto atlas = static_cast<Atlas*>(std::malloc(sizeof(Atlas)));
             if (atlas != nullptr) {
@@ -131,19 +348,12 @@ namespace rl::nvg::font {
                 atlas->width = w;
                 atlas->height = h;
 
-                // Allocate space for skyline nodes
-                atlas->nodes = static_cast<AtlasNode*>(std::malloc(sizeof(AtlasNode) * nnodes));
-                if (atlas->nodes != nullptr) {
-                    memset(atlas->nodes, 0, sizeof(AtlasNode) * nnodes);
-                    atlas->nnodes = 0;
-                    atlas->cnodes = nnodes;
-
-                    // Init root node.
-                    atlas->nodes[0].x = 0;
-                    atlas->nodes[0].y = 0;
-                    atlas->nodes[0].width = static_cast<i16>(w);
-                    atlas->nnodes++;
-
+                // Allocate space for shelves, pages are added on demand
+                atlas->shelves = static_cast<AtlasShelf*>(
+                    std::malloc(sizeof(AtlasShelf) * nshelves));
+                if (atlas->shelves != nullptr) {
+                    atlas->nshelves = 0;
+                    atlas->cshelves = nshelves;
                     return atlas;
                 }
             }
@@ -155,168 +365,155 @@ namespace rl::nvg::font {
             return nullptr;
         }
 
-        i32 atlas_insert_node(Atlas* atlas, const i32 idx, const i32 x, const i32 y, const i32 w) {
-            // Insert node
-            if (atlas->nnodes + 1 > atlas->cnodes) {
-                atlas->cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
-                atlas->nodes = static_cast<AtlasNode*>(
-                    std::realloc(  // NOLINT(bugprone-suspicious-realloc-usage)
-                        atlas->nodes, sizeof(AtlasNode) * static_cast<u64>(atlas->cnodes)));
-
-                if (atlas->nodes == nullptr)
-                    return 0;
-            }
+        i32 atlas_add_page(Atlas* atlas) {
+            if (atlas->npages >= MAX_ATLAS_PAGES)
+                return 0;
 
-            for (i32 i = atlas->nnodes; i > idx; i--)
-                atlas->nodes[i] = atlas->nodes[i - 1];
+            // the first page's memory is reused across resets
+            AtlasPage* page = &atlas->pages[atlas->npages];
+            const u64 size = static_cast<u64>(atlas->width) * static_cast<u64>(atlas->height);
+            u8* data = static_cast<u8*>(std::realloc(page->data, size));
+            if (data == nullptr)
+                return 0;
 
-            atlas->nodes[idx].x = static_cast<i16>(x);
-            atlas->nodes[idx].y = static_cast<i16>(y);
-            atlas->nodes[idx].width = static_cast<i16>(w);
-            atlas->nnodes++;
+            std::memset(data, 0, size);
+            page->data = data;
+            page->top = 0;
+            reset_dirty_rect(page, atlas->width, atlas->height);
+            atlas->npages++;
 
             return 1;
         }
 
-        void atlas_remove_node(Atlas* atlas, const i32 idx) {
-            if (atlas->nnodes == 0)
-                return;
-
-            for (i32 i = idx; i < atlas->nnodes - 1; i++)
-                atlas->nodes[i] = atlas->nodes[i + 1];
-
-            atlas->nnodes--;
-        }
-
-        void atlas_expand(Atlas* atlas, const i32 w, const i32 h) {
-            // Insert node for empty space
-            if (w > atlas->width)
-                atlas_insert_node(atlas, atlas->nnodes, atlas->width, 0, w - atlas->width);
+        // Opens a shelf of height h at the top of the free part of a page. Returns
+        // the index of the shelf or -1 if the shelf array couldn't be grown.
+        i32 atlas_open_shelf(Atlas* atlas, const i32 page, const i32 h) {
+            if (atlas->nshelves + 1 > atlas->cshelves) {
+                const i32 cshelves = atlas->cshelves == 0 ? 8 : atlas->cshelves * 2;
+                const auto shelves = static_cast<AtlasShelf*>(
+                    std::realloc(atlas->shelves, sizeof(AtlasShelf) * static_cast<u64>(cshelves)));
+                if (shelves == nullptr)
+                    return -1;
 
-            atlas->width = w;
-            atlas->height = h;
-        }
+                atlas->shelves = shelves;
+                atlas->cshelves = cshelves;
+            }
 
-        void atlas_reset(Atlas* atlas, const i32 w, const i32 h) {
-            atlas->width = w;
-            atlas->height = h;
-            atlas->nnodes = 0;
+            AtlasShelf* shelf = &atlas->shelves[atlas->nshelves];
+            shelf->page = static_cast<i16>(page);
+            shelf->y = static_cast<i16>(atlas->pages[page].top);
+            shelf->height = static_cast<i16>(h);
+            shelf->x = 0;
+            shelf->last_used = 0;
+            atlas->pages[page].top += h;
 
-            // Init root node.
-            atlas->nodes[0].x = 0;
-            atlas->nodes[0].y = 0;
-            atlas->nodes[0].width = static_cast<i16>(w);
-            atlas->nnodes++;
+            return atlas->nshelves++;
         }
 
-        i32 atlas_add_skyline_level(Atlas* atlas, const i32 idx, const i32 x, const i32 y,
-                                    const i32 w, const i32 h) {
-            // Insert new node
-            if (atlas_insert_node(atlas, idx, x, y + h, w) == 0)
-                return 0;
-
-            // Delete skyline segments that fall under the shadow of the new segment.
-            for (i32 i = idx + 1; i < atlas->nnodes; ++i) {
-                if (atlas->nodes[i].x >= atlas->nodes[i - 1].x + atlas->nodes[i - 1].width)
-                    break;
-
-                const i32 shrink{ atlas->nodes[i - 1].x + atlas->nodes[i - 1].width -
-                                  atlas->nodes[i].x };
-
-                atlas->nodes[i].x += shrink;
-                atlas->nodes[i].width -= shrink;
-                if (atlas->nodes[i].width > 0)
-                    break;
-
-                atlas_remove_node(atlas, i);
-                --i;
-            }
-
-            // Merge same height skyline segments that are next to each other.
-            for (i32 i = 0; i < atlas->nnodes - 1; ++i) {
-                if (atlas->nodes[i].y == atlas->nodes[i + 1].y) {
-                    atlas->nodes[i].width += atlas->nodes[i + 1].width;
-                    atlas_remove_node(atlas, i + 1);
-                    --i;
+        // Drops the bitmaps of every glyph on a shelf, they're rasterized
+        // again (somewhere else) the next time they're drawn.
+        void evict_shelf(Context* font_ctx, const i32 index) {
+            Atlas* atlas = font_ctx->atlas;
+            AtlasShelf* shelf = &atlas->shelves[index];
+            for (i32 i = 0; i < font_ctx->nfonts; ++i) {
+                const Font* font = font_ctx->fonts[i];
+                for (i32 j = 0; j < font->nglyphs; ++j) {
+                    Glyph* glyph = &font->glyphs[j];
+                    if (glyph->shelf != index)
+                        continue;
+
+                    // Negative coordinate indicates there is no bitmap data created.
+                    glyph->x0 = -1;
+                    glyph->y0 = -1;
+                    glyph->shelf = -1;
+                    font_ctx->evicted_glyphs++;
                 }
             }
 
-            return 1;
+            // Clear the rows, the padding around the bitmaps
+            // rasterized into the shelf next has to be empty.
+            std::memset(&atlas->pages[shelf->page].data[shelf->y * atlas->width], 0,
+                        static_cast<u64>(shelf->height) * static_cast<u64>(atlas->width));
+            shelf->x = 0;
+            font_ctx->evicted_shelves++;
+            font_ctx->generation++;
         }
 
-        i32 atlas_rect_fits(const Atlas* atlas, i32 i, const i32 w, const i32 h) {
-            // Checks if there is enough space at the location of skyline span 'i',
-            // and return the max height of all skyline spans under that at that location,
-            // (think tetris block being dropped at that position). Or -1 if no space found.
-            const i32 x = atlas->nodes[i].x;
-            i32 y = atlas->nodes[i].y;
-            if (x + w > atlas->width)
-                return -1;
-
-            i32 space_left = w;
-            while (space_left > 0) {
-                if (i == atlas->nnodes)
-                    return -1;
+        // Finds room for a rw by rh bitmap. In order of preference it goes on an open shelf of a
+        // similar height, on a new shelf, on a new page or on the least recently used shelf that
+        // hasn't been drawn from this frame, which is evicted (unless evict is false).
+        i32 atlas_add_rect(Context* font_ctx, const i32 rw, const i32 rh, const bool evict,
+                           i32* page, i32* shelf, i32* rx, i32* ry) {
+            Atlas* atlas = font_ctx->atlas;
+            if (rw > atlas->width || rh > atlas->height)
+                return 0;
 
-                y = math::max(y, atlas->nodes[i].y);
-                if (y + h > atlas->height)
-                    return -1;
+            // Shelf heights are rounded up so glyphs of close sizes share them.
+            const i32 sh = math::min((rh + 7) & ~7, atlas->height);
 
-                space_left -= atlas->nodes[i].width;
-                ++i;
+            i32 best = -1;
+            for (i32 i = 0; i < atlas->nshelves; ++i) {
+                const AtlasShelf& s = atlas->shelves[i];
+                if (s.height < rh || s.height > sh + sh / 2 || s.x + rw > atlas->width)
+                    continue;
+                if (best == -1 || s.height < atlas->shelves[best].height)
+                    best = i;
             }
 
-            return y;
-        }
+            for (i32 i = 0; best == -1 && i < atlas->npages; ++i)
+                if (atlas->pages[i].top + sh <= atlas->height)
+                    best = atlas_open_shelf(atlas, i, sh);
 
-        i32 atlas_add_rect(Atlas* atlas, const i32 rw, const i32 rh, i32* rx, i32* ry) {
-            i32 besth = atlas->height, bestw = atlas->width, besti = -1;
-            i32 bestx = -1, besty = -1;
+            if (best == -1 && atlas_add_page(atlas) != 0)
+                best = atlas_open_shelf(atlas, atlas->npages - 1, sh);
 
-            // Bottom left fit heuristic.
-            for (i32 i = 0; i < atlas->nnodes; i++) {
-                const i32 y = atlas_rect_fits(atlas, i, rw, rh);
-                if (y != -1) {
-                    if (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw)) {
-                        besti = i;
-                        bestw = atlas->nodes[i].width;
-                        besth = y + rh;
-                        bestx = atlas->nodes[i].x;
-                        besty = y;
-                    }
+            if (best == -1) {
+                if (!evict)
+                    return 0;
+                for (i32 i = 0; i < atlas->nshelves; ++i) {
+                    const AtlasShelf& s = atlas->shelves[i];
+                    if (s.height < rh || s.last_used >= font_ctx->frame)
+                        continue;
+                    if (best == -1 || s.last_used < atlas->shelves[best].last_used ||
+                        (s.last_used == atlas->shelves[best].last_used &&
+                         s.height < atlas->shelves[best].height))
+                        best = i;
                 }
-            }
 
-            if (besti == -1)
-                return 0;
+                if (best == -1)
+                    return 0;
 
-            // Perform the actual packing.
-            if (atlas_add_skyline_level(atlas, besti, bestx, besty, rw, rh) == 0)
-                return 0;
+                evict_shelf(font_ctx, best);
+            }
 
-            *rx = bestx;
-            *ry = besty;
+            AtlasShelf* s = &atlas->shelves[best];
+            *page = s->page;
+            *shelf = best;
+            *rx = s->x;
+            *ry = s->y;
+            s->x = static_cast<i16>(s->x + rw);
 
             return 1;
         }
 
         void add_white_rect(Context* font_ctx, const i32 w, const i32 h) {
-            i32 gx, gy;
-            if (atlas_add_rect(font_ctx->atlas, w, h, &gx, &gy) == 0)
+            i32 page, shelf, gx, gy;
+            if (atlas_add_rect(font_ctx, w, h, true, &page, &shelf, &gx, &gy) == 0)
                 return;
 
+            // Never evicted.
+            font_ctx->atlas->shelves[shelf].last_used = std::numeric_limits<u32>::max();
+
             // Rasterize
-            u8* dst = &font_ctx->tex_data[gx + gy * font_ctx->params.width];
+            AtlasPage* dst_page = &font_ctx->atlas->pages[page];
+            u8* dst = &dst_page->data[gx + gy * font_ctx->params.width];
             for (i32 y = 0; y < h; y++) {
                 for (i32 x = 0; x < w; x++)
                     dst[x] = 0xff;
                 dst += font_ctx->params.width;
             }
 
-            font_ctx->dirty_rect[0] = std::min(font_ctx->dirty_rect[0], gx);
-            font_ctx->dirty_rect[1] = std::min(font_ctx->dirty_rect[1], gy);
-            font_ctx->dirty_rect[2] = math::max(font_ctx->dirty_rect[2], gx + w);
-            font_ctx->dirty_rect[3] = math::max(font_ctx->dirty_rect[3], gy + h);
+            mark_dirty(dst_page, gx, gy, gx + w, gy + h);
         }
 
         font::State* get_state(Context* font_ctx) {
@@ -395,80 +592,312 @@ namespace rl::nvg::font {
             return &font->glyphs[font->nglyphs - 1];
         }
 
-        Glyph* get_glyph(Context* font_ctx, Font* font, const u32 codepoint, const i16 isize,
-                         i16 iblur, const i32 bitmap_option) {
+        u32 glyph_hash(const u32 codepoint, const i16 isize, const i16 iblur) {
+            const u32 params{ static_cast<u32>(static_cast<u16>(isize)) << 16 |
+                              static_cast<u16>(iblur) };
+            return hashint(codepoint ^ hashint(params));
+        }
+
+        u8 glyph_tag(const u32 hash) {
+            return static_cast<u8>(0x80u | (hash >> 25));
+        }
+
+        // Bit i of the result is set if the i-th of the GLYPH_GROUP_SIZE tags starting at tags
+        // is equal to tag.
+        u32 match_tags(const u8* tags, const u8 tag) {
+#if FONS_SIMD_SSE2
+            const __m128i group{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags)) };
+            const __m128i eq{ _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag))) };
+            return static_cast<u32>(_mm_movemask_epi8(eq));
+#else
+            u32 mask{ 0 };
+            for (i32 i = 0; i < GLYPH_GROUP_SIZE; ++i)
+                mask |= static_cast<u32>(tags[i] == tag) << i;
+            return mask;
+#endif
+        }
+
+        // Returns the slot holding the glyph with the given key, or the empty slot it would be
+        // inserted in. The load factor is kept below 7/8 so there always is an empty slot.
+        i32 find_glyph_slot(const GlyphTable& table, const Glyph* glyphs, const u32 hash,
+                            const u32 codepoint, const i16 isize, const i16 iblur) {
+            const i32 group_mask{ table.capacity / GLYPH_GROUP_SIZE - 1 };
+            const u8 tag{ glyph_tag(hash) };
+            i32 group{ static_cast<i32>(hash) & group_mask };
+            for (i32 step = 1;; ++step) {
+                const u8* tags{ table.tags + group * GLYPH_GROUP_SIZE };
+                for (u32 match = match_tags(tags, tag); match != 0; match &= match - 1) {
+                    const i32 slot{ group * GLYPH_GROUP_SIZE + std::countr_zero(match) };
+                    const Glyph& glyph{ glyphs[table.slots[slot]] };
+                    if (glyph.codepoint == codepoint && glyph.size == isize && glyph.blur == iblur)
+                        return slot;
+                }
+
+                const u32 empty{ match_tags(tags, 0) };
+                if (empty != 0)
+                    return group * GLYPH_GROUP_SIZE + std::countr_zero(empty);
+
+                // Triangular probing, visits every group of a power of two table.
+                group = (group + step) & group_mask;
+            }
+        }
+
+        // Grows the glyph table so it can hold count glyphs, rehashing the cached ones.
+        i32 reserve_glyph_table(Font* font, const i32 count) {
+            GlyphTable& table = font->table;
+            if (count * 8 <= table.capacity * 7)
+                return 1;
+
+            i32 capacity = table.capacity < GLYPH_GROUP_SIZE ? GLYPH_GROUP_SIZE : table.capacity;
+            while (count * 8 > capacity * 7)
+                capacity *= 2;
+
+            const auto tags = static_cast<u8*>(std::malloc(capacity));
+            const auto slots = static_cast<i32*>(std::malloc(sizeof(i32) * capacity));
+            if (tags == nullptr || slots == nullptr) {
+                std::free(tags);
+                std::free(slots);
+                return 0;
+            }
+
+            std::free(table.tags);
+            std::free(table.slots);
+            std::memset(tags, 0, capacity);
+            table.tags = tags;
+            table.slots = slots;
+            table.capacity = capacity;
+
+            // Every glyph is in the table, so they can be reinserted straight from the array.
+            for (i32 i = 0; i < font->nglyphs; ++i) {
+                const Glyph& glyph = font->glyphs[i];
+                const u32 hash = glyph_hash(glyph.codepoint, glyph.size, glyph.blur);
+                const i32 slot = find_glyph_slot(table, font->glyphs, hash, glyph.codepoint,
+                                                 glyph.size, glyph.blur);
+                table.tags[slot] = glyph_tag(hash);
+                table.slots[slot] = i;
+            }
+
+            return 1;
+        }
+
+        void clear_glyphs(Font* font) {
+            font->nglyphs = 0;
+            font->table.count = 0;
+            if (font->table.tags != nullptr)
+                std::memset(font->table.tags, 0, font->table.capacity);
+        }
+
+        // Clamps the size and blur a glyph is cached with. Distance field
+        // glyphs are the same for every size and blur, see get_quad().
+        void glyph_key(const u8 flags, i16* isize, i16* iblur) {
+            if ((flags & FonsSdf) != 0) {
+                *isize = SDF_SIZE * 10;
+                *iblur = 0;
+            }
+            if (*iblur > 20)
+                *iblur = 20;
+        }
+
+        // Glyph index, metrics and padded bitmap size of a codepoint. Only the font data is
+        // read, so glyphs can be measured and rasterized on any thread, see stage_glyph().
+        struct GlyphBox {
+            // font the glyph is rasterized from, the requested one or a fallback
+            const STTFontImpl* font;
+            i32 index;
+            f32 scale;
+            i32 pad;
+            i32 width;
+            i32 height;
+            i32 x_adv;
+            i32 x_off;
+            i32 y_off;
+        };
+
+        // Glyph index of a codepoint in the font or, if it doesn't have it,
+        // the first fallback that does. found is set to the font it's in.
+        i32 find_glyph(const STTFontImpl* font, const STTFontImpl* const* fallbacks,
+                       const i32 nfallbacks, const u32 codepoint, const STTFontImpl** found) {
+            *found = font;
+            const i32 index = tt_get_glyph_index(font, static_cast<i32>(codepoint));
+            if (index != 0)
+                return index;
+
+            // Try to find the glyph in fallback fonts.
+            for (i32 i = 0; i < nfallbacks; ++i) {
+                const i32 fallback_index = tt_get_glyph_index(fallbacks[i],
+                                                              static_cast<i32>(codepoint));
+                if (fallback_index != 0) {
+                    *found = fallbacks[i];
+                    return fallback_index;
+                }
+            }
+
+            // It is possible that we did not find a fallback glyph.
+            // In that case the glyph index is 0, and the empty glyph is used.
+            return 0;
+        }
+
+        GlyphBox glyph_box(const STTFontImpl* font, const STTFontImpl* const* fallbacks,
+                           const i32 nfallbacks, const u32 codepoint, const i16 isize,
+                           const i16 iblur, const u8 flags) {
+            GlyphBox box{};
+            box.index = find_glyph(font, fallbacks, nfallbacks, codepoint, &box.font);
+
             i32 advance;
-            i32 lsb;
             i32 x0;
             i32 y0;
             i32 x1;
             i32 y1;
+            const f32 size = static_cast<f32>(isize) / 10.0f;
+            box.scale = tt_get_pixel_height_scale(box.font, size);
+            tt_build_glyph_bitmap(box.font, box.index, size, box.scale, &advance, &x0, &y0, &x1,
+                                  &y1);
+
+            // The distance field already fades out towards the edges of its
+            // padding, it only needs the one pixel empty border.
+            box.pad = (flags & FonsSdf) != 0 ? SDF_PADDING + 1 : iblur + 2;
+            box.width = x1 - x0 + box.pad * 2;
+            box.height = y1 - y0 + box.pad * 2;
+            box.x_adv = static_cast<i32>(box.scale * static_cast<f32>(advance) * 10.0f);
+            box.x_off = x0 - box.pad;
+            box.y_off = y0 - box.pad;
+            return box;
+        }
+
+        // Rasterizes a glyph into dst, the top left corner of its padded bitmap.
+        void rasterize_glyph(const GlyphBox& box, u8* dst, const i32 stride, const i16 iblur,
+                             const u8 flags) {
+            if ((flags & FonsSdf) != 0) {
+                u8* field = &dst[1 + stride];
+                for (i32 y = 0; y < box.height - 2; ++y)
+                    std::memset(&field[y * stride], 0, static_cast<u64>(box.width - 2));
+                tt_render_glyph_sdf(box.font, field, stride, box.scale, SDF_PADDING, box.index);
+            }
+            else {
+                tt_render_glyph_bitmap(box.font, &dst[box.pad + box.pad * stride],
+                                       box.width - box.pad * 2, box.height - box.pad * 2, stride,
+                                       box.scale, box.scale, box.index);
+            }
+
+            // Make sure there is one pixel empty border.
+            for (i32 y = 0; y < box.height; y++) {
+                dst[y * stride] = 0;
+                dst[box.width - 1 + y * stride] = 0;
+            }
+            for (i32 x = 0; x < box.width; x++) {
+                dst[x] = 0;
+                dst[x + (box.height - 1) * stride] = 0;
+            }
+
+            // Debug code to color the glyph background
+            /*
+            for (y = 0; y < box.height; y++) {
+                for (x = 0; x < box.width; x++) {
+                    i32 a = (i32)dst[x+y*stride] + 20;
+                    if (a > 255) a = 255;
+                    dst[x+y*stride] = a;
+                }
+            }
+            */
+
+            // Blur
+            if (iblur > 0)
+                blur(nullptr, dst, box.width, box.height, stride, iblur);
+        }
+
+        // Adds a glyph to a font's cache, without a bitmap in the atlas yet.
+        Glyph* insert_glyph(Font* font, const u32 hash, const u32 codepoint, const i16 isize,
+                            const i16 iblur) {
+            // The slot is looked up since growing the table rehashes it.
+            if (reserve_glyph_table(font, font->table.count + 1) == 0)
+                return nullptr;
+            const i32 slot = find_glyph_slot(font->table, font->glyphs, hash, codepoint, isize,
+                                             iblur);
+
+            Glyph* glyph = alloc_glyph(font);
+            if (glyph == nullptr)
+                return nullptr;
+
+            glyph->codepoint = codepoint;
+            glyph->size = isize;
+            glyph->blur = iblur;
+
+            // Insert char to hash lookup.
+            font->table.tags[slot] = glyph_tag(hash);
+            font->table.slots[slot] = font->nglyphs - 1;
+            font->table.count++;
+            return glyph;
+        }
+
+        // Sets a glyph's metrics and where its bitmap is, a negative x and y
+        // mean there's no bitmap data created.
+        void place_glyph(Glyph* glyph, const i32 index, const i32 width, const i32 height,
+                         const i32 x_adv, const i32 x_off, const i32 y_off, const i32 page,
+                         const i32 shelf, const i32 x, const i32 y) {
+            glyph->index = index;
+            glyph->page = static_cast<i16>(page);
+            glyph->shelf = static_cast<i16>(shelf);
+            glyph->x0 = static_cast<i16>(x);
+            glyph->y0 = static_cast<i16>(y);
+            glyph->x1 = static_cast<i16>(x + width);
+            glyph->y1 = static_cast<i16>(y + height);
+            glyph->x_adv = static_cast<i16>(x_adv);
+            glyph->x_off = static_cast<i16>(x_off);
+            glyph->y_off = static_cast<i16>(y_off);
+        }
+
+        Glyph* get_glyph(Context* font_ctx, Font* font, const u32 codepoint, i16 isize,
+                         i16 iblur, const i32 bitmap_option) {
             i32 gx;
             i32 gy;
+            i32 gpage = 0;
+            i32 gshelf = -1;
             Glyph* glyph = nullptr;
-            const f32 size = static_cast<f32>(isize) / 10.0f;
-            const Font* render_font = font;
 
             if (isize < 2)
                 return nullptr;
-            if (iblur > 20)
-                iblur = 20;
-            const i32 pad = iblur + 2;
+            glyph_key(font_ctx->params.flags, &isize, &iblur);
 
             // Reset allocator.
             font_ctx->nscratch = 0;
 
             // Find code point and size.
-            const u32 h = hashint(codepoint) & (HASH_LUT_SIZE - 1);
-            i32 i = font->lut[h];
-            while (i != -1) {
-                if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize &&
-                    font->glyphs[i].blur == iblur) {
-                    glyph = &font->glyphs[i];
-                    if (bitmap_option == FonsGlyphBitmapOptional ||
-                        (glyph->x0 >= 0 && glyph->y0 >= 0))
-                        return glyph;
-                    // At this point, glyph exists but the bitmap data is not yet created.
-                    break;
+            const u32 hash = glyph_hash(codepoint, isize, iblur);
+            const i32 cached = find_glyph_slot(font->table, font->glyphs, hash, codepoint, isize,
+                                               iblur);
+            if (font->table.tags[cached] != 0) {
+                glyph = &font->glyphs[font->table.slots[cached]];
+                if (bitmap_option == FonsGlyphBitmapOptional)
+                    return glyph;
+                if (glyph->x0 >= 0 && glyph->y0 >= 0) {
+                    touch_shelf(font_ctx, glyph->shelf);
+                    return glyph;
                 }
-                i = font->glyphs[i].next;
+                // At this point, glyph exists but the bitmap data is not yet created.
             }
 
             // Create a new glyph or rasterize bitmap data for a cached glyph.
-            i32 g = tt_get_glyph_index(&font->font, static_cast<i32>(codepoint));
-            // Try to find the glyph in fallback fonts.
-            if (g == 0) {
-                for (i = 0; i < font->nfallbacks; ++i) {
-                    const Font* fallbackFont = font_ctx->fonts[font->fallbacks[i]];
-                    const i32 fallback_index = tt_get_glyph_index(&fallbackFont->font,
-                                                                  static_cast<i32>(codepoint));
-                    if (fallback_index != 0) {
-                        g = fallback_index;
-                        render_font = fallbackFont;
-                        break;
-                    }
-                }
-                // It is possible that we did not find a fallback glyph.
-                // In that case the glyph index 'g' is 0, and we'll proceed below and cache empty
-                // glyph.
-            }
-            const f32 scale = tt_get_pixel_height_scale(&render_font->font, size);
-            tt_build_glyph_bitmap(&render_font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1,
-                                  &y1);
-            const i32 gw = x1 - x0 + pad * 2;
-            const i32 gh = y1 - y0 + pad * 2;
+            const STTFontImpl* fallbacks[MAX_FALLBACKS];
+            for (i32 i = 0; i < font->nfallbacks; ++i)
+                fallbacks[i] = &font_ctx->fonts[font->fallbacks[i]]->font;
+            const GlyphBox box = glyph_box(&font->font, fallbacks, font->nfallbacks, codepoint,
+                                           isize, iblur, font_ctx->params.flags);
 
             // Determines the spot to draw glyph in the atlas.
             if (bitmap_option == FonsGlyphBitmapRequired) {
                 // Find free spot for the rect in the atlas
-                i32 added = atlas_add_rect(font_ctx->atlas, gw, gh, &gx, &gy);
+                i32 added = atlas_add_rect(font_ctx, box.width, box.height, true, &gpage,
+                                           &gshelf, &gx, &gy);
                 if (added == 0 && font_ctx->handle_error != nullptr) {
-                    // Atlas is full, let the user to resize the atlas (or not), and try again.
+                    // Every page is full of glyphs drawn this frame, let the user reset the
+                    // atlas (or not), and try again.
                     font_ctx->handle_error(font_ctx->error_uptr, ErrorCode::FonsAtlasFull, 0);
-                    added = atlas_add_rect(font_ctx->atlas, gw, gh, &gx, &gy);
+                    added = atlas_add_rect(font_ctx, box.width, box.height, true, &gpage,
+                                           &gshelf, &gx, &gy);
                 }
                 if (added == 0)
                     return nullptr;
+                touch_shelf(font_ctx, gshelf);
             }
             else {
                 // Negative coordinate indicates there is no bitmap data created.
@@ -476,101 +905,60 @@ namespace rl::nvg::font {
                 gy = -1;
             }
 
-            // Init glyph.
-            if (glyph == nullptr) {
-                glyph = alloc_glyph(font);
-                glyph->codepoint = codepoint;
-                glyph->size = isize;
-                glyph->blur = iblur;
-                glyph->next = 0;
-
-                // Insert char to hash lookup.
-                glyph->next = font->lut[h];
-                font->lut[h] = font->nglyphs - 1;
+            // Init glyph. The atlas full callback above may have reset the glyphs.
+            if (glyph == nullptr || font->nglyphs == 0) {
+                glyph = insert_glyph(font, hash, codepoint, isize, iblur);
+                if (glyph == nullptr)
+                    return nullptr;
             }
-            glyph->index = g;
-            glyph->x0 = static_cast<i16>(gx);
-            glyph->y0 = static_cast<i16>(gy);
-            glyph->x1 = static_cast<i16>(glyph->x0 + gw);
-            glyph->y1 = static_cast<i16>(glyph->y0 + gh);
-            glyph->x_adv = static_cast<i16>(scale * static_cast<f32>(advance) * 10.0f);
-            glyph->x_off = static_cast<i16>(x0 - pad);
-            glyph->y_off = static_cast<i16>(y0 - pad);
+            place_glyph(glyph, box.index, box.width, box.height, box.x_adv, box.x_off, box.y_off,
+                        gpage, gshelf, gx, gy);
 
             if (bitmap_option == FonsGlyphBitmapOptional)
                 return glyph;
 
             // Rasterize
-            u8* dst = &font_ctx->tex_data[(glyph->x0 + pad) +
-                                          (glyph->y0 + pad) * font_ctx->params.width];
-            tt_render_glyph_bitmap(&render_font->font, dst, gw - pad * 2, gh - pad * 2,
-                                   font_ctx->params.width, scale, scale, g);
-
-            // Make sure there is one pixel empty border.
-            dst = &font_ctx->tex_data[glyph->x0 + glyph->y0 * font_ctx->params.width];
-            for (i32 y = 0; y < gh; y++) {
-                dst[y * font_ctx->params.width] = 0;
-                dst[gw - 1 + y * font_ctx->params.width] = 0;
-            }
-            for (i32 x = 0; x < gw; x++) {
-                dst[x] = 0;
-                dst[x + (gh - 1) * font_ctx->params.width] = 0;
-            }
-
-            // Debug code to color the glyph background
-            /*
-            u8* fdst = &font_ctx->texData[glyph->x0 + glyph->y0 * font_ctx->params.width];
-            for (y = 0; y < gh; y++) {
-                for (x = 0; x < gw; x++) {
-                    i32 a = (i32)fdst[x+y*font_ctx->params.width] + 20;
-                    if (a > 255) a = 255;
-                    fdst[x+y*font_ctx->params.width] = a;
-                }
-            }
-            */
-
-            // Blur
-            if (iblur > 0) {
-                font_ctx->nscratch = 0;
-                u8* bdst = &font_ctx->tex_data[glyph->x0 + glyph->y0 * font_ctx->params.width];
-                blur(font_ctx, bdst, gw, gh, font_ctx->params.width, iblur);
-            }
-
-            font_ctx->dirty_rect[0] = math::min(font_ctx->dirty_rect[0], glyph->x0);
-            font_ctx->dirty_rect[1] = math::min(font_ctx->dirty_rect[1], glyph->y0);
-            font_ctx->dirty_rect[2] = math::max(font_ctx->dirty_rect[2], glyph->x1);
-            font_ctx->dirty_rect[3] = math::max(font_ctx->dirty_rect[3], glyph->y1);
+            AtlasPage* page = &font_ctx->atlas->pages[glyph->page];
+            rasterize_glyph(box, &page->data[glyph->x0 + glyph->y0 * font_ctx->params.width],
+                            font_ctx->params.width, iblur, font_ctx->params.flags);
+            mark_dirty(page, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
 
             return glyph;
         }
 
         void get_quad(const Context* font_ctx, const Font* font, const i32 prev_glyph_index,
-                      const Glyph* glyph, const f32 scale, const f32 spacing, f32* x, const f32* y,
-                      FontQuad* q) {
+                      const Glyph* glyph, const i16 isize, const f32 scale, const f32 spacing,
+                      f32* x, const f32* y, FontQuad* q) {
+            // Distance field glyphs are baked at SDF_SIZE and scaled to the requested size,
+            // their positions aren't snapped to whole pixels so text zooms smoothly.
+            const bool sdf = (font_ctx->params.flags & FonsSdf) != 0;
+            const f32 k = sdf ? static_cast<f32>(isize) / static_cast<f32>(glyph->size) : 1.0f;
+            const auto snap = [sdf](const f32 v) { return sdf ? v : std::floor(v); };
+
             if (prev_glyph_index != -1) {
                 const f32 adv{ scale * static_cast<f32>(tt_get_glyph_kern_advance(
                                            &font->font, prev_glyph_index, glyph->index)) };
-                *x += std::round(adv + spacing);
+                *x += sdf ? adv + spacing : std::round(adv + spacing);
             }
 
             // Each glyph has 2px border to allow good interpolation,
             // one pixel to prevent leaking, and one to allow good interpolation for rendering.
             // Inset the texture region by one pixel for correct interpolation.
-            const f32 xoff = static_cast<i16>(glyph->x_off + 1);
-            const f32 yoff = static_cast<i16>(glyph->y_off + 1);
+            const f32 xoff = static_cast<f32>(glyph->x_off + 1) * k;
+            const f32 yoff = static_cast<f32>(glyph->y_off + 1) * k;
             const f32 x0 = static_cast<f32>(glyph->x0 + 1);
             const f32 y0 = static_cast<f32>(glyph->y0 + 1);
             const f32 x1 = static_cast<f32>(glyph->x1 - 1);
             const f32 y1 = static_cast<f32>(glyph->y1 - 1);
 
             if (font_ctx->params.flags & FonsZeroTopleft) {
-                f32 rx = std::floor(*x + xoff);
-                f32 ry = std::floor(*y + yoff);
+                f32 rx = snap(*x + xoff);
+                f32 ry = snap(*y + yoff);
 
                 q->x0 = rx;
                 q->y0 = ry;
-                q->x1 = rx + x1 - x0;
-                q->y1 = ry + y1 - y0;
+                q->x1 = rx + (x1 - x0) * k;
+                q->y1 = ry + (y1 - y0) * k;
 
                 q->s0 = x0 * font_ctx->itw;
                 q->t0 = y0 * font_ctx->ith;
@@ -578,13 +966,13 @@ namespace rl::nvg::font {
                 q->t1 = y1 * font_ctx->ith;
             }
             else {
-                f32 rx = std::floor(*x + xoff);
-                f32 ry = std::floor(*y - yoff);
+                f32 rx = snap(*x + xoff);
+                f32 ry = snap(*y - yoff);
 
                 q->x0 = rx;
                 q->y0 = ry;
-                q->x1 = rx + x1 - x0;
-                q->y1 = ry - y1 + y0;
+                q->x1 = rx + (x1 - x0) * k;
+                q->y1 = ry - (y1 - y0) * k;
 
                 q->s0 = x0 * font_ctx->itw;
                 q->t0 = y0 * font_ctx->ith;
@@ -592,21 +980,24 @@ namespace rl::nvg::font {
                 q->t1 = y1 * static_cast<f32>(font_ctx->ith);
             }
 
-            *x += std::round(static_cast<f32>(glyph->x_adv) / 10.0f);
+            q->page = glyph->page;
+            q->shelf = glyph->shelf;
+            const f32 advance = static_cast<f32>(glyph->x_adv) / 10.0f * k;
+            *x += sdf ? advance : std::round(advance);
         }
 
         void flush(Context* font_ctx) {
             // Flush texture
-            if (font_ctx->dirty_rect[0] < font_ctx->dirty_rect[2] &&
-                font_ctx->dirty_rect[1] < font_ctx->dirty_rect[3]) {
-                if (font_ctx->params.render_update != nullptr)
-                    font_ctx->params.render_update(font_ctx->params.user_ptr, font_ctx->dirty_rect,
-                                                   font_ctx->tex_data);
-                // Reset dirty rect
-                font_ctx->dirty_rect[0] = font_ctx->params.width;
-                font_ctx->dirty_rect[1] = font_ctx->params.height;
-                font_ctx->dirty_rect[2] = 0;
-                font_ctx->dirty_rect[3] = 0;
+            for (i32 i = 0; i < font_ctx->atlas->npages; ++i) {
+                AtlasPage* page = &font_ctx->atlas->pages[i];
+                if (page->dirty_rect[0] < page->dirty_rect[2] &&
+                    page->dirty_rect[1] < page->dirty_rect[3]) {
+                    if (font_ctx->params.render_update != nullptr)
+                        font_ctx->params.render_update(font_ctx->params.user_ptr, i,
+                                                       page->dirty_rect, page->data);
+                    // Reset dirty rect
+                    reset_dirty_rect(page, font_ctx->params.width, font_ctx->params.height);
+                }
             }
 
             // Flush triangles
@@ -658,8 +1049,13 @@ namespace rl::nvg::font {
             if (font == nullptr)
                 return;
 
+            free_font_tables(&font->font.tables);
             if (font->glyphs)
                 std::free(font->glyphs);
+            if (font->table.tags)
+                std::free(font->table.tags);
+            if (font->table.slots)
+                std::free(font->table.slots);
             if (font->free_data && font->data)
                 std::free(font->data);
 
@@ -682,7 +1078,7 @@ namespace rl::nvg::font {
 
                 font->glyphs = static_cast<Glyph*>(std::malloc(sizeof(Glyph) * INIT_GLYPHS));
 
-                if (font->glyphs != nullptr) {
+                if (font->glyphs != nullptr && reserve_glyph_table(font, INIT_GLYPHS) != 0) {
                     font->cglyphs = INIT_GLYPHS;
                     font->nglyphs = 0;
 
@@ -712,7 +1108,7 @@ namespace rl::nvg::font {
                     font_ctx->params.render_create(font_ctx->params.user_ptr, font_ctx->params.width,
                                                    font_ctx->params.height) != 0) {
                     font_ctx->atlas = alloc_atlas(font_ctx->params.width, font_ctx->params.height,
-                                                  INIT_ATLAS_NODES);
+                                                  INIT_ATLAS_SHELVES);
                     if (font_ctx->atlas != nullptr) {
                         // Allocate space for fonts.
                         font_ctx->fonts = static_cast<Font**>(
@@ -723,21 +1119,12 @@ namespace rl::nvg::font {
                             font_ctx->cfonts = INIT_FONTS;
                             font_ctx->nfonts = 0;
 
-                            // Create texture for the cache.
+                            // Create the first page of the cache.
                             font_ctx->itw = 1.0f / static_cast<f32>(font_ctx->params.width);
                             font_ctx->ith = 1.0f / static_cast<f32>(font_ctx->params.height);
-                            font_ctx->tex_data = static_cast<u8*>(
-                                std::malloc(font_ctx->params.width * font_ctx->params.height));
-
-                            if (font_ctx->tex_data != nullptr) {
-                                std::memset(font_ctx->tex_data, 0,
-                                            font_ctx->params.width * font_ctx->params.height);
-
-                                font_ctx->dirty_rect[0] = font_ctx->params.width;
-                                font_ctx->dirty_rect[1] = font_ctx->params.height;
-                                font_ctx->dirty_rect[2] = 0;
-                                font_ctx->dirty_rect[3] = 0;
+                            font_ctx->frame = 1;
 
+                            if (atlas_add_page(font_ctx->atlas) != 0) {
                                 // Add white rect at 0,0 for debug drawing.
                                 add_white_rect(font_ctx, 2, 2);
                                 push_state(font_ctx);
@@ -758,6 +1145,7 @@ namespace rl::nvg::font {
         Font* base_font = font_ctx->fonts[base];
         if (base_font->nfallbacks < MAX_FALLBACKS) {
             base_font->fallbacks[base_font->nfallbacks++] = fallback;
+            base_font->generation++;
             return 1;
         }
         return 0;
@@ -766,9 +1154,8 @@ namespace rl::nvg::font {
     void reset_fallback_font(const Context* font_ctx, const i32 base) {
         Font* base_font = font_ctx->fonts[base];
         base_font->nfallbacks = 0;
-        base_font->nglyphs = 0;
-        for (i32& i : base_font->lut)
-            i = -1;
+        base_font->generation++;
+        clear_glyphs(base_font);
     }
 
     void set_size(Context* font_ctx, const f32 size) {
@@ -878,10 +1265,6 @@ namespace rl::nvg::font {
         std::strncpy(font->name, name, sizeof(font->name));
         font->name[sizeof(font->name) - 1] = '\0';
 
-        // Init hash lookup.
-        for (i32& i : font->lut)
-            i = -1;
-
         // Read in the font data.
         font->data_size = data_size;
         font->data = data;
@@ -890,6 +1273,8 @@ namespace rl::nvg::font {
         // Init font
         font_ctx->nscratch = 0;
         if (tt_load_font(font_ctx, &font->font, data, data_size, font_index)) {
+            build_font_tables(&font->font);
+
             // Store normalized line height. The real line height is got
             // by multiplying the lineh by font size.
             tt_get_font_v_metrics(&font->font, &ascent, &descent, &line_gap);
@@ -917,8 +1302,6 @@ namespace rl::nvg::font {
 
     f32 draw_text(Context* font_ctx, f32 x, f32 y, const char* str, const char* end) {
         const font::State* state = get_state(font_ctx);
-        u32 codepoint;
-        u32 utf8_state = 0;
         FontQuad q;
         i32 prev_glyph_index = -1;
         const i16 isize = static_cast<i16>(state->size * 10.0f);
@@ -956,27 +1339,34 @@ namespace rl::nvg::font {
         // Align vertically.
         y += get_vert_align(font_ctx, font, state->align, isize);
 
-        for (; str != end; ++str) {
-            if (decutf8(&utf8_state, &codepoint, *reinterpret_cast<const u8*>(str)))
-                continue;
-
-            const Glyph* glyph = get_glyph(font_ctx, font, codepoint, isize, iblur,
-                                           FonsGlyphBitmapRequired);
-            if (glyph != nullptr) {
-                get_quad(font_ctx, font, prev_glyph_index, glyph, scale, state->spacing, &x, &y, &q);
-                if (font_ctx->nverts + 6 > VERTEX_COUNT)
-                    flush(font_ctx);
-
-                vertex(font_ctx, q.x0, q.y0, q.s0, q.t0, state->color);
-                vertex(font_ctx, q.x1, q.y1, q.s1, q.t1, state->color);
-                vertex(font_ctx, q.x1, q.y0, q.s1, q.t0, state->color);
+        // malformed text is cut off at the first bad byte, what's left is decoded a
+        // batch at a time
+        end = utf8::simd::valid_prefix(str, end);
+        u32 codepoints[TEXT_ITER_BATCH];
+        while (str < end) {
+            const u32 ncodepoints{ utf8::simd::decode(str, end, codepoints, nullptr,
+                                                      TEXT_ITER_BATCH, &str) };
+            for (u32 i = 0; i < ncodepoints; ++i) {
+                const u32 codepoint{ codepoints[i] };
+                const Glyph* glyph = get_glyph(font_ctx, font, codepoint, isize, iblur,
+                                               FonsGlyphBitmapRequired);
+                if (glyph != nullptr) {
+                    get_quad(font_ctx, font, prev_glyph_index, glyph, isize, scale,
+                             state->spacing, &x, &y, &q);
+                    if (font_ctx->nverts + 6 > VERTEX_COUNT)
+                        flush(font_ctx);
+
+                    vertex(font_ctx, q.x0, q.y0, q.s0, q.t0, state->color);
+                    vertex(font_ctx, q.x1, q.y1, q.s1, q.t1, state->color);
+                    vertex(font_ctx, q.x1, q.y0, q.s1, q.t0, state->color);
+
+                    vertex(font_ctx, q.x0, q.y0, q.s0, q.t0, state->color);
+                    vertex(font_ctx, q.x0, q.y1, q.s0, q.t1, state->color);
+                    vertex(font_ctx, q.x1, q.y1, q.s1, q.t1, state->color);
+                }
 
-                vertex(font_ctx, q.x0, q.y0, q.s0, q.t0, state->color);
-                vertex(font_ctx, q.x0, q.y1, q.s0, q.t1, state->color);
-                vertex(font_ctx, q.x1, q.y1, q.s1, q.t1, state->color);
+                prev_glyph_index = glyph != nullptr ? glyph->index : -1;
             }
-
-            prev_glyph_index = glyph != nullptr ? glyph->index : -1;
         }
 
         flush(font_ctx);
@@ -1027,7 +1417,8 @@ namespace rl::nvg::font {
         iter->spacing = state->spacing;
         iter->str = str;
         iter->next = str;
-        iter->end = end;
+        // malformed text is cut off at the first bad byte, so it can be decoded unchecked
+        iter->end = utf8::simd::valid_prefix(str, end);
         iter->codepoint = 0;
         iter->prev_glyph_index = -1;
         iter->bitmap_option = bitmap_option;
@@ -1035,31 +1426,32 @@ namespace rl::nvg::font {
     }
 
     i32 text_iter_next(Context* font_ctx, TextIter* iter, FontQuad* quad) {
-        const char* str = iter->next;
         iter->str = iter->next;
-
-        if (str == iter->end)
+        if (iter->str == iter->end)
             return 0;
 
-        for (; str != iter->end; str++) {
-            if (decutf8(&iter->utf8_state, &iter->codepoint, *reinterpret_cast<const u8*>(str)))
-                continue;
-
-            str++;
-            // Get glyph and quad
-            iter->x = iter->nextx;
-            iter->y = iter->nexty;
-            const Glyph* glyph = get_glyph(font_ctx, iter->font, iter->codepoint, iter->isize,
-                                           iter->iblur, iter->bitmap_option);
-            // If the iterator was initialized with GLYPH_BITMAP_OPTIONAL, then the UV
-            // coordinates of the quad will be invalid.
-            if (glyph != nullptr)
-                get_quad(font_ctx, iter->font, iter->prev_glyph_index, glyph, iter->scale,
-                         iter->spacing, &iter->nextx, &iter->nexty, quad);
-            iter->prev_glyph_index = glyph != nullptr ? glyph->index : -1;
-            break;
+        // the next batch of codepoints is decoded once the last one is used up
+        if (iter->icodepoint == iter->ncodepoints) {
+            iter->ncodepoints = static_cast<i32>(utf8::simd::decode(
+                iter->str, iter->end, iter->codepoints, iter->lengths, TEXT_ITER_BATCH));
+            iter->icodepoint = 0;
         }
-        iter->next = str;
+
+        iter->codepoint = iter->codepoints[iter->icodepoint];
+        iter->next = iter->str + iter->lengths[iter->icodepoint];
+        ++iter->icodepoint;
+
+        // Get glyph and quad
+        iter->x = iter->nextx;
+        iter->y = iter->nexty;
+        const Glyph* glyph = get_glyph(font_ctx, iter->font, iter->codepoint, iter->isize,
+                                       iter->iblur, iter->bitmap_option);
+        // If the iterator was initialized with GLYPH_BITMAP_OPTIONAL, then the UV
+        // coordinates of the quad will be invalid.
+        if (glyph != nullptr)
+            get_quad(font_ctx, iter->font, iter->prev_glyph_index, glyph, iter->isize,
+                     iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+        iter->prev_glyph_index = glyph != nullptr ? glyph->index : -1;
 
         return 1;
     }
@@ -1091,24 +1483,25 @@ namespace rl::nvg::font {
         vertex(font_ctx, x + 0, y + h, 0, 1, 0xffffffff);
         vertex(font_ctx, x + w, y + h, 1, 1, 0xffffffff);
 
-        // Drawbug draw atlas
-        for (i32 i = 0; i < font_ctx->atlas->nnodes; i++) {
-            const AtlasNode* n = &font_ctx->atlas->nodes[i];
+        // Drawbug draw atlas, the shelves of the first page
+        for (i32 i = 0; i < font_ctx->atlas->nshelves; i++) {
+            const AtlasShelf* n = &font_ctx->atlas->shelves[i];
+            if (n->page != 0)
+                continue;
 
             if (font_ctx->nverts + 6 > VERTEX_COUNT)
                 flush(font_ctx);
 
             const f32 nx = static_cast<f32>(n->x);
-            const f32 ny = static_cast<f32>(n->y);
-            const f32 nw = static_cast<f32>(n->width);
+            const f32 ny = static_cast<f32>(n->y + n->height);
 
-            vertex(font_ctx, x + nx + 0, y + ny + 0, u, v, 0xc00000ff);
-            vertex(font_ctx, x + nx + nw, y + ny + 1, u, v, 0xc00000ff);
-            vertex(font_ctx, x + nx + nw, y + ny + 0, u, v, 0xc00000ff);
+            vertex(font_ctx, x + 0, y + ny + 0, u, v, 0xc00000ff);
+            vertex(font_ctx, x + nx, y + ny + 1, u, v, 0xc00000ff);
+            vertex(font_ctx, x + nx, y + ny + 0, u, v, 0xc00000ff);
 
-            vertex(font_ctx, x + nx + 0, y + ny + 0, u, v, 0xc00000ff);
-            vertex(font_ctx, x + nx + 0, y + ny + 1, u, v, 0xc00000ff);
-            vertex(font_ctx, x + nx + nw, y + ny + 1, u, v, 0xc00000ff);
+            vertex(font_ctx, x + 0, y + ny + 0, u, v, 0xc00000ff);
+            vertex(font_ctx, x + 0, y + ny + 1, u, v, 0xc00000ff);
+            vertex(font_ctx, x + nx, y + ny + 1, u, v, 0xc00000ff);
         }
 
         flush(font_ctx);
@@ -1124,8 +1517,6 @@ namespace rl::nvg::font {
         f32 text_width{ 0.0f };
 
         const font::State* state = get_state(font_ctx);
-        u32 codepoint;
-        u32 utf8_state = 0;
         FontQuad q;
         i32 prev_glyph_index = -1;
         const i16 isize = static_cast<i16>(state->size * 10.0f);
@@ -1154,36 +1545,41 @@ namespace rl::nvg::font {
         if (end == nullptr)
             end = str + std::strlen(str);
 
-        for (; str < end; ++str) {
-            if (decutf8(&utf8_state, &codepoint, *reinterpret_cast<const u8*>(str)))
-                continue;
-
-            const Glyph* glyph = get_glyph(font_ctx, font, codepoint, isize, iblur,
-                                           FonsGlyphBitmapOptional);
-            if (glyph != nullptr) {
-                get_quad(font_ctx, font, prev_glyph_index, glyph, scale, state->spacing, &pos.x,
-                         &pos.y, &q);
-
-                if (q.x0 < minx)
-                    minx = q.x0;
-                if (q.x1 > maxx)
-                    maxx = q.x1;
-
-                if (font_ctx->params.flags & FonsZeroTopleft) {
-                    if (q.y0 < miny)
-                        miny = q.y0;
-                    if (q.y1 > maxy)
-                        maxy = q.y1;
-                }
-                else {
-                    if (q.y1 < miny)
-                        miny = q.y1;
-                    if (q.y0 > maxy)
-                        maxy = q.y0;
+        // decoded like in draw_text()
+        end = utf8::simd::valid_prefix(str, end);
+        u32 codepoints[TEXT_ITER_BATCH];
+        while (str < end) {
+            const u32 ncodepoints{ utf8::simd::decode(str, end, codepoints, nullptr,
+                                                      TEXT_ITER_BATCH, &str) };
+            for (u32 i = 0; i < ncodepoints; ++i) {
+                const u32 codepoint{ codepoints[i] };
+                const Glyph* glyph = get_glyph(font_ctx, font, codepoint, isize, iblur,
+                                               FonsGlyphBitmapOptional);
+                if (glyph != nullptr) {
+                    get_quad(font_ctx, font, prev_glyph_index, glyph, isize, scale, state->spacing,
+                             &pos.x, &pos.y, &q);
+
+                    if (q.x0 < minx)
+                        minx = q.x0;
+                    if (q.x1 > maxx)
+                        maxx = q.x1;
+
+                    if (font_ctx->params.flags & FonsZeroTopleft) {
+                        if (q.y0 < miny)
+                            miny = q.y0;
+                        if (q.y1 > maxy)
+                            maxy = q.y1;
+                    }
+                    else {
+                        if (q.y1 < miny)
+                            miny = q.y1;
+                        if (q.y0 > maxy)
+                            maxy = q.y0;
+                    }
                 }
-            }
 
-            prev_glyph_index = glyph != nullptr ? glyph->index : -1;
+                prev_glyph_index = glyph != nullptr ? glyph->index : -1;
+            }
         }
 
         text_width = pos.x - startx;
@@ -1263,27 +1659,32 @@ namespace rl::nvg::font {
         }
     }
 
-    const u8* get_texture_data(const Context* font_ctx, i32* width, i32* height) {
+    i32 atlas_page_count(const Context* font_ctx) {
+        return font_ctx->atlas->npages;
+    }
+
+    const u8* get_texture_data(const Context* font_ctx, const i32 page, i32* width, i32* height) {
         if (width != nullptr)
             *width = font_ctx->params.width;
         if (height != nullptr)
             *height = font_ctx->params.height;
 
-        return font_ctx->tex_data;
+        return page < font_ctx->atlas->npages ? font_ctx->atlas->pages[page].data : nullptr;
     }
 
-    i32 validate_texture(Context* font_ctx, i32* dirty) {
-        if (font_ctx->dirty_rect[0] < font_ctx->dirty_rect[2] &&
-            font_ctx->dirty_rect[1] < font_ctx->dirty_rect[3]) {
-            dirty[0] = font_ctx->dirty_rect[0];
-            dirty[1] = font_ctx->dirty_rect[1];
-            dirty[2] = font_ctx->dirty_rect[2];
-            dirty[3] = font_ctx->dirty_rect[3];
+    i32 validate_texture(Context* font_ctx, const i32 page, i32* dirty) {
+        if (page >= font_ctx->atlas->npages)
+            return 0;
+
+        AtlasPage* atlas_page = &font_ctx->atlas->pages[page];
+        if (atlas_page->dirty_rect[0] < atlas_page->dirty_rect[2] &&
+            atlas_page->dirty_rect[1] < atlas_page->dirty_rect[3]) {
+            dirty[0] = atlas_page->dirty_rect[0];
+            dirty[1] = atlas_page->dirty_rect[1];
+            dirty[2] = atlas_page->dirty_rect[2];
+            dirty[3] = atlas_page->dirty_rect[3];
             // Reset dirty rect
-            font_ctx->dirty_rect[0] = font_ctx->params.width;
-            font_ctx->dirty_rect[1] = font_ctx->params.height;
-            font_ctx->dirty_rect[2] = 0;
-            font_ctx->dirty_rect[3] = 0;
+            reset_dirty_rect(atlas_page, font_ctx->params.width, font_ctx->params.height);
             return 1;
         }
         return 0;
@@ -1303,8 +1704,6 @@ namespace rl::nvg::font {
             delete_atlas(font_ctx->atlas);
         if (font_ctx->fonts)
             free(font_ctx->fonts);
-        if (font_ctx->tex_data)
-            free(font_ctx->tex_data);
         if (font_ctx->scratch)
             free(font_ctx->scratch);
 
@@ -1330,17 +1729,10 @@ namespace rl::nvg::font {
         *height = font_ctx->params.height;
     }
 
-    i32 expand_atlas(Context* font_ctx, i32 width, i32 height) {
-        i32 maxy = 0;
+    i32 reset_atlas(Context* font_ctx, const i32 width, const i32 height) {
         if (font_ctx == nullptr)
             return 0;
 
-        width = math::max(width, font_ctx->params.width);
-        height = math::max(height, font_ctx->params.height);
-
-        if (width == font_ctx->params.width && height == font_ctx->params.height)
-            return 1;
-
         // Flush pending glyphs.
         flush(font_ctx);
 
@@ -1350,90 +1742,360 @@ namespace rl::nvg::font {
                 return 0;
         }
 
-        // Copy old texture data over.
-        const auto data = static_cast<u8*>(std::malloc(width * height));
-        if (data == nullptr)
-            return 0;
-
-        for (i32 i = 0; i < font_ctx->params.height; i++) {
-            u8* dst = &data[i * width];
-            const u8* src = &font_ctx->tex_data[i * font_ctx->params.width];
-            std::memcpy(dst, src, font_ctx->params.width);
-            if (width > font_ctx->params.width)
-                std::memset(dst + font_ctx->params.width, 0, width - font_ctx->params.width);
+        // Reset atlas, the first page is cleared and the others released.
+        Atlas* atlas = font_ctx->atlas;
+        for (i32 i = 1; i < atlas->npages; ++i) {
+            std::free(atlas->pages[i].data);
+            atlas->pages[i].data = nullptr;
         }
-        if (height > font_ctx->params.height)
-            std::memset(&data[font_ctx->params.height * width], 0,
-                        (height - font_ctx->params.height) * width);
-
-        std::free(font_ctx->tex_data);
-        font_ctx->tex_data = data;
-
-        // Increase atlas size
-        atlas_expand(font_ctx->atlas, width, height);
-
-        // Add existing data as dirty.
-        for (i32 i = 0; i < font_ctx->atlas->nnodes; i++)
-            maxy = math::max(maxy, font_ctx->atlas->nodes[i].y);
+        atlas->width = width;
+        atlas->height = height;
+        atlas->npages = 0;
+        atlas->nshelves = 0;
+        if (atlas_add_page(atlas) == 0)
+            return 0;
 
-        font_ctx->dirty_rect[0] = 0;
-        font_ctx->dirty_rect[1] = 0;
-        font_ctx->dirty_rect[2] = font_ctx->params.width;
-        font_ctx->dirty_rect[3] = maxy;
+        // Reset cached glyphs
+        for (i32 i = 0; i < font_ctx->nfonts; i++)
+            clear_glyphs(font_ctx->fonts[i]);
+        font_ctx->generation++;
 
         font_ctx->params.width = width;
         font_ctx->params.height = height;
         font_ctx->itw = 1.0f / static_cast<f32>(font_ctx->params.width);
         font_ctx->ith = 1.0f / static_cast<f32>(font_ctx->params.height);
 
+        // Add white rect at 0,0 for debug drawing.
+        add_white_rect(font_ctx, 2, 2);
+
         return 1;
     }
 
-    i32 reset_atlas(Context* font_ctx, const i32 width, const i32 height) {
-        if (font_ctx == nullptr)
+    void next_frame(Context* font_ctx) {
+        font_ctx->frame++;
+    }
+
+    u32 glyph_generation(const Context* font_ctx, const i32 font) {
+        // both only ever go up, so neither can change without the sum changing
+        return font_ctx->generation + font_ctx->fonts[font]->generation;
+    }
+
+    void touch_shelf(const Context* font_ctx, const i32 shelf) {
+        AtlasShelf* s = &font_ctx->atlas->shelves[shelf];
+        s->last_used = math::max(s->last_used, font_ctx->frame);
+    }
+
+    AtlasStats atlas_stats(const Context* font_ctx) {
+        const Atlas* atlas = font_ctx->atlas;
+        AtlasStats stats{
+            .pages = atlas->npages,
+            .shelves = atlas->nshelves,
+            .evicted_shelves = font_ctx->evicted_shelves,
+            .evicted_glyphs = font_ctx->evicted_glyphs,
+        };
+
+        i64 used = 0;
+        for (i32 i = 0; i < atlas->nshelves; ++i)
+            used += static_cast<i64>(atlas->shelves[i].x) * atlas->shelves[i].height;
+
+        const i64 area = static_cast<i64>(atlas->width) * atlas->height * atlas->npages;
+        if (area > 0)
+            stats.occupancy = static_cast<f32>(static_cast<f64>(used) / static_cast<f64>(area));
+
+        return stats;
+    }
+
+    i32 glyph_index(const STTFontImpl* font, const u32 codepoint) {
+        const FontTables& tables = font->tables;
+        if (tables.bmp == nullptr)
+            return stbtt_find_glyph_index(&font->font, static_cast<i32>(codepoint));
+        if (codepoint <= 0xffff)
+            return tables.bmp[codepoint];
+
+        const CmapEntry* begin = tables.tail;
+        const CmapEntry* end = begin + tables.ntail;
+        const CmapEntry* entry = std::lower_bound(
+            begin, end, codepoint,
+            [](const CmapEntry& e, const u32 c) { return e.codepoint < c; });
+        return entry != end && entry->codepoint == codepoint ? entry->glyph : 0;
+    }
+
+    i32 glyph_advance(const STTFontImpl* font, const i32 glyph) {
+        const FontTables& tables = font->tables;
+        if (glyph >= 0 && glyph < tables.nglyphs)
+            return tables.advances[glyph];
+
+        i32 advance;
+        i32 lsb;
+        stbtt_get_glyph_h_metrics(&font->font, glyph, &advance, &lsb);
+        return advance;
+    }
+
+    i32 glyph_kerning(const STTFontImpl* font, const i32 glyph1, const i32 glyph2) {
+        const FontTables& tables = font->tables;
+        const u32 key = kern_key(glyph1, glyph2);
+        if (tables.kern_keys != nullptr && key != 0) {
+            const u32 mask = static_cast<u32>(tables.kern_capacity - 1);
+            for (u32 slot = kern_slot(key, tables.kern_capacity); tables.kern_keys[slot] != 0;
+                 slot = (slot + 1) & mask)
+                if (tables.kern_keys[slot] == key)
+                    return tables.kern_values[slot];
+        }
+
+        if (tables.kern_complete)
+            return 0;
+        if (tables.kern_covered != nullptr && kern_covers(tables, glyph1) &&
+            kern_covers(tables, glyph2))
             return 0;
+        return stbtt_get_glyph_kern_advance(&font->font, glyph1, glyph2);
+    }
 
-        // Flush pending glyphs.
-        flush(font_ctx);
+    FontMetrics* create_metrics(const Context* font_ctx) {
+        const auto metrics = static_cast<FontMetrics*>(std::malloc(sizeof(FontMetrics)));
+        if (metrics == nullptr)
+            return nullptr;
+        std::memset(metrics, 0, sizeof(FontMetrics));
 
-        // Create new texture
-        if (font_ctx->params.render_resize != nullptr) {
-            if (font_ctx->params.render_resize(font_ctx->params.user_ptr, width, height) == 0)
-                return 0;
+        metrics->flags = font_ctx->params.flags;
+        metrics->fonts = static_cast<MetricsFont*>(
+            std::calloc(static_cast<u64>(math::max(font_ctx->nfonts, 1)), sizeof(MetricsFont)));
+        if (metrics->fonts == nullptr) {
+            delete_metrics(metrics);
+            return nullptr;
         }
 
-        // Reset atlas
-        atlas_reset(font_ctx->atlas, width, height);
+        // same as with the staging, the font info and tables are only ever read
+        metrics->nfonts = font_ctx->nfonts;
+        for (i32 i = 0; i < font_ctx->nfonts; ++i) {
+            const Font* font = font_ctx->fonts[i];
+            MetricsFont* copy = &metrics->fonts[i];
+            copy->font = font->font;
+            copy->nfallbacks = font->nfallbacks;
+            std::memcpy(copy->fallbacks, font->fallbacks, sizeof(copy->fallbacks));
+            copy->lineh = font->lineh;
+            copy->valid = font->data != nullptr;
+        }
 
-        // Clear texture data.
-        font_ctx->tex_data = static_cast<u8*>(std::realloc(font_ctx->tex_data, width * height));
-        if (font_ctx->tex_data == nullptr)
-            return 0;
+        return metrics;
+    }
 
-        std::memset(font_ctx->tex_data, 0, width * height);
+    void delete_metrics(FontMetrics* metrics) {
+        if (metrics == nullptr)
+            return;
 
-        // Reset dirty rect
-        font_ctx->dirty_rect[0] = width;
-        font_ctx->dirty_rect[1] = height;
-        font_ctx->dirty_rect[2] = 0;
-        font_ctx->dirty_rect[3] = 0;
+        std::free(metrics->fonts);
+        std::free(metrics);
+    }
 
-        // Reset cached glyphs
-        for (i32 i = 0; i < font_ctx->nfonts; i++) {
-            Font* font = font_ctx->fonts[i];
-            font->nglyphs = 0;
-            for (i32& j : font->lut)
-                j = -1;
+    f32 measure_text(const FontMetrics* metrics, const i32 font, const f32 size,
+                     const f32 spacing, const char* str, const char* end, f32* lineh) {
+        if (font < 0 || font >= metrics->nfonts || !metrics->fonts[font].valid)
+            return 0.0f;
+
+        const MetricsFont* base = &metrics->fonts[font];
+        if (lineh != nullptr)
+            *lineh = base->lineh * std::round(size * 10.0f) / 10.0f;
+
+        // Walks the glyphs like text_bounds() does, with the glyph advances
+        // computed the way they are when glyphs are added to the atlas.
+        const i16 isize = static_cast<i16>(size * 10.0f);
+        i16 ikey = isize;
+        i16 iblur = 0;
+        if (isize < 2)
+            return 0.0f;
+        glyph_key(metrics->flags, &ikey, &iblur);
+
+        const bool sdf = (metrics->flags & FonsSdf) != 0;
+        const f32 k = static_cast<f32>(isize) / static_cast<f32>(ikey);
+        const f32 scale = tt_get_pixel_height_scale(&base->font, static_cast<f32>(isize) / 10.0f);
+        const STTFontImpl* fallbacks[MAX_FALLBACKS];
+        for (i32 i = 0; i < base->nfallbacks; ++i)
+            fallbacks[i] = &metrics->fonts[base->fallbacks[i]].font;
+
+        if (end == nullptr)
+            end = str + std::strlen(str);
+
+        f32 x = 0.0f;
+        i32 prev_glyph_index = -1;
+        // decoded like in draw_text()
+        end = utf8::simd::valid_prefix(str, end);
+        u32 codepoints[TEXT_ITER_BATCH];
+        while (str < end) {
+            const u32 ncodepoints{ utf8::simd::decode(str, end, codepoints, nullptr,
+                                                      TEXT_ITER_BATCH, &str) };
+            for (u32 i = 0; i < ncodepoints; ++i) {
+                const u32 codepoint{ codepoints[i] };
+                const STTFontImpl* glyph_font;
+                const i32 index = find_glyph(&base->font, fallbacks, base->nfallbacks, codepoint,
+                                             &glyph_font);
+                if (prev_glyph_index != -1) {
+                    const f32 adv{ scale * static_cast<f32>(glyph_kerning(
+                                               &base->font, prev_glyph_index, index)) };
+                    x += sdf ? adv + spacing : std::round(adv + spacing);
+                }
+
+                const f32 glyph_scale = tt_get_pixel_height_scale(glyph_font,
+                                                                  static_cast<f32>(ikey) / 10.0f);
+                const i16 x_adv = static_cast<i16>(
+                    glyph_scale * static_cast<f32>(glyph_advance(glyph_font, index)) * 10.0f);
+                const f32 advance = static_cast<f32>(x_adv) / 10.0f * k;
+                x += sdf ? advance : std::round(advance);
+                prev_glyph_index = index;
+            }
         }
 
-        font_ctx->params.width = width;
-        font_ctx->params.height = height;
-        font_ctx->itw = 1.0f / static_cast<f32>(font_ctx->params.width);
-        font_ctx->ith = 1.0f / static_cast<f32>(font_ctx->params.height);
+        return x;
+    }
 
-        // Add white rect at 0,0 for debug drawing.
-        add_white_rect(font_ctx, 2, 2);
+    GlyphStaging* create_staging(const Context* font_ctx) {
+        if (font_ctx == nullptr)
+            return nullptr;
+
+        const auto staging = static_cast<GlyphStaging*>(std::malloc(sizeof(GlyphStaging)));
+        if (staging == nullptr)
+            return nullptr;
+        std::memset(staging, 0, sizeof(GlyphStaging));
+
+        staging->flags = font_ctx->params.flags;
+        staging->fonts = static_cast<StagingFont*>(
+            std::calloc(static_cast<u64>(math::max(font_ctx->nfonts, 1)), sizeof(StagingFont)));
+        if (staging->fonts == nullptr) {
+            delete_staging(staging);
+            return nullptr;
+        }
+
+        // The stbtt font info only refers to the font data, which stays where it
+        // is until the context is deleted, copying it is all it takes to share it.
+        staging->nfonts = font_ctx->nfonts;
+        for (i32 i = 0; i < font_ctx->nfonts; ++i) {
+            const Font* font = font_ctx->fonts[i];
+            StagingFont* copy = &staging->fonts[i];
+            copy->font = font->font;
+            copy->nfallbacks = font->nfallbacks;
+            std::memcpy(copy->fallbacks, font->fallbacks, sizeof(copy->fallbacks));
+            copy->valid = font->data != nullptr;
+        }
+
+        return staging;
+    }
+
+    void delete_staging(GlyphStaging* staging) {
+        if (staging == nullptr)
+            return;
+
+        std::free(staging->fonts);
+        std::free(staging->data);
+        std::free(staging->glyphs);
+        std::free(staging);
+    }
+
+    i32 stage_glyph(GlyphStaging* staging, const i32 font, const u32 codepoint, const f32 size,
+                    const f32 blur) {
+        if (font < 0 || font >= staging->nfonts || !staging->fonts[font].valid)
+            return 0;
+
+        i16 isize = static_cast<i16>(size * 10.0f);
+        i16 iblur = static_cast<i16>(blur);
+        if (isize < 2)
+            return 0;
+        glyph_key(staging->flags, &isize, &iblur);
+
+        const StagingFont* staged_font = &staging->fonts[font];
+        const STTFontImpl* fallbacks[MAX_FALLBACKS];
+        for (i32 i = 0; i < staged_font->nfallbacks; ++i)
+            fallbacks[i] = &staging->fonts[staged_font->fallbacks[i]].font;
+        const GlyphBox box = glyph_box(&staged_font->font, fallbacks, staged_font->nfallbacks,
+                                       codepoint, isize, iblur, staging->flags);
+
+        const i32 nbytes = box.width * box.height;
+        if (staging->ndata + nbytes > staging->cdata) {
+            // 1.5x Overallocate
+            const i32 cdata = math::max(staging->ndata + nbytes + staging->cdata / 2, 4096);
+            const auto data = static_cast<u8*>(std::realloc(staging->data, static_cast<u64>(cdata)));
+            if (data == nullptr)
+                return 0;
+            staging->data = data;
+            staging->cdata = cdata;
+        }
+        if (staging->nglyphs + 1 > staging->cglyphs) {
+            const i32 cglyphs = staging->cglyphs == 0 ? 64 : staging->cglyphs * 2;
+            const auto glyphs = static_cast<StagedGlyph*>(
+                std::realloc(staging->glyphs, sizeof(StagedGlyph) * static_cast<u64>(cglyphs)));
+            if (glyphs == nullptr)
+                return 0;
+            staging->glyphs = glyphs;
+            staging->cglyphs = cglyphs;
+        }
+
+        StagedGlyph* staged = &staging->glyphs[staging->nglyphs++];
+        std::memset(staged, 0, sizeof(StagedGlyph));
+        staged->font = font;
+        staged->codepoint = codepoint;
+        staged->size = isize;
+        staged->blur = iblur;
+        staged->index = box.index;
+        staged->width = static_cast<i16>(box.width);
+        staged->height = static_cast<i16>(box.height);
+        staged->x_adv = static_cast<i16>(box.x_adv);
+        staged->x_off = static_cast<i16>(box.x_off);
+        staged->y_off = static_cast<i16>(box.y_off);
+        staged->offset = staging->ndata;
+
+        u8* dst = &staging->data[staging->ndata];
+        std::memset(dst, 0, static_cast<u64>(nbytes));
+        rasterize_glyph(box, dst, box.width, iblur, staging->flags);
+        staging->ndata += nbytes;
 
         return 1;
     }
+
+    i32 add_staged_glyphs(Context* font_ctx, const GlyphStaging* staging) {
+        if (font_ctx == nullptr || staging == nullptr)
+            return 0;
+
+        i32 added = 0;
+        for (i32 i = 0; i < staging->nglyphs; ++i) {
+            const StagedGlyph& staged = staging->glyphs[i];
+            if (staged.font < 0 || staged.font >= font_ctx->nfonts)
+                continue;
+            Font* font = font_ctx->fonts[staged.font];
+            if (font->data == nullptr)
+                continue;
+
+            // Glyphs rasterized by the context in the meantime are kept.
+            const u32 hash = glyph_hash(staged.codepoint, staged.size, staged.blur);
+            const i32 cached = find_glyph_slot(font->table, font->glyphs, hash, staged.codepoint,
+                                               staged.size, staged.blur);
+            Glyph* glyph = nullptr;
+            if (font->table.tags[cached] != 0) {
+                glyph = &font->glyphs[font->table.slots[cached]];
+                if (glyph->x0 >= 0 && glyph->y0 >= 0)
+                    continue;
+            }
+
+            // Only free space is used, the atlas is full once that runs out.
+            i32 page, shelf, gx, gy;
+            if (atlas_add_rect(font_ctx, staged.width, staged.height, false, &page, &shelf, &gx,
+                               &gy) == 0)
+                break;
+
+            if (glyph == nullptr) {
+                glyph = insert_glyph(font, hash, staged.codepoint, staged.size, staged.blur);
+                if (glyph == nullptr)
+                    break;
+            }
+            place_glyph(glyph, staged.index, staged.width, staged.height, staged.x_adv,
+                        staged.x_off, staged.y_off, page, shelf, gx, gy);
+
+            AtlasPage* dst_page = &font_ctx->atlas->pages[page];
+            for (i32 y = 0; y < staged.height; ++y)
+                std::memcpy(&dst_page->data[gx + (gy + y) * font_ctx->params.width],
+                            &staging->data[staged.offset + y * staged.width],
+                            static_cast<u64>(staged.width));
+            mark_dirty(dst_page, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
+            ++added;
+        }
+
+        return added;
+    }
 }
@@ -7,22 +7,63 @@
 namespace rl::nvg::font {
     constexpr i32 INVALID{ -1 };
     constexpr i32 SCRATCH_BUF_SIZE{ 96000 };
-    constexpr i32 HASH_LUT_SIZE{ 256 };
+    constexpr i32 GLYPH_GROUP_SIZE{ 16 };
     constexpr i32 INIT_FONTS{ 4 };
     constexpr i32 INIT_GLYPHS{ 256 };
-    constexpr i32 INIT_ATLAS_NODES{ 256 };
+    constexpr i32 INIT_ATLAS_SHELVES{ 64 };
+    constexpr i32 MAX_ATLAS_PAGES{ 4 };
     constexpr i32 VERTEX_COUNT{ 1024 };
     constexpr i32 MAX_STATES{ 20 };
     constexpr i32 MAX_FALLBACKS{ 20 };
+    // Codepoints decoded at once when walking text.
+    constexpr i32 TEXT_ITER_BATCH{ 64 };
+    // Glyphs are baked once at SDF_SIZE pixels with FonsSdf, the distance field extends
+    // SDF_PADDING pixels past the outline and the outline itself is at SDF_ON_EDGE.
+    constexpr i32 SDF_SIZE{ 48 };
+    constexpr i32 SDF_PADDING{ 6 };
+    constexpr u8 SDF_ON_EDGE{ 128 };
+
+    // A codepoint past the BMP and its glyph index, see FontTables.
+    struct CmapEntry {
+        u32 codepoint{ 0 };
+        i32 glyph{ 0 };
+    };
+
+    // Lookup tables built from a font's cmap, hmtx and kerning data when it's added, so looking
+    // glyphs up and measuring them doesn't walk the font data. They're never modified after
+    // that and are shared by copies of the font (see GlyphStaging).
+    struct FontTables {
+        // glyph index of every BMP codepoint, 0 when the font doesn't map it
+        u16* bmp{ nullptr };
+        // codepoints past the BMP the font maps, sorted
+        CmapEntry* tail{ nullptr };
+        i32 ntail{ 0 };
+        // advance width of every glyph, in font units
+        i32* advances{ nullptr };
+        i32 nglyphs{ 0 };
+        // Kerning of glyph pairs in font units, open addressing on glyph1 << 16 | glyph2 with 0
+        // marking empty slots. Pairs in the kern table are all there, GPOS pairs can't be listed
+        // so only the ones between printable ASCII glyphs are, and kern_complete is false:
+        // pairs are then looked up in the font unless both glyphs are set in kern_covered
+        // (one bit per glyph), which means the pair was measured and isn't kerned if missing.
+        u32* kern_keys{ nullptr };
+        i16* kern_values{ nullptr };
+        i32 kern_capacity{ 0 };
+        u8* kern_covered{ nullptr };
+        bool kern_complete{ false };
+    };
 
     struct STTFontImpl {
         stb::stbtt_fontinfo font{};
+        FontTables tables{};
     };
 
     struct Glyph {
         u32 codepoint{ 0 };
         i32 index{ 0 };
-        i32 next{ 0 };
+        // atlas page and shelf the bitmap is in, see Atlas
+        i16 page{ 0 };
+        i16 shelf{ -1 };
         i16 size{ 0 };
         i16 blur{ 0 };
         i16 x0{ 0 };
@@ -34,6 +75,18 @@ namespace rl::nvg::font {
         i16 y_off{ 0 };
     };
 
+    // Open addressing table from (codepoint, size, blur) to the index of one of a font's cached
+    // glyphs. Slots are probed in groups of GLYPH_GROUP_SIZE, every slot has a tag byte that's
+    // 0 when empty and otherwise holds 7 bits of the key's hash, so a whole group is compared
+    // at once. The capacity is a power of two and is kept when the glyphs are reset, so the
+    // table stays sized for the working set it has seen.
+    struct GlyphTable {
+        u8* tags{ nullptr };
+        i32* slots{ nullptr };
+        i32 capacity{ 0 };
+        i32 count{ 0 };
+    };
+
     struct Font {
         STTFontImpl font{};
         char name[64]{};
@@ -46,9 +99,11 @@ namespace rl::nvg::font {
         Glyph* glyphs{ nullptr };
         i32 cglyphs{ 0 };
         i32 nglyphs{ 0 };
-        i32 lut[HASH_LUT_SIZE]{};
+        GlyphTable table{};
         i32 fallbacks[MAX_FALLBACKS]{};
         i32 nfallbacks{ 0 };
+        // bumped when the fallbacks change, see glyph_generation()
+        u32 generation{ 0 };
     };
 
     struct State {
@@ -60,18 +115,103 @@ namespace rl::nvg::font {
         f32 spacing{ 0 };
     };
 
-    struct AtlasNode {
-        i32 x{ 0 };
-        i32 y{ 0 };
-        i32 width{ 0 };
+    // A row of glyph bitmaps packed left to right on one of the atlas pages. Shelves are what
+    // the atlas evicts once every page is full, last_used is the frame any of the shelf's
+    // glyphs was last drawn in.
+    struct AtlasShelf {
+        i16 page{ 0 };
+        i16 y{ 0 };
+        i16 height{ 0 };
+        i16 x{ 0 };
+        u32 last_used{ 0 };
     };
 
+    struct AtlasPage {
+        u8* data{ nullptr };
+        i32 dirty_rect[4]{};
+        // top of the part of the page no shelf has been opened in yet
+        i32 top{ 0 };
+    };
+
+    // Glyph atlas split over up to MAX_ATLAS_PAGES equally sized pages, each uploaded to a texture
+    // of its own. Pages are added as they're needed. Once all of them are full the shelf least
+    // recently drawn from is evicted, its glyphs are rasterized again the next time they're used.
     struct Atlas {
         i32 width{ 0 };
         i32 height{ 0 };
-        AtlasNode* nodes{ nullptr };
-        i32 nnodes{ 0 };
-        i32 cnodes{ 0 };
+        AtlasPage pages[MAX_ATLAS_PAGES]{};
+        i32 npages{ 0 };
+        AtlasShelf* shelves{ nullptr };
+        i32 nshelves{ 0 };
+        i32 cshelves{ 0 };
+    };
+
+    // Atlas usage, see atlas_stats(). The eviction counts are totals since the atlas was created.
+    struct AtlasStats {
+        i32 pages{ 0 };
+        i32 shelves{ 0 };
+        // fraction of the allocated pages' area taken up by glyph bitmaps
+        f32 occupancy{ 0.0f };
+        u32 evicted_shelves{ 0 };
+        u32 evicted_glyphs{ 0 };
+    };
+
+    // A glyph rasterized into a GlyphStaging, its padded bitmap is
+    // width * height bytes at offset in the staging's data.
+    struct StagedGlyph {
+        i32 font{ 0 };
+        u32 codepoint{ 0 };
+        i32 index{ 0 };
+        i16 size{ 0 };
+        i16 blur{ 0 };
+        i16 width{ 0 };
+        i16 height{ 0 };
+        i16 x_adv{ 0 };
+        i16 x_off{ 0 };
+        i16 y_off{ 0 };
+        i32 offset{ 0 };
+    };
+
+    // Copy of what a font's glyphs are looked up and rasterized from.
+    struct StagingFont {
+        STTFontImpl font{};
+        i32 fallbacks[MAX_FALLBACKS]{};
+        i32 nfallbacks{ 0 };
+        bool valid{ false };
+    };
+
+    // Staging atlas glyphs are rasterized into away from the context, see stage_glyph(). It
+    // copies the fonts when it's created and shares no mutable state with the context, so
+    // glyphs can be staged on another thread while the context keeps drawing. The context
+    // owns the font data and has to outlive the staging.
+    struct GlyphStaging {
+        StagingFont* fonts{ nullptr };
+        i32 nfonts{ 0 };
+        u8 flags{ 0 };
+        u8* data{ nullptr };
+        i32 ndata{ 0 };
+        i32 cdata{ 0 };
+        StagedGlyph* glyphs{ nullptr };
+        i32 nglyphs{ 0 };
+        i32 cglyphs{ 0 };
+    };
+
+    // Copy of what a font's text is measured with.
+    struct MetricsFont {
+        STTFontImpl font{};
+        i32 fallbacks[MAX_FALLBACKS]{};
+        i32 nfallbacks{ 0 };
+        f32 lineh{ 0.0f };
+        bool valid{ false };
+    };
+
+    // Fonts text is measured with away from the context, see measure_text(). Like GlyphStaging
+    // it copies the fonts when it's created and only ever reads the font data and tables, so
+    // any number of threads can measure with it at once. Fonts added later on aren't in it.
+    struct FontMetrics {
+        MetricsFont* fonts{ nullptr };
+        i32 nfonts{ 0 };
+        u8 flags{ 0 };
     };
 
     struct Params {
@@ -81,7 +221,7 @@ namespace rl::nvg::font {
         void* user_ptr;
         i32 (*render_create)(void* uptr, i32 width, i32 height);
         i32 (*render_resize)(void* uptr, i32 width, i32 height);
-        void (*render_update)(void* uptr, i32* rect, const u8* data);
+        void (*render_update)(void* uptr, i32 page, i32* rect, const u8* data);
         void (*render_draw)(void* uptr, const f32* verts, const f32* tcoords, const u32* colors,
                             i32 nverts);
         void (*render_delete)(void* uptr);
@@ -105,8 +245,6 @@ namespace rl::nvg::font {
         Params params{};
         f32 itw{ 0.0f };
         f32 ith{ 0.0f };
-        u8* tex_data{ nullptr };
-        i32 dirty_rect[4]{};
         Font** fonts{ nullptr };
         Atlas* atlas{ nullptr };
         i32 cfonts{ 0 };
@@ -121,11 +259,22 @@ namespace rl::nvg::font {
         i32 nstates{ 0 };
         void (*handle_error)(void* uptr, ErrorCode error, i32 val);
         void* error_uptr{ nullptr };
+        // frame counter glyph use is stamped with, see next_frame()
+        u32 frame{ 1 };
+        u32 evicted_shelves{ 0 };
+        u32 evicted_glyphs{ 0 };
+        // bumped when glyphs are dropped from the atlas, see glyph_generation()
+        u32 generation{ 0 };
     };
 
     enum FontFlags {
         FonsZeroTopleft = 1,
         FonsZeroBottomleft = 2,
+        // Rasterize signed distance fields instead of coverage bitmaps. Every glyph is baked
+        // once at SDF_SIZE regardless of the size and blur it's drawn with, quads are scaled
+        // to the requested size and aren't snapped to whole pixels. The renderer is expected
+        // to reconstruct the outline from the distance (and apply blur) when drawing.
+        FonsSdf = 4,
     };
 
     enum GlyphBitmap {
@@ -142,6 +291,9 @@ namespace rl::nvg::font {
         f32 y1{ 0.0f };
         f32 s1{ 0.0f };
         f32 t1{ 0.0f };
+        // atlas page and shelf the texture coordinates refer to
+        i32 page{ 0 };
+        i32 shelf{ -1 };
     };
 
     struct TextIter {
@@ -159,7 +311,11 @@ namespace rl::nvg::font {
         const char* str{ nullptr };
         const char* next{ nullptr };
         const char* end{ nullptr };
-        u32 utf8_state{ 0 };
+        // decoded ahead of the iterator, see text_iter_next()
+        u32 codepoints[TEXT_ITER_BATCH]{};
+        u8 lengths[TEXT_ITER_BATCH]{};
+        i32 ncodepoints{ 0 };
+        i32 icodepoint{ 0 };
         i32 bitmap_option{ 0 };
     };
 
@@ -170,15 +326,25 @@ namespace rl::nvg::font {
     void set_error_callback(Context* font_ctx,
                             void (*callback)(void* uptr, ErrorCode error, i32 val), void* uptr);
 
-    // Returns current atlas size.
+    // Returns the size of an atlas page.
     void get_atlas_size(const Context* font_ctx, i32* width, i32* height);
 
-    // Expands the atlas size.
-    i32 expand_atlas(Context* font_ctx, i32 width, i32 height);
-
-    // Resets the whole stash.
+    // Resets the whole stash, dropping every page but the first.
     i32 reset_atlas(Context* font_ctx, i32 width, i32 height);
 
+    // Starts a new frame. Shelves with glyphs drawn in the current frame are never evicted,
+    // the texture data they have been drawn with is still needed when the frame is rendered.
+    void next_frame(Context* font_ctx);
+
+    AtlasStats atlas_stats(const Context* font_ctx);
+
+    // Changes whenever quads of the font's glyphs that were handed out before may no longer
+    // match the atlas or the glyphs the font would be drawn with now (shelves were evicted, the
+    // atlas was reset or the fallbacks changed). Lets quads be kept around between frames.
+    u32 glyph_generation(const Context* font_ctx, i32 font);
+    // Marks the shelf a kept quad refers to as drawn from in the current frame.
+    void touch_shelf(const Context* font_ctx, i32 shelf);
+
     // Add fonts
     i32 add_font(Context* font_ctx, const char* name, const char* path, i32 font_index);
     i32 add_font_mem(Context* font_ctx, const char* name, u8* data, i32 data_size, i32 free_data,
@@ -214,13 +380,37 @@ namespace rl::nvg::font {
                        const char* end, i32 bitmap_option);
     i32 text_iter_next(Context* font_ctx, TextIter* iter, FontQuad* quad);
 
-    // Pull texture changes
-    const u8* get_texture_data(const Context* font_ctx, i32* width, i32* height);
-    i32 validate_texture(Context* font_ctx, i32* dirty);
+    // Pull texture changes, per atlas page
+    i32 atlas_page_count(const Context* font_ctx);
+    const u8* get_texture_data(const Context* font_ctx, i32 page, i32* width, i32* height);
+    i32 validate_texture(Context* font_ctx, i32 page, i32* dirty);
 
     // Draws the stash texture for debugging
     void draw_debug(Context* font_ctx, f32 x, f32 y);
 
     i32 add_fallback_font(const Context* font_ctx, i32 base, i32 fallback);
     void reset_fallback_font(const Context* font_ctx, i32 base);
+
+    // Glyph lookups through the font's tables, see FontTables. Fonts without
+    // tables (they failed to allocate) are looked up in the font data.
+    i32 glyph_index(const STTFontImpl* font, u32 codepoint);
+    i32 glyph_advance(const STTFontImpl* font, i32 glyph);
+    i32 glyph_kerning(const STTFontImpl* font, i32 glyph1, i32 glyph2);
+
+    // Context free text measurement, create_metrics() is called on the thread using the context.
+    FontMetrics* create_metrics(const Context* font_ctx);
+    void delete_metrics(FontMetrics* metrics);
+    // Advance width of a line of text drawn at size (in font pixels), the same width
+    // text_bounds() measures. The line height is returned in lineh when it isn't null.
+    f32 measure_text(const FontMetrics* metrics, i32 font, f32 size, f32 spacing, const char* str,
+                     const char* end, f32* lineh);
+
+    // Glyph pre-rasterization. The staging is created and its glyphs are added on the thread
+    // using the context, stage_glyph() can be called from any thread owning the staging.
+    GlyphStaging* create_staging(const Context* font_ctx);
+    void delete_staging(GlyphStaging* staging);
+    i32 stage_glyph(GlyphStaging* staging, i32 font, u32 codepoint, f32 size, f32 blur);
+    // Copies the staged glyphs that aren't cached yet into the atlas. Only free space is used,
+    // glyphs already in the atlas are never evicted for them. Returns the number added.
+    i32 add_staged_glyphs(Context* font_ctx, const GlyphStaging* staging);
 }
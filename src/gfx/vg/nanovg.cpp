@@ -1,14 +1,23 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
 #include <cstdlib>
+#include <mutex>
 #include <numbers>
 #include <print>
+#include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "ds/color.hpp"
 #include "ds/rect.hpp"
 #include "gfx/stb/stb_image.hpp"
 #include "gfx/text.hpp"
 #include "gfx/vg/nanovg.hpp"
+#include "gfx/vg/nanovg_simd.hpp"
 
 namespace rl::nvg {
     enum InitSize {
@@ -33,13 +42,6 @@ namespace rl::nvg {
         Winding = 4,
     };
 
-    enum NVGpointFlags {
-        NvgPtCorner = 0x01,
-        NvgPtLeft = 0x02,
-        NvgPtBevel = 0x04,
-        NvgPrInnerbevel = 0x08,
-    };
-
     namespace {
         namespace detail {
             f32 sqrtf(const f32 a) {
@@ -109,44 +111,108 @@ namespace rl::nvg {
                 return d;
             }
 
+            // The cache's buffers live in the context's frame arena.
             void delete_path_cache(PathCache* c) {
-                if (c == nullptr)
-                    return;
-                if (c->points != nullptr)
-                    std::free(c->points);
-                if (c->paths != nullptr)
-                    std::free(c->paths);
-                if (c->verts != nullptr)
-                    std::free(c->verts);
-
                 std::free(c);
             }
 
-            PathCache* alloc_path_cache() {
+            // All point streams share a single allocation, each one padded to a multiple of 16
+            // elements so every stream starts on a 64 byte boundary relative to the first.
+            i32 reserve_points(PathCache* c, const i32 cpoints) {
+                const u64 stride{ static_cast<u64>((cpoints + 15) & ~15) };
+                const auto block = static_cast<u8*>(
+                    arena_alloc(c->arena, stride * (sizeof(f32) * 7 + sizeof(u8))));
+                if (block == nullptr)
+                    return 0;
+
+                const auto stream = [&](const u64 idx) {
+                    return reinterpret_cast<f32*>(block + stride * sizeof(f32) * idx);
+                };
+
+                const PointStreams points{
+                    .x = stream(0),
+                    .y = stream(1),
+                    .dx = stream(2),
+                    .dy = stream(3),
+                    .len = stream(4),
+                    .dmx = stream(5),
+                    .dmy = stream(6),
+                    .flags = block + stride * sizeof(f32) * 7,
+                };
+
+                if (c->points.x != nullptr) {
+                    const u64 n{ static_cast<u64>(c->npoints) };
+                    std::memcpy(points.x, c->points.x, sizeof(f32) * n);
+                    std::memcpy(points.y, c->points.y, sizeof(f32) * n);
+                    std::memcpy(points.dx, c->points.dx, sizeof(f32) * n);
+                    std::memcpy(points.dy, c->points.dy, sizeof(f32) * n);
+                    std::memcpy(points.len, c->points.len, sizeof(f32) * n);
+                    std::memcpy(points.dmx, c->points.dmx, sizeof(f32) * n);
+                    std::memcpy(points.dmy, c->points.dmy, sizeof(f32) * n);
+                    std::memcpy(points.flags, c->points.flags, sizeof(u8) * n);
+                }
+
+                c->points = points;
+                c->cpoints = cpoints;
+                return 1;
+            }
+
+            Point load_point(const PointStreams& pts, const i32 idx) {
+                return Point{
+                    .x = pts.x[idx],
+                    .y = pts.y[idx],
+                    .dx = pts.dx[idx],
+                    .dy = pts.dy[idx],
+                    .len = pts.len[idx],
+                    .dmx = pts.dmx[idx],
+                    .dmy = pts.dmy[idx],
+                    .flags = pts.flags[idx],
+                };
+            }
+
+            // Returns the end of the run of points starting at begin that don't have any of the
+            // join flags in mask set, those are emitted by the tessellation kernels in bulk.
+            i32 straight_run_end(const u8* flags, const i32 begin, const i32 end, const u8 mask) {
+                i32 i{ begin };
+                while (i < end && (flags[i] & mask) == 0)
+                    ++i;
+                return i;
+            }
+
+            // Carves the cache's buffers out of its arena, any previous contents are dropped.
+            i32 reserve_path_cache(PathCache* c, const i32 cpoints, const i32 cpaths,
+                                   const i32 cverts) {
+                c->points = PointStreams{};
+                c->npoints = 0;
+                c->cpoints = 0;
+                c->npaths = 0;
+                c->nverts = 0;
+                c->segments = nullptr;
+                c->csegments = 0;
+
+                if (!detail::reserve_points(c, cpoints))
+                    return 0;
+
+                c->paths = static_cast<NVGpath*>(
+                    arena_alloc(c->arena, sizeof(NVGpath) * static_cast<u64>(cpaths)));
+                c->cpaths = c->paths != nullptr ? cpaths : 0;
+
+                c->verts = static_cast<Vertex*>(
+                    arena_alloc(c->arena, sizeof(Vertex) * static_cast<u64>(cverts)));
+                c->cverts = c->verts != nullptr ? cverts : 0;
+
+                return c->paths != nullptr && c->verts != nullptr;
+            }
+
+            PathCache* alloc_path_cache(FrameArena* arena) {
                 const auto c = static_cast<PathCache*>(std::malloc(sizeof(PathCache)));
                 if (c != nullptr) {
                     std::memset(c, 0, sizeof(PathCache));
-                    c->points = static_cast<Point*>(std::malloc(sizeof(Point) * NvgInitPointsSize));
-
-                    if (c->points != nullptr) {
-                        c->npoints = 0;
-                        c->cpoints = NvgInitPointsSize;
-                        c->paths = static_cast<NVGpath*>(
-                            std::malloc(sizeof(NVGpath) * NvgInitPathsSize));
-
-                        if (c->paths != nullptr) {
-                            c->npaths = 0;
-                            c->cpaths = NvgInitPathsSize;
-                            c->verts = static_cast<Vertex*>(
-                                std::malloc(sizeof(Vertex) * NvgInitVertsSize));
-
-                            if (c->verts != nullptr) {
-                                c->nverts = 0;
-                                c->cverts = NvgInitVertsSize;
-                                return c;
-                            }
-                        }
-                    }
+                    c->arena = arena;
+
+                    if (detail::reserve_path_cache(c, NvgInitPointsSize, NvgInitPathsSize,
+                                                   NvgInitVertsSize))
+                        return c;
                 }
 
                 // error
@@ -251,8 +317,10 @@ namespace rl::nvg {
             void add_path(const Context* ctx) {
                 if (ctx->cache->npaths + 1 > ctx->cache->cpaths) {
                     const i32 cpaths = ctx->cache->npaths + 1 + ctx->cache->cpaths / 2;
-                    const auto paths = static_cast<NVGpath*>(realloc(
-                        ctx->cache->paths, sizeof(NVGpath) * static_cast<uint64_t>(cpaths)));
+                    const auto paths = static_cast<NVGpath*>(arena_grow(
+                        ctx->cache->arena, ctx->cache->paths,
+                        sizeof(NVGpath) * static_cast<u64>(ctx->cache->npaths),
+                        sizeof(NVGpath) * static_cast<u64>(cpaths)));
 
                     if (paths == nullptr)
                         return;
@@ -268,50 +336,56 @@ namespace rl::nvg {
                 ctx->cache->npaths++;
             }
 
-            Point* last_point(const Context* ctx) {
-                if (ctx->cache->npoints > 0)
-                    return &ctx->cache->points[ctx->cache->npoints - 1];
-                return nullptr;
-            }
-
             i32 pt_equals(const f32 x1, const f32 y1, const f32 x2, const f32 y2, const f32 tol) {
                 const f32 dx = x2 - x1;
                 const f32 dy = y2 - y1;
                 return dx * dx + dy * dy < tol * tol;
             }
 
-            void add_point(const Context* ctx, const f32 x, const f32 y, const i32 flags) {
-                NVGpath* path = last_path(ctx);
-                Point* pt;
-                if (path == nullptr)
-                    return;
+            // Makes room for count more points in the cache.
+            i32 reserve_path_points(PathCache* cache, const i32 count) {
+                if (cache->npoints + count <= cache->cpoints)
+                    return 1;
 
-                if (path->count > 0 && ctx->cache->npoints > 0) {
-                    pt = last_point(ctx);
-                    if (pt_equals(pt->x, pt->y, x, y, ctx->dist_tol)) {
-                        pt->flags |= flags;
+                // 1.5x Overallocate
+                const i32 cpoints{ cache->npoints + count + cache->cpoints / 2 };
+                return detail::reserve_points(cache, cpoints);
+            }
+
+            // Appends a point to the path, the cache must already have room for it. Points
+            // closer than the distance tolerance to the previous one are merged into it.
+            void push_point(PathCache* cache, NVGpath* path, const f32 x, const f32 y,
+                            const i32 flags, const f32 dist_tol) {
+                if (path->count > 0 && cache->npoints > 0) {
+                    const i32 last{ cache->npoints - 1 };
+                    if (pt_equals(cache->points.x[last], cache->points.y[last], x, y, dist_tol)) {
+                        cache->points.flags[last] |= static_cast<u8>(flags);
                         return;
                     }
                 }
 
-                if (ctx->cache->npoints + 1 > ctx->cache->cpoints) {
-                    const i32 cpoints = ctx->cache->npoints + 1 + ctx->cache->cpoints / 2;
-                    const auto points = static_cast<Point*>(realloc(
-                        ctx->cache->points, sizeof(Point) * static_cast<uint64_t>(cpoints)));
-                    if (points == nullptr)
-                        return;
-                    ctx->cache->points = points;
-                    ctx->cache->cpoints = cpoints;
-                }
+                const i32 idx{ cache->npoints };
+                cache->points.x[idx] = x;
+                cache->points.y[idx] = y;
+                cache->points.dx[idx] = 0.0f;
+                cache->points.dy[idx] = 0.0f;
+                cache->points.len[idx] = 0.0f;
+                cache->points.dmx[idx] = 0.0f;
+                cache->points.dmy[idx] = 0.0f;
+                cache->points.flags[idx] = static_cast<u8>(flags);
+
+                cache->npoints++;
+                path->count++;
+            }
 
-                pt = &ctx->cache->points[ctx->cache->npoints];
-                std::memset(pt, 0, sizeof(*pt));
-                pt->x = x;
-                pt->y = y;
-                pt->flags = static_cast<u8>(flags);
+            void add_point(const Context* ctx, const f32 x, const f32 y, const i32 flags) {
+                NVGpath* path = last_path(ctx);
+                if (path == nullptr)
+                    return;
+                if (!detail::reserve_path_points(ctx->cache, 1))
+                    return;
 
-                ctx->cache->npoints++;
-                path->count++;
+                detail::push_point(ctx->cache, path, x, y, flags, ctx->dist_tol);
             }
 
             void close_path_internal(const Context* ctx) {
@@ -339,8 +413,9 @@ namespace rl::nvg {
                     const i32 cverts = nverts + 0xff & ~0xff;  // Round up to prevent
                                                                // allocations when
                     // things change just slightly.
-                    const auto verts = static_cast<Vertex*>(std::realloc(
-                        ctx->cache->verts, sizeof(Vertex) * static_cast<uint64_t>(cverts)));
+                    // the previous contents are never needed once more vertices are requested
+                    const auto verts = static_cast<Vertex*>(arena_alloc(
+                        ctx->cache->arena, sizeof(Vertex) * static_cast<uint64_t>(cverts)));
 
                     if (verts == nullptr)
                         return nullptr;
@@ -361,26 +436,25 @@ namespace rl::nvg {
                 return acx * aby - abx * acy;
             }
 
-            f32 poly_area(const Point* pts, const i32 npts) {
+            f32 poly_area(const PointStreams& pts, const i32 first, const i32 npts) {
                 f32 area = 0;
-                for (i32 i = 2; i < npts; ++i) {
-                    const Point* a{ &pts[0] };
-                    const Point* b{ &pts[i - 1] };
-                    const Point* c{ &pts[i] };
-                    area += detail::triarea2(a->x, a->y, b->x, b->y, c->x, c->y);
-                }
+                const f32* x{ pts.x + first };
+                const f32* y{ pts.y + first };
+                for (i32 i = 2; i < npts; ++i)
+                    area += detail::triarea2(x[0], y[0], x[i - 1], y[i - 1], x[i], y[i]);
                 return area * 0.5f;
             }
 
-            void poly_reverse(Point* pts, const i32 npts) {
-                i32 i = 0, j = npts - 1;
-                while (i < j) {
-                    const Point tmp = pts[i];
-                    pts[i] = pts[j];
-                    pts[j] = tmp;
-                    i++;
-                    j--;
-                }
+            void poly_reverse(const PointStreams& pts, const i32 first, const i32 npts) {
+                const i32 last{ first + npts };
+                std::reverse(pts.x + first, pts.x + last);
+                std::reverse(pts.y + first, pts.y + last);
+                std::reverse(pts.dx + first, pts.dx + last);
+                std::reverse(pts.dy + first, pts.dy + last);
+                std::reverse(pts.len + first, pts.len + last);
+                std::reverse(pts.dmx + first, pts.dmx + last);
+                std::reverse(pts.dmy + first, pts.dmy + last);
+                std::reverse(pts.flags + first, pts.flags + last);
             }
 
             void vset(Vertex* vtx, const f32 x, const f32 y, const f32 u, const f32 v) {
@@ -390,49 +464,74 @@ namespace rl::nvg {
                 vtx->v = v;
             }
 
-            void tesselate_bezier(Context* ctx, const f32 x1, const f32 y1, const f32 x2,
-                                  const f32 y2, const f32 x3, const f32 y3, const f32 x4,
-                                  const f32 y4, const i32 level, const i32 type) {
-                if (level > 10)
-                    return;
+            // Flattens a cubic bezier into a uniform number of segments, estimated with Wang's
+            // formula so the flattened curve stays within the flattening tolerance of the real
+            // one. The control points are already in screen space, so the count
+            // shrinks along with the curve as the transform scales it down. The points are
+            // produced by forward differencing straight into the path cache.
+            void flatten_bezier(const Context* ctx, const f32 x1, const f32 y1, const f32 x2,
+                                const f32 y2, const f32 x3, const f32 y3, const f32 x4,
+                                const f32 y4, const i32 type) {
+                constexpr i32 max_segments{ 1024 };
 
-                const f32 x12 = (x1 + x2) * 0.5f;
-                const f32 y12 = (y1 + y2) * 0.5f;
-                const f32 x23 = (x2 + x3) * 0.5f;
-                const f32 y23 = (y2 + y3) * 0.5f;
-                const f32 x34 = (x3 + x4) * 0.5f;
-                const f32 y34 = (y3 + y4) * 0.5f;
-                const f32 x123 = (x12 + x23) * 0.5f;
-                const f32 y123 = (y12 + y23) * 0.5f;
-
-                const f32 dx = x4 - x1;
-                const f32 dy = y4 - y1;
-                const f32 d2 = absf((x2 - x4) * dy - (y2 - y4) * dx);
-                const f32 d3 = absf((x3 - x4) * dy - (y3 - y4) * dx);
-
-                if ((d2 + d3) * (d2 + d3) < ctx->tess_tol * (dx * dx + dy * dy)) {
-                    add_point(ctx, x4, y4, type);
+                NVGpath* path{ detail::last_path(ctx) };
+                if (path == nullptr)
                     return;
-                }
 
-                /*  if (_absf(x1+x3-x2-x2) + _absf(y1+y3-y2-y2) + _absf(x2+x4-x3-x3) +
-                   _absf(y2+y4-y3-y3) < ctx->tessTol) { _addPoint(ctx, x4, y4, type); return;
-                    }*/
+                // Wang's formula is an upper bound on the error and the flattened curve stays well
+                // inside it in practice, half a device pixel doesn't show any faceting.
+                // n = ceil(sqrt(3 * 2 / 8 * max|P[i] - 2P[i+1] + P[i+2]| / tol))
+                const f32 tol{ ctx->tess_tol * 2.0f };
+                const f32 ddx0{ x1 - 2.0f * x2 + x3 };
+                const f32 ddy0{ y1 - 2.0f * y2 + y3 };
+                const f32 ddx1{ x2 - 2.0f * x3 + x4 };
+                const f32 ddy1{ y2 - 2.0f * y3 + y4 };
+                const f32 dd{ detail::max(ddx0 * ddx0 + ddy0 * ddy0, ddx1 * ddx1 + ddy1 * ddy1) };
+                const f32 estimate{ std::ceil(detail::sqrtf(0.75f * detail::sqrtf(dd) / tol)) };
+                const i32 n{ std::clamp(static_cast<i32>(detail::min(estimate, 1e6f)), 1,
+                                        max_segments) };
+
+                PathCache* cache{ ctx->cache };
+                if (!detail::reserve_path_points(cache, n))
+                    return;
 
-                const f32 x234 = (x23 + x34) * 0.5f;
-                const f32 y234 = (y23 + y34) * 0.5f;
-                const f32 x1234 = (x123 + x234) * 0.5f;
-                const f32 y1234 = (y123 + y234) * 0.5f;
+                // B(t) = a*t^3 + b*t^2 + c*t + P1, stepped by h = 1/n
+                const f32 h{ 1.0f / static_cast<f32>(n) };
+                const f32 h2{ h * h };
+                const f32 h3{ h2 * h };
+                const f32 ax{ 3.0f * (x2 - x3) + x4 - x1 };
+                const f32 ay{ 3.0f * (y2 - y3) + y4 - y1 };
+                const f32 bx{ 3.0f * (x1 - 2.0f * x2 + x3) };
+                const f32 by{ 3.0f * (y1 - 2.0f * y2 + y3) };
+                const f32 cx{ 3.0f * (x2 - x1) };
+                const f32 cy{ 3.0f * (y2 - y1) };
+
+                f32 px{ x1 };
+                f32 py{ y1 };
+                f32 dx{ ax * h3 + bx * h2 + cx * h };
+                f32 dy{ ay * h3 + by * h2 + cy * h };
+                f32 ddx{ 6.0f * ax * h3 + 2.0f * bx * h2 };
+                f32 ddy{ 6.0f * ay * h3 + 2.0f * by * h2 };
+                const f32 dddx{ 6.0f * ax * h3 };
+                const f32 dddy{ 6.0f * ay * h3 };
+
+                for (i32 i = 1; i < n; ++i) {
+                    px += dx;
+                    py += dy;
+                    dx += ddx;
+                    dy += ddy;
+                    ddx += dddx;
+                    ddy += dddy;
+                    detail::push_point(cache, path, px, py, 0, ctx->dist_tol);
+                }
 
-                tesselate_bezier(ctx, x1, y1, x12, y12, x123, y123, x1234, y1234, level + 1, 0);
-                tesselate_bezier(ctx, x1234, y1234, x234, y234, x34, y34, x4, y4, level + 1, type);
+                // the end point is emitted exactly to keep rounding drift out of the joins
+                detail::push_point(cache, path, x4, y4, type, ctx->dist_tol);
             }
 
             void flatten_paths(Context* ctx) {
                 PathCache* cache = ctx->cache;
                 //  State* state = _getState(ctx);
-                const Point* last{ nullptr };
-                Point* pts{ nullptr };
                 f32* p;
 
                 if (cache->npaths > 0)
@@ -455,14 +554,14 @@ namespace rl::nvg {
                             i += 3;
                             break;
                         case Commands::Bezierto:
-                            last = detail::last_point(ctx);
-                            if (last != nullptr) {
+                            if (cache->npoints > 0) {
+                                const i32 last{ cache->npoints - 1 };
                                 const f32* cp1 = &ctx->commands[i + 1];
                                 const f32* cp2 = &ctx->commands[i + 3];
                                 p = &ctx->commands[i + 5];
-                                detail::tesselate_bezier(ctx, last->x, last->y, cp1[0], cp1[1],
-                                                         cp2[0], cp2[1], p[0], p[1], 0,
-                                                         NvgPtCorner);
+                                detail::flatten_bezier(ctx, cache->points.x[last],
+                                                       cache->points.y[last], cp1[0], cp1[1],
+                                                       cp2[0], cp2[1], p[0], p[1], NvgPtCorner);
                             }
                             i += 7;
                             break;
@@ -484,42 +583,31 @@ namespace rl::nvg {
                 cache->bounds[2] = cache->bounds[3] = -1e6f;
 
                 // Calculate the direction and length of line segments.
+                const simd::Kernels& kernels{ simd::kernels() };
                 for (i32 j = 0; j < cache->npaths; j++) {
                     NVGpath* path{ &cache->paths[j] };
-                    pts = &cache->points[path->first];
+                    const PointStreams& pts{ cache->points };
 
                     // If the first and last points are the same, remove the last, mark as closed
                     // path.
-                    Point* p0{ &pts[path->count - 1] };
-                    Point* p1{ &pts[0] };
-                    if (detail::pt_equals(p0->x, p0->y, p1->x, p1->y, ctx->dist_tol)) {
+                    const i32 p0{ path->first + path->count - 1 };
+                    const i32 p1{ path->first };
+                    if (detail::pt_equals(pts.x[p0], pts.y[p0], pts.x[p1], pts.y[p1],
+                                          ctx->dist_tol)) {
                         path->count--;
-                        p0 = &pts[path->count - 1];
                         path->closed = 1;
                     }
 
                     // Enforce winding.
                     if (path->count > 2) {
-                        const f32 area = detail::poly_area(pts, path->count);
+                        const f32 area = detail::poly_area(pts, path->first, path->count);
                         if (path->winding == ShapeWinding::CounterClockwise && area < 0.0f)
-                            detail::poly_reverse(pts, path->count);
+                            detail::poly_reverse(pts, path->first, path->count);
                         if (path->winding == ShapeWinding::Clockwise && area > 0.0f)
-                            detail::poly_reverse(pts, path->count);
+                            detail::poly_reverse(pts, path->first, path->count);
                     }
 
-                    for (i = 0; i < path->count; i++) {
-                        // Calculate segment direction and length
-                        p0->dx = p1->x - p0->x;
-                        p0->dy = p1->y - p0->y;
-                        p0->len = detail::normalize(&p0->dx, &p0->dy);
-                        // Update bounds
-                        cache->bounds[0] = detail::min(cache->bounds[0], p0->x);
-                        cache->bounds[1] = detail::min(cache->bounds[1], p0->y);
-                        cache->bounds[2] = detail::max(cache->bounds[2], p0->x);
-                        cache->bounds[3] = detail::max(cache->bounds[3], p0->y);
-                        // Advance
-                        p0 = p1++;
-                    }
+                    kernels.segments(pts, path->first, path->count, cache->bounds);
                 }
             }
 
@@ -828,6 +916,9 @@ namespace rl::nvg {
             void calculate_joins(const Context* ctx, const f32 w, const LineCap line_join,
                                  const f32 miter_limit) {
                 const PathCache* cache{ ctx->cache };
+                const simd::Kernels& kernels{ simd::kernels() };
+                const bool bevel_corners{ line_join == LineCap::Bevel ||
+                                          line_join == LineCap::Round };
                 f32 iw = 0.0f;
 
                 if (w > 0.0f)
@@ -836,59 +927,10 @@ namespace rl::nvg {
                 // Calculate which joins needs extra vertices to append, and gather vertex count.
                 for (i32 i = 0; i < cache->npaths; i++) {
                     NVGpath* path = &cache->paths[i];
-                    Point* pts = &cache->points[path->first];
-                    const Point* p0 = &pts[path->count - 1];
-                    Point* p1 = &pts[0];
-                    i32 nleft = 0;
-
                     path->nbevel = 0;
 
-                    for (i32 j = 0; j < path->count; j++) {
-                        const f32 dlx0{ p0->dy };
-                        const f32 dly0{ -p0->dx };
-                        const f32 dlx1{ p1->dy };
-                        const f32 dly1{ -p1->dx };
-
-                        // Calculate extrusions
-                        p1->dmx = (dlx0 + dlx1) * 0.5f;
-                        p1->dmy = (dly0 + dly1) * 0.5f;
-
-                        const f32 dmr2 = p1->dmx * p1->dmx + p1->dmy * p1->dmy;
-                        if (dmr2 > 0.000001f) {
-                            f32 scale = 1.0f / dmr2;
-                            if (scale > 600.0f)
-                                scale = 600.0f;
-
-                            p1->dmx *= scale;
-                            p1->dmy *= scale;
-                        }
-
-                        // Clear flags, but keep the corner.
-                        p1->flags = p1->flags & NvgPtCorner ? NvgPtCorner : 0;
-
-                        // Keep track of left turns.
-                        const f32 cross = p1->dx * p0->dy - p0->dx * p1->dy;
-                        if (cross > 0.0f) {
-                            nleft++;
-                            p1->flags |= NvgPtLeft;
-                        }
-
-                        // Calculate if we should use bevel or miter for inner join.
-                        const f32 limit = detail::max(1.01f, detail::min(p0->len, p1->len) * iw);
-                        if (dmr2 * limit * limit < 1.0f)
-                            p1->flags |= NvgPrInnerbevel;
-
-                        // Check to see if the corner needs to be beveled.
-                        if (p1->flags & NvgPtCorner)
-                            if (dmr2 * miter_limit * miter_limit < 1.0f ||
-                                line_join == LineCap::Bevel || line_join == LineCap::Round)
-                                p1->flags |= NvgPtBevel;
-
-                        if ((p1->flags & (NvgPtBevel | NvgPrInnerbevel)) != 0)
-                            path->nbevel++;
-
-                        p0 = p1++;
-                    }
+                    const i32 nleft{ kernels.joins(cache->points, path->first, path->count, iw,
+                                                   miter_limit, bevel_corners, &path->nbevel) };
 
                     path->convex = nleft == path->count ? 1 : 0;
                 }
@@ -940,11 +982,13 @@ namespace rl::nvg {
                 if (verts == nullptr)
                     return 0;
 
+                const simd::Kernels& kernels{ simd::kernels() };
+                constexpr u8 join_mask{ NvgPtBevel | NvgPrInnerbevel };
+
                 for (i32 i = 0; i < cache->npaths; ++i) {
                     NVGpath* path = &cache->paths[i];
-                    Point* pts = &cache->points[path->first];
-                    Point* p0;
-                    Point* p1;
+                    const PointStreams& pts{ cache->points };
+                    const i32 first{ path->first };
                     i32 s, e;
                     f32 dx, dy;
 
@@ -958,46 +1002,49 @@ namespace rl::nvg {
 
                     if (loop) {
                         // Looping
-                        p0 = &pts[path->count - 1];
-                        p1 = &pts[0];
                         s = 0;
                         e = path->count;
                     }
                     else {
                         // Add cap
-                        p0 = &pts[0];
-                        p1 = &pts[1];
                         s = 1;
                         e = path->count - 1;
                     }
 
                     if (loop == 0) {
                         // Add cap
-                        dx = p1->x - p0->x;
-                        dy = p1->y - p0->y;
+                        const Point p0{ detail::load_point(pts, first) };
+                        const Point p1{ detail::load_point(pts, first + 1) };
+                        dx = p1.x - p0.x;
+                        dy = p1.y - p0.y;
                         detail::normalize(&dx, &dy);
                         if (line_cap == LineCap::Butt)
-                            dst = detail::butt_cap_start(dst, p0, dx, dy, w, -aa * 0.5f, aa, u0, u1);
+                            dst = detail::butt_cap_start(dst, &p0, dx, dy, w, -aa * 0.5f, aa, u0,
+                                                         u1);
                         else if (line_cap == LineCap::Butt || line_cap == LineCap::Square)
-                            dst = detail::butt_cap_start(dst, p0, dx, dy, w, w - aa, aa, u0, u1);
+                            dst = detail::butt_cap_start(dst, &p0, dx, dy, w, w - aa, aa, u0, u1);
                         else if (line_cap == LineCap::Round)
-                            dst = detail::round_cap_start(dst, p0, dx, dy, w, ncap, aa, u0, u1);
+                            dst = detail::round_cap_start(dst, &p0, dx, dy, w, ncap, aa, u0, u1);
                     }
 
-                    for (i32 j = s; j < e; ++j) {
-                        if ((p1->flags & (NvgPtBevel | NvgPrInnerbevel)) != 0) {
+                    for (i32 j = s; j < e;) {
+                        const i32 p1{ first + j };
+                        if ((pts.flags[p1] & join_mask) != 0) {
+                            const Point pt0{ detail::load_point(
+                                pts, j == 0 ? first + path->count - 1 : p1 - 1) };
+                            const Point pt1{ detail::load_point(pts, p1) };
                             if (line_join == LineCap::Round)
-                                dst = detail::round_join(dst, p0, p1, w, w, u0, u1, ncap, aa);
+                                dst = detail::round_join(dst, &pt0, &pt1, w, w, u0, u1, ncap, aa);
                             else
-                                dst = detail::bevel_join(dst, p0, p1, w, w, u0, u1, aa);
+                                dst = detail::bevel_join(dst, &pt0, &pt1, w, w, u0, u1, aa);
+                            ++j;
                         }
                         else {
-                            detail::vset(dst, p1->x + p1->dmx * w, p1->y + p1->dmy * w, u0, 1);
-                            dst++;
-                            detail::vset(dst, p1->x - p1->dmx * w, p1->y - p1->dmy * w, u1, 1);
-                            dst++;
+                            const i32 run_end{ detail::straight_run_end(pts.flags, p1, first + e,
+                                                                        join_mask) };
+                            dst = kernels.extrude(dst, pts, p1, run_end, w, w, u0, u1);
+                            j = run_end - first;
                         }
-                        p0 = p1++;
                     }
 
                     if (loop) {
@@ -1009,15 +1056,18 @@ namespace rl::nvg {
                     }
                     else {
                         // Add cap
-                        dx = p1->x - p0->x;
-                        dy = p1->y - p0->y;
+                        const i32 end{ first + detail::max(s, e) };
+                        const Point p0{ detail::load_point(pts, end - 1) };
+                        const Point p1{ detail::load_point(pts, end) };
+                        dx = p1.x - p0.x;
+                        dy = p1.y - p0.y;
                         detail::normalize(&dx, &dy);
                         if (line_cap == LineCap::Butt)
-                            dst = detail::butt_cap_end(dst, p1, dx, dy, w, -aa * 0.5f, aa, u0, u1);
+                            dst = detail::butt_cap_end(dst, &p1, dx, dy, w, -aa * 0.5f, aa, u0, u1);
                         else if (line_cap == LineCap::Butt || line_cap == LineCap::Square)
-                            dst = detail::butt_cap_end(dst, p1, dx, dy, w, w - aa, aa, u0, u1);
+                            dst = detail::butt_cap_end(dst, &p1, dx, dy, w, w - aa, aa, u0, u1);
                         else if (line_cap == LineCap::Round)
-                            dst = detail::round_cap_end(dst, p1, dx, dy, w, ncap, aa, u0, u1);
+                            dst = detail::round_cap_end(dst, &p1, dx, dy, w, ncap, aa, u0, u1);
                     }
 
                     path->nstroke = static_cast<i32>(dst - verts);
@@ -1028,6 +1078,165 @@ namespace rl::nvg {
                 return 1;
             }
 
+            // Direction a segment leaves its start point in and arrives at its end point in. A curve
+            // starting or ending on its own control point uses the next one along the curve, the
+            // stroke geometry shader picks the same directions.
+            void segment_start_dir(const StrokeSegment* seg, f32* dx, f32* dy) {
+                *dx = seg->cx0 - seg->x0;
+                *dy = seg->cy0 - seg->y0;
+                if (*dx * *dx + *dy * *dy < 1e-6f) {
+                    *dx = seg->cx1 - seg->x0;
+                    *dy = seg->cy1 - seg->y0;
+                }
+                if (*dx * *dx + *dy * *dy < 1e-6f) {
+                    *dx = seg->x1 - seg->x0;
+                    *dy = seg->y1 - seg->y0;
+                }
+                detail::normalize(dx, dy);
+            }
+
+            void segment_end_dir(const StrokeSegment* seg, f32* dx, f32* dy) {
+                *dx = seg->x1 - seg->cx1;
+                *dy = seg->y1 - seg->cy1;
+                if (*dx * *dx + *dy * *dy < 1e-6f) {
+                    *dx = seg->x1 - seg->cx0;
+                    *dy = seg->y1 - seg->cy0;
+                }
+                if (*dx * *dx + *dy * *dy < 1e-6f) {
+                    *dx = seg->x1 - seg->x0;
+                    *dy = seg->y1 - seg->y0;
+                }
+                detail::normalize(dx, dy);
+            }
+
+            i32 push_segment(const Context* ctx, i32* nsegments, const StrokeSegment& segment) {
+                PathCache* cache{ ctx->cache };
+                if (*nsegments + 1 > cache->csegments) {
+                    // 1.5x Overallocate
+                    const i32 csegments{ detail::max(*nsegments + 1, 64) + cache->csegments / 2 };
+                    const auto segments{ static_cast<StrokeSegment*>(arena_grow(
+                        cache->arena, cache->segments,
+                        sizeof(StrokeSegment) * static_cast<u64>(*nsegments),
+                        sizeof(StrokeSegment) * static_cast<u64>(csegments))) };
+                    if (segments == nullptr)
+                        return 0;
+                    cache->segments = segments;
+                    cache->csegments = csegments;
+                }
+
+                cache->segments[(*nsegments)++] = segment;
+                return 1;
+            }
+
+            // Links up the segments of a sub-path. Corners get a join, the ends of open
+            // sub-paths a cap, and sub-paths ending on their start point are closed.
+            void finish_segments(const Context* ctx, const i32 first, const i32 end, bool closed) {
+                if (end <= first)
+                    return;
+
+                StrokeSegment* segments{ ctx->cache->segments };
+                StrokeSegment* head{ &segments[first] };
+                const StrokeSegment* tail{ &segments[end - 1] };
+                closed = closed || detail::pt_equals(tail->x1, tail->y1, head->x0, head->y0,
+                                                     ctx->dist_tol);
+
+                for (i32 i = closed ? first : first + 1; i < end; ++i) {
+                    StrokeSegment* seg{ &segments[i] };
+                    const StrokeSegment* prev{ i == first ? tail : &segments[i - 1] };
+                    f32 dx0, dy0, dx1, dy1;
+                    detail::segment_end_dir(prev, &dx0, &dy0);
+                    detail::segment_start_dir(seg, &dx1, &dy1);
+                    // the strips of nearly parallel segments already meet
+                    if (dx0 * dx1 + dy0 * dy1 < 0.99999f) {
+                        seg->join_dx = dx0;
+                        seg->join_dy = dy0;
+                        seg->flags |= SegmentJoin;
+                    }
+                }
+
+                if (!closed) {
+                    head->flags |= SegmentStartCap;
+                    segments[end - 1].flags |= SegmentEndCap;
+                }
+            }
+
+            // Collects the segments of the current path for Params::render_stroke_segments, with
+            // the same point merging and closed path detection as flatten_paths(). Returns the
+            // number of segments, or -1 if they couldn't be allocated.
+            i32 build_stroke_segments(const Context* ctx) {
+                i32 nsegments{ 0 };
+                i32 first{ 0 };
+                bool started{ false };
+                bool closed{ false };
+                f32 startx{ 0.0f };
+                f32 starty{ 0.0f };
+                f32 x{ 0.0f };
+                f32 y{ 0.0f };
+
+                i32 i = 0;
+                while (i < ctx->ncommands) {
+                    const auto cmd = static_cast<Commands>(ctx->commands[i]);
+                    const f32* p{ &ctx->commands[i + 1] };
+                    switch (cmd) {
+                        case Commands::MoveTo:
+                            detail::finish_segments(ctx, first, nsegments, closed);
+                            first = nsegments;
+                            started = true;
+                            closed = false;
+                            startx = x = p[0];
+                            starty = y = p[1];
+                            i += 3;
+                            break;
+                        case Commands::LineTo:
+                            if (started && !detail::pt_equals(x, y, p[0], p[1], ctx->dist_tol)) {
+                                if (!detail::push_segment(ctx, &nsegments,
+                                                          StrokeSegment{ x, y, x, y, p[0], p[1],
+                                                                         p[0], p[1], 0.0f, 0.0f,
+                                                                         SegmentLine }))
+                                    return -1;
+                                x = p[0];
+                                y = p[1];
+                            }
+                            i += 3;
+                            break;
+                        case Commands::Bezierto:
+                            if (started && (!detail::pt_equals(x, y, p[4], p[5], ctx->dist_tol) ||
+                                            !detail::pt_equals(x, y, p[0], p[1], ctx->dist_tol) ||
+                                            !detail::pt_equals(x, y, p[2], p[3], ctx->dist_tol))) {
+                                if (!detail::push_segment(ctx, &nsegments,
+                                                          StrokeSegment{ x, y, p[0], p[1], p[2],
+                                                                         p[3], p[4], p[5] }))
+                                    return -1;
+                                x = p[4];
+                                y = p[5];
+                            }
+                            i += 7;
+                            break;
+                        case Commands::Close:
+                            if (started && !detail::pt_equals(x, y, startx, starty, ctx->dist_tol)) {
+                                if (!detail::push_segment(ctx, &nsegments,
+                                                          StrokeSegment{ x, y, x, y, startx, starty,
+                                                                         startx, starty, 0.0f, 0.0f,
+                                                                         SegmentLine }))
+                                    return -1;
+                                x = startx;
+                                y = starty;
+                            }
+                            closed = started;
+                            i++;
+                            break;
+                        case Commands::Winding:
+                            i += 2;
+                            break;
+                        default:
+                            i++;
+                    }
+                }
+
+                detail::finish_segments(ctx, first, nsegments, closed);
+                return nsegments;
+            }
+
             i32 expand_fill(const Context* ctx, const f32 w, const LineCap lineJoin,
                             const f32 miterLimit) {
                 const PathCache* cache = ctx->cache;
@@ -1051,12 +1260,13 @@ namespace rl::nvg {
                     return 0;
 
                 const auto convex = cache->npaths == 1 && cache->paths[0].convex;
+                const simd::Kernels& kernels{ simd::kernels() };
 
                 for (i = 0; i < cache->npaths; i++) {
                     NVGpath* path = &cache->paths[i];
-                    Point* pts = &cache->points[path->first];
-                    Point* p0;
-                    Point* p1;
+                    const PointStreams& pts{ cache->points };
+                    const i32 first{ path->first };
+                    const i32 last{ first + path->count };
 
                     // Calculate shape vertices.
                     const f32 woff = 0.5f * aa;
@@ -1065,44 +1275,41 @@ namespace rl::nvg {
 
                     if (fringe) {
                         // Looping
-                        p0 = &pts[path->count - 1];
-                        p1 = &pts[0];
-                        for (j = 0; j < path->count; ++j) {
-                            if (p1->flags & NvgPtBevel) {
-                                const f32 dlx0 = p0->dy;
-                                const f32 dly0 = -p0->dx;
-                                const f32 dlx1 = p1->dy;
-                                const f32 dly1 = -p1->dx;
-                                if (p1->flags & NvgPtLeft) {
-                                    const f32 lx = p1->x + p1->dmx * woff;
-                                    const f32 ly = p1->y + p1->dmy * woff;
+                        for (j = first; j < last;) {
+                            if (pts.flags[j] & NvgPtBevel) {
+                                const i32 p0{ j == first ? last - 1 : j - 1 };
+                                const f32 dlx0 = pts.dy[p0];
+                                const f32 dly0 = -pts.dx[p0];
+                                const f32 dlx1 = pts.dy[j];
+                                const f32 dly1 = -pts.dx[j];
+                                if (pts.flags[j] & NvgPtLeft) {
+                                    const f32 lx = pts.x[j] + pts.dmx[j] * woff;
+                                    const f32 ly = pts.y[j] + pts.dmy[j] * woff;
                                     detail::vset(dst, lx, ly, 0.5f, 1);
                                     dst++;
                                 }
                                 else {
-                                    const f32 lx0 = p1->x + dlx0 * woff;
-                                    const f32 ly0 = p1->y + dly0 * woff;
-                                    const f32 lx1 = p1->x + dlx1 * woff;
-                                    const f32 ly1 = p1->y + dly1 * woff;
+                                    const f32 lx0 = pts.x[j] + dlx0 * woff;
+                                    const f32 ly0 = pts.y[j] + dly0 * woff;
+                                    const f32 lx1 = pts.x[j] + dlx1 * woff;
+                                    const f32 ly1 = pts.y[j] + dly1 * woff;
                                     detail::vset(dst, lx0, ly0, 0.5f, 1);
                                     dst++;
                                     detail::vset(dst, lx1, ly1, 0.5f, 1);
                                     dst++;
                                 }
+                                ++j;
                             }
                             else {
-                                detail::vset(dst, p1->x + p1->dmx * woff, p1->y + p1->dmy * woff,
-                                             0.5f, 1);
-                                dst++;
+                                const i32 run_end{ detail::straight_run_end(pts.flags, j, last,
+                                                                            NvgPtBevel) };
+                                dst = kernels.inset(dst, pts, j, run_end, woff);
+                                j = run_end;
                             }
-                            p0 = p1++;
                         }
                     }
                     else
-                        for (j = 0; j < path->count; ++j) {
-                            detail::vset(dst, pts[j].x, pts[j].y, 0.5f, 1);
-                            dst++;
-                        }
+                        dst = kernels.copy(dst, pts, first, last);
 
                     path->nfill = static_cast<i32>(dst - verts);
                     verts = dst;
@@ -1124,19 +1331,21 @@ namespace rl::nvg {
                         }
 
                         // Looping
-                        p0 = &pts[path->count - 1];
-                        p1 = &pts[0];
-
-                        for (j = 0; j < path->count; ++j) {
-                            if ((p1->flags & (NvgPtBevel | NvgPrInnerbevel)) != 0)
-                                dst = bevel_join(dst, p0, p1, lw, rw, lu, ru, ctx->fringe_width);
+                        constexpr u8 join_mask{ NvgPtBevel | NvgPrInnerbevel };
+                        for (j = first; j < last;) {
+                            if ((pts.flags[j] & join_mask) != 0) {
+                                const Point p0{ detail::load_point(pts,
+                                                                   j == first ? last - 1 : j - 1) };
+                                const Point p1{ detail::load_point(pts, j) };
+                                dst = bevel_join(dst, &p0, &p1, lw, rw, lu, ru, ctx->fringe_width);
+                                ++j;
+                            }
                             else {
-                                detail::vset(dst, p1->x + p1->dmx * lw, p1->y + p1->dmy * lw, lu, 1);
-                                dst++;
-                                detail::vset(dst, p1->x - p1->dmx * rw, p1->y - p1->dmy * rw, ru, 1);
-                                dst++;
+                                const i32 run_end{ detail::straight_run_end(pts.flags, j, last,
+                                                                            join_mask) };
+                                dst = kernels.extrude(dst, pts, j, run_end, lw, rw, lu, ru);
+                                j = run_end;
                             }
-                            p0 = p1++;
                         }
 
                         // Loop it
@@ -1191,67 +1400,63 @@ namespace rl::nvg {
                 return (a / d + 0.5f) * d;
             }
 
-            f32 get_font_scale(const State* state) {
+            f32 get_font_scale(const Context* ctx, const State* state) {
+                // distance field glyphs look the same at every scale, the exact one keeps
+                // text in step with the rest of the drawing while the view zooms
+                if (ctx->params.sdf_text)
+                    return get_average_scale(state->xform);
                 return min(quantize(get_average_scale(state->xform), 0.01f), 4.0f);
             }
 
-            void flush_text_texture(const Context* ctx) {
-                i32 dirty[4] = { 0 };
+            ImageFlags font_image_flags(const Context* ctx) {
+                return ctx->params.sdf_text ? ImageFlags::SignedDistance : ImageFlags::None;
+            }
+
+            // Uploads the glyphs rasterized since the last flush, creating the
+            // textures of atlas pages that have been added in the meantime.
+            void flush_text_texture(Context* ctx) {
+                for (i32 page = 0; page < font::atlas_page_count(ctx->fs); ++page) {
+                    i32 dirty[4] = { 0 };
+                    if (font::validate_texture(ctx->fs, page, dirty) == 0)
+                        continue;
+
+                    i32 iw, ih;
+                    const u8* data = font::get_texture_data(ctx->fs, page, &iw, &ih);
+                    if (ctx->font_images[page] == 0)
+                        ctx->font_images[page] = ctx->params.render_create_texture(
+                            ctx->params.user_ptr, TextureProperty::Alpha, iw, ih,
+                            font_image_flags(ctx), nullptr);
 
-                if (font::validate_texture(ctx->fs, dirty)) {
-                    const i32 font_image = ctx->font_images[ctx->font_image_idx];
                     // Update texture
-                    if (font_image != 0) {
-                        i32 iw, ih;
-                        const u8* data = font::get_texture_data(ctx->fs, &iw, &ih);
+                    if (ctx->font_images[page] != 0) {
                         const i32 x = dirty[0];
                         const i32 y = dirty[1];
                         const i32 w = dirty[2] - dirty[0];
                         const i32 h = dirty[3] - dirty[1];
-                        ctx->params.render_update_texture(ctx->params.user_ptr, font_image, x, y, w,
-                                                          h, data);
+                        ctx->params.render_update_texture(ctx->params.user_ptr,
+                                                          ctx->font_images[page], x, y, w, h, data);
                     }
                 }
             }
 
-            i32 alloc_text_atlas(Context* ctx) {
-                flush_text_texture(ctx);
-                if (ctx->font_image_idx >= NvgMaxFontimages - 1)
-                    return 0;
-
-                f32 iw, ih;
-                // if next fontImage already have a texture
-                if (ctx->font_images[ctx->font_image_idx + 1] != 0)
-                    image_size(ctx, ctx->font_images[ctx->font_image_idx + 1], &iw, &ih);
-                else {
-                    // calculate the new font image size and create it.
-                    image_size(ctx, ctx->font_images[ctx->font_image_idx], &iw, &ih);
-                    if (iw > ih)
-                        ih *= 2;
-                    else
-                        iw *= 2;
-
-                    if (iw > static_cast<f32>(NvgMaxFontimageSize) ||
-                        ih > static_cast<f32>(NvgMaxFontimageSize))
-                        iw = ih = NvgMaxFontimageSize;
-
-                    ctx->font_images[ctx->font_image_idx + 1] = ctx->params.render_create_texture(
-                        ctx->params.user_ptr, TextureProperty::Alpha, static_cast<i32>(iw),
-                        static_cast<i32>(ih), ImageFlags::None, nullptr);
-                }
-
-                ++ctx->font_image_idx;
-                font::reset_atlas(ctx->fs, static_cast<i32>(iw), static_cast<i32>(ih));
-
-                return 1;
-            }
+            void flush_deferred(Context* ctx);
 
-            void render_text(Context* ctx, const Vertex* vertices, const i32 vertex_count) {
+            void render_text(Context* ctx, const Vertex* vertices, const i32 vertex_count,
+                             const i32 page) {
                 const State* state = detail::get_state(ctx);
                 PaintStyle paint = state->fill;
 
                 // Render triangles.
-                paint.image = ctx->font_images[ctx->font_image_idx];
+                paint.image = ctx->font_images[page];
+                detail::flush_deferred(ctx);
+
+                if (ctx->params.sdf_text) {
+                    // the renderer blurs and outlines distance field glyphs, in device pixels
+                    const f32 scale{ get_font_scale(ctx, state) * ctx->device_px_ratio };
+                    paint.feather = state->font_blur * scale;
+                    paint.radius = state->text_outline_width * scale;
+                    paint.outer_color = state->text_outline_color;
+                }
 
                 // Apply global alpha
                 paint.inner_color.a *= state->alpha;
@@ -1270,6 +1475,362 @@ namespace rl::nvg {
                 return det < 0;
             }
 
+            u64 hash_bytes(u64 hash, const void* data, const u64 size) {
+                // FNV-1a
+                const auto bytes = static_cast<const u8*>(data);
+                for (u64 i = 0; i < size; ++i)
+                    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+                return hash;
+            }
+
+            bool same_text_run(const TextRun* run, const State* state, const f32 scale,
+                               const std::string_view text, const f32 break_width,
+                               const f32 line_height) {
+                return run->font == state->font_id && run->size == state->font_size &&
+                       run->spacing == state->letter_spacing && run->blur == state->font_blur &&
+                       run->line_height == line_height && run->align == state->text_align &&
+                       run->break_width == break_width && run->scale == scale &&
+                       run->ntext == static_cast<i32>(text.size()) &&
+                       std::memcmp(run->text, text.data(), text.size()) == 0;
+            }
+
+            void clear_text_run(TextRun* run) {
+                run->nquads = 0;
+                run->has_quads = false;
+                run->has_bounds = false;
+                run->nrows = 0;
+                run->has_rows = false;
+            }
+
+            static_assert(std::has_single_bit(static_cast<u32>(NvgTextRunSlots)) &&
+                          NvgTextRunSlots >= NvgMaxTextRuns * 2);
+
+            // Makes the run at index the most recently used one, it must not be linked.
+            void link_text_run(TextRunCache* cache, const i32 index) {
+                TextRun* run = &cache->runs[index];
+                run->newer = -1;
+                run->older = cache->newest;
+                if (cache->newest != -1)
+                    cache->runs[cache->newest].newer = index;
+                else
+                    cache->oldest = index;
+                cache->newest = index;
+            }
+
+            void unlink_text_run(TextRunCache* cache, const i32 index) {
+                TextRun* run = &cache->runs[index];
+                if (run->newer != -1)
+                    cache->runs[run->newer].older = run->older;
+                else
+                    cache->newest = run->older;
+                if (run->older != -1)
+                    cache->runs[run->older].newer = run->newer;
+                else
+                    cache->oldest = run->newer;
+                run->newer = -1;
+                run->older = -1;
+            }
+
+            // Empties the slot of the run at index. The runs probed past it are moved back so
+            // every run stays reachable from its home slot without tombstones.
+            void remove_text_run_slot(TextRunCache* cache, const i32 index) {
+                constexpr u64 mask = NvgTextRunSlots - 1;
+                u64 hole = cache->hashes[index] & mask;
+                while (cache->slots[hole] != index + 1)
+                    hole = (hole + 1) & mask;
+
+                for (u64 slot = (hole + 1) & mask; cache->slots[slot] != 0;
+                     slot = (slot + 1) & mask) {
+                    // runs can only move back as far as their home slot
+                    const u64 home = cache->hashes[cache->slots[slot] - 1] & mask;
+                    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                        cache->slots[hole] = cache->slots[slot];
+                        hole = slot;
+                    }
+                }
+
+                cache->slots[hole] = 0;
+            }
+
+            // Finds the run of the text laid out with the current state, replacing the least
+            // recently used run when it isn't cached. Returns nullptr if it can't be allocated.
+            TextRun* find_text_run(Context* ctx, const State* state, const f32 scale,
+                                   const std::string_view text, const f32 break_width) {
+                constexpr u64 mask = NvgTextRunSlots - 1;
+                TextRunCache* cache = &ctx->text_runs;
+                // only rows are ever spaced out by the line height
+                const f32 line_height = break_width < 0.0f ? 0.0f : state->line_height;
+
+                u64 hash = hash_bytes(0xcbf29ce484222325ull, text.data(), text.size());
+                for (const f32 v : { state->font_size, state->letter_spacing, state->font_blur,
+                                     line_height, break_width, scale })
+                    hash = hash_bytes(hash, &v, sizeof(v));
+                hash = hash_bytes(hash, &state->font_id, sizeof(state->font_id));
+                hash = hash_bytes(hash, &state->text_align, sizeof(state->text_align));
+
+                i32 index = -1;
+                for (u64 slot = hash & mask; cache->slots[slot] != 0; slot = (slot + 1) & mask) {
+                    const i32 i = cache->slots[slot] - 1;
+                    if (cache->hashes[i] == hash &&
+                        same_text_run(&cache->runs[i], state, scale, text, break_width,
+                                      line_height)) {
+                        index = i;
+                        break;
+                    }
+                }
+
+                TextRun* run = nullptr;
+                if (index != -1) {
+                    run = &cache->runs[index];
+                    if (cache->newest != index) {
+                        unlink_text_run(cache, index);
+                        link_text_run(cache, index);
+                    }
+                }
+                else {
+                    if (cache->nruns + 1 > cache->cruns && cache->cruns < NvgMaxTextRuns) {
+                        const i32 cruns = min(max(cache->nruns + 1, 16) + cache->cruns / 2,
+                                              static_cast<i32>(NvgMaxTextRuns));
+                        const auto runs = static_cast<TextRun*>(
+                            std::realloc(cache->runs, sizeof(TextRun) * static_cast<u64>(cruns)));
+                        if (runs != nullptr)
+                            cache->runs = runs;
+                        const auto hashes = static_cast<u64*>(
+                            std::realloc(cache->hashes, sizeof(u64) * static_cast<u64>(cruns)));
+                        if (hashes != nullptr)
+                            cache->hashes = hashes;
+                        if (runs != nullptr && hashes != nullptr) {
+                            for (i32 i = cache->cruns; i < cruns; ++i)
+                                cache->runs[i] = TextRun{};
+                            cache->cruns = cruns;
+                        }
+                    }
+
+                    if (cache->nruns < cache->cruns)
+                        index = cache->nruns++;
+                    else {
+                        if (cache->oldest == -1)
+                            return nullptr;
+                        index = cache->oldest;
+                        unlink_text_run(cache, index);
+                        // runs whose text couldn't be copied aren't in the table
+                        if (cache->runs[index].ntext >= 0)
+                            remove_text_run_slot(cache, index);
+                    }
+
+                    run = &cache->runs[index];
+                    link_text_run(cache, index);
+
+                    const auto copy = static_cast<char*>(
+                        std::realloc(run->text, text.size() + 1));
+                    if (copy == nullptr) {
+                        // the text of the run that was replaced is gone too
+                        run->ntext = -1;
+                        return nullptr;
+                    }
+                    std::memcpy(copy, text.data(), text.size());
+                    copy[text.size()] = '\0';
+
+                    run->text = copy;
+                    run->ntext = static_cast<i32>(text.size());
+                    run->font = state->font_id;
+                    run->size = state->font_size;
+                    run->spacing = state->letter_spacing;
+                    run->blur = state->font_blur;
+                    run->line_height = line_height;
+                    run->align = state->text_align;
+                    run->break_width = break_width;
+                    run->scale = scale;
+                    clear_text_run(run);
+
+                    cache->hashes[index] = hash;
+                    u64 slot = hash & mask;
+                    while (cache->slots[slot] != 0)
+                        slot = (slot + 1) & mask;
+                    cache->slots[slot] = index + 1;
+                }
+
+                const u32 generation = font::glyph_generation(ctx->fs, state->font_id);
+                if (run->generation != generation) {
+                    clear_text_run(run);
+                    run->generation = generation;
+                }
+
+                return run;
+            }
+
+            void free_text_runs(TextRunCache* cache) {
+                for (i32 i = 0; i < cache->cruns; ++i) {
+                    std::free(cache->runs[i].text);
+                    std::free(cache->runs[i].quads);
+                    std::free(cache->runs[i].rows);
+                }
+                std::free(cache->runs);
+                std::free(cache->hashes);
+                *cache = TextRunCache{};
+            }
+
+            // Text is laid out at whole font pixels unless it's drawn with distance fields, so
+            // runs are only moved by whole font pixels too. That keeps their glyphs exactly
+            // where laying them out at the rounded position would have put them.
+            ds::vector2<f32> text_run_offset(const Context* ctx, const ds::point<f32> pos) {
+                if (ctx->params.sdf_text)
+                    return { pos.x, pos.y };
+                return { std::round(pos.x), std::round(pos.y) };
+            }
+
+            // Appends the quads of a line of text with the pen starting at (x, y) to the run,
+            // using the font state that's been set. Returns false when a glyph was left out
+            // because it couldn't be rasterized, the quads then shouldn't be kept.
+            bool layout_text_quads(Context* ctx, TextRun* run, const f32 x, const f32 y,
+                                   const char* str, const char* end, f32* nextx) {
+                // there are never more glyphs than bytes
+                const i32 needed = run->nquads + static_cast<i32>(end - str);
+                if (needed > run->cquads) {
+                    const i32 cquads = max(needed, 32) + run->cquads / 2;
+                    const auto quads = static_cast<font::FontQuad*>(std::realloc(
+                        run->quads, sizeof(font::FontQuad) * static_cast<u64>(cquads)));
+                    if (quads == nullptr)
+                        return false;
+                    run->quads = quads;
+                    run->cquads = cquads;
+                }
+
+                bool complete = true;
+                font::TextIter iter{};
+                font::text_iter_init(ctx->fs, &iter, { x, y }, str, end,
+                                     font::FonsGlyphBitmapRequired);
+                font::FontQuad q{};
+                while (font::text_iter_next(ctx->fs, &iter, &q)) {
+                    if (iter.prev_glyph_index == -1) {
+                        // the font size is too small or every atlas page is full of
+                        // glyphs drawn this frame, the glyph is left out.
+                        complete = false;
+                        continue;
+                    }
+                    run->quads[run->nquads++] = q;
+                }
+
+                if (nextx != nullptr)
+                    *nextx = iter.nextx;
+                return complete;
+            }
+
+            // Breaks the text of a text box run into rows, see text_box().
+            bool break_text_run(Context* ctx, TextRun* run) {
+                if (run->has_rows)
+                    return true;
+
+                State* state = get_state(ctx);
+                const Align old_align = state->text_align;
+                state->text_align = Align::HLeft |
+                                    (state->text_align &
+                                     (Align::VTop | Align::VMiddle | Align::VBottom | Align::VBaseline));
+
+                std::array<TextRow, 16> rows{};
+                const char* str = run->text;
+                const char* end = run->text + run->ntext;
+                run->nrows = 0;
+                bool broken = true;
+                u32 nrows = text_break_lines(ctx, str, end, run->break_width, rows.data(),
+                                             static_cast<u32>(rows.size()));
+                while (nrows > 0) {
+                    const i32 needed = run->nrows + static_cast<i32>(nrows);
+                    if (needed > run->crows) {
+                        const i32 crows = max(needed, 8) + run->crows / 2;
+                        const auto grown = static_cast<TextRunRow*>(std::realloc(
+                            run->rows, sizeof(TextRunRow) * static_cast<u64>(crows)));
+                        if (grown == nullptr) {
+                            broken = false;
+                            break;
+                        }
+                        run->rows = grown;
+                        run->crows = crows;
+                    }
+
+                    for (u32 i = 0; i < nrows; i++) {
+                        run->rows[run->nrows++] = {
+                            .start = static_cast<i32>(rows[i].start - run->text),
+                            .end = static_cast<i32>(rows[i].end - run->text),
+                            .next = static_cast<i32>(rows[i].next - run->text),
+                            .width = rows[i].width,
+                            .min_x = rows[i].min_x,
+                            .max_x = rows[i].max_x,
+                        };
+                    }
+
+                    str = rows[nrows - 1].next;
+                    nrows = text_break_lines(ctx, str, end, run->break_width, rows.data(),
+                                             static_cast<u32>(rows.size()));
+                }
+
+                state->text_align = old_align;
+                run->has_rows = broken;
+                return broken;
+            }
+
+            // Draws the run's quads moved by offset, in font pixels.
+            void draw_text_run(Context* ctx, const TextRun* run, const ds::vector2<f32> offset,
+                               const f32 invscale) {
+                const State* state = get_state(ctx);
+                const i32 cverts = max(2, run->nquads) * 6;
+                Vertex* verts = alloc_temp_verts(ctx, cverts);
+                if (verts == nullptr)
+                    return;
+
+                // the run's glyphs are all in the atlas by now, but the pages they're on may
+                // have been added while laying it out and need their textures before drawing.
+                // TODO: add back-end bit to do this just once per frame.
+                flush_text_texture(ctx);
+
+                const i32 is_flipped = is_transform_flipped(state->xform);
+                i32 nverts = 0;
+                i32 page = 0;
+                for (i32 i = 0; i < run->nquads; ++i) {
+                    font::FontQuad q = run->quads[i];
+                    f32 c[4 * 2]{};
+
+                    // the shelf is still in use, it can't be evicted for glyphs added later on
+                    if (q.shelf >= 0)
+                        font::touch_shelf(ctx->fs, q.shelf);
+
+                    // glyphs on another atlas page go into a draw call of their own
+                    if (q.page != page) {
+                        if (nverts != 0) {
+                            render_text(ctx, verts, nverts, page);
+                            nverts = 0;
+                        }
+                        page = q.page;
+                    }
+
+                    if (is_flipped) {
+                        std::swap(q.y0, q.y1);
+                        std::swap(q.t0, q.t1);
+                    }
+
+                    const f32 x0 = (q.x0 + offset.x) * invscale;
+                    const f32 y0 = (q.y0 + offset.y) * invscale;
+                    const f32 x1 = (q.x1 + offset.x) * invscale;
+                    const f32 y1 = (q.y1 + offset.y) * invscale;
+
+                    // Transform corners.
+                    transform_point(&c[0], &c[1], state->xform, x0, y0);
+                    transform_point(&c[2], &c[3], state->xform, x1, y0);
+                    transform_point(&c[4], &c[5], state->xform, x1, y1);
+                    transform_point(&c[6], &c[7], state->xform, x0, y1);
+
+                    // Create triangles
+                    vset(&verts[nverts++], c[0], c[1], q.s0, q.t0);
+                    vset(&verts[nverts++], c[4], c[5], q.s1, q.t1);
+                    vset(&verts[nverts++], c[2], c[3], q.s1, q.t0);
+                    vset(&verts[nverts++], c[0], c[1], q.s0, q.t0);
+                    vset(&verts[nverts++], c[6], c[7], q.s0, q.t1);
+                    vset(&verts[nverts++], c[4], c[5], q.s1, q.t1);
+                }
+
+                render_text(ctx, verts, nverts, page);
+            }
+
             void isect_rects(f32* dst, const f32 ax, const f32 ay, const f32 aw, const f32 ah,
                              const f32 bx, const f32 by, const f32 bw, const f32 bh) {
                 const f32 minx = detail::max(ax, bx);
@@ -1301,6 +1862,43 @@ namespace rl::nvg {
                 return dx * dx + dy * dy;
             }
 
+            void transform_commands(f32* vals, const i32 nvals, const f32* xform) {
+                i32 i = 0;
+                while (i < nvals) {
+                    const auto cmd{ static_cast<Commands>(static_cast<i32>(vals[i])) };
+                    switch (cmd) {
+                        case Commands::MoveTo:
+                            [[fallthrough]];
+                        case Commands::LineTo:
+                            transform_point(&vals[i + 1], &vals[i + 2], xform, vals[i + 1],
+                                            vals[i + 2]);
+                            i += 3;
+                            break;
+
+                        case Commands::Bezierto:
+                            transform_point(&vals[i + 1], &vals[i + 2], xform, vals[i + 1],
+                                            vals[i + 2]);
+                            transform_point(&vals[i + 3], &vals[i + 4], xform, vals[i + 3],
+                                            vals[i + 4]);
+                            transform_point(&vals[i + 5], &vals[i + 6], xform, vals[i + 5],
+                                            vals[i + 6]);
+                            i += 7;
+                            break;
+
+                        case Commands::Close:
+                            i++;
+                            break;
+
+                        case Commands::Winding:
+                            i += 2;
+                            break;
+
+                        default:
+                            i++;
+                    }
+                }
+            }
+
             void append_commands(Context* ctx, f32* vals, const i32 nvals) {
                 const State* state = detail::get_state(ctx);
                 if (ctx->ncommands + nvals > ctx->ccommands) {
@@ -1311,54 +1909,507 @@ namespace rl::nvg {
                     if (commands == nullptr)
                         return;
 
-                    ctx->commands = commands;
-                    ctx->ccommands = ccommands;
-                }
+                    ctx->commands = commands;
+                    ctx->ccommands = ccommands;
+                }
+
+                const i32 val = static_cast<i32>(vals[0]);
+                if (val != Commands::Close && val != Commands::Winding) {
+                    ctx->commandx = vals[nvals - 2];
+                    ctx->commandy = vals[nvals - 1];
+                }
+
+                // transform commands
+                transform_commands(vals, nvals, state->xform);
+
+                std::memcpy(&ctx->commands[ctx->ncommands], vals, nvals * sizeof(f32));
+                ctx->ncommands += nvals;
+            }
+
+            RetainedPath* find_retained_path(const Context* ctx, const PathHandle id) {
+                if (id == 0)
+                    return nullptr;
+
+                for (i32 i = 0; i < ctx->nretained_paths; i++)
+                    if (ctx->retained_paths[i].id == id)
+                        return &ctx->retained_paths[i];
+
+                return nullptr;
+            }
+
+            void release_retained_geometry(const Context* ctx, RetainedPath* path) {
+                if (path->fill_geometry != 0)
+                    ctx->params.render_delete_geometry(ctx->params.user_ptr, path->fill_geometry);
+                if (path->stroke_geometry != 0)
+                    ctx->params.render_delete_geometry(ctx->params.user_ptr, path->stroke_geometry);
+
+                path->fill_geometry = 0;
+                path->stroke_geometry = 0;
+            }
+
+            // Copies the current path into the retained path. The commands are stored in screen
+            // space, so they're mapped back into the local space of the current transform.
+            i32 record_retained_path(Context* ctx, RetainedPath* path) {
+                f32 inverse[6]{};
+                if (transform_inverse(inverse, get_state(ctx)->xform) == 0)
+                    return 0;
+
+                const auto commands{ static_cast<f32*>(std::realloc(
+                    path->commands, sizeof(f32) * static_cast<uint64_t>(max(ctx->ncommands, 1)))) };
+                if (commands == nullptr)
+                    return 0;
+
+                std::memcpy(commands, ctx->commands, sizeof(f32) * ctx->ncommands);
+                transform_commands(commands, ctx->ncommands, inverse);
+
+                path->commands = commands;
+                path->ncommands = ctx->ncommands;
+                return 1;
+            }
+
+            // The cached geometry is expanded in local space, where the width of the anti-aliased
+            // fringe depends on the scale the path is drawn at. Small differences are tolerated
+            // so rotated paths don't get tessellated again every frame due to rounding.
+            bool retained_param_changed(const f32 cached, const f32 current) {
+                return absf(cached - current) > max(cached, current) * 0.01f;
+            }
+
+            // Flattens and expands a retained path through the path cache and hands the result
+            // to the backend. The tolerances are scaled so the local space geometry has the same
+            // precision on screen as a path built with the current transform would. A stroke
+            // width of 0 expands the fill geometry.
+            i32 create_retained_geometry(Context* ctx, const RetainedPath* path, const f32 scale,
+                                         const f32 fringe, const f32 stroke_width) {
+                const State* state{ get_state(ctx) };
+                f32* commands{ ctx->commands };
+                const i32 ncommands{ ctx->ncommands };
+                const f32 tess_tol{ ctx->tess_tol };
+                const f32 dist_tol{ ctx->dist_tol };
+                const f32 fringe_width{ ctx->fringe_width };
+
+                ctx->commands = path->commands;
+                ctx->ncommands = path->ncommands;
+                ctx->tess_tol = tess_tol / scale;
+                ctx->dist_tol = dist_tol / scale;
+                // expand_fill() offsets the fill by half of the context's fringe width
+                ctx->fringe_width = fringe_width / scale;
+                clear_path_cache(ctx);
+
+                flatten_paths(ctx);
+                if (stroke_width > 0.0f)
+                    expand_stroke(ctx, stroke_width * 0.5f, fringe, state->line_cap,
+                                  state->line_join, state->miter_limit);
+                else
+                    expand_fill(ctx, fringe, LineCap::Miter, 2.4f);
+
+                const i32 geometry{ ctx->params.render_create_geometry(
+                    ctx->params.user_ptr, ctx->cache->bounds, ctx->cache->paths,
+                    ctx->cache->npaths) };
+
+                // The current path is flattened again the next time it's drawn.
+                ctx->commands = commands;
+                ctx->ncommands = ncommands;
+                ctx->tess_tol = tess_tol;
+                ctx->dist_tol = dist_tol;
+                ctx->fringe_width = fringe_width;
+                clear_path_cache(ctx);
+
+                return geometry;
+            }
+        }
+    }
+
+    // Output of one tessellation thread during a deferred flush. Path vertex pointers are
+    // stored as offsets while the arena can still grow and resolved when the paths are
+    // submitted.
+    struct TessellationWorker {
+        Context* ctx{ nullptr };
+        NVGpath* paths{ nullptr };
+        i32* path_verts{ nullptr };
+        i32 npaths{ 0 };
+        i32 cpaths{ 0 };
+        Vertex* verts{ nullptr };
+        i32 nverts{ 0 };
+        i32 cverts{ 0 };
+    };
+
+    // Worker threads for deferred tessellation. The thread flushing the draws works alongside
+    // them as worker 0, each worker tessellates with its own context and path cache.
+    struct TessellationPool {
+        std::vector<std::jthread> threads{};
+        std::vector<TessellationWorker> workers{};
+        std::mutex mutex{};
+        std::condition_variable wake{};
+        std::condition_variable done{};
+        u64 generation{ 0 };
+        i32 busy{ 0 };
+        bool stop{ false };
+
+        DeferredDraw* draws{ nullptr };
+        f32* commands{ nullptr };
+        i32 ndraws{ 0 };
+        std::atomic<i32> next_draw{ 0 };
+    };
+
+    namespace {
+        namespace detail {
+            // Batches smaller than this are tessellated on the calling thread.
+            constexpr i32 DeferredParallelThreshold{ 16 };
+            constexpr u32 MaxTessellationThreads{ 7 };
+
+            i32 reserve_worker_output(TessellationWorker* w, const i32 npaths, const i32 nverts) {
+                if (w->npaths + npaths > w->cpaths) {
+                    // 1.5x Overallocate
+                    const i32 cpaths{ w->npaths + npaths + w->cpaths / 2 };
+                    const auto paths{ static_cast<NVGpath*>(
+                        std::realloc(w->paths, sizeof(NVGpath) * static_cast<u64>(cpaths))) };
+                    if (paths == nullptr)
+                        return 0;
+                    w->paths = paths;
+
+                    const auto path_verts{ static_cast<i32*>(
+                        std::realloc(w->path_verts, sizeof(i32) * 2 * static_cast<u64>(cpaths))) };
+                    if (path_verts == nullptr)
+                        return 0;
+                    w->path_verts = path_verts;
+                    w->cpaths = cpaths;
+                }
+
+                if (w->nverts + nverts > w->cverts) {
+                    // 1.5x Overallocate
+                    const i32 cverts{ w->nverts + nverts + w->cverts / 2 };
+                    const auto verts{ static_cast<Vertex*>(
+                        std::realloc(w->verts, sizeof(Vertex) * static_cast<u64>(cverts))) };
+                    if (verts == nullptr)
+                        return 0;
+                    w->verts = verts;
+                    w->cverts = cverts;
+                }
+
+                return 1;
+            }
+
+            void tessellate_deferred(TessellationWorker* w, const i32 worker, DeferredDraw* draw,
+                                     f32* commands) {
+                Context* ctx{ w->ctx };
+                ctx->commands = commands + draw->first_command;
+                ctx->ncommands = draw->ncommands;
+                ctx->tess_tol = draw->tess_tol;
+                ctx->dist_tol = draw->dist_tol;
+                ctx->fringe_width = draw->fringe_width;
+                clear_path_cache(ctx);
+
+                draw->worker = worker;
+                draw->first_path = w->npaths;
+                draw->npaths = 0;
+
+                flatten_paths(ctx);
+                const i32 expanded{ draw->stroke
+                                        ? expand_stroke(ctx, draw->stroke_width * 0.5f,
+                                                        draw->fringe, draw->line_cap,
+                                                        draw->line_join, draw->miter_limit)
+                                        : expand_fill(ctx, draw->fringe, LineCap::Miter, 2.4f) };
+                if (expanded == 0)
+                    return;
+
+                const PathCache* cache{ ctx->cache };
+                i32 nverts{ 0 };
+                for (i32 i = 0; i < cache->npaths; ++i) {
+                    const NVGpath* path{ &cache->paths[i] };
+                    if (path->fill != nullptr)
+                        nverts = detail::max(
+                            nverts, static_cast<i32>(path->fill - cache->verts) + path->nfill);
+                    if (path->stroke != nullptr)
+                        nverts = detail::max(
+                            nverts, static_cast<i32>(path->stroke - cache->verts) + path->nstroke);
+                }
+
+                if (!reserve_worker_output(w, cache->npaths, nverts))
+                    return;
+
+                std::memcpy(w->verts + w->nverts, cache->verts,
+                            sizeof(Vertex) * static_cast<u64>(nverts));
+                for (i32 i = 0; i < cache->npaths; ++i) {
+                    const NVGpath* path{ &cache->paths[i] };
+                    const i32 idx{ w->npaths + i };
+                    w->paths[idx] = *path;
+                    w->path_verts[idx * 2 + 0] =
+                        path->fill != nullptr
+                            ? w->nverts + static_cast<i32>(path->fill - cache->verts)
+                            : -1;
+                    w->path_verts[idx * 2 + 1] =
+                        path->stroke != nullptr
+                            ? w->nverts + static_cast<i32>(path->stroke - cache->verts)
+                            : -1;
+                }
+
+                std::memcpy(draw->bounds, cache->bounds, sizeof(draw->bounds));
+                draw->npaths = cache->npaths;
+                w->npaths += cache->npaths;
+                w->nverts += nverts;
+            }
+
+            // Draws are handed out one at a time, every draw only depends on its own commands
+            // and state so the output doesn't depend on which worker picked it up.
+            void run_tessellation_jobs(TessellationPool* pool, const i32 worker) {
+                TessellationWorker* w{ &pool->workers[static_cast<u64>(worker)] };
+                for (i32 i = pool->next_draw.fetch_add(1, std::memory_order_relaxed);
+                     i < pool->ndraws; i = pool->next_draw.fetch_add(1, std::memory_order_relaxed))
+                    tessellate_deferred(w, worker, &pool->draws[i], pool->commands);
+            }
+
+            void tessellation_thread(TessellationPool* pool, const i32 worker) {
+                u64 generation{ 0 };
+                while (true) {
+                    {
+                        std::unique_lock lock{ pool->mutex };
+                        pool->wake.wait(lock, [&] {
+                            return pool->stop || pool->generation != generation;
+                        });
+                        if (pool->stop)
+                            return;
+                        generation = pool->generation;
+                    }
+
+                    run_tessellation_jobs(pool, worker);
+
+                    std::scoped_lock lock{ pool->mutex };
+                    if (--pool->busy == 0)
+                        pool->done.notify_one();
+                }
+            }
+
+            void delete_tessellation_pool(TessellationPool* pool) {
+                if (pool == nullptr)
+                    return;
+
+                {
+                    std::scoped_lock lock{ pool->mutex };
+                    pool->stop = true;
+                }
+                pool->wake.notify_all();
+                pool->threads.clear();
+
+                for (TessellationWorker& w : pool->workers) {
+                    if (w.ctx != nullptr) {
+                        if (w.ctx->cache != nullptr)
+                            delete_path_cache(w.ctx->cache);
+                        arena_release(&w.ctx->arena);
+                        delete w.ctx;
+                    }
+                    std::free(w.paths);
+                    std::free(w.path_verts);
+                    std::free(w.verts);
+                }
+
+                delete pool;
+            }
+
+            TessellationPool* create_tessellation_pool() {
+                const u32 nthreads{ detail::min(
+                    detail::max(std::thread::hardware_concurrency(), 1u) - 1,
+                    MaxTessellationThreads) };
+
+                const auto pool{ new TessellationPool{} };
+                pool->workers.resize(nthreads + 1);
+                for (TessellationWorker& w : pool->workers) {
+                    // only the tessellation state of the worker contexts is ever used
+                    w.ctx = new Context{};
+                    w.ctx->cache = alloc_path_cache(&w.ctx->arena);
+                    if (w.ctx->cache == nullptr) {
+                        delete_tessellation_pool(pool);
+                        return nullptr;
+                    }
+                }
+
+                for (u32 i = 1; i <= nthreads; ++i)
+                    pool->threads.emplace_back(tessellation_thread, pool, static_cast<i32>(i));
+
+                return pool;
+            }
+
+            void defer_draw(Context* ctx, const PaintStyle* paint, const State* state,
+                            const f32 fringe, const f32 stroke_width, const bool stroke) {
+                if (ctx->ndeferred_draws + 1 > ctx->cdeferred_draws) {
+                    // 1.5x Overallocate
+                    const i32 cdraws{ ctx->ndeferred_draws + 1 + ctx->cdeferred_draws / 2 };
+                    const auto draws{ static_cast<DeferredDraw*>(arena_grow(
+                        &ctx->arena, ctx->deferred_draws,
+                        sizeof(DeferredDraw) * static_cast<u64>(ctx->ndeferred_draws),
+                        sizeof(DeferredDraw) * static_cast<u64>(cdraws))) };
+                    if (draws == nullptr)
+                        return;
+                    ctx->deferred_draws = draws;
+                    ctx->cdeferred_draws = cdraws;
+                }
+
+                if (ctx->ndeferred_commands + ctx->ncommands > ctx->cdeferred_commands) {
+                    // 1.5x Overallocate
+                    const i32 ccommands{ ctx->ndeferred_commands + ctx->ncommands +
+                                         ctx->cdeferred_commands / 2 };
+                    const auto commands{ static_cast<f32*>(arena_grow(
+                        &ctx->arena, ctx->deferred_commands,
+                        sizeof(f32) * static_cast<u64>(ctx->ndeferred_commands),
+                        sizeof(f32) * static_cast<u64>(ccommands))) };
+                    if (commands == nullptr)
+                        return;
+                    ctx->deferred_commands = commands;
+                    ctx->cdeferred_commands = ccommands;
+                }
+
+                std::memcpy(ctx->deferred_commands + ctx->ndeferred_commands, ctx->commands,
+                            sizeof(f32) * static_cast<u64>(ctx->ncommands));
+
+                ctx->deferred_draws[ctx->ndeferred_draws++] = DeferredDraw{
+                    .paint = *paint,
+                    .composite_operation = state->composite_operation,
+                    .scissor = state->scissor,
+                    .first_command = ctx->ndeferred_commands,
+                    .ncommands = ctx->ncommands,
+                    .stroke = stroke,
+                    .tess_tol = ctx->tess_tol,
+                    .dist_tol = ctx->dist_tol,
+                    .fringe_width = ctx->fringe_width,
+                    .fringe = fringe,
+                    .stroke_width = stroke_width,
+                    .miter_limit = state->miter_limit,
+                    .line_join = state->line_join,
+                    .line_cap = state->line_cap,
+                };
+                ctx->ndeferred_commands += ctx->ncommands;
+            }
+
+            // Tessellates all pending deferred draws and submits them to the backend in the
+            // order they were recorded.
+            void flush_deferred(Context* ctx) {
+                if (ctx->ndeferred_draws == 0)
+                    return;
+
+                TessellationPool* pool{ ctx->tess_pool };
+                if (pool == nullptr) {
+                    ctx->tess_pool = pool = create_tessellation_pool();
+                    if (pool == nullptr) {
+                        ctx->ndeferred_draws = 0;
+                        ctx->ndeferred_commands = 0;
+                        return;
+                    }
+                }
+
+                for (TessellationWorker& w : pool->workers) {
+                    w.npaths = 0;
+                    w.nverts = 0;
+                }
+
+                pool->draws = ctx->deferred_draws;
+                pool->commands = ctx->deferred_commands;
+                pool->ndraws = ctx->ndeferred_draws;
+                pool->next_draw.store(0, std::memory_order_relaxed);
+
+                if (pool->threads.empty() || ctx->ndeferred_draws < DeferredParallelThreshold)
+                    run_tessellation_jobs(pool, 0);
+                else {
+                    {
+                        std::scoped_lock lock{ pool->mutex };
+                        pool->busy = static_cast<i32>(pool->threads.size());
+                        pool->generation++;
+                    }
+                    pool->wake.notify_all();
+
+                    run_tessellation_jobs(pool, 0);
 
-                const i32 val = static_cast<i32>(vals[0]);
-                if (val != Commands::Close && val != Commands::Winding) {
-                    ctx->commandx = vals[nvals - 2];
-                    ctx->commandy = vals[nvals - 1];
+                    std::unique_lock lock{ pool->mutex };
+                    pool->done.wait(lock, [&] { return pool->busy == 0; });
                 }
 
-                // transform commands
-                i32 i = 0;
-                while (i < nvals) {
-                    const auto cmd{ static_cast<Commands>(static_cast<i32>(vals[i])) };
-                    switch (cmd) {
-                        case Commands::MoveTo:
-                            [[fallthrough]];
-                        case Commands::LineTo:
-                            transform_point(&vals[i + 1], &vals[i + 2], state->xform, vals[i + 1],
-                                            vals[i + 2]);
-                            i += 3;
-                            break;
+                for (i32 i = 0; i < ctx->ndeferred_draws; ++i) {
+                    const DeferredDraw* draw{ &ctx->deferred_draws[i] };
+                    if (draw->npaths == 0)
+                        continue;
+
+                    const TessellationWorker* w{ &pool->workers[static_cast<u64>(draw->worker)] };
+                    NVGpath* paths{ w->paths + draw->first_path };
+                    const i32* path_verts{ w->path_verts + draw->first_path * 2 };
+                    for (i32 j = 0; j < draw->npaths; ++j) {
+                        paths[j].fill = path_verts[j * 2] >= 0 ? w->verts + path_verts[j * 2]
+                                                                : nullptr;
+                        paths[j].stroke = path_verts[j * 2 + 1] >= 0
+                                            ? w->verts + path_verts[j * 2 + 1]
+                                            : nullptr;
+                    }
 
-                        case Commands::Bezierto:
-                            transform_point(&vals[i + 1], &vals[i + 2], state->xform, vals[i + 1],
-                                            vals[i + 2]);
-                            transform_point(&vals[i + 3], &vals[i + 4], state->xform, vals[i + 3],
-                                            vals[i + 4]);
-                            transform_point(&vals[i + 5], &vals[i + 6], state->xform, vals[i + 5],
-                                            vals[i + 6]);
-                            i += 7;
-                            break;
+                    if (draw->stroke) {
+                        ctx->params.render_stroke(ctx->params.user_ptr, &draw->paint,
+                                                  draw->composite_operation, &draw->scissor,
+                                                  draw->fringe_width, draw->stroke_width, paths,
+                                                  draw->npaths);
 
-                        case Commands::Close:
-                            i++;
-                            break;
+                        // Count triangles
+                        for (i32 j = 0; j < draw->npaths; j++) {
+                            ctx->stroke_tri_count += paths[j].nstroke - 2;
+                            ctx->draw_call_count++;
+                        }
+                    }
+                    else {
+                        ctx->params.render_fill(ctx->params.user_ptr, &draw->paint,
+                                                draw->composite_operation, &draw->scissor,
+                                                draw->fringe_width, draw->bounds, paths,
+                                                draw->npaths);
+
+                        // Count triangles
+                        for (i32 j = 0; j < draw->npaths; j++) {
+                            ctx->fill_tri_count += paths[j].nfill - 2;
+                            ctx->fill_tri_count += paths[j].nstroke - 2;
+                            ctx->draw_call_count += 2;
+                        }
+                    }
+                }
 
-                        case Commands::Winding:
-                            i += 2;
-                            break;
+                ctx->ndeferred_draws = 0;
+                ctx->ndeferred_commands = 0;
+            }
 
-                        default:
-                            i++;
-                    }
+            void free_spills(FrameArena* arena) {
+                while (arena->spills != nullptr) {
+                    void* next{ *static_cast<void**>(arena->spills) };
+                    std::free(arena->spills);
+                    arena->spills = next;
                 }
+            }
 
-                std::memcpy(&ctx->commands[ctx->ncommands], vals, nvals * sizeof(f32));
-                ctx->ncommands += nvals;
+            // Drops everything allocated this frame. The path cache and the deferred draw
+            // buffers are carved back out of the arena at the sizes they grew to.
+            void reset_frame_arena(Context* ctx) {
+                PathCache* cache{ ctx->cache };
+                const i32 cpoints{ cache->cpoints };
+                const i32 cpaths{ cache->cpaths };
+                const i32 cverts{ cache->cverts };
+                const i32 csegments{ cache->csegments };
+                const i32 cdraws{ ctx->cdeferred_draws };
+                const i32 ccommands{ ctx->cdeferred_commands };
+
+                arena_reset(&ctx->arena);
+                reserve_path_cache(cache, cpoints, cpaths, cverts);
+                if (csegments > 0)
+                    cache->segments = static_cast<StrokeSegment*>(arena_alloc(
+                        &ctx->arena, sizeof(StrokeSegment) * static_cast<u64>(csegments)));
+                cache->csegments = cache->segments != nullptr ? csegments : 0;
+
+                ctx->deferred_draws = nullptr;
+                ctx->deferred_commands = nullptr;
+                ctx->ndeferred_draws = 0;
+                ctx->ndeferred_commands = 0;
+                if (cdraws > 0)
+                    ctx->deferred_draws = static_cast<DeferredDraw*>(
+                        arena_alloc(&ctx->arena, sizeof(DeferredDraw) * static_cast<u64>(cdraws)));
+                if (ccommands > 0)
+                    ctx->deferred_commands = static_cast<f32*>(
+                        arena_alloc(&ctx->arena, sizeof(f32) * static_cast<u64>(ccommands)));
+                ctx->cdeferred_draws = ctx->deferred_draws != nullptr ? cdraws : 0;
+                ctx->cdeferred_commands = ctx->deferred_commands != nullptr ? ccommands : 0;
+
+                if (ctx->tess_pool != nullptr)
+                    for (const TessellationWorker& w : ctx->tess_pool->workers)
+                        reset_frame_arena(w.ctx);
             }
         }
     }
@@ -1376,7 +2427,7 @@ namespace rl::nvg {
                 ctx->ncommands = 0;
                 ctx->ccommands = NvgInitCommandsSize;
 
-                ctx->cache = detail::alloc_path_cache();
+                ctx->cache = detail::alloc_path_cache(&ctx->arena);
                 if (ctx->cache != nullptr) {
                     save(ctx);
                     reset(ctx);
@@ -1385,9 +2436,10 @@ namespace rl::nvg {
                     if (ctx->params.render_create(ctx->params.user_ptr) != 0) {
                         // Init font rendering
                         std::memset(&font_params, 0, sizeof(font_params));
-                        font_params.width = NvgInitFontimageSize;
-                        font_params.height = NvgInitFontimageSize;
-                        font_params.flags = font::FonsZeroTopleft;
+                        font_params.width = NvgFontPageSize;
+                        font_params.height = NvgFontPageSize;
+                        font_params.flags = static_cast<u8>(
+                            font::FonsZeroTopleft | (ctx->params.sdf_text ? font::FonsSdf : 0));
                         font_params.render_create = nullptr;
                         font_params.render_update = nullptr;
                         font_params.render_draw = nullptr;
@@ -1399,12 +2451,10 @@ namespace rl::nvg {
                             // Create font texture
                             ctx->font_images[0] = ctx->params.render_create_texture(
                                 ctx->params.user_ptr, TextureProperty::Alpha, font_params.width,
-                                font_params.height, ImageFlags::None, nullptr);
+                                font_params.height, detail::font_image_flags(ctx), nullptr);
 
-                            if (ctx->font_images[0] != 0) {
-                                ctx->font_image_idx = 0;
+                            if (ctx->font_images[0] != 0)
                                 return ctx;
-                            }
                         }
                     }
                 }
@@ -1420,6 +2470,72 @@ namespace rl::nvg {
         return &ctx->params;
     }
 
+    void* arena_alloc(FrameArena* arena, u64 size) {
+        size = (size + 15) & ~static_cast<u64>(15);
+        arena->used += size;
+
+        if (arena->offset + size <= arena->capacity) {
+            arena->last = arena->offset;
+            arena->offset += size;
+            return arena->block + arena->last;
+        }
+
+        // spilled blocks are chained through their first 16 bytes
+        const auto spill{ static_cast<u8*>(std::malloc(size + 16)) };
+        if (spill == nullptr)
+            return nullptr;
+
+        *reinterpret_cast<void**>(spill) = arena->spills;
+        arena->spills = spill;
+        arena->nspills++;
+        return spill + 16;
+    }
+
+    void* arena_grow(FrameArena* arena, void* data, const u64 used, u64 size) {
+        if (data != nullptr && data == arena->block + arena->last) {
+            size = (size + 15) & ~static_cast<u64>(15);
+            if (arena->last + size <= arena->capacity) {
+                arena->used += arena->last + size - arena->offset;
+                arena->offset = arena->last + size;
+                return data;
+            }
+        }
+
+        void* grown{ arena_alloc(arena, size) };
+        if (grown != nullptr && data != nullptr && used > 0)
+            std::memcpy(grown, data, used);
+        return grown;
+    }
+
+    void arena_reset(FrameArena* arena) {
+        detail::free_spills(arena);
+
+        arena->peak = detail::max(arena->peak, arena->used);
+        if (arena->peak > arena->capacity) {
+            // rounded up so a slowly growing peak doesn't reallocate every frame
+            const u64 capacity{ (arena->peak + 0xffff) & ~static_cast<u64>(0xffff) };
+            std::free(arena->block);
+            arena->block = static_cast<u8*>(std::malloc(capacity));
+            arena->capacity = arena->block != nullptr ? capacity : 0;
+        }
+
+        arena->last_used = arena->used;
+        arena->used = 0;
+        arena->offset = 0;
+        arena->last = 0;
+        arena->nspills = 0;
+    }
+
+    void arena_release(FrameArena* arena) {
+        detail::free_spills(arena);
+        std::free(arena->block);
+        *arena = FrameArena{};
+    }
+
+    const FrameArena& frame_arena(const Context* ctx) {
+        return ctx->arena;
+    }
+
     void delete_internal(Context* ctx) {
         if (ctx == nullptr)
             return;
@@ -1427,6 +2543,16 @@ namespace rl::nvg {
             std::free(ctx->commands);
         if (ctx->cache != nullptr)
             detail::delete_path_cache(ctx->cache);
+        if (ctx->tess_pool != nullptr)
+            detail::delete_tessellation_pool(ctx->tess_pool);
+        arena_release(&ctx->arena);
+        if (ctx->retained_paths != nullptr) {
+            // the geometry is released with the backend
+            for (i32 i = 0; i < ctx->nretained_paths; i++)
+                std::free(ctx->retained_paths[i].commands);
+            std::free(ctx->retained_paths);
+        }
+        detail::free_text_runs(&ctx->text_runs);
         if (ctx->fs)
             font::delete_internal(ctx->fs);
 
@@ -1453,52 +2579,25 @@ namespace rl::nvg {
         detail::set_device_pixel_ratio(ctx, device_pixel_ratio);
         ctx->params.render_viewport(ctx->params.user_ptr, window_width, window_height,
                                     device_pixel_ratio);
+        font::next_frame(ctx->fs);
 
         ctx->draw_call_count = 0;
         ctx->fill_tri_count = 0;
         ctx->stroke_tri_count = 0;
         ctx->text_tri_count = 0;
+        ctx->ndeferred_draws = 0;
+        ctx->ndeferred_commands = 0;
     }
 
-    void cancel_frame(const Context* ctx) {
+    void cancel_frame(Context* ctx) {
         ctx->params.render_cancel(ctx->params.user_ptr);
+        detail::reset_frame_arena(ctx);
     }
 
     void end_frame(Context* ctx) {
+        detail::flush_deferred(ctx);
         ctx->params.render_flush(ctx->params.user_ptr);
-        if (ctx->font_image_idx != 0) {
-            const i32 font_image = ctx->font_images[ctx->font_image_idx];
-            ctx->font_images[ctx->font_image_idx] = 0;
-
-            // delete images that smaller than current one
-            if (font_image == 0)
-                return;
-
-            f32 iw{ 0.0f };
-            f32 ih{ 0.0f };
-            image_size(ctx, font_image, &iw, &ih);
-
-            i32 j = 0;
-            for (i32 i = 0; i < ctx->font_image_idx; i++) {
-                if (ctx->font_images[i] != 0) {
-                    const i32 image = ctx->font_images[i];
-                    ctx->font_images[i] = 0;
-
-                    f32 nw, nh;
-                    image_size(ctx, image, &nw, &nh);
-
-                    if (nw < iw || nh < ih)
-                        delete_image(ctx, image);
-                    else
-                        ctx->font_images[j++] = image;
-                }
-            }
-
-            // make current font image to first
-            ctx->font_images[j] = ctx->font_images[0];
-            ctx->font_images[0] = font_image;
-            ctx->font_image_idx = 0;
-        }
+        detail::reset_frame_arena(ctx);
     }
 
     ds::color<f32> trans_rgba(ds::color<f32> c0, const u8 a) {
@@ -1722,6 +2821,8 @@ namespace rl::nvg {
         state->letter_spacing = 0.0f;
         state->line_height = 1.0f;
         state->font_blur = 0.0f;
+        state->text_outline_width = 0.0f;
+        state->text_outline_color = { 0, 0, 0, 0 };
         state->text_align = Align::HLeft | Align::VBaseline;
         state->font_id = 0;
     }
@@ -1732,6 +2833,12 @@ namespace rl::nvg {
         state->shape_anti_alias = enabled;
     }
 
+    void deferred_tessellation(Context* ctx, const bool enabled) {
+        if (!enabled)
+            detail::flush_deferred(ctx);
+        ctx->deferred_tessellation = enabled;
+    }
+
     void stroke_width(Context* ctx, const f32 width) {
         State* state = detail::get_state(ctx);
         state->stroke_width = width;
@@ -2130,9 +3237,9 @@ namespace rl::nvg {
         detail::append_commands(ctx, vals.data(), static_cast<i32>(vals.size()));
     }
 
-    void bezier_to(Context* ctx, const f32, const f32, const f32, const f32, const f32 x,
-                   const f32 y) {
-        auto vals = std::array{ static_cast<f32>(Commands::Bezierto), x, y };
+    void bezier_to(Context* ctx, const f32 c1_x, const f32 c1_y, const f32 c2_x, const f32 c2_y,
+                   const f32 x, const f32 y) {
+        auto vals = std::array{ static_cast<f32>(Commands::Bezierto), c1_x, c1_y, c2_x, c2_y, x, y };
         detail::append_commands(ctx, vals.data(), static_cast<i32>(vals.size()));
     }
 
@@ -2488,6 +3595,17 @@ namespace rl::nvg {
         const State* state = detail::get_state(ctx);
         PaintStyle fill_paint = state->fill;
 
+        if (ctx->deferred_tessellation) {
+            // Apply global alpha
+            fill_paint.inner_color.a *= state->alpha;
+            fill_paint.outer_color.a *= state->alpha;
+
+            const bool aa{ ctx->params.edge_anti_alias && state->shape_anti_alias };
+            detail::defer_draw(ctx, &fill_paint, state, aa ? ctx->fringe_width : 0.0f, 0.0f,
+                               false);
+            return;
+        }
+
         detail::flatten_paths(ctx);
         if (ctx->params.edge_anti_alias && state->shape_anti_alias)
             detail::expand_fill(ctx, ctx->fringe_width, LineCap::Miter, 2.4f);
@@ -2530,6 +3648,31 @@ namespace rl::nvg {
         stroke_paint.inner_color.a *= state->alpha;
         stroke_paint.outer_color.a *= state->alpha;
 
+        // The backend expands the path's segments itself, nothing is tessellated here.
+        if (ctx->params.render_stroke_segments != nullptr) {
+            detail::flush_deferred(ctx);
+            const i32 nsegments{ detail::build_stroke_segments(ctx) };
+            if (nsegments >= 0) {
+                const bool aa{ ctx->params.edge_anti_alias && state->shape_anti_alias };
+                if (nsegments > 0) {
+                    ctx->params.render_stroke_segments(
+                        ctx->params.user_ptr, &stroke_paint, state->composite_operation,
+                        &state->scissor, ctx->fringe_width, stroke_width,
+                        aa ? ctx->fringe_width : 0.0f, state->line_cap, state->line_join,
+                        state->miter_limit, ctx->tess_tol, ctx->cache->segments, nsegments);
+                    ctx->draw_call_count++;
+                }
+                return;
+            }
+        }
+
+        if (ctx->deferred_tessellation) {
+            const bool aa{ ctx->params.edge_anti_alias && state->shape_anti_alias };
+            detail::defer_draw(ctx, &stroke_paint, state, aa ? ctx->fringe_width : 0.0f,
+                               stroke_width, true);
+            return;
+        }
+
         detail::flatten_paths(ctx);
 
         if (ctx->params.edge_anti_alias && state->shape_anti_alias)
@@ -2551,6 +3694,209 @@ namespace rl::nvg {
         }
     }
 
+    void fill_rounded_rect(Context* ctx, const ds::rect<f32>& rect, const f32 radius) {
+        const State* state = detail::get_state(ctx);
+        if (ctx->params.render_primitive == nullptr || state->fill.image != 0) {
+            begin_path(ctx);
+            rounded_rect(ctx, rect, radius);
+            fill(ctx);
+            return;
+        }
+
+        PaintStyle fill_paint = state->fill;
+
+        // Apply global alpha
+        fill_paint.inner_color.a *= state->alpha;
+        fill_paint.outer_color.a *= state->alpha;
+
+        detail::flush_deferred(ctx);
+        ctx->params.render_primitive(ctx->params.user_ptr, &fill_paint, state->composite_operation,
+                                     &state->scissor, ctx->fringe_width, state->xform, rect,
+                                     radius, 0.0f);
+        ctx->draw_call_count++;
+    }
+
+    void stroke_rounded_rect(Context* ctx, const ds::rect<f32>& rect, const f32 radius) {
+        const State* state = detail::get_state(ctx);
+        if (ctx->params.render_primitive == nullptr || state->stroke.image != 0) {
+            begin_path(ctx);
+            rounded_rect(ctx, rect, radius);
+            stroke(ctx);
+            return;
+        }
+
+        // The shape is evaluated in local space, so the stroke
+        // width is only scaled to check for sub-pixel strokes.
+        const f32 scale = detail::get_average_scale(state->xform);
+        f32 stroke_width = detail::clampf(state->stroke_width, 0.0f, 200.0f);
+        PaintStyle stroke_paint = state->stroke;
+
+        if (stroke_width * scale < ctx->fringe_width && scale > 0.0f) {
+            // If the stroke width is less than pixel size, use alpha to emulate coverage.
+            // Since coverage is area, scale by alpha*alpha.
+            const f32 alpha = detail::clampf(stroke_width * scale / ctx->fringe_width, 0.0f, 1.0f);
+            stroke_paint.inner_color.a *= alpha * alpha;
+            stroke_paint.outer_color.a *= alpha * alpha;
+            stroke_width = ctx->fringe_width / scale;
+        }
+
+        // Apply global alpha
+        stroke_paint.inner_color.a *= state->alpha;
+        stroke_paint.outer_color.a *= state->alpha;
+
+        detail::flush_deferred(ctx);
+        ctx->params.render_primitive(ctx->params.user_ptr, &stroke_paint,
+                                     state->composite_operation, &state->scissor,
+                                     ctx->fringe_width, state->xform, rect, radius, stroke_width);
+        ctx->draw_call_count++;
+    }
+
+    PathHandle create_path(Context* ctx) {
+        if (ctx->params.render_create_geometry == nullptr)
+            return 0;
+
+        RetainedPath* path{ nullptr };
+        for (i32 i = 0; i < ctx->nretained_paths; i++) {
+            if (ctx->retained_paths[i].id == 0) {
+                path = &ctx->retained_paths[i];
+                break;
+            }
+        }
+
+        if (path == nullptr) {
+            if (ctx->nretained_paths + 1 > ctx->cretained_paths) {
+                // 1.5x Overallocate
+                const i32 cpaths{ detail::max(ctx->nretained_paths + 1, 16) +
+                                  ctx->cretained_paths / 2 };
+                const auto paths{ static_cast<RetainedPath*>(std::realloc(
+                    ctx->retained_paths, sizeof(RetainedPath) * static_cast<uint64_t>(cpaths))) };
+
+                if (paths == nullptr)
+                    return 0;
+
+                ctx->retained_paths = paths;
+                ctx->cretained_paths = cpaths;
+            }
+            path = &ctx->retained_paths[ctx->nretained_paths++];
+            *path = RetainedPath{};
+        }
+
+        if (detail::record_retained_path(ctx, path) == 0)
+            return 0;
+
+        path->id = ++ctx->retained_path_id;
+        return path->id;
+    }
+
+    void update_path(Context* ctx, const PathHandle path) {
+        RetainedPath* retained{ detail::find_retained_path(ctx, path) };
+        if (retained == nullptr)
+            return;
+
+        detail::record_retained_path(ctx, retained);
+        detail::release_retained_geometry(ctx, retained);
+    }
+
+    void delete_path(Context* ctx, const PathHandle path) {
+        RetainedPath* retained{ detail::find_retained_path(ctx, path) };
+        if (retained == nullptr)
+            return;
+
+        detail::release_retained_geometry(ctx, retained);
+        std::free(retained->commands);
+        *retained = RetainedPath{};
+    }
+
+    void fill_path(Context* ctx, const PathHandle path) {
+        RetainedPath* retained{ detail::find_retained_path(ctx, path) };
+        const State* state = detail::get_state(ctx);
+        const f32 scale = detail::get_average_scale(state->xform);
+        if (retained == nullptr || scale <= 0.0f)
+            return;
+
+        const f32 fringe{ ctx->params.edge_anti_alias && state->shape_anti_alias
+                              ? ctx->fringe_width / scale
+                              : 0.0f };
+
+        if (retained->fill_geometry == 0 ||
+            detail::retained_param_changed(retained->fill_fringe, fringe)) {
+            if (retained->fill_geometry != 0)
+                ctx->params.render_delete_geometry(ctx->params.user_ptr, retained->fill_geometry);
+
+            retained->fill_geometry = detail::create_retained_geometry(ctx, retained, scale,
+                                                                       fringe, 0.0f);
+            retained->fill_fringe = fringe;
+        }
+
+        PaintStyle fill_paint = state->fill;
+
+        // Apply global alpha
+        fill_paint.inner_color.a *= state->alpha;
+        fill_paint.outer_color.a *= state->alpha;
+
+        detail::flush_deferred(ctx);
+        ctx->params.render_fill_geometry(ctx->params.user_ptr, &fill_paint,
+                                         state->composite_operation, &state->scissor,
+                                         ctx->fringe_width, state->xform, retained->fill_geometry);
+        ctx->draw_call_count++;
+    }
+
+    void stroke_path(Context* ctx, const PathHandle path) {
+        RetainedPath* retained{ detail::find_retained_path(ctx, path) };
+        const State* state = detail::get_state(ctx);
+        const f32 scale = detail::get_average_scale(state->xform);
+        if (retained == nullptr || scale <= 0.0f)
+            return;
+
+        f32 stroke_width = detail::clampf(state->stroke_width * scale, 0.0f, 200.0f);
+        PaintStyle stroke_paint = state->stroke;
+
+        if (stroke_width < ctx->fringe_width) {
+            // If the stroke width is less than pixel size, use alpha to emulate coverage.
+            // Since coverage is area, scale by alpha*alpha.
+            const f32 alpha = detail::clampf(stroke_width / ctx->fringe_width, 0.0f, 1.0f);
+            stroke_paint.inner_color.a *= alpha * alpha;
+            stroke_paint.outer_color.a *= alpha * alpha;
+            stroke_width = ctx->fringe_width;
+        }
+
+        // Apply global alpha
+        stroke_paint.inner_color.a *= state->alpha;
+        stroke_paint.outer_color.a *= state->alpha;
+
+        // The geometry is expanded in local space, the widths passed
+        // to the renderer stay in screen space like they do in stroke().
+        const f32 local_width{ stroke_width / scale };
+        const f32 fringe{ ctx->params.edge_anti_alias && state->shape_anti_alias
+                              ? ctx->fringe_width / scale
+                              : 0.0f };
+
+        if (retained->stroke_geometry == 0 ||
+            detail::retained_param_changed(retained->stroke_fringe, fringe) ||
+            detail::retained_param_changed(retained->stroke_width, local_width) ||
+            retained->miter_limit != state->miter_limit ||
+            retained->line_join != state->line_join || retained->line_cap != state->line_cap) {
+            if (retained->stroke_geometry != 0)
+                ctx->params.render_delete_geometry(ctx->params.user_ptr,
+                                                   retained->stroke_geometry);
+
+            retained->stroke_geometry = detail::create_retained_geometry(ctx, retained, scale,
+                                                                         fringe, local_width);
+            retained->stroke_fringe = fringe;
+            retained->stroke_width = local_width;
+            retained->miter_limit = state->miter_limit;
+            retained->line_join = state->line_join;
+            retained->line_cap = state->line_cap;
+        }
+
+        detail::flush_deferred(ctx);
+        ctx->params.render_stroke_geometry(ctx->params.user_ptr, &stroke_paint,
+                                           state->composite_operation, &state->scissor,
+                                           ctx->fringe_width, stroke_width, state->xform,
+                                           retained->stroke_geometry);
+        ctx->draw_call_count++;
+    }
+
     // Add fonts
     i32 create_font(const Context* ctx, const char* name, const char* filename) {
         return font::add_font(ctx->fs, name, filename, 0);
@@ -2616,6 +3962,12 @@ namespace rl::nvg {
         state->font_blur = blur;
     }
 
+    void set_text_outline(Context* ctx, const f32 width, const ds::color<f32> color) {
+        State* state = detail::get_state(ctx);
+        state->text_outline_width = width;
+        state->text_outline_color = color;
+    }
+
     void text_letter_spacing_(Context* ctx, const f32 spacing) {
         State* state = detail::get_state(ctx);
         state->letter_spacing = spacing;
@@ -2636,16 +3988,22 @@ namespace rl::nvg {
         state->font_id = font;
     }
 
+    void set_font_face(Context* ctx, const text::font::handle font) {
+        State* state{ detail::get_state(ctx) };
+        state->font_id = std::to_underlying(font);
+        debug_assert(font != text::font::InvalidHandle, "failed to set font: invalid handle");
+    }
+
     void set_font_face(Context* ctx, const char* font) {
         State* state = detail::get_state(ctx);
         state->font_id = font::get_font_by_name(ctx->fs, font);
-        debug_assert(state->font_id != text::font::InvalidHandle, "failed to set font: {}", font);
+        debug_assert(state->font_id != font::INVALID, "failed to set font: {}", font);
     }
 
     void set_font_face(Context* ctx, const std::string_view& font) {
         State* state{ detail::get_state(ctx) };
         state->font_id = font::get_font_by_name(ctx->fs, font.data());
-        debug_assert(state->font_id != text::font::InvalidHandle, "failed to set font: {}", font);
+        debug_assert(state->font_id != font::INVALID, "failed to set font: {}", font);
     }
 
     void set_font_face(Context* ctx, const std::string& font) {
@@ -2660,7 +4018,7 @@ namespace rl::nvg {
             return pos.x;
         }
 
-        f32 scale{ detail::get_font_scale(state) * ctx->device_px_ratio };
+        f32 scale{ detail::get_font_scale(ctx, state) * ctx->device_px_ratio };
         f32 invscale{ 1.0f / scale };
 
         font::set_size(ctx->fs, state->font_size * scale);
@@ -2669,136 +4027,102 @@ namespace rl::nvg {
         font::set_align(ctx->fs, state->text_align);
         font::set_font(ctx->fs, state->font_id);
 
-        // conservative estimate
-        i32 cverts{ detail::max(2, static_cast<i32>(text.size())) * 6 };
-        Vertex* verts{ detail::alloc_temp_verts(ctx, cverts) };
-        if (verts == nullptr)
+        TextRun* run{ detail::find_text_run(ctx, state, scale, text, -1.0f) };
+        if (run == nullptr)
             return pos.x;
 
-        font::TextIter iter{};
-        const char* str{ text.c_str() };
-        const char* end{ str + std::strlen(str) };
-        font::text_iter_init(ctx->fs, &iter, pos * scale, str, end, font::FonsGlyphBitmapRequired);
-        i32 is_flipped{ detail::is_transform_flipped(state->xform) };
-
-        i32 nverts{ 0 };
-        font::FontQuad q{};
-        font::TextIter prev_iter = iter;
-        while (font::text_iter_next(ctx->fs, &iter, &q)) {
-            f32 c[4 * 2]{};
-            if (iter.prev_glyph_index == -1) {
-                // can not retrieve glyph?
-                if (nverts != 0) {
-                    detail::render_text(ctx, verts, nverts);
-                    nverts = 0;
-                }
-
-                if (detail::alloc_text_atlas(ctx) == 0) {
-                    debug_assert("allocation for text atlas failed");
-                    break;
-                }
-
-                iter = prev_iter;
-
-                // try again
-                font::text_iter_next(ctx->fs, &iter, &q);
-                if (iter.prev_glyph_index == -1) {
-                    // still can not find glyph? font size may be too small or negative
-                    debug_assert("failed to find glyph to render");
-                    break;
-                }
-            }
-
-            prev_iter = iter;
-            if (is_flipped) {
-                std::swap(q.y0, q.y1);
-                std::swap(q.t0, q.t1);
-            }
-
-            // Transform corners.
-            transform_point(&c[0], &c[1], state->xform, q.x0 * invscale, q.y0 * invscale);
-            transform_point(&c[2], &c[3], state->xform, q.x1 * invscale, q.y0 * invscale);
-            transform_point(&c[4], &c[5], state->xform, q.x1 * invscale, q.y1 * invscale);
-            transform_point(&c[6], &c[7], state->xform, q.x0 * invscale, q.y1 * invscale);
-
-            // Create triangles
-            if (nverts + 6 <= cverts) {
-                detail::vset(&verts[nverts], c[0], c[1], q.s0, q.t0);
-                nverts++;
-                detail::vset(&verts[nverts], c[4], c[5], q.s1, q.t1);
-                nverts++;
-                detail::vset(&verts[nverts], c[2], c[3], q.s1, q.t0);
-                nverts++;
-                detail::vset(&verts[nverts], c[0], c[1], q.s0, q.t0);
-                nverts++;
-                detail::vset(&verts[nverts], c[6], c[7], q.s0, q.t1);
-                nverts++;
-                detail::vset(&verts[nverts], c[4], c[5], q.s1, q.t1);
-                nverts++;
-            }
+        bool complete{ true };
+        if (!run->has_quads) {
+            complete = detail::layout_text_quads(ctx, run, 0.0f, 0.0f, run->text,
+                                                 run->text + run->ntext, &run->advance);
+            run->has_quads = true;
         }
 
-        // TODO: add back-end bit to do this just once per frame.
-        detail::flush_text_texture(ctx);
-        detail::render_text(ctx, verts, nverts);
+        const ds::vector2<f32> offset{ detail::text_run_offset(ctx, pos * scale) };
+        detail::draw_text_run(ctx, run, offset, invscale);
+
+        // glyphs that were left out get another chance next time
+        if (!complete)
+            detail::clear_text_run(run);
 
-        return iter.nextx / scale;
+        return (run->advance + offset.x) / scale;
     }
 
     void text_box(Context* ctx, const ds::point<f32> pos, const f32 break_row_width, const std::string& text) {
         return text_box(ctx, pos, break_row_width, std::string_view{ text });
     }
 
-    void text_box(Context* ctx, ds::point<f32> pos, const f32 break_row_width, const std::string_view text) {
+    void text_box(Context* ctx, const ds::point<f32> pos, const f32 break_row_width, const std::string_view text) {
         State* state{ detail::get_state(ctx) };
         if (state->font_id == font::INVALID) {
             debug_assert("font not loaded");
             return;
         }
 
-        Align old_align{ state->text_align };
-        Align haling{ state->text_align & (Align::HLeft | Align::HCenter | Align::HRight) };
-        Align valign{ state->text_align &
-                      (Align::VTop | Align::VMiddle | Align::VBottom | Align::VBaseline) };
+        const f32 scale{ detail::get_font_scale(ctx, state) * ctx->device_px_ratio };
+        const f32 invscale{ 1.0f / scale };
 
-        f32 lineh{ 0.0f };
-        text_metrics_(ctx, nullptr, nullptr, &lineh);
-        state->text_align = Align::HLeft | valign;
+        TextRun* run{ detail::find_text_run(ctx, state, scale, text, break_row_width) };
+        if (run == nullptr)
+            return;
 
-        std::array<TextRow, 2> rows{ TextRow{}, TextRow{} };
-        const char* str{ text.data() };
-        u32 nrows = text_break_lines(ctx, str, nullptr, break_row_width, rows.data(),
-                                     static_cast<u32>(rows.size()));
-        while (nrows > 0) {
-            for (u32 i = 0; i < nrows; i++) {
-                const TextRow* row = &rows[i];
-                std::string row_text{ row->start, row->end };
+        bool complete{ true };
+        if (!run->has_quads) {
+            if (!detail::break_text_run(ctx, run))
+                return;
+
+            Align old_align{ state->text_align };
+            Align haling{ state->text_align & (Align::HLeft | Align::HCenter | Align::HRight) };
+            Align valign{ state->text_align &
+                          (Align::VTop | Align::VMiddle | Align::VBottom | Align::VBaseline) };
+
+            f32 lineh{ 0.0f };
+            text_metrics_(ctx, nullptr, nullptr, &lineh);
+            state->text_align = Align::HLeft | valign;
+
+            font::set_size(ctx->fs, state->font_size * scale);
+            font::set_spacing(ctx->fs, state->letter_spacing * scale);
+            font::set_blur(ctx->fs, state->font_blur * scale);
+            font::set_align(ctx->fs, state->text_align);
+            font::set_font(ctx->fs, state->font_id);
 
+            f32 y{ 0.0f };
+            for (i32 i = 0; i < run->nrows; i++) {
+                const TextRunRow* row = &run->rows[i];
+
+                f32 dx{ 0.0f };
                 if ((haling & Align::HLeft) != 0)
-                    draw_text(ctx, pos, row_text);
+                    dx = 0.0f;
                 else if ((haling & Align::HCenter) != 0)
-                    draw_text(ctx, { pos.x + break_row_width * 0.5f - row->width * 0.5f, pos.y },
-                              row_text);
+                    dx = break_row_width * 0.5f - row->width * 0.5f;
                 else if ((haling & Align::HRight) != 0)
-                    draw_text(ctx, { pos.x + break_row_width - row->width, pos.y }, row_text);
+                    dx = break_row_width - row->width;
+
+                // rows are laid out at whole font pixels, like draw_text() does
+                const ds::vector2<f32> origin{ detail::text_run_offset(ctx, { dx * scale, y * scale }) };
+                complete &= detail::layout_text_quads(ctx, run, origin.x, origin.y,
+                                                      run->text + row->start,
+                                                      run->text + row->end, nullptr);
 
-                pos.y += lineh * state->line_height;
+                y += lineh * state->line_height;
             }
 
-            str = rows[nrows - 1].next;
-            nrows = text_break_lines(ctx, str, nullptr, break_row_width, rows.data(),
-                                     static_cast<u32>(rows.size()));
+            state->text_align = old_align;
+            run->has_quads = true;
         }
 
-        state->text_align = old_align;
+        detail::draw_text_run(ctx, run, detail::text_run_offset(ctx, pos * scale), invscale);
+
+        if (!complete)
+            detail::clear_text_run(run);
     }
 
     i32 text_glyph_positions_(Context* ctx, f32 x, f32 y, const char* string, const char* end,
                               GlyphPosition* positions, i32 max_positions) {
         State* state = detail::get_state(ctx);
-        f32 scale = detail::get_font_scale(state) * ctx->device_px_ratio;
+        f32 scale = detail::get_font_scale(ctx, state) * ctx->device_px_ratio;
         f32 invscale = 1.0f / scale;
-        font::TextIter iter, prev_iter;
+        font::TextIter iter;
         font::FontQuad q;
         i32 npos = 0;
 
@@ -2819,15 +4143,7 @@ namespace rl::nvg {
 
         font::text_iter_init(ctx->fs, &iter, { x * scale, y * scale }, string, end,
                              font::FonsGlyphBitmapOptional);
-        prev_iter = iter;
         while (font::text_iter_next(ctx->fs, &iter, &q)) {
-            if (iter.prev_glyph_index < 0 && detail::alloc_text_atlas(ctx)) {
-                // can not retrieve glyph?
-                iter = prev_iter;
-                font::text_iter_next(ctx->fs, &iter, &q);  // try again
-            }
-
-            prev_iter = iter;
             positions[npos].str = iter.str;
             positions[npos].x = iter.x * invscale;
             positions[npos].min_x = detail::min(iter.x, q.x0) * invscale;
@@ -2839,10 +4155,26 @@ namespace rl::nvg {
         return npos;
     }
 
+    font::AtlasStats text_atlas_stats(const Context* ctx) {
+        return font::atlas_stats(ctx->fs);
+    }
+
+    font::GlyphStaging* create_glyph_staging(const Context* ctx) {
+        return font::create_staging(ctx->fs);
+    }
+
+    i32 add_staged_glyphs(Context* ctx, const font::GlyphStaging* staging) {
+        return font::add_staged_glyphs(ctx->fs, staging);
+    }
+
+    font::FontMetrics* create_font_metrics(const Context* ctx) {
+        return font::create_metrics(ctx->fs);
+    }
+
     u32 text_break_lines(Context* ctx, const char* str, const char* end, f32 break_row_width,
                          TextRow* rows, u32 max_rows) {
         State* state = detail::get_state(ctx);
-        f32 scale = detail::get_font_scale(state) * ctx->device_px_ratio;
+        f32 scale = detail::get_font_scale(ctx, state) * ctx->device_px_ratio;
         f32 invscale = 1.0f / scale;
 
         font::FontQuad q{};
@@ -2881,18 +4213,9 @@ namespace rl::nvg {
         break_row_width *= scale;
 
         font::TextIter iter;
-        font::TextIter prev_iter;
         font::text_iter_init(ctx->fs, &iter, ds::point<f32>::zero(), str, end,
                              font::FonsGlyphBitmapOptional);
-        prev_iter = iter;
         while (font::text_iter_next(ctx->fs, &iter, &q)) {
-            if (iter.prev_glyph_index < 0 && detail::alloc_text_atlas(ctx)) {
-                // can not retrieve glyph?
-                iter = prev_iter;
-                font::text_iter_next(ctx->fs, &iter, &q);  // try again
-            }
-
-            prev_iter = iter;
             switch (iter.codepoint) {
                 case 9:       // \t
                 case 11:      // \v
@@ -3069,31 +4392,44 @@ namespace rl::nvg {
 
     f32 text_bounds(Context* ctx, const ds::point<f32> pos, std::string_view text, ds::rect<f32>& bounds) {
         const State* state = detail::get_state(ctx);
-        const f32 scale = detail::get_font_scale(state) * ctx->device_px_ratio;
+        const f32 scale = detail::get_font_scale(ctx, state) * ctx->device_px_ratio;
         const f32 invscale = 1.0f / scale;
 
         if (state->font_id == font::INVALID)
             return 0;
 
-        font::set_size(ctx->fs, state->font_size * scale);
-        font::set_spacing(ctx->fs, state->letter_spacing * scale);
-        font::set_blur(ctx->fs, state->font_blur * scale);
-        font::set_align(ctx->fs, state->text_align);
-        font::set_font(ctx->fs, state->font_id);
+        TextRun* run = detail::find_text_run(ctx, state, scale, text, -1.0f);
+        if (run == nullptr)
+            return 0;
+
+        if (!run->has_bounds) {
+            font::set_size(ctx->fs, state->font_size * scale);
+            font::set_spacing(ctx->fs, state->letter_spacing * scale);
+            font::set_blur(ctx->fs, state->font_blur * scale);
+            font::set_align(ctx->fs, state->text_align);
+            font::set_font(ctx->fs, state->font_id);
+
+            ds::rect<f32> run_bounds{ ds::rect<f32>::zero() };
+            run->width = font::text_bounds(ctx->fs, ds::point<f32>::zero(), run->text,
+                                           run->text + run->ntext, run_bounds);
 
-        const f32 width = font::text_bounds(ctx->fs, pos * scale, text.data(), nullptr, bounds);
-        if (!bounds.is_null()) {
             f32 min_y{ 0.0f };
             f32 max_y{ 0.0f };
 
             // Use line bounds for height.
-            font::line_bounds(ctx->fs, pos.y * scale, &min_y, &max_y);
+            font::line_bounds(ctx->fs, 0.0f, &min_y, &max_y);
 
-            bounds.pt.y = min_y;
-            bounds.size.height = max_y - min_y;
+            run_bounds.pt.y = min_y;
+            run_bounds.size.height = max_y - min_y;
+            run->bounds = run_bounds;
+            run->has_bounds = true;
+        }
+
+        if (!bounds.is_null()) {
+            bounds = run->bounds + detail::text_run_offset(ctx, pos * scale);
             bounds *= invscale;
         }
-        return width * invscale;
+        return run->width * invscale;
     }
 
     f32 text_bounds(Context* ctx, const ds::point<f32> pos, const std::string& text) {
@@ -3116,7 +4452,7 @@ namespace rl::nvg {
     [[nodiscard]]
     ds::rect<f32> text_box_bounds(Context* ctx, ds::point<f32> pos, const f32 break_row_width, std::string_view text) {
         State* state = detail::get_state(ctx);
-        const f32 scale{ detail::get_font_scale(state) * ctx->device_px_ratio };
+        const f32 scale{ detail::get_font_scale(ctx, state) * ctx->device_px_ratio };
         const f32 invscale{ 1.0f / scale };
         const Align old_align{ state->text_align };
         const Align h_align{ state->text_align & (Align::HLeft | Align::HCenter | Align::HRight) };
@@ -3126,6 +4462,10 @@ namespace rl::nvg {
         if (state->font_id == font::INVALID)
             return {};
 
+        TextRun* run{ detail::find_text_run(ctx, state, scale, text, break_row_width) };
+        if (run == nullptr || !detail::break_text_run(ctx, run))
+            return {};
+
         f32 lineh{ 0.0f };
         text_metrics_(ctx, nullptr, nullptr, &lineh);
 
@@ -3148,36 +4488,26 @@ namespace rl::nvg {
         f32 min_y{ pos.y };
         f32 max_y{ pos.y };
 
-        std::array<TextRow, 2> rows{};
-        const char* str{ text.data() };
-        u32 nrows = text_break_lines(ctx, str, nullptr, break_row_width, rows.data(),
-                                     static_cast<u32>(rows.size()));
-        while (nrows > 0) {
-            for (u32 i = 0; i < nrows; i++) {
-                const TextRow* row{ &rows[i] };
-
-                f32 dx = 0;
-                if ((h_align & Align::HLeft) != 0)
-                    dx = 0;
-                else if ((h_align & Align::HCenter) != 0)
-                    dx = break_row_width * 0.5f - row->width * 0.5f;
-                else if ((h_align & Align::HRight) != 0)
-                    dx = break_row_width - row->width;
+        for (i32 i = 0; i < run->nrows; i++) {
+            const TextRunRow* row{ &run->rows[i] };
 
-                const f32 r_min_x{ pos.x + row->min_x + dx };
-                const f32 r_max_x{ pos.x + row->max_x + dx };
+            f32 dx = 0;
+            if ((h_align & Align::HLeft) != 0)
+                dx = 0;
+            else if ((h_align & Align::HCenter) != 0)
+                dx = break_row_width * 0.5f - row->width * 0.5f;
+            else if ((h_align & Align::HRight) != 0)
+                dx = break_row_width - row->width;
 
-                min_x = math::min(min_x, r_min_x);
-                max_x = math::max(max_x, r_max_x);
-                min_y = math::min(min_y, pos.y + r_min_y);
-                max_y = math::max(max_y, pos.y + r_max_y);
+            const f32 r_min_x{ pos.x + row->min_x + dx };
+            const f32 r_max_x{ pos.x + row->max_x + dx };
 
-                pos.y += lineh * state->line_height;
-            }
+            min_x = math::min(min_x, r_min_x);
+            max_x = math::max(max_x, r_max_x);
+            min_y = math::min(min_y, pos.y + r_min_y);
+            max_y = math::max(max_y, pos.y + r_max_y);
 
-            str = rows[nrows - 1].next;
-            nrows = text_break_lines(ctx, str, nullptr, break_row_width, rows.data(),
-                                     static_cast<u32>(rows.size()));
+            pos.y += lineh * state->line_height;
         }
 
         state->text_align = old_align;
@@ -3196,7 +4526,7 @@ namespace rl::nvg {
 
     void text_metrics_(Context* ctx, f32* ascender, f32* descender, f32* lineh) {
         const State* state{ detail::get_state(ctx) };
-        const f32 scale{ detail::get_font_scale(state) * ctx->device_px_ratio };
+        const f32 scale{ detail::get_font_scale(ctx, state) * ctx->device_px_ratio };
         const f32 invscale{ 1.0f / scale };
         if (state->font_id == font::INVALID)
             return;
@@ -13,12 +13,19 @@
   #pragma warning(disable : 4201)  // nonstandard extension used : nameless struct/union
 #endif
 
+namespace rl::text::font {
+    enum class handle : i32;
+}
+
 namespace rl::nvg {
     constexpr i32 MaxNVGStates{ 64 };
     // Length proportional to radius of a
     // cubic bezier handle for 90deg arcs.
     constexpr f32 NVGKappa90{ 0.5522847493f };
 
+    // Handle to a path recorded with create_path(), 0 is never a valid path.
+    using PathHandle = i32;
+
     enum class CompositeOperation {
         SourceOver,
         SourceIn,
@@ -91,14 +98,19 @@ namespace rl::nvg {
         NVGImageFlipY = 1 << 3,            // Flips (inverses) image in Y direction when rendered.
         PreMultiplied = 1 << 4,            // Image data has pre-multiplied alpha.
         NVGImageNearest = 1 << 5,          // Image interpolation is Nearest instead Linear
+        SignedDistance = 1 << 6,           // Alpha image holds a distance field, see font::FonsSdf
 
         NoDelete = 1 << 16,  // OpenGL only
     };
 
     enum {
-        NvgInitFontimageSize = 512,
-        NvgMaxFontimageSize = 2048,
-        NvgMaxFontimages = 4
+        // size of each of the font atlas pages, there's one texture per page
+        NvgFontPageSize = 1024,
+        NvgMaxFontimages = font::MAX_ATLAS_PAGES,
+        // text runs kept between frames, see TextRunCache
+        NvgMaxTextRuns = 512,
+        // slots of the table text runs are looked up in, a power of two at least twice as big
+        NvgTextRunSlots = 1024,
     };
 
     struct ScissorParams {
@@ -126,6 +138,31 @@ namespace rl::nvg {
         i32 convex{ 0 };
     };
 
+    enum StrokeSegmentFlags {
+        SegmentLine = 0x01,
+        SegmentStartCap = 0x02,
+        SegmentEndCap = 0x04,
+        SegmentJoin = 0x08,
+    };
+
+    // Segment of a stroked path in screen space, handed as is to backends that expand strokes
+    // on the GPU (see Params::render_stroke_segments). Lines keep their control points on
+    // their end points.
+    struct StrokeSegment {
+        f32 x0{ 0.0f };
+        f32 y0{ 0.0f };
+        f32 cx0{ 0.0f };
+        f32 cy0{ 0.0f };
+        f32 cx1{ 0.0f };
+        f32 cy1{ 0.0f };
+        f32 x1{ 0.0f };
+        f32 y1{ 0.0f };
+        // direction the previous segment ends in, the join is drawn at (x0, y0)
+        f32 join_dx{ 0.0f };
+        f32 join_dy{ 0.0f };
+        u32 flags{ 0 };
+    };
+
     struct CompositeOperationState {
         BlendFactor src_rgb{};
         BlendFactor dst_rgb{};
@@ -159,6 +196,8 @@ namespace rl::nvg {
         f32 letter_spacing{ 0.0f };
         f32 line_height{ 0.0f };
         f32 font_blur{ 0.0f };
+        f32 text_outline_width{ 0.0f };
+        ds::color<f32> text_outline_color{ 0, 0, 0, 0 };
         Align text_align{ Align::None };
         i32 font_id{ 0 };
     };
@@ -169,6 +208,9 @@ namespace rl::nvg {
     {
         void* user_ptr{ nullptr };
         bool edge_anti_alias{ false };
+        // glyphs are rasterized as distance fields and drawn from textures created with
+        // ImageFlags::SignedDistance, the renderer applies the text blur and outline
+        bool sdf_text{ false };
 
         i32 (*render_create)(void* uptr);
         i32 (*render_create_texture)(void* uptr, TextureProperty type, i32 w, i32 h, ImageFlags image_flags, const u8* data);
@@ -181,12 +223,26 @@ namespace rl::nvg {
         void (*render_flush)(void* uptr);
         void (*render_fill)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, const f32* bounds, const NVGpath* paths, i32 npaths);
         void (*render_stroke)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, f32 stroke_width, const NVGpath* paths, i32 npaths);
+        // optional, strokes are sent as segments instead of being tessellated when it's set
+        void (*render_stroke_segments)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, f32 stroke_width, f32 aa, LineCap line_cap, LineCap line_join, f32 miter_limit, f32 tess_tol, const StrokeSegment* segments, i32 nsegments);
         void (*render_triangles)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, const Vertex* verts, i32 nverts, f32 fringe);
+        void (*render_primitive)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, const f32* xform, const ds::rect<f32>& rect, f32 radius, f32 stroke_width);
+        i32 (*render_create_geometry)(void* uptr, const f32* bounds, const NVGpath* paths, i32 npaths);
+        void (*render_delete_geometry)(void* uptr, i32 geometry);
+        void (*render_fill_geometry)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, const f32* xform, i32 geometry);
+        void (*render_stroke_geometry)(void* uptr, const PaintStyle* paint, CompositeOperationState composite_operation, const ScissorParams* scissor, f32 fringe, f32 stroke_width, const f32* xform, i32 geometry);
         void (*render_delete)(void* uptr);
     };
 
     // clang-format on
 
+    enum NVGpointFlags {
+        NvgPtCorner = 0x01,
+        NvgPtLeft = 0x02,
+        NvgPtBevel = 0x04,
+        NvgPrInnerbevel = 0x08,
+    };
+
     struct Point {
         f32 x{ 0.0f };
         f32 y{ 0.0f };
@@ -198,8 +254,41 @@ namespace rl::nvg {
         u8 flags{ 0 };
     };
 
+    // Flattened path points, stored as one array per attribute so the tessellation
+    // kernels can load and process several consecutive points at once.
+    struct PointStreams {
+        f32* x{ nullptr };
+        f32* y{ nullptr };
+        f32* dx{ nullptr };
+        f32* dy{ nullptr };
+        f32* len{ nullptr };
+        f32* dmx{ nullptr };
+        f32* dmy{ nullptr };
+        u8* flags{ nullptr };
+    };
+
+    // Bump allocator for memory that's only needed until the end of the frame. The block is
+    // sized to the peak usage of earlier frames, allocations that don't fit in it spill into
+    // their own heap blocks until the next reset grows the block to the new peak.
+    struct FrameArena {
+        u8* block{ nullptr };
+        u64 capacity{ 0 };
+        u64 offset{ 0 };
+        // start of the most recent allocation in the block, it can be grown in place
+        u64 last{ 0 };
+        // bytes allocated this frame, including spills and storage left behind when growing
+        u64 used{ 0 };
+        // bytes allocated in the previous frame and the most ever allocated in a single frame
+        u64 last_used{ 0 };
+        u64 peak{ 0 };
+        // blocks allocated this frame because the arena was full, freed on reset
+        void* spills{ nullptr };
+        u32 nspills{ 0 };
+    };
+
     struct PathCache {
-        Point* points{ nullptr };
+        FrameArena* arena{ nullptr };
+        PointStreams points{};
         i32 npoints{ 0 };
         i32 cpoints{ 0 };
         NVGpath* paths{ nullptr };
@@ -208,9 +297,115 @@ namespace rl::nvg {
         Vertex* verts{ nullptr };
         i32 nverts{ 0 };
         i32 cverts{ 0 };
+        StrokeSegment* segments{ nullptr };
+        i32 csegments{ 0 };
+        f32 bounds[4]{};
+    };
+
+    // Path commands recorded in local space along with the geometry tessellated from them. The
+    // fill and stroke geometry is owned by the render backend and only rebuilt when the commands
+    // or the parameters it was expanded with change.
+    struct RetainedPath {
+        PathHandle id{ 0 };
+        f32* commands{ nullptr };
+        i32 ncommands{ 0 };
+        i32 fill_geometry{ 0 };
+        f32 fill_fringe{ 0.0f };
+        i32 stroke_geometry{ 0 };
+        f32 stroke_fringe{ 0.0f };
+        f32 stroke_width{ 0.0f };
+        f32 miter_limit{ 0.0f };
+        LineCap line_join{ LineCap::Butt };
+        LineCap line_cap{ LineCap::Butt };
+    };
+
+    // A fill or stroke recorded in deferred tessellation mode. Holds everything needed to
+    // tessellate the path away from the context, along with where the result ended up.
+    struct DeferredDraw {
+        PaintStyle paint{};
+        CompositeOperationState composite_operation{};
+        ScissorParams scissor{};
+        i32 first_command{ 0 };
+        i32 ncommands{ 0 };
+        bool stroke{ false };
+        f32 tess_tol{ 0.0f };
+        f32 dist_tol{ 0.0f };
+        f32 fringe_width{ 0.0f };
+        // fringe the geometry is expanded with, 0 when anti-aliasing is off
+        f32 fringe{ 0.0f };
+        f32 stroke_width{ 0.0f };
+        f32 miter_limit{ 0.0f };
+        LineCap line_join{ LineCap::Butt };
+        LineCap line_cap{ LineCap::Butt };
+        // tessellated paths, stored in the arena of the worker that produced them
+        i32 worker{ 0 };
+        i32 first_path{ 0 };
+        i32 npaths{ 0 };
         f32 bounds[4]{};
     };
 
+    // Row of a text box run, like TextRow with offsets into the run's text.
+    struct TextRunRow {
+        i32 start{ 0 };
+        i32 end{ 0 };
+        i32 next{ 0 };
+        f32 width{ 0.0f };
+        f32 min_x{ 0.0f };
+        f32 max_x{ 0.0f };
+    };
+
+    // Text laid out by draw_text(), text_bounds() or text_box() along with everything the layout
+    // depends on. Runs are laid out at the origin in font pixels (local units times the font
+    // scale), drawing or measuring the same text again only translates them. The quads, bounds
+    // and rows are each filled in the first time they're needed and dropped along with the rest
+    // when the glyphs may have moved in the atlas, see font::glyph_generation().
+    struct TextRun {
+        char* text{ nullptr };
+        i32 ntext{ 0 };
+        i32 font{ font::INVALID };
+        f32 size{ 0.0f };
+        f32 spacing{ 0.0f };
+        f32 blur{ 0.0f };
+        f32 line_height{ 0.0f };
+        Align align{ 0 };
+        // row width text box runs are broken at, negative for single lines
+        f32 break_width{ -1.0f };
+        f32 scale{ 0.0f };
+        u32 generation{ 0 };
+        // neighbours in the cache's use order, -1 at either end
+        i32 newer{ -1 };
+        i32 older{ -1 };
+        font::FontQuad* quads{ nullptr };
+        i32 nquads{ 0 };
+        i32 cquads{ 0 };
+        bool has_quads{ false };
+        // pen position after the last glyph and the width and bounds text_bounds() measures
+        f32 advance{ 0.0f };
+        f32 width{ 0.0f };
+        ds::rect<f32> bounds{ ds::rect<f32>::zero() };
+        bool has_bounds{ false };
+        TextRunRow* rows{ nullptr };
+        i32 nrows{ 0 };
+        i32 crows{ 0 };
+        bool has_rows{ false };
+    };
+
+    // Text runs kept between frames, looked up by the hash of the text and the state it's laid
+    // out with. slots is a linear probing table of run indices plus one (0 when empty) that's
+    // never more than half full. The runs are also linked from the most to the least recently
+    // used, once NvgMaxTextRuns are cached the oldest one is replaced.
+    struct TextRunCache {
+        TextRun* runs{ nullptr };
+        u64* hashes{ nullptr };
+        i32 nruns{ 0 };
+        i32 cruns{ 0 };
+        i32 slots[NvgTextRunSlots]{};
+        i32 newest{ -1 };
+        i32 oldest{ -1 };
+    };
+
+    struct TessellationPool;
+
     struct Context {
         Params params{};
         f32* commands{ nullptr };
@@ -227,11 +422,25 @@ namespace rl::nvg {
         f32 device_px_ratio{ 0.0f };
         font::Context* fs{ nullptr };
         i32 font_images[NvgMaxFontimages]{};
-        i32 font_image_idx{ 0 };
         i32 draw_call_count{ 0 };
         i32 fill_tri_count{ 0 };
         i32 stroke_tri_count{ 0 };
         i32 text_tri_count{ 0 };
+        RetainedPath* retained_paths{ nullptr };
+        i32 nretained_paths{ 0 };
+        i32 cretained_paths{ 0 };
+        PathHandle retained_path_id{ 0 };
+        bool deferred_tessellation{ false };
+        DeferredDraw* deferred_draws{ nullptr };
+        i32 ndeferred_draws{ 0 };
+        i32 cdeferred_draws{ 0 };
+        f32* deferred_commands{ nullptr };
+        i32 ndeferred_commands{ 0 };
+        i32 cdeferred_commands{ 0 };
+        TessellationPool* tess_pool{ nullptr };
+        // backs the path cache and the deferred draws, reset at the end of every frame
+        FrameArena arena{};
+        TextRunCache text_runs{};
     };
 
     struct GlyphPosition {
@@ -271,7 +480,7 @@ namespace rl::nvg {
     void begin_frame(Context* ctx, f32 window_width, f32 window_height, f32 device_pixel_ratio);
 
     // Cancels drawing the current frame.
-    void cancel_frame(const Context* ctx);
+    void cancel_frame(Context* ctx);
 
     // Ends drawing flushing remaining render state.
     void end_frame(Context* ctx);
@@ -351,6 +560,13 @@ namespace rl::nvg {
     // Sets whether to draw antialias for Stroke() and Fill(). It's enabled by default.
     void shape_anti_alias(Context* ctx, bool enabled);
 
+    // Sets whether Fill() and Stroke() only record the path, leaving the tessellation to
+    // EndFrame() where the recorded paths are tessellated in parallel on a worker pool.
+    // Draws that can't be deferred (text, primitives, retained paths) tessellate the pending
+    // ones first, so the output is identical to immediate mode and submitted in the same
+    // order. It's disabled by default.
+    void deferred_tessellation(Context* ctx, bool enabled);
+
     // Sets current stroke style to a solid color.
     void stroke_color(Context* ctx, const ds::color<f32>& color);
 
@@ -644,6 +860,59 @@ namespace rl::nvg {
     // Fills the current path with current stroke style.
     void stroke(Context* ctx);
 
+    //
+    // Analytic Shapes
+    //
+    // Rounded rectangles evaluated as signed distance fields by the renderer instead of being
+    // flattened and tessellated as paths. Consecutive shapes are batched by the backend into a
+    // single instanced draw call. The current path is left untouched, unless the paint is an
+    // image pattern, in which case the shape falls back to a regular path fill.
+
+    // Fills rounded rectangle with current fill style.
+    void fill_rounded_rect(Context* ctx, const ds::rect<f32>& rect, f32 radius);
+
+    // Strokes rounded rectangle outline with current stroke style and stroke width.
+    void stroke_rounded_rect(Context* ctx, const ds::rect<f32>& rect, f32 radius);
+
+    //
+    // Retained Paths
+    //
+    // Static shapes (icons, arrows, check marks...) can be recorded once instead of being rebuilt
+    // every frame. The recorded commands are kept in the local space of the transform that was
+    // current when the path was recorded, and the tessellated fill and stroke vertices are cached
+    // by the render backend. Drawing a retained path only submits the current transform and paint,
+    // the transform is applied on the GPU.
+    //
+    // The cached geometry is rebuilt when the path is updated, when it's stroked with a different
+    // stroke width, line cap, line join or miter limit, or when it's drawn at a scale that changes
+    // the width of the anti-aliased fringe.
+    //
+    //      PathHandle arrow = 0;
+    //      ...
+    //      if (arrow == 0) {
+    //          BeginPath(vg);
+    //          MoveTo(vg, 0,-6); LineTo(vg, 4,0); LineTo(vg, -4,0);
+    //          arrow = CreatePath(vg);
+    //      }
+    //      Translate(vg, x,y);
+    //      FillPath(vg, arrow);
+
+    // Records the current path into a new retained path.
+    // Returns 0 if the render backend does not support retained paths.
+    PathHandle create_path(Context* ctx);
+
+    // Replaces the commands of a retained path with the current path.
+    void update_path(Context* ctx, PathHandle path);
+
+    // Deletes a retained path and the geometry cached for it.
+    void delete_path(Context* ctx, PathHandle path);
+
+    // Fills a retained path with current fill style and transform.
+    void fill_path(Context* ctx, PathHandle path);
+
+    // Strokes a retained path with current stroke style and transform.
+    void stroke_path(Context* ctx, PathHandle path);
+
     //
     // Text
     //
@@ -717,6 +986,11 @@ namespace rl::nvg {
     // Sets the blur of current text style.
     void font_blur_(Context* ctx, f32 blur);
 
+    // Sets the outline width and color of current text style. Outlines are only drawn when the
+    // renderer draws distance field text (sdf_text in Params), they can be as wide as the
+    // distance field reaches, font::SDF_PADDING pixels at font::SDF_SIZE.
+    void set_text_outline(Context* ctx, f32 width, ds::color<f32> color);
+
     // Sets the letter spacing of current text style.
     void text_letter_spacing_(Context* ctx, f32 spacing);
 
@@ -730,6 +1004,9 @@ namespace rl::nvg {
     // Sets the font face based on specified id of current text style.
     void font_face_id_(Context* ctx, i32 font);
 
+    // Sets the font face to a handle resolved when the font was loaded, no name lookup needed.
+    void set_font_face(Context* ctx, text::font::handle font);
+
     // Sets the font face based on specified name of current text style.
     void set_font_face(Context* ctx, const char* font);
     void set_font_face(Context* ctx, const std::string_view& font);
@@ -771,6 +1048,20 @@ namespace rl::nvg {
     // Measured values are returned in local coordinate space.
     void text_metrics_(Context* ctx, f32* ascender, f32* descender, f32* lineh);
 
+    // Returns the number of glyph atlas pages, how much of them is used by glyphs
+    // and how many shelves of glyphs had to be evicted to make room for others.
+    font::AtlasStats text_atlas_stats(const Context* ctx);
+
+    // Glyph pre-rasterization, see font::GlyphStaging. The staging snapshots the loaded fonts and
+    // is handed back on the thread using the context, glyphs are staged (font::stage_glyph()) on
+    // any thread in between. Sizes are in device pixels, the font scale isn't applied.
+    font::GlyphStaging* create_glyph_staging(const Context* ctx);
+    i32 add_staged_glyphs(Context* ctx, const font::GlyphStaging* staging);
+
+    // Snapshot of the loaded fonts text can be measured with on any thread, see
+    // font::measure_text(). Freed with font::delete_metrics() before the context is deleted.
+    font::FontMetrics* create_font_metrics(const Context* ctx);
+
     // Breaks the specified text into lines. If end is specified only the sub-string will be
     // used. White space is stripped at the beginning of the rows, the text is split at word
     // boundaries or when new-line characters are encountered. Words longer than the max width
@@ -784,6 +1075,20 @@ namespace rl::nvg {
 
     Params* internal_params(Context* ctx);
 
+    // Frame arena allocation, also used by the render back-ends for their per frame buffers.
+    // Memory returned by the arena is 16 byte aligned and valid until the next reset.
+    void* arena_alloc(FrameArena* arena, u64 size);
+    // Moves an allocation to a larger one, keeping its first used bytes. The most recent
+    // allocation is extended in place when the block has room for it.
+    void* arena_grow(FrameArena* arena, void* data, u64 used, u64 size);
+    // Releases everything allocated since the last reset. The block is reallocated once if
+    // the frame didn't fit in it, so steady state frames never touch the heap.
+    void arena_reset(FrameArena* arena);
+    void arena_release(FrameArena* arena);
+
+    // Frame arena of the context, last_used and peak report its usage.
+    const FrameArena& frame_arena(const Context* ctx);
+
     // Debug function to dump cached path data.
     void debug_dump_path_cache(const Context* ctx);
 
@@ -1,14 +1,19 @@
 #include <glad/gl.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <print>
 
+#include "gfx/gl/state_cache.hpp"
 #include "gfx/vg/nanovg_gl.hpp"
 
 namespace rl::nvg::gl {
 
     enum GLUniformLoc {
         LocViewsize,
+        LocVertXform,
         LocTex,
         LocFrag,
         MaxLocs
@@ -18,26 +23,57 @@ namespace rl::nvg::gl {
         SVGShaderFillgrad,
         SVGShaderFillimg,
         SVGShaderSimple,
-        SVGShaderImg
+        SVGShaderImg,
+        SVGShaderTypeCount
     };
 
+    // Texture formats of image paints: premultiplied RGBA, straight alpha RGBA, alpha only and
+    // distance field glyphs (see ImageFlags::SignedDistance).
+    constexpr i32 TexTypeCount{ 4 };
+    // The fragment shader is compiled once per shader type, texture type and whether the
+    // scissor mask is evaluated. See shader_variant() for the combinations actually used.
+    constexpr i32 ShaderVariantCount{ SVGShaderTypeCount * TexTypeCount * 2 };
+
     enum GLUniformBindings {
         FragBinding = 0,
     };
 
+    // Number of regions each persistent mapped streaming buffer is split into. The CPU writes
+    // one region per frame while the GPU may still be reading from the other ones.
+    constexpr i32 StreamRegionCount{ 3 };
+    // Upper bound on the number of fragment uniform entries a merged draw can index into.
+    constexpr i32 MaxFragWindow{ 128 };
+    // Vertex transform of everything except retained geometry, which
+    // is the only vertex data that isn't already in screen space.
+    constexpr f32 IdentityXform[6]{ 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+
     enum GLCallType {
         NVGNone = 0,
         NVGFill,
         NVGConvexFill,
         NVGStroke,
         NVGTriangles,
+        NVGPrimitives,
+        NVGSegments,
     };
 
     struct GLShader {
         GLuint prog{ 0 };
         GLuint frag{ 0 };
         GLuint vert{ 0 };
+        GLuint geom{ 0 };
         GLint loc[MaxLocs] = {};
+        // uniform values last uploaded to the program
+        f32 view[2] = {};
+        f32 xform[6] = {};
+    };
+
+    // Timer queries issued around the draws of one frame, along with the variant of each one.
+    struct GLTimerQueries {
+        GLuint* queries{ nullptr };
+        i32* variants{ nullptr };
+        i32 nqueries{ 0 };
+        i32 cqueries{ 0 };
     };
 
     struct GLTexture {
@@ -64,7 +100,24 @@ namespace rl::nvg::gl {
         i32 triangle_offset{ 0 };
         i32 triangle_count{ 0 };
         i32 uniform_offset{ 0 };
+        i32 instance_offset{ 0 };
+        i32 instance_count{ 0 };
+        i32 segment_offset{ 0 };
+        i32 segment_count{ 0 };
+        // retained geometry the call draws from instead of the frame's vertices, and the
+        // transform applied to it in the vertex shader. Calls drawing packed vertices use
+        // the transform to map them back to screen space.
+        i32 geometry{ 0 };
+        f32 xform[6] = {};
         GLBlend blend_func{ 0 };
+        // pixel aligned, axis aligned scissor rects are applied with glScissor(), in
+        // framebuffer coordinates. Only the calls with other clip rects need the shader's
+        // scissor mask.
+        bool hw_scissor{ false };
+        bool shader_scissor{ false };
+        GLint scissor_rect[4] = {};
+        // program variant of the call's paint, set by merge_calls()
+        i32 variant{ 0 };
     };
 
     struct GLPath {
@@ -74,6 +127,74 @@ namespace rl::nvg::gl {
         i32 stroke_count{ 0 };
     };
 
+    // Tessellated vertices of a retained path (see nvg::create_path), uploaded once to a static
+    // vertex buffer. Convex fills are stored as a triangle list, everything else as the path's
+    // fans and strips followed by the quad covering the path's bounds.
+    struct GLGeometry {
+        i32 id{ 0 };
+        GLuint buf{ 0 };
+        GLPath* paths{ nullptr };
+        i32 npaths{ 0 };
+        i32 triangle_offset{ 0 };
+        i32 triangle_count{ 0 };
+        bool convex{ false };
+        // deleted by the frontend, released once the calls of the current frame are flushed
+        bool orphaned{ false };
+    };
+
+    // Per instance attributes of an analytic rounded rect, see render_primitive(). Every four
+    // floats map to one vec4 vertex attribute of the primitive shader.
+    struct GLPrimitive {
+        f32 xform[6] = {};
+        f32 corner_radius{ 0.0f };
+        f32 stroke_width{ 0.0f };
+        f32 rect[4] = {};
+        f32 paint_mat[6] = {};
+        f32 extent[2] = {};
+        f32 radius{ 0.0f };
+        f32 feather{ 0.0f };
+        f32 scissor_scale[2] = {};
+        f32 scissor_mat[6] = {};
+        f32 scissor_ext[2] = {};
+        ds::color<f32> inner_col{ 0, 0, 0, 0 };
+        ds::color<f32> outer_col{ 0, 0, 0, 0 };
+    };
+
+    // Frame vertex stored with CreateFlags::PackedVertices. The position is in steps of
+    // GLCall::xform's scale from its origin, the texture coordinates are normalized.
+    struct GLPackedVertex {
+        u16 x{ 0 };
+        u16 y{ 0 };
+        u16 u{ 0 };
+        u16 v{ 0 };
+    };
+
+    constexpr i32 PrimitiveAttribCount{ sizeof(GLPrimitive) / (4 * sizeof(f32)) };
+    static_assert(sizeof(GLPrimitive) % (4 * sizeof(f32)) == 0);
+
+    // Stroke segment expanded by the stroke geometry shader, one point per segment. The flags
+    // are StrokeSegmentFlags with the cap type in bits 4-6 and the join type in bits 7-9.
+    struct GLSegment {
+        f32 points[8] = {};
+        f32 join_dir[2] = {};
+        f32 flags{ 0.0f };
+        f32 unused{ 0.0f };
+        f32 half_width{ 0.0f };
+        f32 fringe{ 0.0f };
+        f32 miter_limit{ 0.0f };
+        f32 tess_tol{ 0.0f };
+    };
+
+    constexpr i32 SegmentAttribCount{ sizeof(GLSegment) / (4 * sizeof(f32)) };
+    static_assert(sizeof(GLSegment) % (4 * sizeof(f32)) == 0);
+
+    struct GLStreamBuffer {
+        // persistent, coherent mapping of the whole buffer
+        u8* data{ nullptr };
+        // size in bytes of a single region
+        int64_t region_size{ 0 };
+    };
+
     struct GLFragUniforms {
         // matrices are actually 3 vec4s
         f32 scissor_mat[12] = {};
@@ -91,20 +212,76 @@ namespace rl::nvg::gl {
         i32 type{ 0 };
     };
 
+    // the shader indexes an std140 array of these, padded out to GLContext::frag_size
+    static_assert(sizeof(GLFragUniforms) % 16 == 0);
+
+    // Uniform entries already written this frame, see dedup_frag_uniforms().
+    struct GLUniformSlot {
+        u32 hash{ 0 };
+        // number of consecutive entries, 0 for empty slots
+        i32 count{ 0 };
+        i32 offset{ 0 };
+    };
+
     struct GLContext {
-        GLShader shader{};
+        GLShader variants[ShaderVariantCount]{};
+        // the fill variants behind the stroke geometry shader, see CreateFlags::GeometryStrokes
+        GLShader stroke_variants[ShaderVariantCount]{};
+        GLShader prim_shader{};
         GLTexture* textures{ nullptr };
         f32 view[2] = {};
+        f32 device_px_ratio{ 1.0f };
         i32 ntextures{ 0 };
         i32 ctextures{ 0 };
         i32 texture_id{ 0 };
+        GLGeometry* geometries{ nullptr };
+        i32 ngeometries{ 0 };
+        i32 cgeometries{ 0 };
+        i32 geometry_id{ 0 };
         GLuint vert_buf{ 0 };
         GLuint vert_arr{ 0 };
         GLuint frag_buf{ 0 };
+        GLuint frag_index_buf{ 0 };
+        GLuint prim_arr{ 0 };
+        GLuint prim_buf{ 0 };
+        GLuint segment_arr{ 0 };
+        GLuint segment_buf{ 0 };
+        // pixel unpack buffer texture updates are staged in, see map_upload_buffer()
+        GLuint upload_buf{ 0 };
         i32 frag_size{ 0 };
+        // number of fragment uniform entries visible through a single UBO binding
+        i32 frag_window{ 1 };
         CreateFlags flags{ CreateFlags::None };
 
-        // Per frame buffers
+        // Persistent mapped streaming buffers, used
+        // instead of glBufferData() when supported.
+        bool persistent_buffers{ false };
+        GLStreamBuffer vert_stream{};
+        GLStreamBuffer frag_stream{};
+        GLStreamBuffer frag_index_stream{};
+        GLStreamBuffer prim_stream{};
+        GLStreamBuffer segment_stream{};
+        GLsync stream_fences[StreamRegionCount] = {};
+        i32 stream_region{ 0 };
+        int64_t vert_base{ 0 };
+        int64_t frag_base{ 0 };
+        int64_t frag_index_base{ 0 };
+        int64_t prim_base{ 0 };
+        int64_t segment_base{ 0 };
+        // texture updates are staged in the current region along with the frame's
+        // vertices, upload_used is the part of it already handed out
+        GLStreamBuffer upload_stream{};
+        int64_t upload_used{ 0 };
+        FrameStats stats{};
+
+        // GPU timings per variant, see CreateFlags::ShaderTimings
+        GLTimerQueries timers[2]{};
+        i32 timer_set{ 0 };
+        ShaderTiming timings[ShaderVariantCount]{};
+        char variant_names[ShaderVariantCount][32]{};
+
+        // Per frame buffers, allocated from the frame arena
+        FrameArena arena{};
         GLCall* calls{ nullptr };
         i32 ccalls{ 0 };
         i32 ncalls{ 0 };
@@ -114,17 +291,35 @@ namespace rl::nvg::gl {
         Vertex* verts{ nullptr };
         i32 cverts{ 0 };
         i32 nverts{ 0 };
+        // per vertex index into the bound fragment uniform window
+        u16* frag_indices{ nullptr };
+        // the vertices quantized by pack_vertices(), null when uploading them as is
+        GLPackedVertex* packed_verts{ nullptr };
         uint8_t* uniforms{ nullptr };
         i32 cuniforms{ 0 };
         i32 nuniforms{ 0 };
-
-        // cached state
-        GLuint bound_texture{ 0 };
-        GLuint stencil_mask{ 0 };
-        GLenum stencil_func{ 0 };
-        GLint stencil_func_ref{ 0 };
-        GLuint stencil_func_mask{ 0 };
-        GLBlend blend_func{ 0 };
+        // open addressing table of the uniform entries, capacity is a power of 2
+        GLUniformSlot* uniform_slots{ nullptr };
+        i32 cslots{ 0 };
+        i32 nslots{ 0 };
+        GLPrimitive* prims{ nullptr };
+        i32 cprims{ 0 };
+        i32 nprims{ 0 };
+        GLSegment* segments{ nullptr };
+        i32 csegments{ 0 };
+        i32 nsegments{ 0 };
+
+        // glMultiDrawArrays() arguments of the call being drawn
+        GLint* draw_firsts{ nullptr };
+        GLsizei* draw_counts{ nullptr };
+        i32 cdraws{ 0 };
+
+        // GL state shared with the rest of the renderer, or own_state if none was given
+        rl::gl::StateCache* state{ nullptr };
+        rl::gl::StateCache own_state{};
+        // fill variant currently in use, null while another program is bound
+        GLShader* bound_shader{ nullptr };
+        f32 vert_xform[6] = {};
 
         i32 dummy_tex{ 0 };
     };
@@ -135,39 +330,14 @@ namespace rl::nvg::gl {
                 return a > b ? a : b;
             }
 
-            void bind_texture(GLContext* gl, const GLuint tex) {
-                if (gl->bound_texture != tex) {
-                    gl->bound_texture = tex;
-                    glBindTexture(GL_TEXTURE_2D, tex);
-                }
-            }
-
-            void stencil_mask(GLContext* gl, const GLuint mask) {
-                if (gl->stencil_mask != mask) {
-                    gl->stencil_mask = mask;
-                    glStencilMask(mask);
-                }
-            }
-
-            void stencil_func(GLContext* gl, const GLenum func, const GLint ref, const GLuint mask) {
-                if ((gl->stencil_func != func) || (gl->stencil_func_ref != ref) ||
-                    (gl->stencil_func_mask != mask)) {
-                    gl->stencil_func = func;
-                    gl->stencil_func_ref = ref;
-                    gl->stencil_func_mask = mask;
-                    glStencilFunc(func, ref, mask);
-                }
+            void bind_texture(const GLContext* gl, const GLuint tex) {
+                gl->state->active_texture(GL_TEXTURE0);
+                gl->state->bind_texture(GL_TEXTURE_2D, tex);
             }
 
-            void blend_func_separate(GLContext* gl, const GLBlend* blend) {
-                if ((gl->blend_func.src_rgb != blend->src_rgb) ||
-                    (gl->blend_func.dst_rgb != blend->dst_rgb) ||
-                    (gl->blend_func.src_alpha != blend->src_alpha) ||
-                    (gl->blend_func.dst_alpha != blend->dst_alpha)) {
-                    gl->blend_func = *blend;
-                    glBlendFuncSeparate(blend->src_rgb, blend->dst_rgb, blend->src_alpha,
-                                        blend->dst_alpha);
-                }
+            void blend_func_separate(const GLContext* gl, const GLBlend* blend) {
+                gl->state->blend_func_separate(blend->src_rgb, blend->dst_rgb, blend->src_alpha,
+                                               blend->dst_alpha);
             }
 
             GLTexture* alloc_texture(GLContext* gl) {
@@ -214,7 +384,7 @@ namespace rl::nvg::gl {
                     if (gl->textures[i].id == id) {
                         if (gl->textures[i].tex != 0 &&
                             (gl->textures[i].flags & ImageFlags::NoDelete) == 0)
-                            glDeleteTextures(1, &gl->textures[i].tex);
+                            gl->state->delete_texture(gl->textures[i].tex);
 
                         std::memset(&gl->textures[i], 0, sizeof(gl->textures[i]));
                         return 1;
@@ -223,6 +393,60 @@ namespace rl::nvg::gl {
                 return 0;
             }
 
+            GLGeometry* alloc_geometry(GLContext* gl) {
+                GLGeometry* geometry{ nullptr };
+                for (i32 i = 0; i < gl->ngeometries; i++) {
+                    if (gl->geometries[i].id == 0) {
+                        geometry = &gl->geometries[i];
+                        break;
+                    }
+                }
+
+                if (geometry == nullptr) {
+                    if (gl->ngeometries + 1 > gl->cgeometries) {
+                        // 1.5x Overallocate
+                        const i32 cgeometries{ maxi(gl->ngeometries + 1, 16) +
+                                               gl->cgeometries / 2 };
+                        auto geometries{ static_cast<GLGeometry*>(
+                            std::realloc(gl->geometries, sizeof(GLGeometry) * cgeometries)) };
+
+                        if (geometries == nullptr)
+                            return nullptr;
+
+                        gl->geometries = geometries;
+                        gl->cgeometries = cgeometries;
+                    }
+                    geometry = &gl->geometries[gl->ngeometries++];
+                }
+
+                *geometry = GLGeometry{};
+                geometry->id = ++gl->geometry_id;
+
+                return geometry;
+            }
+
+            GLGeometry* find_geometry(const GLContext* gl, const i32 id) {
+                for (i32 i = 0; i < gl->ngeometries; i++)
+                    if (gl->geometries[i].id == id)
+                        return &gl->geometries[i];
+
+                return nullptr;
+            }
+
+            void release_geometry(const GLContext* gl, GLGeometry* geometry) {
+                if (geometry->buf != 0)
+                    gl->state->delete_buffer(geometry->buf);
+
+                std::free(geometry->paths);
+                *geometry = GLGeometry{};
+            }
+
+            void release_orphaned_geometry(const GLContext* gl) {
+                for (i32 i = 0; i < gl->ngeometries; i++)
+                    if (gl->geometries[i].orphaned)
+                        release_geometry(gl, &gl->geometries[i]);
+            }
+
             void dump_shader_error(const GLuint shader, const char* name, const char* type) {
                 GLsizei len{ 0 };
                 GLchar str[512 + 1];
@@ -257,7 +481,8 @@ namespace rl::nvg::gl {
             }
 
             i32 create_shader(GLShader* shader, const char* name, const char* header,
-                              const char* opts, const char* vshader, const char* fshader) {
+                              const char* opts, const char* vshader, const char* fshader,
+                              const char* gshader = nullptr) {
                 GLint status;
                 const char* str[3];
                 str[0] = header;
@@ -287,11 +512,26 @@ namespace rl::nvg::gl {
                     return 0;
                 }
 
+                GLuint geom{ 0 };
+                if (gshader != nullptr) {
+                    geom = glCreateShader(GL_GEOMETRY_SHADER);
+                    str[2] = gshader;
+                    glShaderSource(geom, 3, str, nullptr);
+                    glCompileShader(geom);
+                    glGetShaderiv(geom, GL_COMPILE_STATUS, &status);
+                    if (status != GL_TRUE) {
+                        dump_shader_error(geom, name, "geom");
+                        return 0;
+                    }
+                    glAttachShader(prog, geom);
+                }
+
                 glAttachShader(prog, vert);
                 glAttachShader(prog, frag);
 
                 glBindAttribLocation(prog, 0, "vertex");
                 glBindAttribLocation(prog, 1, "tcoord");
+                glBindAttribLocation(prog, 2, "fragIndex");
 
                 glLinkProgram(prog);
                 glGetProgramiv(prog, GL_LINK_STATUS, &status);
@@ -303,25 +543,39 @@ namespace rl::nvg::gl {
                 shader->prog = prog;
                 shader->vert = vert;
                 shader->frag = frag;
+                shader->geom = geom;
 
                 return 1;
             }
 
-            void delete_shader(const GLShader* shader) {
+            void delete_shader(const GLContext* gl, const GLShader* shader) {
                 if (shader->prog != 0)
-                    glDeleteProgram(shader->prog);
+                    gl->state->delete_program(shader->prog);
                 if (shader->vert != 0)
                     glDeleteShader(shader->vert);
                 if (shader->frag != 0)
                     glDeleteShader(shader->frag);
+                if (shader->geom != 0)
+                    glDeleteShader(shader->geom);
             }
 
             void get_uniforms(GLShader* shader) {
                 shader->loc[LocViewsize] = glGetUniformLocation(shader->prog, "viewSize");
+                shader->loc[LocVertXform] = glGetUniformLocation(shader->prog, "vertXform");
                 shader->loc[LocTex] = glGetUniformLocation(shader->prog, "tex");
                 shader->loc[LocFrag] = glGetUniformBlockIndex(shader->prog, "frag");
             }
 
+            // Index of the program variant drawing a paint. Combinations the shader doesn't
+            // distinguish map to the same variant, distance fields are only reconstructed for
+            // glyphs (textured triangles) and image patterns sample them as plain alpha.
+            constexpr i32 shader_variant(const i32 type, const i32 tex_type, const bool scissor) {
+                const bool image{ type == SVGShaderFillimg || type == SVGShaderImg };
+                const i32 tex{ type == SVGShaderFillimg && tex_type == 3 ? 2 : tex_type };
+                return (type * TexTypeCount + (image ? tex : 0)) * 2 +
+                       (scissor && type != SVGShaderSimple ? 1 : 0);
+            }
+
             i32 render_create_texture(void* uptr, TextureProperty type, i32 w, i32 h,
                                       ImageFlags image_flags, const uint8_t* data);
 
@@ -333,19 +587,24 @@ namespace rl::nvg::gl {
 
                 static auto fill_vert_shader =
                     "uniform vec2 viewSize;\n"
+                    "uniform mat3 vertXform;\n"
                     "in vec2 vertex;\n"
                     "in vec2 tcoord;\n"
+                    "in int fragIndex;\n"
                     "out vec2 ftcoord;\n"
                     "out vec2 fpos;\n"
+                    "flat out int ffragIndex;\n"
                     "\n"
                     "void main(void) {\n"
+                    "    vec2 pos = (vertXform * vec3(vertex,1.0)).xy;\n"
                     "    ftcoord = tcoord;\n"
-                    "    fpos = vertex;\n"
-                    "    gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
+                    "    fpos = pos;\n"
+                    "    ffragIndex = fragIndex;\n"
+                    "    gl_Position = vec4(2.0*pos.x/viewSize.x - 1.0, 1.0 - 2.0*pos.y/viewSize.y, 0, 1);\n"
                     "}\n";
 
                 static auto fill_frag_shader =
-                    "layout(std140) uniform frag {\n"
+                    "struct FragUniforms {\n"
                     "    mat3 scissorMat;\n"
                     "    mat3 paintMat;\n"
                     "    vec4 innerCol;\n"
@@ -359,11 +618,19 @@ namespace rl::nvg::gl {
                     "    float strokeThr;\n"
                     "    int texType;\n"
                     "    int type;\n"
+                    "#if FRAG_PADDING > 0\n"
+                    "    vec4 padding[FRAG_PADDING];\n"
+                    "#endif\n"
+                    "};\n"
+                    "layout(std140) uniform frag {\n"
+                    "    FragUniforms frags[FRAG_COUNT];\n"
                     "};\n"
                     "uniform sampler2D tex;\n"
                     "in vec2 ftcoord;\n"
                     "in vec2 fpos;\n"
+                    "flat in int ffragIndex;\n"
                     "out vec4 outColor;\n"
+                    "FragUniforms u;\n"
                     "\n"
                     "float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
                     "    vec2 ext2 = ext - vec2(rad,rad);\n"
@@ -372,86 +639,475 @@ namespace rl::nvg::gl {
                     "}\n"
                     "\n"
                     "// Scissoring\n"
+                    "#ifdef SCISSOR\n"
                     "float scissorMask(vec2 p) {\n"
-                    "    vec2 sc = (abs((scissorMat * vec3(p,1.0)).xy) - scissorExt);\n"
-                    "    sc = vec2(0.5,0.5) - sc * scissorScale;\n"
+                    "    vec2 sc = (abs((u.scissorMat * vec3(p,1.0)).xy) - u.scissorExt);\n"
+                    "    sc = vec2(0.5,0.5) - sc * u.scissorScale;\n"
                     "    return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);\n"
                     "}\n"
+                    "#else\n"
+                    "float scissorMask(vec2 p) {\n"
+                    "    return 1.0;\n"
+                    "}\n"
+                    "#endif\n"
                     "#ifdef EDGE_AA\n"
                     "  // Stroke - from [0..1] to clipped pyramid, where the slope is 1px.\n"
                     "  float strokeMask() {\n"
-                    "      return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*strokeMult) * min(1.0, ftcoord.y);\n"
+                    "      return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*u.strokeMult) * min(1.0, ftcoord.y);\n"
                     "  }\n"
                     "#endif\n"
                     "\n"
+                    "vec4 texColor(vec2 pt) {\n"
+                    "    vec4 color = texture(tex, pt);\n"
+                    "#if TEX_TYPE == 1\n"
+                    "    color = vec4(color.xyz*color.w,color.w);\n"
+                    "#elif TEX_TYPE >= 2\n"
+                    "    color = vec4(color.x);\n"
+                    "#endif\n"
+                    "    return color;\n"
+                    "}\n"
+                    "\n"
                     "void main(void) {\n"
-                    "    vec4 result;\n"
+                    "#if SHADER_TYPE == 2\n"
+                    "    // Stencil fill\n"
+                    "    outColor = vec4(1,1,1,1);\n"
+                    "#else\n"
+                    "    u = frags[ffragIndex];\n"
                     "    float scissor = scissorMask(fpos);\n"
                     "#ifdef EDGE_AA\n"
                     "    float strokeAlpha = strokeMask();\n"
-                    "    if (strokeAlpha < strokeThr) discard;\n"
+                    "    if (strokeAlpha < u.strokeThr) discard;\n"
                     "#else\n"
                     "    float strokeAlpha = 1.0;\n"
                     "#endif\n"
-                    "    if (type == 0) {            // Gradient\n"
-                    "        // Calculate gradient color using box gradient\n"
-                    "        vec2 pt = (paintMat * vec3(fpos,1.0)).xy;\n"
-                    "        float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);\n"
-                    "        vec4 color = mix(innerCol,outerCol,d);\n"
-                    "        // Combine alpha\n"
-                    "        color *= strokeAlpha * scissor;\n"
-                    "        result = color;\n"
-                    "    } else if (type == 1) {        // Image\n"
-                    "        // Calculate color fron texture\n"
-                    "        vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;\n"
-                    "        vec4 color = texture(tex, pt);\n"
-                    "        if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
-                    "        if (texType == 2) color = vec4(color.x);"
-                    "        // Apply color tint and alpha.\n"
-                    "        color *= innerCol;\n"
-                    "        // Combine alpha\n"
-                    "        color *= strokeAlpha * scissor;\n"
-                    "        result = color;\n"
-                    "    } else if (type == 2) {        // Stencil fill\n"
-                    "        result = vec4(1,1,1,1);\n"
-                    "    } else if (type == 3) {        // Textured tris\n"
-                    "        vec4 color = texture(tex, ftcoord);\n"
-                    "        if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
-                    "        if (texType == 2) color = vec4(color.x);"
-                    "        color *= scissor;\n"
-                    "        result = color * innerCol;\n"
+                    "#if SHADER_TYPE == 0\n"
+                    "    // Calculate gradient color using box gradient\n"
+                    "    vec2 pt = (u.paintMat * vec3(fpos,1.0)).xy;\n"
+                    "    float d = clamp((sdroundrect(pt, u.extent, u.radius) + u.feather*0.5) / u.feather, 0.0, 1.0);\n"
+                    "    vec4 color = mix(u.innerCol,u.outerCol,d);\n"
+                    "    // Combine alpha\n"
+                    "    outColor = color * strokeAlpha * scissor;\n"
+                    "#elif SHADER_TYPE == 1\n"
+                    "    // Calculate color from texture\n"
+                    "    vec2 pt = (u.paintMat * vec3(fpos,1.0)).xy / u.extent;\n"
+                    "    // Apply color tint and alpha.\n"
+                    "    vec4 color = texColor(pt) * u.innerCol;\n"
+                    "    // Combine alpha\n"
+                    "    outColor = color * strokeAlpha * scissor;\n"
+                    "#else\n"
+                    "    // Textured tris\n"
+                    "#if TEX_TYPE == 3\n"
+                    "    // Distance field glyphs. The edge is anti-aliased over a pixel and widened by\n"
+                    "    // the blur (feather), the outline around it is radius pixels wide in outerCol.\n"
+                    "    vec2 texels = fwidth(ftcoord) * vec2(textureSize(tex, 0));\n"
+                    "    float px = max(0.5 * (texels.x + texels.y) * SDF_TEXEL_DIST, 1e-5);\n"
+                    "    float dist = texture(tex, ftcoord).x - SDF_EDGE;\n"
+                    "    float edge = px * (0.5 + u.feather);\n"
+                    "    float fill = smoothstep(-edge, edge, dist);\n"
+                    "    float outline = smoothstep(-edge, edge, dist + u.radius * px);\n"
+                    "    outColor = mix(u.outerCol * outline, u.innerCol, fill) * scissor;\n"
+                    "#else\n"
+                    "    outColor = texColor(ftcoord) * scissor * u.innerCol;\n"
+                    "#endif\n"
+                    "#endif\n"
+                    "#endif\n"
+                    "}\n";
+
+                // Strokes expanded on the GPU, see CreateFlags::GeometryStrokes. Every segment is a
+                // point, the geometry shader steps along it and emits the same strips, caps and
+                // joins expand_stroke() would, for the fill fragment shader to draw as usual.
+                static auto stroke_vert_shader =
+                    "layout(location = 0) in vec4 points0;\n"
+                    "layout(location = 1) in vec4 points1;\n"
+                    "layout(location = 2) in vec4 join;\n"
+                    "layout(location = 3) in vec4 params;\n"
+                    "out vec4 vpoints0;\n"
+                    "out vec4 vpoints1;\n"
+                    "out vec4 vjoin;\n"
+                    "out vec4 vparams;\n"
+                    "\n"
+                    "void main(void) {\n"
+                    "    vpoints0 = points0;\n"
+                    "    vpoints1 = points1;\n"
+                    "    vjoin = join;\n"
+                    "    vparams = params;\n"
+                    "}\n";
+
+                // The output is sized for a round join or cap at both ends of a curve stepped
+                // MAX_CURVE_STEPS times, 9 components per vertex stay within the 1024 GL allows.
+                static auto stroke_geom_shader =
+                    "#define SEGMENT_LINE 1\n"
+                    "#define SEGMENT_START_CAP 2\n"
+                    "#define SEGMENT_END_CAP 4\n"
+                    "#define SEGMENT_JOIN 8\n"
+                    "#define CAP_ROUND 1\n"
+                    "#define CAP_SQUARE 2\n"
+                    "#define JOIN_ROUND 1\n"
+                    "#define JOIN_MITER 4\n"
+                    "#define MAX_CURVE_STEPS 32\n"
+                    "#define MAX_ARC_STEPS 10\n"
+                    "#define SEAM_OVERLAP 0.05\n"
+                    "#define PI 3.14159265358979\n"
+                    "layout(points) in;\n"
+                    "layout(triangle_strip, max_vertices = 110) out;\n"
+                    "uniform vec2 viewSize;\n"
+                    "in vec4 vpoints0[];\n"
+                    "in vec4 vpoints1[];\n"
+                    "in vec4 vjoin[];\n"
+                    "in vec4 vparams[];\n"
+                    "out vec2 ftcoord;\n"
+                    "out vec2 fpos;\n"
+                    "flat out int ffragIndex;\n"
+                    "\n"
+                    "void emit(vec2 pos, float u, float v) {\n"
+                    "    ftcoord = vec2(u, v);\n"
+                    "    fpos = pos;\n"
+                    "    ffragIndex = 0;\n"
+                    "    gl_Position = vec4(2.0*pos.x/viewSize.x - 1.0, 1.0 - 2.0*pos.y/viewSize.y, 0, 1);\n"
+                    "    EmitVertex();\n"
+                    "}\n"
+                    "\n"
+                    "// first of the directions that isn't degenerate, same as the frontend\n"
+                    "vec2 direction(vec2 a, vec2 b, vec2 c) {\n"
+                    "    vec2 d = dot(a,a) >= 1e-6 ? a : (dot(b,b) >= 1e-6 ? b : c);\n"
+                    "    return dot(d,d) > 1e-12 ? normalize(d) : vec2(1.0, 0.0);\n"
+                    "}\n"
+                    "\n"
+                    "void main(void) {\n"
+                    "    vec2 p0 = vpoints0[0].xy;\n"
+                    "    vec2 c0 = vpoints0[0].zw;\n"
+                    "    vec2 c1 = vpoints1[0].xy;\n"
+                    "    vec2 p1 = vpoints1[0].zw;\n"
+                    "    int flags = int(vjoin[0].z);\n"
+                    "    int cap = (flags >> 4) & 7;\n"
+                    "    int join = (flags >> 7) & 7;\n"
+                    "    float w = vparams[0].x;\n"
+                    "    float aa = vparams[0].y;\n"
+                    "    float tol = vparams[0].w;\n"
+                    "    // no gradient across the stroke without anti-aliasing\n"
+                    "    float u0 = aa > 0.0 ? 0.0 : 0.5;\n"
+                    "    float u1 = aa > 0.0 ? 1.0 : 0.5;\n"
+                    "    // divisions per half circle, see curve_divs()\n"
+                    "    float r = w - aa*0.5;\n"
+                    "    int narc = clamp(int(ceil(PI / (acos(r / (r + tol)) * 2.0))), 2, MAX_ARC_STEPS);\n"
+                    "    vec2 t0 = direction(c0 - p0, c1 - p0, p1 - p0);\n"
+                    "    vec2 t1 = direction(p1 - c1, p1 - c0, p1 - p0);\n"
+                    "    vec2 n0 = vec2(t0.y, -t0.x);\n"
+                    "    vec2 n1 = vec2(t1.y, -t1.x);\n"
+                    "\n"
+                    "    if ((flags & SEGMENT_JOIN) != 0) {\n"
+                    "        // fill the wedge on the outer side of the corner, the inner sides overlap\n"
+                    "        vec2 tp = vjoin[0].xy;\n"
+                    "        float side = tp.x*t0.y - tp.y*t0.x < 0.0 ? -1.0 : 1.0;\n"
+                    "        float uo = side > 0.0 ? u0 : u1;\n"
+                    "        vec2 a = side * vec2(tp.y, -tp.x);\n"
+                    "        vec2 b = side * n0;\n"
+                    "        if (join == JOIN_ROUND) {\n"
+                    "            float a0 = atan(a.y, a.x);\n"
+                    "            float da = atan(b.y, b.x) - a0;\n"
+                    "            if (da > PI) da -= 2.0*PI;\n"
+                    "            if (da < -PI) da += 2.0*PI;\n"
+                    "            int n = clamp(int(ceil(abs(da) / PI * float(narc))), 1, narc);\n"
+                    "            for (int i = 0; i <= n; i++) {\n"
+                    "                float ang = a0 + da*float(i)/float(n);\n"
+                    "                emit(p0 + vec2(cos(ang), sin(ang))*w, uo, 1.0);\n"
+                    "                emit(p0, 0.5, 1.0);\n"
+                    "            }\n"
+                    "        } else {\n"
+                    "            vec2 dm = (a + b) * 0.5;\n"
+                    "            float dmr2 = dot(dm, dm);\n"
+                    "            bool miter = join == JOIN_MITER && dmr2 * vparams[0].z * vparams[0].z >= 1.0;\n"
+                    "            // a bevel edge is only |dm|*w away from the center, the gradient is\n"
+                    "            // scaled to keep the anti-aliased edge as wide as everywhere else\n"
+                    "            float uc = miter ? 0.5 : mix(uo, 0.5, sqrt(dmr2));\n"
+                    "            emit(p0 + a*w, uo, 1.0);\n"
+                    "            emit(p0, uc, 1.0);\n"
+                    "            if (miter)\n"
+                    "                emit(p0 + dm / dmr2 * w, uo, 1.0);\n"
+                    "            emit(p0 + b*w, uo, 1.0);\n"
+                    "        }\n"
+                    "        EndPrimitive();\n"
+                    "    }\n"
+                    "\n"
+                    "    if ((flags & SEGMENT_START_CAP) != 0) {\n"
+                    "        if (cap == CAP_ROUND) {\n"
+                    "            for (int i = 0; i < narc; i++) {\n"
+                    "                float ang = float(i) / float(narc - 1) * PI;\n"
+                    "                emit(p0 - n0*cos(ang)*w - t0*sin(ang)*w, u0, 1.0);\n"
+                    "                emit(p0, 0.5, 1.0);\n"
+                    "            }\n"
+                    "        } else {\n"
+                    "            vec2 p = p0 - t0 * (cap == CAP_SQUARE ? w - aa : -aa*0.5);\n"
+                    "            emit(p + n0*w - t0*aa, u0, 0.0);\n"
+                    "            emit(p - n0*w - t0*aa, u1, 0.0);\n"
+                    "            emit(p + n0*w, u0, 1.0);\n"
+                    "            emit(p - n0*w, u1, 1.0);\n"
+                    "        }\n"
+                    "    }\n"
+                    "\n"
+                    "    // Wang's formula for the number of steps keeping the curve within tol\n"
+                    "    int steps = 1;\n"
+                    "    if ((flags & SEGMENT_LINE) == 0) {\n"
+                    "        float dd = max(length(p0 - 2.0*c0 + c1), length(c0 - 2.0*c1 + p1));\n"
+                    "        steps = clamp(int(ceil(sqrt(0.75 * dd / tol))), 1, MAX_CURVE_STEPS);\n"
+                    "    }\n"
+                    "    // ends meeting a join or the next segment overlap it slightly, abutting\n"
+                    "    // edges built from different vertices can leave cracks between them\n"
+                    "    vec2 q0 = (flags & SEGMENT_JOIN) != 0 ? p0 - t0*SEAM_OVERLAP : p0;\n"
+                    "    vec2 q1 = (flags & SEGMENT_END_CAP) == 0 ? p1 + t1*SEAM_OVERLAP : p1;\n"
+                    "    emit(q0 + n0*w, u0, 1.0);\n"
+                    "    emit(q0 - n0*w, u1, 1.0);\n"
+                    "    for (int i = 1; i < steps; i++) {\n"
+                    "        float t = float(i) / float(steps);\n"
+                    "        float s = 1.0 - t;\n"
+                    "        vec2 p = s*s*s*p0 + 3.0*s*s*t*c0 + 3.0*s*t*t*c1 + t*t*t*p1;\n"
+                    "        vec2 d = s*s*(c0 - p0) + 2.0*s*t*(c1 - c0) + t*t*(p1 - c1);\n"
+                    "        d = dot(d,d) > 1e-12 ? normalize(d) : t0;\n"
+                    "        emit(p + vec2(d.y, -d.x)*w, u0, 1.0);\n"
+                    "        emit(p - vec2(d.y, -d.x)*w, u1, 1.0);\n"
                     "    }\n"
-                    "    outColor = result;\n"
+                    "    emit(q1 + n1*w, u0, 1.0);\n"
+                    "    emit(q1 - n1*w, u1, 1.0);\n"
+                    "\n"
+                    "    if ((flags & SEGMENT_END_CAP) != 0) {\n"
+                    "        if (cap == CAP_ROUND) {\n"
+                    "            for (int i = 0; i < narc; i++) {\n"
+                    "                float ang = float(i) / float(narc - 1) * PI;\n"
+                    "                emit(p1, 0.5, 1.0);\n"
+                    "                emit(p1 - n1*cos(ang)*w + t1*sin(ang)*w, u0, 1.0);\n"
+                    "            }\n"
+                    "        } else {\n"
+                    "            vec2 p = p1 + t1 * (cap == CAP_SQUARE ? w - aa : -aa*0.5);\n"
+                    "            emit(p + n1*w, u0, 1.0);\n"
+                    "            emit(p - n1*w, u1, 1.0);\n"
+                    "            emit(p + n1*w + t1*aa, u0, 0.0);\n"
+                    "            emit(p - n1*w + t1*aa, u1, 0.0);\n"
+                    "        }\n"
+                    "    }\n"
+                    "    EndPrimitive();\n"
+                    "}\n";
+
+                // Analytic rounded rects, one instance per shape. The quad corners are derived
+                // from gl_VertexID and the shape's coverage from its signed distance field.
+                static auto prim_vert_shader =
+                    "uniform vec2 viewSize;\n"
+                    "layout(location = 0) in vec4 xform;\n"
+                    "layout(location = 1) in vec4 translateShape;\n"
+                    "layout(location = 2) in vec4 rect;\n"
+                    "layout(location = 3) in vec4 paintXform;\n"
+                    "layout(location = 4) in vec4 paintTranslateExt;\n"
+                    "layout(location = 5) in vec4 paintParams;\n"
+                    "layout(location = 6) in vec4 scissorXform;\n"
+                    "layout(location = 7) in vec4 scissorTranslateExt;\n"
+                    "layout(location = 8) in vec4 innerCol;\n"
+                    "layout(location = 9) in vec4 outerCol;\n"
+                    "out vec2 flocal;\n"
+                    "out vec2 fpaint;\n"
+                    "out vec2 fscissor;\n"
+                    "flat out vec4 fshape;\n"
+                    "flat out vec4 fpaintParams;\n"
+                    "flat out vec4 fscissorParams;\n"
+                    "flat out vec4 finnerCol;\n"
+                    "flat out vec4 fouterCol;\n"
+                    "\n"
+                    "vec2 transformPoint(vec4 m, vec2 t, vec2 p) {\n"
+                    "    return vec2(m.x*p.x + m.z*p.y, m.y*p.x + m.w*p.y) + t;\n"
+                    "}\n"
+                    "\n"
+                    "void main(void) {\n"
+                    "    vec2 halfSize = rect.zw * 0.5;\n"
+                    "    // grow the quad to fit the outline and the anti-aliased edge\n"
+                    "    vec2 pad = vec2(translateShape.w * 0.5 + 2.0);\n"
+                    "    vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+                    "    flocal = (corner * 2.0 - 1.0) * (halfSize + pad);\n"
+                    "    vec2 pos = transformPoint(xform, translateShape.xy, rect.xy + halfSize + flocal);\n"
+                    "    fpaint = transformPoint(paintXform, paintTranslateExt.xy, pos);\n"
+                    "    fscissor = transformPoint(scissorXform, scissorTranslateExt.xy, pos);\n"
+                    "    fshape = vec4(halfSize, translateShape.zw);\n"
+                    "    fpaintParams = vec4(paintTranslateExt.zw, paintParams.xy);\n"
+                    "    fscissorParams = vec4(scissorTranslateExt.zw, paintParams.zw);\n"
+                    "    finnerCol = innerCol;\n"
+                    "    fouterCol = outerCol;\n"
+                    "    gl_Position = vec4(2.0*pos.x/viewSize.x - 1.0, 1.0 - 2.0*pos.y/viewSize.y, 0, 1);\n"
+                    "}\n";
+
+                static auto prim_frag_shader =
+                    "in vec2 flocal;\n"
+                    "in vec2 fpaint;\n"
+                    "in vec2 fscissor;\n"
+                    "flat in vec4 fshape;\n"
+                    "flat in vec4 fpaintParams;\n"
+                    "flat in vec4 fscissorParams;\n"
+                    "flat in vec4 finnerCol;\n"
+                    "flat in vec4 fouterCol;\n"
+                    "out vec4 outColor;\n"
+                    "\n"
+                    "float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
+                    "    vec2 ext2 = ext - vec2(rad,rad);\n"
+                    "    vec2 d = abs(pt) - ext2;\n"
+                    "    return min(max(d.x,d.y),0.0) + length(max(d,0.0)) - rad;\n"
+                    "}\n"
+                    "\n"
+                    "void main(void) {\n"
+                    "    // Shape coverage, the outline is centered on the shape's edge\n"
+                    "    float rad = min(fshape.z, min(fshape.x, fshape.y));\n"
+                    "    float d = sdroundrect(flocal, fshape.xy, rad);\n"
+                    "    float aa = max(fwidth(d), 0.0001);\n"
+                    "    float coverage = fshape.w > 0.0\n"
+                    "        ? clamp((fshape.w*0.5 - abs(d)) / aa + 0.5, 0.0, 1.0)\n"
+                    "        : clamp(0.5 - d / aa, 0.0, 1.0);\n"
+                    "    // Scissoring\n"
+                    "    vec2 sc = vec2(0.5,0.5) - (abs(fscissor) - fscissorParams.xy) * fscissorParams.zw;\n"
+                    "    float scissor = clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);\n"
+                    "    // Box gradient, solid colors and linear gradients are special cases of it\n"
+                    "    float g = clamp((sdroundrect(fpaint, fpaintParams.xy, fpaintParams.z) + fpaintParams.w*0.5) / fpaintParams.w, 0.0, 1.0);\n"
+                    "    outColor = mix(finnerCol,fouterCol,g) * coverage * scissor;\n"
                     "}\n";
 
                 check_error(gl, "init");
 
-                if ((gl->flags & CreateFlags::AntiAlias) != 0) {
-                    if (create_shader(&gl->shader, "shader", shader_header, "#define EDGE_AA 1\n",
-                                      fill_vert_shader, fill_frag_shader) == 0)
-                        return 0;
-                }
-                else {
-                    if (create_shader(&gl->shader, "shader", shader_header, nullptr,
-                                      fill_vert_shader, fill_frag_shader) == 0)
-                        return 0;
+                // Uniform entries are bound as an array so merged draw calls can index them per
+                // vertex. The entry stride has to satisfy both the UBO offset alignment and the
+                // std140 struct array stride, both of which are powers of two.
+                i32 align = 4;
+                i32 max_block_size = 16384;
+                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+                glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+
+                align = math::max(align, 16);
+                gl->frag_size = static_cast<i32>(
+                    (sizeof(GLFragUniforms) + align - 1) / align * align);
+                gl->frag_window = math::min(max_block_size / gl->frag_size, MaxFragWindow);
+
+                // One program per paint variant. Only image paints depend on the texture type,
+                // the stencil pass never reads the scissor and only fills and strokes use the
+                // anti-aliased stroke mask.
+                char shader_opts[256]{};
+                // The distance field value on the glyph outline and its
+                // change per texel, see tt_render_glyph_sdf()
+                constexpr f64 sdf_edge{ font::SDF_ON_EDGE / 255.0 };
+                constexpr f64 sdf_texel_dist{ sdf_edge / font::SDF_PADDING };
+                for (i32 type = 0; type < SVGShaderTypeCount; ++type) {
+                    for (i32 tex_type = 0; tex_type < TexTypeCount; ++tex_type) {
+                        for (const bool scissor : { false, true }) {
+                            const i32 variant{ shader_variant(type, tex_type, scissor) };
+                            GLShader* shader{ &gl->variants[variant] };
+                            if (shader->prog != 0)
+                                continue;
+
+                            static constexpr const char* type_names[SVGShaderTypeCount]{
+                                "gradient", "image", "stencil", "triangles"
+                            };
+                            static constexpr const char* tex_names[TexTypeCount]{
+                                "", "/straight", "/alpha", "/sdf"
+                            };
+                            std::snprintf(gl->variant_names[variant],
+                                          sizeof(gl->variant_names[variant]), "%s%s%s",
+                                          type_names[type],
+                                          tex_names[variant / 2 % TexTypeCount],
+                                          variant % 2 != 0 ? "+scissor" : "");
+
+                            const bool edge_aa{ (gl->flags & CreateFlags::AntiAlias) != 0 &&
+                                                (type == SVGShaderFillgrad ||
+                                                 type == SVGShaderFillimg) };
+                            std::snprintf(shader_opts, sizeof(shader_opts),
+                                          "#define FRAG_COUNT %d\n"
+                                          "#define FRAG_PADDING %d\n"
+                                          "#define SHADER_TYPE %d\n"
+                                          "#define TEX_TYPE %d\n"
+                                          "#define SDF_EDGE %f\n"
+                                          "#define SDF_TEXEL_DIST %f\n"
+                                          "%s%s",
+                                          gl->frag_window,
+                                          static_cast<i32>((gl->frag_size - sizeof(GLFragUniforms)) /
+                                                           16),
+                                          type, variant / 2 % TexTypeCount, sdf_edge,
+                                          sdf_texel_dist, edge_aa ? "#define EDGE_AA 1\n" : "",
+                                          variant % 2 != 0 ? "#define SCISSOR 1\n" : "");
+
+                            if (create_shader(shader, gl->variant_names[variant], shader_header,
+                                              shader_opts, fill_vert_shader, fill_frag_shader) == 0)
+                                return 0;
+
+                            get_uniforms(shader);
+                            gl->state->use_program(shader->prog);
+                            glUniform1i(shader->loc[LocTex], 0);
+                            // the stencil variant doesn't read the uniforms at all
+                            if (static_cast<GLuint>(shader->loc[LocFrag]) != GL_INVALID_INDEX)
+                                glUniformBlockBinding(shader->prog, shader->loc[LocFrag],
+                                                      FragBinding);
+
+                            // strokes only ever use the paint variants
+                            if ((gl->flags & CreateFlags::GeometryStrokes) == 0 ||
+                                (type != SVGShaderFillgrad && type != SVGShaderFillimg))
+                                continue;
+
+                            GLShader* stroke_shader{ &gl->stroke_variants[variant] };
+                            if (create_shader(stroke_shader, gl->variant_names[variant],
+                                              shader_header, shader_opts, stroke_vert_shader,
+                                              fill_frag_shader, stroke_geom_shader) == 0)
+                                return 0;
+
+                            get_uniforms(stroke_shader);
+                            gl->state->use_program(stroke_shader->prog);
+                            glUniform1i(stroke_shader->loc[LocTex], 0);
+                            glUniformBlockBinding(stroke_shader->prog, stroke_shader->loc[LocFrag],
+                                                  FragBinding);
+                        }
+                    }
                 }
 
+                for (i32 i = 0; i < ShaderVariantCount; ++i)
+                    gl->timings[i].name = gl->variant_names[i];
+
+                if (create_shader(&gl->prim_shader, "primitive", shader_header, nullptr,
+                                  prim_vert_shader, prim_frag_shader) == 0)
+                    return 0;
+
                 check_error(gl, "uniform locations");
-                get_uniforms(&gl->shader);
+                gl->prim_shader.loc[LocViewsize] = glGetUniformLocation(gl->prim_shader.prog,
+                                                                        "viewSize");
 
-                // Create dynamic vertex array
+                // Persistent mapped buffers require immutable buffer storage, otherwise
+                // fall back to re-specifying the buffers with glBufferData() every frame.
+                gl->persistent_buffers = (gl->flags & CreateFlags::BufferDataUploads) == 0 &&
+                                         (GLAD_GL_VERSION_4_4 != 0 || GLAD_GL_ARB_buffer_storage != 0);
+
+                // Create dynamic vertex array. The streaming buffers
+                // are allocated on the first flush once sizes are known.
                 glGenVertexArrays(1, &gl->vert_arr);
-                glGenBuffers(1, &gl->vert_buf);
+                gl->state->bind_vertex_array(gl->vert_arr);
+                glEnableVertexAttribArray(0);
+                glEnableVertexAttribArray(1);
+                if (!gl->persistent_buffers) {
+                    glGenBuffers(1, &gl->vert_buf);
+                    glGenBuffers(1, &gl->frag_index_buf);
+                }
 
-                // Create UBOs
-                i32 align = 4;
-                glUniformBlockBinding(gl->shader.prog, gl->shader.loc[LocFrag], FragBinding);
-                glGenBuffers(1, &gl->frag_buf);
-                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+                // Create primitive instance array. Every attribute advances once per instance,
+                // the pointers themselves are set per draw since they depend on the batch offset.
+                glGenVertexArrays(1, &gl->prim_arr);
+                gl->state->bind_vertex_array(gl->prim_arr);
+                for (i32 i = 0; i < PrimitiveAttribCount; ++i) {
+                    glEnableVertexAttribArray(i);
+                    glVertexAttribDivisor(i, 1);
+                }
+                if (!gl->persistent_buffers)
+                    glGenBuffers(1, &gl->prim_buf);
+
+                // Create stroke segment array, one point per segment.
+                if ((gl->flags & CreateFlags::GeometryStrokes) != 0) {
+                    glGenVertexArrays(1, &gl->segment_arr);
+                    gl->state->bind_vertex_array(gl->segment_arr);
+                    for (i32 i = 0; i < SegmentAttribCount; ++i)
+                        glEnableVertexAttribArray(i);
+                    if (!gl->persistent_buffers)
+                        glGenBuffers(1, &gl->segment_buf);
+                }
 
-                gl->frag_size = static_cast<i32>(
-                    sizeof(GLFragUniforms) + align - sizeof(GLFragUniforms) % align);
+                // Create UBOs
+                if (!gl->persistent_buffers)
+                    glGenBuffers(1, &gl->frag_buf);
 
                 // Some platforms does not allow to have samples to unset textures.
                 // Create empty one which is bound when there's no texture specified.
@@ -540,6 +1196,55 @@ namespace rl::nvg::gl {
                 return delete_texture(gl, image);
             }
 
+            i32 reserve_stream_buffer(const GLContext* gl, GLStreamBuffer* stream, GLuint* buf,
+                                      GLenum target, int64_t size);
+            void wait_stream_region(GLContext* gl);
+
+            // Returns where to write size bytes of texels for the next texture update, with the
+            // staging buffer bound to GL_PIXEL_UNPACK_BUFFER and offset set to the position of
+            // the bytes in it. Returns null if no staging memory could be mapped.
+            u8* map_upload_buffer(GLContext* gl, const int64_t size, int64_t* offset) {
+                if (!gl->persistent_buffers) {
+                    if (gl->upload_buf == 0)
+                        glGenBuffers(1, &gl->upload_buf);
+
+                    // orphaning the storage leaves the previous update's copy of it to the
+                    // driver, mapping it never waits for the GPU to be done reading it
+                    gl->state->bind_buffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_buf);
+                    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+                    *offset = 0;
+                    return static_cast<u8*>(glMapBufferRange(
+                        GL_PIXEL_UNPACK_BUFFER, 0, size,
+                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+                }
+
+                // the region was last read StreamRegionCount frames ago, so the first
+                // update of a frame almost never has to wait on its fence
+                if (gl->upload_used == 0)
+                    wait_stream_region(gl);
+
+                // row copies are faster from aligned offsets
+                int64_t used{ (gl->upload_used + 63) & ~static_cast<int64_t>(63) };
+                if (used + size > gl->upload_stream.region_size) {
+                    // 1.5x Overallocate, the replaced storage stays alive until
+                    // the updates already submitted from it have completed
+                    const int64_t region_size{ gl->upload_stream.region_size };
+                    if (reserve_stream_buffer(gl, &gl->upload_stream, &gl->upload_buf,
+                                              GL_PIXEL_UNPACK_BUFFER,
+                                              math::max(size, region_size + region_size / 2)) == 0)
+                        return nullptr;
+                    used = 0;
+                }
+
+                gl->state->bind_buffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_buf);
+                *offset = gl->stream_region * gl->upload_stream.region_size + used;
+                gl->upload_used = used + size;
+                return gl->upload_stream.data + *offset;
+            }
+
+            // The updated block is copied out of the texture's client side data into the
+            // staging buffer and uploaded from there, so glTexSubImage2D() returns right away
+            // and the copy into the texture happens on the GPU's timeline.
             i32 render_update_texture(void* uptr, const i32 image, const i32 x, const i32 y,
                                       const i32 w, const i32 h, const uint8_t* data) {
                 auto gl{ static_cast<GLContext*>(uptr) };
@@ -548,21 +1253,42 @@ namespace rl::nvg::gl {
                 if (tex == nullptr)
                     return 0;
 
+                const GLenum format{ tex->type == TextureProperty::RGBA ? GL_RGBA : GL_RED };
+                const int64_t texel_size{ tex->type == TextureProperty::RGBA ? 4 : 1 };
+                const int64_t row_size{ w * texel_size };
+                const int64_t size{ row_size * h };
+
                 bind_texture(gl, tex->tex);
                 glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-                glPixelStorei(GL_UNPACK_ROW_LENGTH, tex->width);
-                glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
-                glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
 
-                if (tex->type == TextureProperty::RGBA)
-                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                else
-                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, data);
+                int64_t offset{ 0 };
+                u8* staging{ size > 0 ? map_upload_buffer(gl, size, &offset) : nullptr };
+                if (staging != nullptr) {
+                    const int64_t stride{ tex->width * texel_size };
+                    const uint8_t* src{ data + y * stride + x * texel_size };
+                    for (i32 row = 0; row < h; ++row)
+                        std::memcpy(staging + row * row_size, src + row * stride, row_size);
+                    if (!gl->persistent_buffers)
+                        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, GL_UNSIGNED_BYTE,
+                                    reinterpret_cast<const void*>(offset));
+                    gl->state->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    gl->stats.texture_bytes_uploaded += static_cast<u64>(size);
+                }
+                else if (size > 0) {
+                    // no staging memory, upload straight from the client side data
+                    gl->state->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, tex->width);
+                    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+                    glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, GL_UNSIGNED_BYTE, data);
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+                    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+                    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+                }
 
                 glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-                glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-                glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
                 bind_texture(gl, 0);
 
                 return 1;
@@ -601,6 +1327,45 @@ namespace rl::nvg::gl {
                 return c;
             }
 
+            // Uses glScissor() for the call when the clip rect is axis aligned and its edges
+            // fall on device pixel boundaries, the shader's anti-aliased scissor mask is exactly
+            // 0 or 1 at every pixel center then. Returns the scissor the call's uniforms should
+            // be built with, which is "no scissor" when it's done in hardware.
+            const ScissorParams* setup_scissor(const GLContext* gl, GLCall* call,
+                                               const ScissorParams* scissor) {
+                static constexpr ScissorParams no_scissor{ .extent = { -1.0f, -1.0f } };
+                if (scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f)
+                    return scissor;
+
+                const f32* t{ scissor->xform };
+                if (t[1] != 0.0f || t[2] != 0.0f) {
+                    call->shader_scissor = true;
+                    return scissor;
+                }
+
+                const f32 ratio{ gl->device_px_ratio };
+                const f32 hw{ scissor->extent[0] * std::abs(t[0]) };
+                const f32 hh{ scissor->extent[1] * std::abs(t[3]) };
+                const f32 rect[4]{
+                    (t[4] - hw) * ratio,
+                    (gl->view[1] - t[5] - hh) * ratio,
+                    hw * 2.0f * ratio,
+                    hh * 2.0f * ratio,
+                };
+
+                for (i32 i = 0; i < 4; ++i) {
+                    const f32 px{ std::round(rect[i]) };
+                    if (std::abs(rect[i] - px) > 1e-3f || std::abs(px) > 1e8f) {
+                        call->shader_scissor = true;
+                        return scissor;
+                    }
+                    call->scissor_rect[i] = static_cast<GLint>(px);
+                }
+
+                call->hw_scissor = true;
+                return &no_scissor;
+            }
+
             i32 convert_paint(const GLContext* gl, GLFragUniforms* frag, const PaintStyle* paint,
                               const ScissorParams* scissor, const f32 width, const f32 fringe,
                               const f32 stroke_thr) {
@@ -658,6 +1423,12 @@ namespace rl::nvg::gl {
                     frag->type = SVGShaderFillimg;
                     if (tex->type == TextureProperty::RGBA)
                         frag->tex_type = (tex->flags & ImageFlags::PreMultiplied) != 0 ? 0 : 1;
+                    else if ((tex->flags & ImageFlags::SignedDistance) != 0) {
+                        // glyph blur and outline width, in device pixels
+                        frag->tex_type = 3;
+                        frag->radius = paint->radius;
+                        frag->feather = paint->feather;
+                    }
                     else
                         frag->tex_type = 2;
                 }
@@ -678,8 +1449,9 @@ namespace rl::nvg::gl {
 
             void set_uniforms(GLContext* gl, const i32 uniformOffset, const i32 image) {
                 const GLTexture* tex = nullptr;
-                glBindBufferRange(GL_UNIFORM_BUFFER, FragBinding, gl->frag_buf, uniformOffset,
-                                  sizeof(GLFragUniforms));
+                gl->state->bind_buffer_range(GL_UNIFORM_BUFFER, FragBinding, gl->frag_buf,
+                                             gl->frag_base + uniformOffset,
+                                             static_cast<int64_t>(gl->frag_window) * gl->frag_size);
 
                 if (image != 0)
                     tex = find_texture(gl, image);
@@ -692,138 +1464,305 @@ namespace rl::nvg::gl {
                 check_error(gl, "tex paint tex");
             }
 
-            void render_viewport(void* uptr, const f32 width, const f32 height, f32) {
+            void render_viewport(void* uptr, const f32 width, const f32 height,
+                                 const f32 device_pixel_ratio) {
                 auto gl = static_cast<GLContext*>(uptr);
                 gl->view[0] = width;
                 gl->view[1] = height;
+                gl->device_px_ratio = device_pixel_ratio;
+                gl->stats = FrameStats{};
             }
 
-            void fill(GLContext* gl, const GLCall* call) {
+            // Binds a fill program variant. The view size and vertex transform are program
+            // state, they're only uploaded when the program's copy is out of date.
+            void use_shader(GLContext* gl, GLShader* shader) {
+                if (gl->bound_shader != shader) {
+                    gl->bound_shader = shader;
+                    gl->stats.program_switches++;
+                    gl->state->use_program(shader->prog);
+                }
+
+                if (std::memcmp(shader->view, gl->view, sizeof(shader->view)) != 0) {
+                    std::memcpy(shader->view, gl->view, sizeof(shader->view));
+                    glUniform2fv(shader->loc[LocViewsize], 1, gl->view);
+                }
+
+                if (std::memcmp(shader->xform, gl->vert_xform, sizeof(shader->xform)) != 0) {
+                    const f32* t{ gl->vert_xform };
+                    const f32 m3[9] = { t[0], t[1], 0.0f, t[2], t[3], 0.0f, t[4], t[5], 1.0f };
+                    std::memcpy(shader->xform, t, sizeof(shader->xform));
+                    glUniformMatrix3fv(shader->loc[LocVertXform], 1, GL_FALSE, m3);
+                }
+            }
+
+            void set_vertex_xform(GLContext* gl, const f32* t) {
+                if (std::memcmp(gl->vert_xform, t, sizeof(gl->vert_xform)) == 0)
+                    return;
+
+                std::memcpy(gl->vert_xform, t, sizeof(gl->vert_xform));
+                if (gl->bound_shader != nullptr)
+                    use_shader(gl, gl->bound_shader);
+                // mirrored transforms flip the winding of the retained triangles
+                gl->state->front_face(t[0] * t[3] - t[2] * t[1] < 0.0f ? GL_CW : GL_CCW);
+            }
+
+            // Gathers the first vertex and vertex count of either the fill fans or the fringe /
+            // stroke strips of a call's paths so they can be drawn with one glMultiDrawArrays().
+            // Returns the number of draws, or -1 if the argument arrays couldn't be grown.
+            i32 gather_path_draws(GLContext* gl, const GLCall* call, const bool fills) {
                 const GLPath* paths = &gl->paths[call->path_offset];
                 const i32 npaths = call->path_count;
 
+                if (npaths > gl->cdraws) {
+                    // 1.5x Overallocate
+                    const i32 cdraws{ math::max(npaths, 64) + gl->cdraws / 2 };
+                    const auto firsts{ static_cast<GLint*>(
+                        std::realloc(gl->draw_firsts, sizeof(GLint) * cdraws)) };
+                    if (firsts == nullptr)
+                        return -1;
+                    gl->draw_firsts = firsts;
+
+                    const auto counts{ static_cast<GLsizei*>(
+                        std::realloc(gl->draw_counts, sizeof(GLsizei) * cdraws)) };
+                    if (counts == nullptr)
+                        return -1;
+                    gl->draw_counts = counts;
+                    gl->cdraws = cdraws;
+                }
+
+                i32 ndraws{ 0 };
+                for (i32 i = 0; i < npaths; i++) {
+                    const i32 count{ fills ? paths[i].fill_count : paths[i].stroke_count };
+                    if (count > 0) {
+                        gl->draw_firsts[ndraws] = fills ? paths[i].fill_offset
+                                                        : paths[i].stroke_offset;
+                        gl->draw_counts[ndraws] = count;
+                        ndraws++;
+                    }
+                }
+
+                return ndraws;
+            }
+
+            // Draws the draws gathered by gather_path_draws(), falling back to one draw per path
+            // if they couldn't be gathered.
+            void draw_paths(GLContext* gl, const GLCall* call, const GLenum mode, const bool fills,
+                            const i32 ndraws) {
+                if (ndraws >= 0) {
+                    if (ndraws > 0) {
+                        glMultiDrawArrays(mode, gl->draw_firsts, gl->draw_counts, ndraws);
+                        gl->stats.draw_calls++;
+                    }
+                    return;
+                }
+
+                const GLPath* paths = &gl->paths[call->path_offset];
+                for (i32 i = 0; i < call->path_count; i++) {
+                    glDrawArrays(mode, fills ? paths[i].fill_offset : paths[i].stroke_offset,
+                                 fills ? paths[i].fill_count : paths[i].stroke_count);
+                    gl->stats.draw_calls++;
+                }
+            }
+
+            void fill(GLContext* gl, const GLCall* call) {
                 // Draw shapes
-                glEnable(GL_STENCIL_TEST);
-                stencil_mask(gl, 0xff);
-                stencil_func(gl, GL_ALWAYS, 0, 0xff);
-                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                gl->state->enable(GL_STENCIL_TEST);
+                gl->state->stencil_mask(0xff);
+                gl->state->stencil_func(GL_ALWAYS, 0, 0xff);
+                gl->state->color_mask(false, false, false, false);
 
                 // set bindpoint for solid loc
+                use_shader(gl, &gl->variants[shader_variant(SVGShaderSimple, 0, false)]);
                 set_uniforms(gl, call->uniform_offset, 0);
                 check_error(gl, "fill simple");
 
-                glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
-                glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
-                glDisable(GL_CULL_FACE);
+                gl->state->stencil_op_separate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+                gl->state->stencil_op_separate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+                gl->state->disable(GL_CULL_FACE);
 
-                for (i32 i = 0; i < npaths; i++)
-                    glDrawArrays(GL_TRIANGLE_FAN, paths[i].fill_offset, paths[i].fill_count);
+                draw_paths(gl, call, GL_TRIANGLE_FAN, true, gather_path_draws(gl, call, true));
 
-                glEnable(GL_CULL_FACE);
+                gl->state->enable(GL_CULL_FACE);
 
                 // Draw anti-aliased pixels
-                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                gl->state->color_mask(true, true, true, true);
 
+                use_shader(gl, &gl->variants[call->variant]);
                 set_uniforms(gl, call->uniform_offset + gl->frag_size, call->image);
                 check_error(gl, "fill fill");
 
                 if ((gl->flags & CreateFlags::AntiAlias) != 0) {
-                    stencil_func(gl, GL_EQUAL, 0x00, 0xff);
-                    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+                    gl->state->stencil_func(GL_EQUAL, 0x00, 0xff);
+                    gl->state->stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
                     // Draw fringes
-                    for (i32 i = 0; i < npaths; i++)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+                    draw_paths(gl, call, GL_TRIANGLE_STRIP, false,
+                               gather_path_draws(gl, call, false));
                 }
 
                 // Draw fill
-                stencil_func(gl, GL_NOTEQUAL, 0x0, 0xff);
-                glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+                gl->state->stencil_func(GL_NOTEQUAL, 0x0, 0xff);
+                gl->state->stencil_op(GL_ZERO, GL_ZERO, GL_ZERO);
                 glDrawArrays(GL_TRIANGLE_STRIP, call->triangle_offset, call->triangle_count);
-                glDisable(GL_STENCIL_TEST);
+                gl->stats.draw_calls++;
+                gl->state->disable(GL_STENCIL_TEST);
             }
 
-            void convex_fill(GLContext* gl, const GLCall* call) {
-                const GLPath* paths = &gl->paths[call->path_offset];
-                const i32 npaths = call->path_count;
-
-                set_uniforms(gl, call->uniform_offset, call->image);
-                check_error(gl, "convex fill");
-
-                for (i32 i = 0; i < npaths; i++) {
-                    glDrawArrays(GL_TRIANGLE_FAN, paths[i].fill_offset, paths[i].fill_count);
-                    // Draw fringes
-                    if (paths[i].stroke_count > 0)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+            // Draws the strips of a stroke, or lets the geometry shader expand its segments.
+            void draw_stroke(GLContext* gl, const GLCall* call, const i32 ndraws) {
+                if (call->type != NVGSegments) {
+                    draw_paths(gl, call, GL_TRIANGLE_STRIP, false, ndraws);
+                    return;
                 }
+
+                glDrawArrays(GL_POINTS, call->segment_offset, call->segment_count);
+                gl->stats.draw_calls++;
             }
 
             void stroke(GLContext* gl, const GLCall* call) {
-                const GLPath* paths = &gl->paths[call->path_offset];
-                const i32 npaths = call->path_count;
-
+                // every pass draws the same strips
+                const bool segments{ call->type == NVGSegments };
+                const i32 ndraws{ segments ? 0 : gather_path_draws(gl, call, false) };
+
+                if (segments) {
+                    // the strips of the geometry shader aren't consistently wound
+                    use_shader(gl, &gl->stroke_variants[call->variant]);
+                    gl->state->bind_vertex_array(gl->segment_arr);
+                    gl->state->disable(GL_CULL_FACE);
+                }
+                else
+                    use_shader(gl, &gl->variants[call->variant]);
                 if ((gl->flags & CreateFlags::StencilStrokes) != 0) {
-                    glEnable(GL_STENCIL_TEST);
-                    stencil_mask(gl, 0xff);
+                    gl->state->enable(GL_STENCIL_TEST);
+                    gl->state->stencil_mask(0xff);
 
                     // Fill the stroke base without overlap
-                    stencil_func(gl, GL_EQUAL, 0x0, 0xff);
-                    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+                    gl->state->stencil_func(GL_EQUAL, 0x0, 0xff);
+                    gl->state->stencil_op(GL_KEEP, GL_KEEP, GL_INCR);
                     set_uniforms(gl, call->uniform_offset + gl->frag_size, call->image);
                     check_error(gl, "stroke fill 0");
 
-                    for (i32 i = 0; i < npaths; i++)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+                    draw_stroke(gl, call, ndraws);
 
                     // Draw anti-aliased pixels.
                     set_uniforms(gl, call->uniform_offset, call->image);
-                    stencil_func(gl, GL_EQUAL, 0x00, 0xff);
-                    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+                    gl->state->stencil_func(GL_EQUAL, 0x00, 0xff);
+                    gl->state->stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
 
-                    for (i32 i = 0; i < npaths; i++)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+                    draw_stroke(gl, call, ndraws);
 
                     // Clear stencil buffer.
-                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-                    stencil_func(gl, GL_ALWAYS, 0x0, 0xff);
-                    glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+                    gl->state->color_mask(false, false, false, false);
+                    gl->state->stencil_func(GL_ALWAYS, 0x0, 0xff);
+                    gl->state->stencil_op(GL_ZERO, GL_ZERO, GL_ZERO);
                     check_error(gl, "stroke fill 1");
 
-                    for (i32 i = 0; i < npaths; i++)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+                    draw_stroke(gl, call, ndraws);
 
-                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-                    glDisable(GL_STENCIL_TEST);
+                    gl->state->color_mask(true, true, true, true);
+                    gl->state->disable(GL_STENCIL_TEST);
                 }
                 else {
                     set_uniforms(gl, call->uniform_offset, call->image);
                     check_error(gl, "stroke fill");
                     // Draw Strokes
-                    for (i32 i = 0; i < npaths; i++)
-                        glDrawArrays(GL_TRIANGLE_STRIP, paths[i].stroke_offset,
-                                     paths[i].stroke_count);
+                    draw_stroke(gl, call, ndraws);
+                }
+
+                if (segments) {
+                    gl->state->enable(GL_CULL_FACE);
+                    gl->state->bind_vertex_array(gl->vert_arr);
                 }
             }
 
+            // Convex fills are stored as triangle lists (see render_fill) so they're drawn the same
+            // way as triangle calls, which also lets the two be merged with each other.
             void triangles(GLContext* gl, const GLCall* call) {
+                use_shader(gl, &gl->variants[call->variant]);
                 set_uniforms(gl, call->uniform_offset, call->image);
                 check_error(gl, "triangles fill");
 
                 glDrawArrays(GL_TRIANGLES, call->triangle_offset, call->triangle_count);
+                gl->stats.draw_calls++;
             }
 
-            void render_cancel(void* uptr) {
-                auto gl = static_cast<GLContext*>(uptr);
+            void primitives(GLContext* gl, const GLCall* call) {
+                const int64_t offset{ gl->prim_base +
+                                      call->instance_offset *
+                                          static_cast<int64_t>(sizeof(GLPrimitive)) };
+
+                gl->state->use_program(gl->prim_shader.prog);
+                gl->bound_shader = nullptr;
+                gl->stats.program_switches++;
+                gl->state->bind_vertex_array(gl->prim_arr);
+                gl->state->bind_buffer(GL_ARRAY_BUFFER, gl->prim_buf);
+                for (i32 i = 0; i < PrimitiveAttribCount; ++i)
+                    glVertexAttribPointer(
+                        i, 4, GL_FLOAT, GL_FALSE, sizeof(GLPrimitive),
+                        reinterpret_cast<const void*>(offset + i * 4 * sizeof(f32)));
+                check_error(gl, "primitives");
+
+                // quads of mirrored transforms would be culled otherwise
+                gl->state->disable(GL_CULL_FACE);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, call->instance_count);
+                gl->stats.draw_calls++;
+                gl->state->enable(GL_CULL_FACE);
+
+                gl->state->bind_vertex_array(gl->vert_arr);
+            }
+
+            // Drops the frame's buffers and carves them back out of the arena at the sizes
+            // they grew to, so the next frame only allocates if it outgrows this one.
+            void reset_frame_buffers(GLContext* gl) {
+                const i32 ccalls{ gl->ccalls };
+                const i32 cpaths{ gl->cpaths };
+                const i32 cverts{ gl->cverts };
+                const i32 cuniforms{ gl->cuniforms };
+                const i32 cprims{ gl->cprims };
+                const i32 csegments{ gl->csegments };
+                const i32 cslots{ gl->cslots };
+
+                gl->stats.arena_bytes = gl->arena.used;
+                gl->stats.arena_spills = gl->arena.nspills;
+                arena_reset(&gl->arena);
+                gl->stats.arena_peak = gl->arena.peak;
+
+                const auto carve = [&]<typename T>(T*& data, i32& capacity, const i32 count,
+                                                   const u64 size) {
+                    data = count > 0 ? static_cast<T*>(arena_alloc(&gl->arena, size)) : nullptr;
+                    capacity = data != nullptr ? count : 0;
+                };
+
+                i32 cindices{ 0 };
+                carve(gl->calls, gl->ccalls, ccalls, sizeof(GLCall) * ccalls);
+                carve(gl->paths, gl->cpaths, cpaths, sizeof(GLPath) * cpaths);
+                carve(gl->verts, gl->cverts, cverts, sizeof(Vertex) * cverts);
+                carve(gl->frag_indices, cindices, cverts, sizeof(u16) * cverts);
+                carve(gl->uniforms, gl->cuniforms, cuniforms,
+                      static_cast<u64>(gl->frag_size) * (cuniforms + gl->frag_window));
+                carve(gl->prims, gl->cprims, cprims, sizeof(GLPrimitive) * cprims);
+                carve(gl->segments, gl->csegments, csegments, sizeof(GLSegment) * csegments);
+                carve(gl->uniform_slots, gl->cslots, cslots, sizeof(GLUniformSlot) * cslots);
+                if (cindices != gl->cverts)
+                    gl->cverts = 0;
+                if (gl->uniform_slots != nullptr)
+                    std::memset(gl->uniform_slots, 0, sizeof(GLUniformSlot) * gl->cslots);
+
+                gl->packed_verts = nullptr;
+                gl->nslots = 0;
+                gl->nprims = 0;
+                gl->nsegments = 0;
                 gl->nverts = 0;
                 gl->npaths = 0;
                 gl->ncalls = 0;
                 gl->nuniforms = 0;
             }
 
+            void render_cancel(void* uptr) {
+                auto gl = static_cast<GLContext*>(uptr);
+                release_orphaned_geometry(gl);
+                reset_frame_buffers(gl);
+            }
+
             GLenum convert_blend_func_factor(const BlendFactor factor) {
                 if (factor == BlendFactor::Zero)
                     return GL_ZERO;
@@ -867,87 +1806,552 @@ namespace rl::nvg::gl {
                 return blend;
             }
 
-            void render_flush(void* uptr) {
-                auto gl = static_cast<GLContext*>(uptr);
+            // Makes sure every region of the streaming buffer can hold at least size bytes. Growing
+            // the buffer replaces it with new immutable storage that's mapped for its whole lifetime.
+            i32 reserve_stream_buffer(const GLContext* gl, GLStreamBuffer* stream, GLuint* buf,
+                                      const GLenum target, const int64_t size) {
+                if (*buf != 0 && size <= stream->region_size)
+                    return 1;
+
+                constexpr GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                                            GL_MAP_COHERENT_BIT };
+
+                // the GL keeps the old storage alive until
+                // draws that are still in flight complete
+                if (*buf != 0) {
+                    gl->state->bind_buffer(target, *buf);
+                    glUnmapBuffer(target);
+                    gl->state->delete_buffer(*buf);
+                }
 
-                if (gl->ncalls > 0) {
-                    // Setup require GL state.
-                    glUseProgram(gl->shader.prog);
-
-                    glEnable(GL_CULL_FACE);
-                    glCullFace(GL_BACK);
-                    glFrontFace(GL_CCW);
-                    glEnable(GL_BLEND);
-                    glDisable(GL_DEPTH_TEST);
-                    glDisable(GL_SCISSOR_TEST);
-                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-                    glStencilMask(0xffffffff);
-                    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-                    glStencilFunc(GL_ALWAYS, 0, 0xffffffff);
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-
-                    gl->bound_texture = 0;
-                    gl->stencil_mask = 0xffffffff;
-                    gl->stencil_func = GL_ALWAYS;
-                    gl->stencil_func_ref = 0;
-                    gl->stencil_func_mask = 0xffffffff;
-                    gl->blend_func.src_rgb = GL_INVALID_ENUM;
-                    gl->blend_func.src_alpha = GL_INVALID_ENUM;
-                    gl->blend_func.dst_rgb = GL_INVALID_ENUM;
-                    gl->blend_func.dst_alpha = GL_INVALID_ENUM;
-
-                    // Upload ubo for frag shaders
-                    glBindBuffer(GL_UNIFORM_BUFFER, gl->frag_buf);
-                    glBufferData(GL_UNIFORM_BUFFER, static_cast<i32>(gl->nuniforms * gl->frag_size),
-                                 gl->uniforms, GL_STREAM_DRAW);
-
-                    // Upload vertex data
-                    glBindVertexArray(gl->vert_arr);
-                    glBindBuffer(GL_ARRAY_BUFFER, gl->vert_buf);
-                    glBufferData(GL_ARRAY_BUFFER, gl->nverts * static_cast<int64_t>(sizeof(Vertex)),
-                                 gl->verts, GL_STREAM_DRAW);
-                    glEnableVertexAttribArray(0);
-                    glEnableVertexAttribArray(1);
-                    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                                          static_cast<const GLvoid*>(nullptr));
-                    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                                          reinterpret_cast<const void*>(0 + 2 * sizeof(f32)));
+                const int64_t region_size{ math::max(size, static_cast<int64_t>(1024)) };
+                glGenBuffers(1, buf);
+                gl->state->bind_buffer(target, *buf);
+                glBufferStorage(target, region_size * StreamRegionCount, nullptr, flags);
 
-                    // Set view and texture just once per frame.
-                    glUniform1i(gl->shader.loc[LocTex], 0);
-                    glUniform2fv(gl->shader.loc[LocViewsize], 1, gl->view);
+                stream->data = static_cast<u8*>(
+                    glMapBufferRange(target, 0, region_size * StreamRegionCount, flags));
+                stream->region_size = stream->data != nullptr ? region_size : 0;
 
-                    glBindBuffer(GL_UNIFORM_BUFFER, gl->frag_buf);
+                return stream->data != nullptr ? 1 : 0;
+            }
 
-                    for (i32 i = 0; i < gl->ncalls; i++) {
-                        GLCall* call{ &gl->calls[i] };
-                        blend_func_separate(gl, &call->blend_func);
-                        if (call->type == NVGFill)
-                            fill(gl, call);
-                        else if (call->type == NVGConvexFill)
-                            convex_fill(gl, call);
-                        else if (call->type == NVGStroke)
-                            stroke(gl, call);
-                        else if (call->type == NVGTriangles)
-                            triangles(gl, call);
+            // Blocks until the GPU is done reading the streaming region about to be overwritten.
+            void wait_stream_region(GLContext* gl) {
+                GLsync& fence{ gl->stream_fences[gl->stream_region] };
+                if (fence == nullptr)
+                    return;
+
+                GLenum result{ glClientWaitSync(fence, 0, 0) };
+                if (result == GL_TIMEOUT_EXPIRED) {
+                    gl->stats.fence_stalls++;
+                    constexpr GLuint64 timeout_ns{ 1000000 };
+                    do {
+                        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
                     }
+                    while (result == GL_TIMEOUT_EXPIRED);
+                }
 
-                    glDisableVertexAttribArray(0);
-                    glDisableVertexAttribArray(1);
-                    glBindVertexArray(0);
-                    glDisable(GL_CULL_FACE);
-                    glBindBuffer(GL_ARRAY_BUFFER, 0);
-                    glUseProgram(0);
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
 
-                    bind_texture(gl, 0);
-                }
+            // Fences everything submitted from the current streaming region and moves on to the next.
+            void fence_stream_region(GLContext* gl) {
+                gl->stream_fences[gl->stream_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                gl->stream_region = (gl->stream_region + 1) % StreamRegionCount;
+                gl->upload_used = 0;
+            }
 
-                // Reset calls
-                gl->nverts = 0;
-                gl->npaths = 0;
-                gl->ncalls = 0;
-                gl->nuniforms = 0;
+            // Size of a vertex as uploaded, and where the frame's uploaded vertices are.
+            int64_t vertex_size(const GLContext* gl) {
+                return gl->packed_verts != nullptr ? sizeof(GLPackedVertex) : sizeof(Vertex);
+            }
+
+            const void* vertex_data(const GLContext* gl) {
+                return gl->packed_verts != nullptr ? static_cast<const void*>(gl->packed_verts)
+                                                   : static_cast<const void*>(gl->verts);
+            }
+
+            // Copies this frame's vertices and uniforms into the next region of the persistent
+            // mapped buffers. Returns 0 if the buffers couldn't be (re)allocated.
+            i32 stream_upload(GLContext* gl) {
+                wait_stream_region(gl);
+
+                const int64_t vert_bytes{ gl->nverts * vertex_size(gl) };
+                const int64_t index_bytes{ gl->nverts * static_cast<int64_t>(sizeof(u16)) };
+                const int64_t frag_bytes{ gl->nuniforms * static_cast<int64_t>(gl->frag_size) };
+
+                // reserve based on capacity rather than usage so the storage grows at the same
+                // rate as the client buffers. the uniform storage is padded by a full window
+                // since every binding covers frag_window entries past the call's offset.
+                const int64_t frag_capacity{ gl->cuniforms + gl->frag_window };
+                if (reserve_stream_buffer(gl, &gl->frag_stream, &gl->frag_buf, GL_UNIFORM_BUFFER,
+                                          frag_capacity * gl->frag_size) == 0)
+                    return 0;
+                if (reserve_stream_buffer(gl, &gl->vert_stream, &gl->vert_buf, GL_ARRAY_BUFFER,
+                                          gl->cverts * vertex_size(gl)) == 0)
+                    return 0;
+                if (reserve_stream_buffer(gl, &gl->frag_index_stream, &gl->frag_index_buf,
+                                          GL_ARRAY_BUFFER,
+                                          gl->cverts * static_cast<int64_t>(sizeof(u16))) == 0)
+                    return 0;
+
+                gl->frag_base = gl->stream_region * gl->frag_stream.region_size;
+                gl->vert_base = gl->stream_region * gl->vert_stream.region_size;
+                if (gl->cprims > 0 &&
+                    reserve_stream_buffer(gl, &gl->prim_stream, &gl->prim_buf, GL_ARRAY_BUFFER,
+                                          gl->cprims * static_cast<int64_t>(sizeof(GLPrimitive))) == 0)
+                    return 0;
+
+                if (gl->csegments > 0 &&
+                    reserve_stream_buffer(gl, &gl->segment_stream, &gl->segment_buf, GL_ARRAY_BUFFER,
+                                          gl->csegments * static_cast<int64_t>(sizeof(GLSegment))) == 0)
+                    return 0;
+
+                gl->frag_index_base = gl->stream_region * gl->frag_index_stream.region_size;
+                gl->prim_base = gl->stream_region * gl->prim_stream.region_size;
+                gl->segment_base = gl->stream_region * gl->segment_stream.region_size;
+
+                if (frag_bytes > 0)
+                    std::memcpy(gl->frag_stream.data + gl->frag_base, gl->uniforms, frag_bytes);
+                if (vert_bytes > 0) {
+                    std::memcpy(gl->vert_stream.data + gl->vert_base, vertex_data(gl), vert_bytes);
+                    std::memcpy(gl->frag_index_stream.data + gl->frag_index_base,
+                                gl->frag_indices, index_bytes);
+                }
+
+                const int64_t prim_bytes{ gl->nprims * static_cast<int64_t>(sizeof(GLPrimitive)) };
+                if (prim_bytes > 0)
+                    std::memcpy(gl->prim_stream.data + gl->prim_base, gl->prims, prim_bytes);
+
+                const int64_t segment_bytes{ gl->nsegments *
+                                             static_cast<int64_t>(sizeof(GLSegment)) };
+                if (segment_bytes > 0)
+                    std::memcpy(gl->segment_stream.data + gl->segment_base, gl->segments,
+                                segment_bytes);
+
+                gl->stats.bytes_uploaded += static_cast<u64>(frag_bytes + vert_bytes + index_bytes +
+                                                             prim_bytes + segment_bytes);
+                return 1;
+            }
+
+            bool is_mergeable(const GLCall* call) {
+                return (call->type == NVGConvexFill || call->type == NVGTriangles) &&
+                       call->geometry == 0;
+            }
+
+            // Program variant drawing the call's paint, fills keep it in their second uniform
+            // entry after the one for the stencil pass.
+            i32 paint_variant(const GLContext* gl, const GLCall* call, const bool scissor) {
+                const i32 offset{ call->type == NVGFill ? call->uniform_offset + gl->frag_size
+                                                        : call->uniform_offset };
+                const GLFragUniforms* frag{ frag_uniform_ptr(gl, offset) };
+                return shader_variant(frag->type, frag->tex_type, scissor);
+            }
+
+            bool blend_equals(const GLBlend* a, const GLBlend* b) {
+                return a->src_rgb == b->src_rgb && a->dst_rgb == b->dst_rgb &&
+                       a->src_alpha == b->src_alpha && a->dst_alpha == b->dst_alpha;
+            }
+
+            // Coalesces runs of adjacent convex fill / triangle calls that share blend state and
+            // texture into a single draw. Every vertex is tagged with the index of its original
+            // call's uniforms relative to the lowest entry used by the run, so the merged draw only
+            // needs one UBO binding covering the whole run. Calls sharing deduplicated uniforms
+            // may point back at entries before the first call's.
+            void merge_calls(GLContext* gl) {
+                if (gl->nverts > 0)
+                    std::memset(gl->frag_indices, 0, sizeof(u16) * gl->nverts);
+
+                i32 ncalls{ 0 };
+                for (i32 i = 0; i < gl->ncalls;) {
+                    const i32 first{ i };
+                    GLCall batch{ gl->calls[i++] };
+                    if (is_mergeable(&batch)) {
+                        i32 lo{ batch.uniform_offset };
+                        i32 hi{ batch.uniform_offset };
+                        for (; i < gl->ncalls; ++i) {
+                            const GLCall* next{ &gl->calls[i] };
+                            const i32 next_lo{ math::min(lo, next->uniform_offset) };
+                            const i32 next_hi{ math::max(hi, next->uniform_offset) };
+
+                            if (!is_mergeable(next) || next->image != batch.image ||
+                                paint_variant(gl, next, false) != paint_variant(gl, &batch, false) ||
+                                !blend_equals(&next->blend_func, &batch.blend_func) ||
+                                next->hw_scissor != batch.hw_scissor ||
+                                std::memcmp(next->scissor_rect, batch.scissor_rect,
+                                            sizeof(batch.scissor_rect)) != 0 ||
+                                next->triangle_offset != batch.triangle_offset + batch.triangle_count ||
+                                (next_hi - next_lo) / gl->frag_size >= gl->frag_window)
+                                break;
+
+                            lo = next_lo;
+                            hi = next_hi;
+                            batch.triangle_count += next->triangle_count;
+                            batch.shader_scissor |= next->shader_scissor;
+                        }
+
+                        // the calls of the run haven't been overwritten yet, ncalls <= first
+                        if (i - first > 1) {
+                            for (i32 j = first; j < i; ++j) {
+                                const GLCall* call{ &gl->calls[j] };
+                                std::fill_n(&gl->frag_indices[call->triangle_offset],
+                                            call->triangle_count,
+                                            static_cast<u16>((call->uniform_offset - lo) /
+                                                             gl->frag_size));
+                            }
+                            batch.uniform_offset = lo;
+                        }
+                    }
+
+                    if (batch.type != NVGPrimitives)
+                        batch.variant = paint_variant(gl, &batch, batch.shader_scissor);
+                    gl->calls[ncalls++] = batch;
+                }
+
+                gl->stats.calls_recorded += static_cast<u32>(gl->ncalls);
+                gl->stats.calls_submitted += static_cast<u32>(ncalls);
+                gl->ncalls = ncalls;
+            }
+
+            // Range of the frame's vertices drawn by a call. Every call allocates its vertices in
+            // one block and merged calls are adjacent, so the range has no gaps.
+            void call_vertex_range(const GLContext* gl, const GLCall* call, i32* begin, i32* end) {
+                *begin = call->triangle_count > 0 ? call->triangle_offset : gl->nverts;
+                *end = call->triangle_count > 0 ? call->triangle_offset + call->triangle_count : 0;
+                for (i32 i = 0; i < call->path_count; ++i) {
+                    const GLPath* path{ &gl->paths[call->path_offset + i] };
+                    if (path->fill_count > 0) {
+                        *begin = math::min(*begin, path->fill_offset);
+                        *end = math::max(*end, path->fill_offset + path->fill_count);
+                    }
+                    if (path->stroke_count > 0) {
+                        *begin = math::min(*begin, path->stroke_offset);
+                        *end = math::max(*end, path->stroke_offset + path->stroke_count);
+                    }
+                }
+            }
+
+            // Quantizes the vertices of every call (after merging) to GLPackedVertex. Positions
+            // are stored relative to the call's bounds in steps of the smallest power of two that
+            // spans the bounds with 16 bits, the call's xform scales them back up exactly.
+            void pack_vertices(GLContext* gl) {
+                if (gl->nverts == 0)
+                    return;
+
+                gl->packed_verts = static_cast<GLPackedVertex*>(
+                    arena_alloc(&gl->arena, sizeof(GLPackedVertex) * gl->nverts));
+                if (gl->packed_verts == nullptr)
+                    return;
+
+                for (i32 i = 0; i < gl->ncalls; ++i) {
+                    GLCall* call{ &gl->calls[i] };
+                    if (call->geometry != 0 || call->type == NVGPrimitives)
+                        continue;
+
+                    i32 begin{ 0 };
+                    i32 end{ 0 };
+                    call_vertex_range(gl, call, &begin, &end);
+                    if (begin >= end)
+                        continue;
+
+                    const Vertex* src{ &gl->verts[begin] };
+                    f32 bounds[4]{ src->x, src->y, src->x, src->y };
+                    for (i32 v = 1; v < end - begin; ++v) {
+                        bounds[0] = math::min(bounds[0], src[v].x);
+                        bounds[1] = math::min(bounds[1], src[v].y);
+                        bounds[2] = math::max(bounds[2], src[v].x);
+                        bounds[3] = math::max(bounds[3], src[v].y);
+                    }
+
+                    i32 exp{ 0 };
+                    std::frexp(math::max(bounds[2] - bounds[0], bounds[3] - bounds[1]) / 65535.0f,
+                               &exp);
+                    const f32 step{ std::ldexp(1.0f, exp) };
+                    const f32 inv_step{ std::ldexp(1.0f, -exp) };
+
+                    GLPackedVertex* dst{ &gl->packed_verts[begin] };
+                    for (i32 v = 0; v < end - begin; ++v) {
+                        dst[v].x = static_cast<u16>((src[v].x - bounds[0]) * inv_step + 0.5f);
+                        dst[v].y = static_cast<u16>((src[v].y - bounds[1]) * inv_step + 0.5f);
+                        dst[v].u = static_cast<u16>(
+                            std::clamp(src[v].u, 0.0f, 1.0f) * 65535.0f + 0.5f);
+                        dst[v].v = static_cast<u16>(
+                            std::clamp(src[v].v, 0.0f, 1.0f) * 65535.0f + 0.5f);
+                    }
+
+                    const f32 xform[6]{ step, 0.0f, 0.0f, step, bounds[0], bounds[1] };
+                    std::memcpy(call->xform, xform, sizeof(call->xform));
+                }
+            }
+
+            // Points the vertex attributes at the frame's streamed vertices, or at the vertices of a
+            // retained geometry. Retained geometry is never merged, so every one of its vertices
+            // uses the first entry of the bound fragment uniform window.
+            void bind_vertex_buffer(const GLContext* gl, const GLGeometry* geometry) {
+                const int64_t base{ geometry != nullptr ? 0 : gl->vert_base };
+                gl->state->bind_buffer(GL_ARRAY_BUFFER,
+                                       geometry != nullptr ? geometry->buf : gl->vert_buf);
+                if (geometry == nullptr && gl->packed_verts != nullptr) {
+                    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GLPackedVertex),
+                                          reinterpret_cast<const void*>(base));
+                    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GLPackedVertex),
+                                          reinterpret_cast<const void*>(base + 2 * sizeof(u16)));
+                }
+                else {
+                    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                          reinterpret_cast<const void*>(base));
+                    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                          reinterpret_cast<const void*>(base + 2 * sizeof(f32)));
+                }
+
+                if (geometry != nullptr) {
+                    glDisableVertexAttribArray(2);
+                    glVertexAttribI4i(2, 0, 0, 0, 0);
+                }
+                else {
+                    glEnableVertexAttribArray(2);
+                    gl->state->bind_buffer(GL_ARRAY_BUFFER, gl->frag_index_buf);
+                    glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(u16),
+                                           reinterpret_cast<const void*>(gl->frag_index_base));
+                }
+            }
+
+            void set_scissor(const GLContext* gl, const GLCall* call) {
+                if (!call->hw_scissor) {
+                    gl->state->disable(GL_SCISSOR_TEST);
+                    return;
+                }
+
+                gl->state->enable(GL_SCISSOR_TEST);
+                gl->state->scissor(call->scissor_rect[0], call->scissor_rect[1],
+                                   call->scissor_rect[2], call->scissor_rect[3]);
+            }
+
+            // Starts a GL_TIME_ELAPSED query around the draws of a call. Returns 0 if no
+            // query was started, in which case the call must not end one either.
+            i32 begin_timer(GLContext* gl, const i32 variant) {
+                GLTimerQueries* timers{ &gl->timers[gl->timer_set] };
+                if (timers->nqueries + 1 > timers->cqueries) {
+                    // 1.5x Overallocate
+                    const i32 cqueries{ math::max(timers->nqueries + 1, 64) + timers->cqueries / 2 };
+                    const auto queries{ static_cast<GLuint*>(
+                        std::realloc(timers->queries, sizeof(GLuint) * cqueries)) };
+                    if (queries == nullptr)
+                        return 0;
+                    timers->queries = queries;
+
+                    const auto variants{ static_cast<i32*>(
+                        std::realloc(timers->variants, sizeof(i32) * cqueries)) };
+                    if (variants == nullptr)
+                        return 0;
+                    timers->variants = variants;
+
+                    glGenQueries(cqueries - timers->cqueries, &queries[timers->cqueries]);
+                    timers->cqueries = cqueries;
+                }
+
+                timers->variants[timers->nqueries] = variant;
+                glBeginQuery(GL_TIME_ELAPSED, timers->queries[timers->nqueries++]);
+                return 1;
+            }
+
+            // Adds up the queries issued two flushes ago, which have almost always completed
+            // by now, and hands their set back to the current frame.
+            void collect_timings(GLContext* gl) {
+                gl->timer_set ^= 1;
+                GLTimerQueries* timers{ &gl->timers[gl->timer_set] };
+                for (i32 i = 0; i < timers->nqueries; ++i) {
+                    GLuint64 elapsed{ 0 };
+                    glGetQueryObjectui64v(timers->queries[i], GL_QUERY_RESULT, &elapsed);
+
+                    ShaderTiming& timing{ gl->timings[timers->variants[i]] };
+                    timing.gpu_time_ns += elapsed;
+                    timing.draws++;
+                }
+                timers->nqueries = 0;
+            }
+
+            void render_flush(void* uptr) {
+                auto gl = static_cast<GLContext*>(uptr);
+
+                if (gl->ncalls > 0) {
+                    merge_calls(gl);
+                    if ((gl->flags & CreateFlags::PackedVertices) != 0)
+                        pack_vertices(gl);
+
+                    // Setup require GL state, only what changed since the last frame is sent.
+                    rl::gl::StateCache* state{ gl->state };
+                    gl->bound_shader = nullptr;
+
+                    state->enable(GL_CULL_FACE);
+                    state->cull_face(GL_BACK);
+                    state->front_face(GL_CCW);
+                    state->enable(GL_BLEND);
+                    state->disable(GL_DEPTH_TEST);
+                    state->disable(GL_SCISSOR_TEST);
+                    state->color_mask(true, true, true, true);
+                    state->stencil_mask(0xffffffff);
+                    state->stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
+                    state->stencil_func(GL_ALWAYS, 0, 0xffffffff);
+                    state->active_texture(GL_TEXTURE0);
+
+                    if (gl->persistent_buffers && stream_upload(gl) == 0) {
+                        // mapping failed, switch to glBufferData() for the rest of the session.
+                        // immutable storage can't be re-specified so the buffers are replaced.
+                        gl->persistent_buffers = false;
+                        gl->frag_base = 0;
+                        gl->vert_base = 0;
+                        gl->frag_index_base = 0;
+                        gl->prim_base = 0;
+                        gl->segment_base = 0;
+                        state->delete_buffer(gl->frag_buf);
+                        state->delete_buffer(gl->vert_buf);
+                        state->delete_buffer(gl->frag_index_buf);
+                        state->delete_buffer(gl->prim_buf);
+                        glGenBuffers(1, &gl->frag_buf);
+                        glGenBuffers(1, &gl->vert_buf);
+                        glGenBuffers(1, &gl->frag_index_buf);
+                        glGenBuffers(1, &gl->prim_buf);
+                        if (gl->segment_arr != 0) {
+                            state->delete_buffer(gl->segment_buf);
+                            glGenBuffers(1, &gl->segment_buf);
+                        }
+                        // the staging buffer is recreated by the next texture update
+                        if (gl->upload_buf != 0) {
+                            state->delete_buffer(gl->upload_buf);
+                            gl->upload_buf = 0;
+                            gl->upload_stream = GLStreamBuffer{};
+                            gl->upload_used = 0;
+                        }
+                    }
+
+                    if (!gl->persistent_buffers) {
+                        // the uniform upload is padded by a full window (see alloc_frag_uniforms)
+                        const int64_t frag_bytes{ (gl->nuniforms + gl->frag_window) *
+                                                  static_cast<int64_t>(gl->frag_size) };
+                        const int64_t vert_bytes{ gl->nverts * vertex_size(gl) };
+                        const int64_t index_bytes{ gl->nverts * static_cast<int64_t>(sizeof(u16)) };
+
+                        // Upload ubo for frag shaders
+                        state->bind_buffer(GL_UNIFORM_BUFFER, gl->frag_buf);
+                        glBufferData(GL_UNIFORM_BUFFER, frag_bytes, gl->uniforms, GL_STREAM_DRAW);
+
+                        // Upload vertex data
+                        state->bind_buffer(GL_ARRAY_BUFFER, gl->vert_buf);
+                        glBufferData(GL_ARRAY_BUFFER, vert_bytes, vertex_data(gl), GL_STREAM_DRAW);
+                        state->bind_buffer(GL_ARRAY_BUFFER, gl->frag_index_buf);
+                        glBufferData(GL_ARRAY_BUFFER, index_bytes, gl->frag_indices, GL_STREAM_DRAW);
+
+                        gl->stats.bytes_uploaded += static_cast<u64>(frag_bytes + vert_bytes +
+                                                                     index_bytes);
+
+                        if (gl->nprims > 0) {
+                            const int64_t prim_bytes{ gl->nprims *
+                                                      static_cast<int64_t>(sizeof(GLPrimitive)) };
+                            state->bind_buffer(GL_ARRAY_BUFFER, gl->prim_buf);
+                            glBufferData(GL_ARRAY_BUFFER, prim_bytes, gl->prims, GL_STREAM_DRAW);
+                            gl->stats.bytes_uploaded += static_cast<u64>(prim_bytes);
+                        }
+
+                        if (gl->nsegments > 0) {
+                            const int64_t segment_bytes{ gl->nsegments *
+                                                         static_cast<int64_t>(sizeof(GLSegment)) };
+                            state->bind_buffer(GL_ARRAY_BUFFER, gl->segment_buf);
+                            glBufferData(GL_ARRAY_BUFFER, segment_bytes, gl->segments,
+                                         GL_STREAM_DRAW);
+                            gl->stats.bytes_uploaded += static_cast<u64>(segment_bytes);
+                        }
+                    }
+
+                    // The segments are all drawn from the same offset, so unlike the
+                    // primitives their pointers are set once per frame.
+                    if (gl->nsegments > 0) {
+                        state->bind_vertex_array(gl->segment_arr);
+                        state->bind_buffer(GL_ARRAY_BUFFER, gl->segment_buf);
+                        for (i32 i = 0; i < SegmentAttribCount; ++i)
+                            glVertexAttribPointer(
+                                i, 4, GL_FLOAT, GL_FALSE, sizeof(GLSegment),
+                                reinterpret_cast<const void*>(gl->segment_base +
+                                                              i * 4 * sizeof(f32)));
+                    }
+
+                    state->bind_vertex_array(gl->vert_arr);
+                    bind_vertex_buffer(gl, nullptr);
+
+                    // Set view just once per frame, the fill variants get it when first bound.
+                    if (gl->nprims > 0) {
+                        state->use_program(gl->prim_shader.prog);
+                        glUniform2fv(gl->prim_shader.loc[LocViewsize], 1, gl->view);
+                    }
+                    set_vertex_xform(gl, IdentityXform);
+
+                    const bool timed{ (gl->flags & CreateFlags::ShaderTimings) != 0 };
+                    if (timed)
+                        collect_timings(gl);
+
+                    state->bind_buffer(GL_UNIFORM_BUFFER, gl->frag_buf);
+
+                    const GLGeometry* bound_geometry{ nullptr };
+                    for (i32 i = 0; i < gl->ncalls; i++) {
+                        GLCall* call{ &gl->calls[i] };
+                        const GLGeometry* geometry{ nullptr };
+                        if (call->geometry != 0) {
+                            geometry = find_geometry(gl, call->geometry);
+                            if (geometry == nullptr)
+                                continue;
+                        }
+
+                        if (geometry != bound_geometry) {
+                            bind_vertex_buffer(gl, geometry);
+                            if (geometry == nullptr)
+                                set_vertex_xform(gl, IdentityXform);
+                            bound_geometry = geometry;
+                        }
+                        if (geometry != nullptr ||
+                            (gl->packed_verts != nullptr && call->type != NVGPrimitives &&
+                             call->type != NVGSegments))
+                            set_vertex_xform(gl, call->xform);
+
+                        set_scissor(gl, call);
+                        blend_func_separate(gl, &call->blend_func);
+                        const bool timing{ timed && call->type != NVGPrimitives &&
+                                           begin_timer(gl, call->variant) != 0 };
+
+                        if (call->type == NVGFill)
+                            fill(gl, call);
+                        else if (call->type == NVGStroke || call->type == NVGSegments)
+                            stroke(gl, call);
+                        else if (call->type == NVGConvexFill || call->type == NVGTriangles)
+                            triangles(gl, call);
+                        else if (call->type == NVGPrimitives)
+                            primitives(gl, call);
+
+                        if (timing)
+                            glEndQuery(GL_TIME_ELAPSED);
+                    }
+
+                    // Fence the region the GPU reads from so it's not overwritten
+                    // until all of the draw calls submitted above have completed.
+                    if (gl->persistent_buffers)
+                        fence_stream_region(gl);
+
+                    // bindings are left as they are, everything else rendering to the
+                    // context goes through the same cache and binds what it needs.
+                    state->disable(GL_SCISSOR_TEST);
+                    state->disable(GL_CULL_FACE);
+                    state->front_face(GL_CCW);
+                }
+
+                else if (gl->persistent_buffers && gl->upload_used > 0) {
+                    // nothing was drawn, but texture updates were staged in the region
+                    fence_stream_region(gl);
+                }
+
+                // Reset calls
+                release_orphaned_geometry(gl);
+                reset_frame_buffers(gl);
             }
 
             i32 max_vert_count(const NVGpath* paths, const i32 npaths) {
@@ -963,8 +2367,8 @@ namespace rl::nvg::gl {
             GLCall* alloc_call(GLContext* gl) {
                 if (gl->ncalls + 1 > gl->ccalls) {
                     const i32 ccalls{ math::max(gl->ncalls + 1, 128) + gl->ccalls / 2 };
-                    auto calls = static_cast<GLCall*>(
-                        std::realloc(gl->calls, sizeof(GLCall) * ccalls));
+                    auto calls = static_cast<GLCall*>(arena_grow(
+                        &gl->arena, gl->calls, sizeof(GLCall) * gl->ncalls, sizeof(GLCall) * ccalls));
 
                     if (calls == nullptr)
                         return nullptr;
@@ -980,8 +2384,8 @@ namespace rl::nvg::gl {
             i32 alloc_paths(GLContext* gl, const i32 n) {
                 if (gl->npaths + n > gl->cpaths) {
                     const i32 cpaths{ math::max(gl->npaths + n, 128) + gl->cpaths / 2 };
-                    auto paths = static_cast<GLPath*>(
-                        std::realloc(gl->paths, sizeof(GLPath) * cpaths));
+                    auto paths = static_cast<GLPath*>(arena_grow(
+                        &gl->arena, gl->paths, sizeof(GLPath) * gl->npaths, sizeof(GLPath) * cpaths));
 
                     if (paths == nullptr)
                         return -1;
@@ -1000,13 +2404,21 @@ namespace rl::nvg::gl {
                 if (gl->nverts + n > gl->cverts) {
                     // 1.5x Overallocate
                     i32 cverts{ math::max(gl->nverts + n, 4096) + gl->cverts / 2 };
-                    auto verts = static_cast<Vertex*>(
-                        std::realloc(gl->verts, sizeof(Vertex) * cverts));
+                    auto verts = static_cast<Vertex*>(arena_grow(
+                        &gl->arena, gl->verts, sizeof(Vertex) * gl->nverts, sizeof(Vertex) * cverts));
 
                     if (verts == nullptr)
                         return -1;
 
                     gl->verts = verts;
+
+                    auto frag_indices = static_cast<u16*>(arena_grow(
+                        &gl->arena, gl->frag_indices, sizeof(u16) * gl->nverts, sizeof(u16) * cverts));
+
+                    if (frag_indices == nullptr)
+                        return -1;
+
+                    gl->frag_indices = frag_indices;
                     gl->cverts = cverts;
                 }
 
@@ -1019,9 +2431,11 @@ namespace rl::nvg::gl {
             i32 alloc_frag_uniforms(GLContext* gl, const i32 n) {
                 const i32 struct_size{ gl->frag_size };
                 if (gl->nuniforms + n > gl->cuniforms) {
+                    // padded by a full window so binding the last entry never reads past the end
                     const i32 cuniforms{ math::max(gl->nuniforms + n, 128) + gl->cuniforms / 2 };
-                    u8* uniforms{ static_cast<u8*>(
-                        std::realloc(gl->uniforms, static_cast<i32>(struct_size) * cuniforms)) };
+                    u8* uniforms{ static_cast<u8*>(arena_grow(
+                        &gl->arena, gl->uniforms, static_cast<u64>(struct_size) * gl->nuniforms,
+                        static_cast<u64>(struct_size) * (cuniforms + gl->frag_window))) };
 
                     if (uniforms == nullptr)
                         return -1;
@@ -1036,6 +2450,118 @@ namespace rl::nvg::gl {
                 return ret;
             }
 
+            u32 hash_frag_uniforms(const GLContext* gl, const i32 offset, const i32 n) {
+                u64 hash{ 0 };
+                for (i32 i = 0; i < n; ++i) {
+                    const u8* entry{ gl->uniforms + offset + i * gl->frag_size };
+                    for (u64 w = 0; w < sizeof(GLFragUniforms); w += sizeof(u64)) {
+                        u64 word{ 0 };
+                        std::memcpy(&word, entry + w, sizeof(word));
+                        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+                        hash ^= hash >> 29;
+                    }
+                }
+                return static_cast<u32>(hash ^ (hash >> 32));
+            }
+
+            bool frag_uniforms_equal(const GLContext* gl, const i32 a, const i32 b, const i32 n) {
+                for (i32 i = 0; i < n; ++i) {
+                    if (std::memcmp(gl->uniforms + a + i * gl->frag_size,
+                                    gl->uniforms + b + i * gl->frag_size,
+                                    sizeof(GLFragUniforms)) != 0)
+                        return false;
+                }
+                return true;
+            }
+
+            // Looks up the n uniform entries just written at offset among the ones written
+            // earlier in the frame. On a match the new entries are released again and the offset
+            // of the earlier ones is returned, so calls with identical paint, scissor and stroke
+            // parameters share their uniforms.
+            i32 dedup_frag_uniforms(GLContext* gl, const i32 offset, const i32 n) {
+                if ((gl->nslots + 1) * 2 > gl->cslots) {
+                    const i32 cslots{ math::max(gl->cslots * 2, 256) };
+                    auto slots{ static_cast<GLUniformSlot*>(
+                        arena_alloc(&gl->arena, sizeof(GLUniformSlot) * cslots)) };
+                    if (slots == nullptr) {
+                        gl->stats.uniform_misses++;
+                        return offset;
+                    }
+
+                    std::memset(slots, 0, sizeof(GLUniformSlot) * cslots);
+                    for (i32 i = 0; i < gl->cslots; ++i) {
+                        const GLUniformSlot& slot{ gl->uniform_slots[i] };
+                        if (slot.count == 0)
+                            continue;
+                        u32 idx{ slot.hash & (cslots - 1) };
+                        while (slots[idx].count != 0)
+                            idx = (idx + 1) & (cslots - 1);
+                        slots[idx] = slot;
+                    }
+
+                    gl->uniform_slots = slots;
+                    gl->cslots = cslots;
+                }
+
+                const u32 hash{ hash_frag_uniforms(gl, offset, n) };
+                const u32 mask{ static_cast<u32>(gl->cslots - 1) };
+                u32 idx{ hash & mask };
+                for (; gl->uniform_slots[idx].count != 0; idx = (idx + 1) & mask) {
+                    const GLUniformSlot& slot{ gl->uniform_slots[idx] };
+                    if (slot.hash == hash && slot.count == n &&
+                        frag_uniforms_equal(gl, slot.offset, offset, n)) {
+                        gl->nuniforms -= n;
+                        gl->stats.uniform_hits++;
+                        return slot.offset;
+                    }
+                }
+
+                gl->uniform_slots[idx] = GLUniformSlot{ hash, n, offset };
+                gl->nslots++;
+                gl->stats.uniform_misses++;
+                return offset;
+            }
+
+            i32 alloc_primitives(GLContext* gl, const i32 n) {
+                if (gl->nprims + n > gl->cprims) {
+                    const i32 cprims{ math::max(gl->nprims + n, 256) + gl->cprims / 2 };
+                    auto prims = static_cast<GLPrimitive*>(arena_grow(
+                        &gl->arena, gl->prims, sizeof(GLPrimitive) * gl->nprims,
+                        sizeof(GLPrimitive) * cprims));
+
+                    if (prims == nullptr)
+                        return -1;
+
+                    gl->prims = prims;
+                    gl->cprims = cprims;
+                }
+
+                const i32 ret = gl->nprims;
+                gl->nprims += n;
+
+                return ret;
+            }
+
+            i32 alloc_segments(GLContext* gl, const i32 n) {
+                if (gl->nsegments + n > gl->csegments) {
+                    const i32 csegments{ math::max(gl->nsegments + n, 256) + gl->csegments / 2 };
+                    auto segments = static_cast<GLSegment*>(arena_grow(
+                        &gl->arena, gl->segments, sizeof(GLSegment) * gl->nsegments,
+                        sizeof(GLSegment) * csegments));
+
+                    if (segments == nullptr)
+                        return -1;
+
+                    gl->segments = segments;
+                    gl->csegments = csegments;
+                }
+
+                const i32 ret = gl->nsegments;
+                gl->nsegments += n;
+
+                return ret;
+            }
+
             void vset(Vertex* vtx, const f32 x, const f32 y, const f32 u, const f32 v) {
                 vtx->x = x;
                 vtx->y = y;
@@ -1043,6 +2569,64 @@ namespace rl::nvg::gl {
                 vtx->v = v;
             }
 
+            // Writes the triangle fan as a triangle list, returns the number of vertices written.
+            i32 fan_to_triangles(Vertex* dst, const Vertex* fan, const i32 count) {
+                i32 n{ 0 };
+                for (i32 i = 2; i < count; ++i) {
+                    dst[n++] = fan[0];
+                    dst[n++] = fan[i - 1];
+                    dst[n++] = fan[i];
+                }
+                return n;
+            }
+
+            // Writes the triangle strip as a triangle list, returns the number of vertices
+            // written. Every odd triangle is flipped to keep the strip's winding order.
+            i32 strip_to_triangles(Vertex* dst, const Vertex* strip, const i32 count) {
+                i32 n{ 0 };
+                for (i32 i = 2; i < count; ++i) {
+                    dst[n++] = strip[(i & 1) == 0 ? i - 2 : i - 1];
+                    dst[n++] = strip[(i & 1) == 0 ? i - 1 : i - 2];
+                    dst[n++] = strip[i];
+                }
+                return n;
+            }
+
+            i32 triangle_list_count(const i32 count) {
+                return math::max(count - 2, 0) * 3;
+            }
+
+            void render_convex_fill(GLContext* gl, GLCall* call, const PaintStyle* paint,
+                                    const ScissorParams* scissor, const f32 fringe,
+                                    const NVGpath* path) {
+                // Convex fills are converted to a triangle list up front so that adjacent ones
+                // can be merged into a single draw call in render_flush()
+                call->type = NVGConvexFill;
+                call->triangle_count = triangle_list_count(path->nfill) +
+                                       triangle_list_count(path->nstroke);
+                call->triangle_offset = alloc_verts(gl, call->triangle_count);
+                if (call->triangle_offset != -1) {
+                    Vertex* dst{ &gl->verts[call->triangle_offset] };
+                    dst += fan_to_triangles(dst, path->fill, path->nfill);
+                    // Fringes
+                    strip_to_triangles(dst, path->stroke, path->nstroke);
+
+                    call->uniform_offset = alloc_frag_uniforms(gl, 1);
+                    if (call->uniform_offset != -1) {
+                        // Fill shader
+                        convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
+                                      scissor, fringe, fringe, -1.0f);
+                        call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 1);
+                        return;
+                    }
+                }
+
+                // error:
+                //  Roll back the call to prevent drawing it.
+                if (gl->ncalls > 0)
+                    gl->ncalls--;
+            }
+
             void render_fill(void* uptr, const PaintStyle* paint,
                              const CompositeOperationState composite_operation,
                              const ScissorParams* scissor, const f32 fringe, const f32* bounds,
@@ -1054,18 +2638,20 @@ namespace rl::nvg::gl {
                 if (call == nullptr)
                     return;
 
+                scissor = setup_scissor(gl, call, scissor);
+
+                call->image = paint->image;
+                call->blend_func = blend_composite_operation(composite_operation);
+                if (npaths == 1 && paths[0].convex) {
+                    render_convex_fill(gl, call, paint, scissor, fringe, &paths[0]);
+                    return;
+                }
+
                 call->type = NVGFill;
                 call->triangle_count = 4;
                 call->path_offset = alloc_paths(gl, npaths);
                 if (call->path_offset != -1) {
                     call->path_count = npaths;
-                    call->image = paint->image;
-                    call->blend_func = blend_composite_operation(composite_operation);
-
-                    if (npaths == 1 && paths[0].convex) {
-                        call->type = NVGConvexFill;
-                        call->triangle_count = 0;
-                    }
 
                     // Allocate vertices for all the paths.
                     const i32 maxverts = max_vert_count(paths, npaths) + call->triangle_count;
@@ -1091,37 +2677,28 @@ namespace rl::nvg::gl {
                             }
                         }
 
+                        // Quad
+                        call->triangle_offset = offset;
+                        quad = &gl->verts[call->triangle_offset];
+                        vset(&quad[0], bounds[2], bounds[3], 0.5f, 1.0f);
+                        vset(&quad[1], bounds[2], bounds[1], 0.5f, 1.0f);
+                        vset(&quad[2], bounds[0], bounds[3], 0.5f, 1.0f);
+                        vset(&quad[3], bounds[0], bounds[1], 0.5f, 1.0f);
+
                         // Setup uniforms for draw calls
-                        if (call->type == NVGFill) {
-                            // Quad
-                            call->triangle_offset = offset;
-                            quad = &gl->verts[call->triangle_offset];
-                            vset(&quad[0], bounds[2], bounds[3], 0.5f, 1.0f);
-                            vset(&quad[1], bounds[2], bounds[1], 0.5f, 1.0f);
-                            vset(&quad[2], bounds[0], bounds[3], 0.5f, 1.0f);
-                            vset(&quad[3], bounds[0], bounds[1], 0.5f, 1.0f);
-
-                            call->uniform_offset = alloc_frag_uniforms(gl, 2);
-                            if (call->uniform_offset != -1) {
-                                // Simple shader for stencil
-                                GLFragUniforms* frag = frag_uniform_ptr(gl, call->uniform_offset);
-                                std::memset(frag, 0, sizeof(*frag));
-                                frag->stroke_thr = -1.0f;
-                                frag->type = SVGShaderSimple;
-
-                                // Fill shader
-                                convert_paint(
-                                    gl, frag_uniform_ptr(gl, call->uniform_offset + gl->frag_size),
-                                    paint, scissor, fringe, fringe, -1.0f);
-                            }
-                        }
-                        else {
-                            call->uniform_offset = alloc_frag_uniforms(gl, 1);
-                            if (call->uniform_offset != -1) {
-                                // Fill shader
-                                convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
-                                              scissor, fringe, fringe, -1.0f);
-                            }
+                        call->uniform_offset = alloc_frag_uniforms(gl, 2);
+                        if (call->uniform_offset != -1) {
+                            // Simple shader for stencil
+                            GLFragUniforms* frag = frag_uniform_ptr(gl, call->uniform_offset);
+                            std::memset(frag, 0, sizeof(*frag));
+                            frag->stroke_thr = -1.0f;
+                            frag->type = SVGShaderSimple;
+
+                            // Fill shader
+                            convert_paint(
+                                gl, frag_uniform_ptr(gl, call->uniform_offset + gl->frag_size),
+                                paint, scissor, fringe, fringe, -1.0f);
+                            call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 2);
                         }
 
                         return;
@@ -1135,6 +2712,25 @@ namespace rl::nvg::gl {
                     gl->ncalls--;
             }
 
+            // Uniforms of a stroke, with the entry for the stencil pass of
+            // CreateFlags::StencilStrokes after the anti-aliased one.
+            i32 alloc_stroke_uniforms(GLContext* gl, const PaintStyle* paint,
+                                      const ScissorParams* scissor, const f32 fringe,
+                                      const f32 stroke_width) {
+                const i32 n{ (gl->flags & CreateFlags::StencilStrokes) != 0 ? 2 : 1 };
+                const i32 offset{ alloc_frag_uniforms(gl, n) };
+                if (offset == -1)
+                    return -1;
+
+                convert_paint(gl, frag_uniform_ptr(gl, offset), paint, scissor, stroke_width,
+                              fringe, -1.0f);
+                if (n > 1)
+                    convert_paint(gl, frag_uniform_ptr(gl, offset + gl->frag_size), paint, scissor,
+                                  stroke_width, fringe, 1.0f - 0.5f / 255.0f);
+
+                return dedup_frag_uniforms(gl, offset, n);
+            }
+
             void render_stroke(void* uptr, const PaintStyle* paint,
                                const CompositeOperationState compositeOperation,
                                const ScissorParams* scissor, const f32 fringe,
@@ -1145,6 +2741,8 @@ namespace rl::nvg::gl {
                 if (call == nullptr)
                     return;
 
+                scissor = setup_scissor(gl, call, scissor);
+
                 call->type = NVGStroke;
                 call->path_offset = alloc_paths(gl, npaths);
                 if (call->path_offset != -1) {
@@ -1169,26 +2767,12 @@ namespace rl::nvg::gl {
                             }
                         }
 
-                        if ((gl->flags & CreateFlags::StencilStrokes) != 0) {
-                            // Fill shader
-                            call->uniform_offset = alloc_frag_uniforms(gl, 2);
-                            if (call->uniform_offset != -1) {
-                                convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
-                                              scissor, strokeWidth, fringe, -1.0f);
-                                convert_paint(
-                                    gl, frag_uniform_ptr(gl, call->uniform_offset + gl->frag_size),
-                                    paint, scissor, strokeWidth, fringe, 1.0f - 0.5f / 255.0f);
-                                return;
-                            }
-                        }
-                        else {
-                            // Fill shader
-                            call->uniform_offset = alloc_frag_uniforms(gl, 1);
-                            if (call->uniform_offset != -1)
-                                convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
-                                              scissor, strokeWidth, fringe, -1.0f);
+                        // Fill shader
+                        call->uniform_offset = alloc_stroke_uniforms(gl, paint, scissor, fringe,
+                                                                     strokeWidth);
+                        if (call->uniform_offset != -1 ||
+                            (gl->flags & CreateFlags::StencilStrokes) == 0)
                             return;
-                        }
                     }
                 }
                 // error:
@@ -1198,6 +2782,58 @@ namespace rl::nvg::gl {
                     gl->ncalls--;
             }
 
+            void render_stroke_segments(void* uptr, const PaintStyle* paint,
+                                        const CompositeOperationState composite_operation,
+                                        const ScissorParams* scissor, const f32 fringe,
+                                        const f32 stroke_width, const f32 aa,
+                                        const LineCap line_cap, const LineCap line_join,
+                                        const f32 miter_limit, const f32 tess_tol,
+                                        const StrokeSegment* segments, const i32 nsegments) {
+                auto gl = static_cast<GLContext*>(uptr);
+                GLCall* call = alloc_call(gl);
+
+                if (call == nullptr)
+                    return;
+
+                scissor = setup_scissor(gl, call, scissor);
+
+                call->type = NVGSegments;
+                call->image = paint->image;
+                call->blend_func = blend_composite_operation(composite_operation);
+                call->segment_offset = alloc_segments(gl, nsegments);
+                if (call->segment_offset != -1) {
+                    call->segment_count = nsegments;
+
+                    const f32 half_width{ stroke_width * 0.5f + aa * 0.5f };
+                    const u32 style{ static_cast<u32>(line_cap) << 4 |
+                                     static_cast<u32>(line_join) << 7 };
+                    for (i32 i = 0; i < nsegments; i++) {
+                        const StrokeSegment* seg{ &segments[i] };
+                        gl->segments[call->segment_offset + i] = GLSegment{
+                            .points = { seg->x0, seg->y0, seg->cx0, seg->cy0, seg->cx1, seg->cy1,
+                                        seg->x1, seg->y1 },
+                            .join_dir = { seg->join_dx, seg->join_dy },
+                            .flags = static_cast<f32>(seg->flags | style),
+                            .half_width = half_width,
+                            .fringe = aa,
+                            .miter_limit = miter_limit,
+                            .tess_tol = tess_tol,
+                        };
+                    }
+
+                    call->uniform_offset = alloc_stroke_uniforms(gl, paint, scissor, fringe,
+                                                                 stroke_width);
+                    if (call->uniform_offset != -1)
+                        return;
+
+                    gl->nsegments -= nsegments;
+                }
+                // error:
+                //  Roll back the call to prevent drawing it.
+                if (gl->ncalls > 0)
+                    gl->ncalls--;
+            }
+
             void render_triangles(void* uptr, const PaintStyle* paint,
                                   const CompositeOperationState composite_operation,
                                   const ScissorParams* scissor, const Vertex* verts,
@@ -1208,6 +2844,8 @@ namespace rl::nvg::gl {
                 if (call == nullptr)
                     return;
 
+                scissor = setup_scissor(gl, call, scissor);
+
                 call->type = NVGTriangles;
                 call->image = paint->image;
                 call->blend_func = blend_composite_operation(composite_operation);
@@ -1225,6 +2863,7 @@ namespace rl::nvg::gl {
                         GLFragUniforms* frag = frag_uniform_ptr(gl, call->uniform_offset);
                         convert_paint(gl, frag, paint, scissor, 1.0f, fringe, -1.0f);
                         frag->type = SVGShaderImg;
+                        call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 1);
 
                         return;
                     }
@@ -1236,46 +2875,346 @@ namespace rl::nvg::gl {
                     gl->ncalls--;
             }
 
+            void render_primitive(void* uptr, const PaintStyle* paint,
+                                  const CompositeOperationState composite_operation,
+                                  const ScissorParams* scissor, const f32 fringe,
+                                  const f32* xform, const ds::rect<f32>& rect, const f32 radius,
+                                  const f32 stroke_width) {
+                auto gl = static_cast<GLContext*>(uptr);
+                const GLBlend blend{ blend_composite_operation(composite_operation) };
+                const i32 offset{ alloc_primitives(gl, 1) };
+                if (offset == -1)
+                    return;
+
+                // Consecutive primitives sharing blend state are drawn as one instanced batch
+                GLCall* call{ gl->ncalls > 0 ? &gl->calls[gl->ncalls - 1] : nullptr };
+                if (call == nullptr || call->type != NVGPrimitives ||
+                    call->instance_offset + call->instance_count != offset ||
+                    !blend_equals(&call->blend_func, &blend)) {
+                    call = alloc_call(gl);
+                    if (call == nullptr) {
+                        gl->nprims--;
+                        return;
+                    }
+
+                    call->type = NVGPrimitives;
+                    call->instance_offset = offset;
+                    call->blend_func = blend;
+                }
+
+                call->instance_count++;
+
+                GLPrimitive* prim{ &gl->prims[offset] };
+                std::memcpy(prim->xform, xform, sizeof(prim->xform));
+                prim->corner_radius = radius;
+                prim->stroke_width = stroke_width;
+                prim->rect[0] = rect.pt.x;
+                prim->rect[1] = rect.pt.y;
+                prim->rect[2] = rect.size.width;
+                prim->rect[3] = rect.size.height;
+
+                transform_inverse(prim->paint_mat, paint->xform);
+                std::memcpy(prim->extent, paint->extent, sizeof(prim->extent));
+                prim->radius = paint->radius;
+                prim->feather = paint->feather;
+                prim->inner_col = premul_color(paint->inner_color);
+                prim->outer_col = premul_color(paint->outer_color);
+
+                if (scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f) {
+                    std::memset(prim->scissor_mat, 0, sizeof(prim->scissor_mat));
+                    prim->scissor_ext[0] = 1.0f;
+                    prim->scissor_ext[1] = 1.0f;
+                    prim->scissor_scale[0] = 1.0f;
+                    prim->scissor_scale[1] = 1.0f;
+                }
+                else {
+                    transform_inverse(prim->scissor_mat, scissor->xform);
+                    prim->scissor_ext[0] = scissor->extent[0];
+                    prim->scissor_ext[1] = scissor->extent[1];
+                    prim->scissor_scale[0] = std::sqrt(scissor->xform[0] * scissor->xform[0] +
+                                                       scissor->xform[2] * scissor->xform[2]) /
+                                             fringe;
+                    prim->scissor_scale[1] = std::sqrt(scissor->xform[1] * scissor->xform[1] +
+                                                       scissor->xform[3] * scissor->xform[3]) /
+                                             fringe;
+                }
+            }
+
+            i32 render_create_geometry(void* uptr, const f32* bounds, const NVGpath* paths,
+                                       const i32 npaths) {
+                auto gl{ static_cast<GLContext*>(uptr) };
+                GLGeometry* geometry{ alloc_geometry(gl) };
+                if (geometry == nullptr)
+                    return 0;
+
+                geometry->convex = npaths == 1 && paths[0].convex && paths[0].nfill > 0;
+                const i32 nverts{ geometry->convex ? triangle_list_count(paths[0].nfill) +
+                                                         triangle_list_count(paths[0].nstroke)
+                                                   : max_vert_count(paths, npaths) + 4 };
+
+                auto verts{ static_cast<Vertex*>(std::malloc(sizeof(Vertex) * nverts)) };
+                if (!geometry->convex)
+                    geometry->paths = static_cast<GLPath*>(
+                        std::malloc(sizeof(GLPath) * maxi(npaths, 1)));
+
+                if (verts == nullptr || (!geometry->convex && geometry->paths == nullptr)) {
+                    std::free(verts);
+                    release_geometry(gl, geometry);
+                    return 0;
+                }
+
+                i32 offset{ 0 };
+                if (geometry->convex) {
+                    // Same layout as render_convex_fill()
+                    offset += fan_to_triangles(verts, paths[0].fill, paths[0].nfill);
+                    offset += strip_to_triangles(&verts[offset], paths[0].stroke,
+                                                 paths[0].nstroke);
+                    geometry->triangle_offset = 0;
+                    geometry->triangle_count = offset;
+                }
+                else {
+                    for (i32 i = 0; i < npaths; i++) {
+                        GLPath* copy = &geometry->paths[i];
+                        const NVGpath* path = &paths[i];
+                        std::memset(copy, 0, sizeof(GLPath));
+                        if (path->nfill > 0) {
+                            copy->fill_offset = offset;
+                            copy->fill_count = path->nfill;
+                            std::memcpy(&verts[offset], path->fill, sizeof(Vertex) * path->nfill);
+                            offset += path->nfill;
+                        }
+                        if (path->nstroke > 0) {
+                            copy->stroke_offset = offset;
+                            copy->stroke_count = path->nstroke;
+                            std::memcpy(&verts[offset], path->stroke,
+                                        sizeof(Vertex) * path->nstroke);
+                            offset += path->nstroke;
+                        }
+                    }
+
+                    // Quad
+                    geometry->npaths = npaths;
+                    geometry->triangle_offset = offset;
+                    geometry->triangle_count = 4;
+                    vset(&verts[offset++], bounds[2], bounds[3], 0.5f, 1.0f);
+                    vset(&verts[offset++], bounds[2], bounds[1], 0.5f, 1.0f);
+                    vset(&verts[offset++], bounds[0], bounds[3], 0.5f, 1.0f);
+                    vset(&verts[offset++], bounds[0], bounds[1], 0.5f, 1.0f);
+                }
+
+                const int64_t vert_bytes{ offset * static_cast<int64_t>(sizeof(Vertex)) };
+                glGenBuffers(1, &geometry->buf);
+                gl->state->bind_buffer(GL_ARRAY_BUFFER, geometry->buf);
+                glBufferData(GL_ARRAY_BUFFER, vert_bytes, verts, GL_STATIC_DRAW);
+                check_error(gl, "create geometry");
+
+                gl->stats.bytes_uploaded += static_cast<u64>(vert_bytes);
+                std::free(verts);
+
+                return geometry->id;
+            }
+
+            void render_delete_geometry(void* uptr, const i32 id) {
+                const auto gl{ static_cast<GLContext*>(uptr) };
+                GLGeometry* geometry{ find_geometry(gl, id) };
+                // calls recorded this frame may still draw it
+                if (geometry != nullptr)
+                    geometry->orphaned = true;
+            }
+
+            void render_fill_geometry(void* uptr, const PaintStyle* paint,
+                                      const CompositeOperationState composite_operation,
+                                      const ScissorParams* scissor, const f32 fringe,
+                                      const f32* xform, const i32 id) {
+                auto gl{ static_cast<GLContext*>(uptr) };
+                const GLGeometry* geometry{ find_geometry(gl, id) };
+                if (geometry == nullptr)
+                    return;
+
+                GLCall* call = alloc_call(gl);
+                if (call == nullptr)
+                    return;
+
+                scissor = setup_scissor(gl, call, scissor);
+
+                call->image = paint->image;
+                call->blend_func = blend_composite_operation(composite_operation);
+                call->geometry = geometry->id;
+                call->triangle_offset = geometry->triangle_offset;
+                call->triangle_count = geometry->triangle_count;
+                std::memcpy(call->xform, xform, sizeof(call->xform));
+
+                if (geometry->convex) {
+                    call->type = NVGConvexFill;
+                    call->uniform_offset = alloc_frag_uniforms(gl, 1);
+                    if (call->uniform_offset != -1) {
+                        // Fill shader
+                        convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
+                                      scissor, fringe, fringe, -1.0f);
+                        call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 1);
+                        return;
+                    }
+                }
+                else {
+                    call->type = NVGFill;
+                    call->path_offset = alloc_paths(gl, geometry->npaths);
+                    if (call->path_offset != -1) {
+                        call->path_count = geometry->npaths;
+                        std::memcpy(&gl->paths[call->path_offset], geometry->paths,
+                                    sizeof(GLPath) * geometry->npaths);
+
+                        call->uniform_offset = alloc_frag_uniforms(gl, 2);
+                        if (call->uniform_offset != -1) {
+                            // Simple shader for stencil
+                            GLFragUniforms* frag = frag_uniform_ptr(gl, call->uniform_offset);
+                            std::memset(frag, 0, sizeof(*frag));
+                            frag->stroke_thr = -1.0f;
+                            frag->type = SVGShaderSimple;
+
+                            // Fill shader
+                            convert_paint(
+                                gl, frag_uniform_ptr(gl, call->uniform_offset + gl->frag_size),
+                                paint, scissor, fringe, fringe, -1.0f);
+                            call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 2);
+                            return;
+                        }
+                    }
+                }
+
+                // error:
+                //  Roll back the call to prevent drawing it.
+                if (gl->ncalls > 0)
+                    gl->ncalls--;
+            }
+
+            void render_stroke_geometry(void* uptr, const PaintStyle* paint,
+                                        const CompositeOperationState composite_operation,
+                                        const ScissorParams* scissor, const f32 fringe,
+                                        const f32 stroke_width, const f32* xform, const i32 id) {
+                auto gl{ static_cast<GLContext*>(uptr) };
+                const GLGeometry* geometry{ find_geometry(gl, id) };
+                if (geometry == nullptr || geometry->convex)
+                    return;
+
+                GLCall* call = alloc_call(gl);
+                if (call == nullptr)
+                    return;
+
+                scissor = setup_scissor(gl, call, scissor);
+
+                call->type = NVGStroke;
+                call->image = paint->image;
+                call->blend_func = blend_composite_operation(composite_operation);
+                call->geometry = geometry->id;
+                std::memcpy(call->xform, xform, sizeof(call->xform));
+
+                call->path_offset = alloc_paths(gl, geometry->npaths);
+                if (call->path_offset != -1) {
+                    call->path_count = geometry->npaths;
+                    std::memcpy(&gl->paths[call->path_offset], geometry->paths,
+                                sizeof(GLPath) * geometry->npaths);
+
+                    if ((gl->flags & CreateFlags::StencilStrokes) != 0) {
+                        call->uniform_offset = alloc_frag_uniforms(gl, 2);
+                        if (call->uniform_offset != -1) {
+                            convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
+                                          scissor, stroke_width, fringe, -1.0f);
+                            convert_paint(
+                                gl, frag_uniform_ptr(gl, call->uniform_offset + gl->frag_size),
+                                paint, scissor, stroke_width, fringe, 1.0f - 0.5f / 255.0f);
+                            call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 2);
+                            return;
+                        }
+                    }
+                    else {
+                        call->uniform_offset = alloc_frag_uniforms(gl, 1);
+                        if (call->uniform_offset != -1) {
+                            convert_paint(gl, frag_uniform_ptr(gl, call->uniform_offset), paint,
+                                          scissor, stroke_width, fringe, -1.0f);
+                            call->uniform_offset = dedup_frag_uniforms(gl, call->uniform_offset, 1);
+                            return;
+                        }
+                    }
+                }
+
+                // error:
+                //  Roll back the call to prevent drawing it.
+                if (gl->ncalls > 0)
+                    gl->ncalls--;
+            }
+
             void render_delete(void* uptr) {
                 auto gl{ static_cast<GLContext*>(uptr) };
                 if (gl == nullptr)
                     return;
 
-                delete_shader(&gl->shader);
+                for (const GLShader& shader : gl->variants)
+                    delete_shader(gl, &shader);
+                for (const GLShader& shader : gl->stroke_variants)
+                    delete_shader(gl, &shader);
+                delete_shader(gl, &gl->prim_shader);
+
+                for (GLTimerQueries& timers : gl->timers) {
+                    if (timers.cqueries > 0)
+                        glDeleteQueries(timers.cqueries, timers.queries);
+                    std::free(timers.queries);
+                    std::free(timers.variants);
+                }
+
+                for (GLsync& fence : gl->stream_fences)
+                    if (fence != nullptr)
+                        glDeleteSync(fence);
 
                 if (gl->frag_buf != 0)
-                    glDeleteBuffers(1, &gl->frag_buf);
+                    gl->state->delete_buffer(gl->frag_buf);
+                if (gl->frag_index_buf != 0)
+                    gl->state->delete_buffer(gl->frag_index_buf);
+                if (gl->prim_arr != 0)
+                    gl->state->delete_vertex_array(gl->prim_arr);
+                if (gl->prim_buf != 0)
+                    gl->state->delete_buffer(gl->prim_buf);
+                if (gl->segment_arr != 0)
+                    gl->state->delete_vertex_array(gl->segment_arr);
+                if (gl->segment_buf != 0)
+                    gl->state->delete_buffer(gl->segment_buf);
                 if (gl->vert_arr != 0)
-                    glDeleteVertexArrays(1, &gl->vert_arr);
+                    gl->state->delete_vertex_array(gl->vert_arr);
                 if (gl->vert_buf != 0)
-                    glDeleteBuffers(1, &gl->vert_buf);
+                    gl->state->delete_buffer(gl->vert_buf);
+                if (gl->upload_buf != 0)
+                    gl->state->delete_buffer(gl->upload_buf);
 
                 for (i32 i = 0; i < gl->ntextures; i++)
                     if (gl->textures[i].tex != 0 &&
                         (gl->textures[i].flags & ImageFlags::NoDelete) == 0)
-                        glDeleteTextures(1, &gl->textures[i].tex);
+                        gl->state->delete_texture(gl->textures[i].tex);
+
+                for (i32 i = 0; i < gl->ngeometries; i++)
+                    release_geometry(gl, &gl->geometries[i]);
 
                 std::free(gl->textures);
-                std::free(gl->paths);
-                std::free(gl->verts);
-                std::free(gl->uniforms);
-                std::free(gl->calls);
+                std::free(gl->geometries);
+                std::free(gl->draw_firsts);
+                std::free(gl->draw_counts);
+                arena_release(&gl->arena);
                 std::free(gl);
             }
         }
     }
 
-    Context* create_gl_context(const CreateFlags flags) {
+    Context* create_gl_context(const CreateFlags flags, rl::gl::StateCache* state_cache) {
         auto gl = static_cast<GLContext*>(std::malloc(sizeof(GLContext)));
         if (gl != nullptr) {
             Params params{};
             // TODO: MEMSET HERE
             // std::memset(gl, 0, sizeof(GLContext));
             *gl = GLContext{};
+            gl->state = state_cache != nullptr ? state_cache : &gl->own_state;
 
             params = {
                 .user_ptr = gl,
                 .edge_anti_alias = (flags & CreateFlags::AntiAlias) != 0,
+                .sdf_text = (flags & CreateFlags::SdfText) != 0,
                 .render_create = detail::render_create,
                 .render_create_texture = detail::render_create_texture,
                 .render_delete_texture = detail::render_delete_texture,
@@ -1286,7 +3225,15 @@ namespace rl::nvg::gl {
                 .render_flush = detail::render_flush,
                 .render_fill = detail::render_fill,
                 .render_stroke = detail::render_stroke,
+                .render_stroke_segments = (flags & CreateFlags::GeometryStrokes) != 0
+                                              ? detail::render_stroke_segments
+                                              : nullptr,
                 .render_triangles = detail::render_triangles,
+                .render_primitive = detail::render_primitive,
+                .render_create_geometry = detail::render_create_geometry,
+                .render_delete_geometry = detail::render_delete_geometry,
+                .render_fill_geometry = detail::render_fill_geometry,
+                .render_stroke_geometry = detail::render_stroke_geometry,
                 .render_delete = detail::render_delete,
             };
 
@@ -1329,4 +3276,20 @@ namespace rl::nvg::gl {
         return tex->tex;
     }
 
+    const FrameStats& frame_stats(Context* ctx) {
+        const auto gl{ static_cast<GLContext*>(internal_params(ctx)->user_ptr) };
+        return gl->stats;
+    }
+
+    i32 shader_timings(Context* ctx, const ShaderTiming** timings) {
+        const auto gl{ static_cast<GLContext*>(internal_params(ctx)->user_ptr) };
+        if ((gl->flags & CreateFlags::ShaderTimings) == 0) {
+            *timings = nullptr;
+            return 0;
+        }
+
+        *timings = gl->timings;
+        return ShaderVariantCount;
+    }
+
 }
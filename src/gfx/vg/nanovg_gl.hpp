@@ -2,6 +2,10 @@
 
 #include "gfx/vg/nanovg.hpp"
 
+namespace rl::gl {
+    class StateCache;
+}
+
 namespace rl::nvg::gl {
     // Create flags
 
@@ -16,6 +20,66 @@ namespace rl::nvg::gl {
         StencilStrokes = 1 << 1,
         // Flag indicating that additional debug checks are done.
         Debug = 1 << 2,
+        // Flag forcing vertex and uniform data to be re-specified with glBufferData() every frame,
+        // even when the driver supports persistent mapped buffers (GL 4.4 / ARB_buffer_storage).
+        BufferDataUploads = 1 << 3,
+        // Flag enabling GL_TIME_ELAPSED queries around every draw call, summed up per
+        // fragment shader variant (see shader_timings()).
+        ShaderTimings = 1 << 4,
+        // Flag packing the frame's vertices into 8 bytes instead of 16: positions become 16 bit
+        // offsets from the bounds of each draw call, quantized to 1/65535 of its extent, and
+        // texture coordinates 16 bit normalized integers (they always are in [0, 1]).
+        PackedVertices = 1 << 5,
+        // Flag expanding strokes in a geometry shader from the path's raw segments instead of
+        // tessellating them on the CPU. The inner sides of corners overlap, so translucent
+        // strokes need StencilStrokes to avoid double blending. Round caps and joins are limited
+        // to 10 divisions and curves to 32 steps, retained paths (stroke_path) aren't affected.
+        GeometryStrokes = 1 << 6,
+        // Flag rasterizing glyphs as signed distance fields, baked once at font::SDF_SIZE and
+        // drawn at any size and zoom level. The edge, blur and outline are computed in the
+        // fragment shader, so the atlas holds one bitmap per glyph instead of one per size.
+        SdfText = 1 << 7,
+    };
+
+    // Counters collected by the GL backend, reset at the start of every frame.
+    struct FrameStats {
+        // Vertex and uniform bytes written for the GPU by render_flush(),
+        // plus the vertices of retained paths tessellated this frame.
+        u64 bytes_uploaded{ 0 };
+        // Texel bytes of texture updates staged through the pixel unpack buffer,
+        // those uploads are copied into the texture asynchronously by the GPU.
+        u64 texture_bytes_uploaded{ 0 };
+        // Number of times a streaming buffer region was still in use by
+        // the GPU and the CPU had to block on its fence before writing.
+        u32 fence_stalls{ 0 };
+        // Number of draw calls recorded by the renderer and the number
+        // actually submitted after merging adjacent compatible calls.
+        u32 calls_recorded{ 0 };
+        u32 calls_submitted{ 0 };
+        // Number of calls whose fragment uniforms were identical to ones written earlier in the
+        // frame and shared with them, and the number of calls that wrote new uniforms.
+        u32 uniform_hits{ 0 };
+        u32 uniform_misses{ 0 };
+        // Number of draw commands issued to the driver. Every stencil, fringe and cover pass
+        // of a call is a single command regardless of how many sub-paths it has.
+        u32 draw_calls{ 0 };
+        // Number of times a different shader program had to be bound.
+        u32 program_switches{ 0 };
+        // Bytes the per frame buffers took from the backend's frame arena, the most it has
+        // needed in any frame, and the allocations that didn't fit in the block reserved
+        // from the previous peak (0 once the frame size has settled).
+        u64 arena_bytes{ 0 };
+        u64 arena_peak{ 0 };
+        u32 arena_spills{ 0 };
+    };
+
+    // GPU time spent in the draw calls using one fragment shader variant, summed over every
+    // frame since the context was created. Query results are read back a frame late so
+    // collecting them doesn't usually stall the pipeline.
+    struct ShaderTiming {
+        const char* name{ nullptr };
+        u64 gpu_time_ns{ 0 };
+        u32 draws{ 0 };
     };
 
     // These are additional flags on top of nvg::ImageFlags.
@@ -23,10 +87,19 @@ namespace rl::nvg::gl {
         ImageNoDelete = 1 << 16,  // Do not delete GL texture handle.
     };
 
-    Context* create_gl_context(CreateFlags flags);
+    // All GL state changes go through state_cache, which has to outlive the context and be
+    // shared with everything else rendering to the same GL context. The context shadows the
+    // state on its own if none is given.
+    Context* create_gl_context(CreateFlags flags, rl::gl::StateCache* state_cache = nullptr);
     void delete_gl_context(Context* ctx);
 
     int create_image_from_handle(Context* ctx, unsigned int texture_id, int w, int h, int flags);
     unsigned int image_handle(Context* ctx, int image);
 
+    const FrameStats& frame_stats(Context* ctx);
+
+    // Timings of every variant, empty unless the context was created with
+    // CreateFlags::ShaderTimings. Returns the number of entries timings points to.
+    i32 shader_timings(Context* ctx, const ShaderTiming** timings);
+
 }
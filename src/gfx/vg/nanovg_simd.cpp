@@ -0,0 +1,710 @@
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#include "gfx/vg/nanovg_simd.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define NVG_SIMD_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    #define NVG_TARGET_SSE4
+    #define NVG_TARGET_AVX2
+  #else
+    #define NVG_TARGET_SSE4 __attribute__((target("sse4.1")))
+    #define NVG_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#else
+  #define NVG_SIMD_X86 0
+#endif
+
+namespace rl::nvg::simd {
+    namespace {
+        namespace detail {
+            constexpr u8 JoinFlags{ NvgPtBevel | NvgPrInnerbevel };
+
+            // Per point versions of the kernels, these are the reference every vector kernel
+            // has to match and are also used for the tails that don't fill a whole register.
+
+            void segment(const PointStreams& pts, const i32 p0, const i32 p1, f32* bounds) {
+                f32 dx{ pts.x[p1] - pts.x[p0] };
+                f32 dy{ pts.y[p1] - pts.y[p0] };
+                const f32 d{ std::sqrt(dx * dx + dy * dy) };
+                if (d > 1e-6f) {
+                    const f32 id{ 1.0f / d };
+                    dx *= id;
+                    dy *= id;
+                }
+
+                pts.dx[p0] = dx;
+                pts.dy[p0] = dy;
+                pts.len[p0] = d;
+
+                bounds[0] = bounds[0] < pts.x[p0] ? bounds[0] : pts.x[p0];
+                bounds[1] = bounds[1] < pts.y[p0] ? bounds[1] : pts.y[p0];
+                bounds[2] = bounds[2] > pts.x[p0] ? bounds[2] : pts.x[p0];
+                bounds[3] = bounds[3] > pts.y[p0] ? bounds[3] : pts.y[p0];
+            }
+
+            u8 join(const PointStreams& pts, const i32 p0, const i32 p1, const f32 iw,
+                    const f32 miter_limit, const bool bevel_corners) {
+                const f32 dlx0{ pts.dy[p0] };
+                const f32 dly0{ -pts.dx[p0] };
+                const f32 dlx1{ pts.dy[p1] };
+                const f32 dly1{ -pts.dx[p1] };
+
+                // Calculate extrusions
+                f32 dmx{ (dlx0 + dlx1) * 0.5f };
+                f32 dmy{ (dly0 + dly1) * 0.5f };
+                const f32 dmr2{ dmx * dmx + dmy * dmy };
+                if (dmr2 > 0.000001f) {
+                    f32 scale{ 1.0f / dmr2 };
+                    if (scale > 600.0f)
+                        scale = 600.0f;
+
+                    dmx *= scale;
+                    dmy *= scale;
+                }
+
+                pts.dmx[p1] = dmx;
+                pts.dmy[p1] = dmy;
+
+                // Clear flags, but keep the corner.
+                u8 flags{ static_cast<u8>(pts.flags[p1] & NvgPtCorner) };
+
+                // Keep track of left turns.
+                const f32 cross{ pts.dx[p1] * pts.dy[p0] - pts.dx[p0] * pts.dy[p1] };
+                if (cross > 0.0f)
+                    flags |= NvgPtLeft;
+
+                // Calculate if we should use bevel or miter for inner join.
+                const f32 shortest{ pts.len[p0] < pts.len[p1] ? pts.len[p0] : pts.len[p1] };
+                const f32 limit{ 1.01f > shortest * iw ? 1.01f : shortest * iw };
+                if (dmr2 * limit * limit < 1.0f)
+                    flags |= NvgPrInnerbevel;
+
+                // Check to see if the corner needs to be beveled.
+                if (flags & NvgPtCorner)
+                    if (dmr2 * miter_limit * miter_limit < 1.0f || bevel_corners)
+                        flags |= NvgPtBevel;
+
+                pts.flags[p1] = flags;
+                return flags;
+            }
+
+            void set_vertex(Vertex* dst, const f32 x, const f32 y, const f32 u) {
+                dst->x = x;
+                dst->y = y;
+                dst->u = u;
+                dst->v = 1.0f;
+            }
+
+            // Scalar kernels
+
+            void segments_scalar(const PointStreams& pts, const i32 first, const i32 count,
+                                 f32* bounds) {
+                for (i32 i = 0; i < count; ++i)
+                    segment(pts, first + i, i + 1 < count ? first + i + 1 : first, bounds);
+            }
+
+            i32 joins_scalar(const PointStreams& pts, const i32 first, const i32 count,
+                             const f32 iw, const f32 miter_limit, const bool bevel_corners,
+                             i32* nbevel) {
+                i32 nleft{ 0 };
+                i32 p0{ first + count - 1 };
+                for (i32 p1 = first; p1 < first + count; ++p1) {
+                    const u8 flags{ join(pts, p0, p1, iw, miter_limit, bevel_corners) };
+                    nleft += (flags & NvgPtLeft) != 0;
+                    *nbevel += (flags & JoinFlags) != 0;
+                    p0 = p1;
+                }
+                return nleft;
+            }
+
+            Vertex* extrude_scalar(Vertex* dst, const PointStreams& pts, const i32 begin,
+                                   const i32 end, const f32 lw, const f32 rw, const f32 lu,
+                                   const f32 ru) {
+                for (i32 i = begin; i < end; ++i) {
+                    set_vertex(dst++, pts.x[i] + pts.dmx[i] * lw, pts.y[i] + pts.dmy[i] * lw, lu);
+                    set_vertex(dst++, pts.x[i] - pts.dmx[i] * rw, pts.y[i] - pts.dmy[i] * rw, ru);
+                }
+                return dst;
+            }
+
+            Vertex* inset_scalar(Vertex* dst, const PointStreams& pts, const i32 begin,
+                                 const i32 end, const f32 w) {
+                for (i32 i = begin; i < end; ++i)
+                    set_vertex(dst++, pts.x[i] + pts.dmx[i] * w, pts.y[i] + pts.dmy[i] * w, 0.5f);
+                return dst;
+            }
+
+            Vertex* copy_scalar(Vertex* dst, const PointStreams& pts, const i32 begin,
+                                const i32 end) {
+                for (i32 i = begin; i < end; ++i)
+                    set_vertex(dst++, pts.x[i], pts.y[i], 0.5f);
+                return dst;
+            }
+
+#if NVG_SIMD_X86
+            // SSE4.1 kernels, 4 points per iteration
+
+            NVG_TARGET_SSE4 void segments_sse4(const PointStreams& pts, const i32 first,
+                                               const i32 count, f32* bounds) {
+                if (count <= 0)
+                    return;
+
+                __m128 bmin_x{ _mm_set1_ps(bounds[0]) };
+                __m128 bmin_y{ _mm_set1_ps(bounds[1]) };
+                __m128 bmax_x{ _mm_set1_ps(bounds[2]) };
+                __m128 bmax_y{ _mm_set1_ps(bounds[3]) };
+                const __m128 eps{ _mm_set1_ps(1e-6f) };
+                const __m128 one{ _mm_set1_ps(1.0f) };
+
+                // every segment but the last one ends at the next point in the stream
+                const i32 last{ first + count - 1 };
+                i32 i{ first };
+                for (; i + 4 <= last; i += 4) {
+                    const __m128 x0{ _mm_loadu_ps(pts.x + i) };
+                    const __m128 y0{ _mm_loadu_ps(pts.y + i) };
+                    __m128 dx{ _mm_sub_ps(_mm_loadu_ps(pts.x + i + 1), x0) };
+                    __m128 dy{ _mm_sub_ps(_mm_loadu_ps(pts.y + i + 1), y0) };
+                    const __m128 d{ _mm_sqrt_ps(
+                        _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))) };
+                    const __m128 mask{ _mm_cmpgt_ps(d, eps) };
+                    const __m128 id{ _mm_div_ps(one, d) };
+                    dx = _mm_blendv_ps(dx, _mm_mul_ps(dx, id), mask);
+                    dy = _mm_blendv_ps(dy, _mm_mul_ps(dy, id), mask);
+
+                    _mm_storeu_ps(pts.dx + i, dx);
+                    _mm_storeu_ps(pts.dy + i, dy);
+                    _mm_storeu_ps(pts.len + i, d);
+
+                    bmin_x = _mm_min_ps(bmin_x, x0);
+                    bmin_y = _mm_min_ps(bmin_y, y0);
+                    bmax_x = _mm_max_ps(bmax_x, x0);
+                    bmax_y = _mm_max_ps(bmax_y, y0);
+                }
+
+                alignas(16) f32 lanes[4][4];
+                _mm_store_ps(lanes[0], bmin_x);
+                _mm_store_ps(lanes[1], bmin_y);
+                _mm_store_ps(lanes[2], bmax_x);
+                _mm_store_ps(lanes[3], bmax_y);
+                for (i32 l = 0; l < 4; ++l) {
+                    bounds[0] = bounds[0] < lanes[0][l] ? bounds[0] : lanes[0][l];
+                    bounds[1] = bounds[1] < lanes[1][l] ? bounds[1] : lanes[1][l];
+                    bounds[2] = bounds[2] > lanes[2][l] ? bounds[2] : lanes[2][l];
+                    bounds[3] = bounds[3] > lanes[3][l] ? bounds[3] : lanes[3][l];
+                }
+
+                for (; i < last; ++i)
+                    segment(pts, i, i + 1, bounds);
+                segment(pts, last, first, bounds);
+            }
+
+            NVG_TARGET_SSE4 i32 joins_sse4(const PointStreams& pts, const i32 first,
+                                           const i32 count, const f32 iw, const f32 miter_limit,
+                                           const bool bevel_corners, i32* nbevel) {
+                if (count <= 0)
+                    return 0;
+
+                // the first point joins the segment that closes the path
+                const u8 flags{ join(pts, first + count - 1, first, iw, miter_limit,
+                                     bevel_corners) };
+                i32 nleft{ (flags & NvgPtLeft) != 0 };
+                *nbevel += (flags & JoinFlags) != 0;
+
+                const __m128 sign{ _mm_set1_ps(-0.0f) };
+                const __m128 half{ _mm_set1_ps(0.5f) };
+                const __m128 eps{ _mm_set1_ps(0.000001f) };
+                const __m128 one{ _mm_set1_ps(1.0f) };
+                const __m128 max_scale{ _mm_set1_ps(600.0f) };
+                const __m128 min_limit{ _mm_set1_ps(1.01f) };
+                const __m128 inv_width{ _mm_set1_ps(iw) };
+                const __m128 miter{ _mm_set1_ps(miter_limit) };
+                const __m128i corner{ _mm_set1_epi32(NvgPtCorner) };
+                const __m128i left{ _mm_set1_epi32(NvgPtLeft) };
+                const __m128i bevel{ _mm_set1_epi32(NvgPtBevel) };
+                const __m128i inner{ _mm_set1_epi32(NvgPrInnerbevel) };
+                const __m128i force_bevel{ _mm_set1_epi32(bevel_corners ? -1 : 0) };
+
+                const i32 end{ first + count };
+                i32 p1{ first + 1 };
+                for (; p1 + 4 <= end; p1 += 4) {
+                    const i32 p0{ p1 - 1 };
+                    const __m128 dx0{ _mm_loadu_ps(pts.dx + p0) };
+                    const __m128 dy0{ _mm_loadu_ps(pts.dy + p0) };
+                    const __m128 dx1{ _mm_loadu_ps(pts.dx + p1) };
+                    const __m128 dy1{ _mm_loadu_ps(pts.dy + p1) };
+
+                    __m128 dmx{ _mm_mul_ps(_mm_add_ps(dy0, dy1), half) };
+                    __m128 dmy{ _mm_mul_ps(
+                        _mm_add_ps(_mm_xor_ps(dx0, sign), _mm_xor_ps(dx1, sign)), half) };
+                    const __m128 dmr2{ _mm_add_ps(_mm_mul_ps(dmx, dmx), _mm_mul_ps(dmy, dmy)) };
+                    const __m128 scale{ _mm_min_ps(_mm_div_ps(one, dmr2), max_scale) };
+                    const __m128 rescale{ _mm_cmpgt_ps(dmr2, eps) };
+                    dmx = _mm_blendv_ps(dmx, _mm_mul_ps(dmx, scale), rescale);
+                    dmy = _mm_blendv_ps(dmy, _mm_mul_ps(dmy, scale), rescale);
+                    _mm_storeu_ps(pts.dmx + p1, dmx);
+                    _mm_storeu_ps(pts.dmy + p1, dmy);
+
+                    const __m128 cross{ _mm_sub_ps(_mm_mul_ps(dx1, dy0), _mm_mul_ps(dx0, dy1)) };
+                    const __m128 is_left{ _mm_cmpgt_ps(cross, _mm_setzero_ps()) };
+
+                    const __m128 shortest{ _mm_min_ps(_mm_loadu_ps(pts.len + p0),
+                                                      _mm_loadu_ps(pts.len + p1)) };
+                    const __m128 limit{ _mm_max_ps(min_limit, _mm_mul_ps(shortest, inv_width)) };
+                    const __m128 is_inner{ _mm_cmplt_ps(
+                        _mm_mul_ps(_mm_mul_ps(dmr2, limit), limit), one) };
+                    const __m128 over_miter{ _mm_cmplt_ps(
+                        _mm_mul_ps(_mm_mul_ps(dmr2, miter), miter), one) };
+
+                    i32 packed;
+                    std::memcpy(&packed, pts.flags + p1, sizeof(packed));
+                    const __m128i flags_in{ _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)) };
+                    const __m128i is_corner{ _mm_cmpeq_epi32(_mm_and_si128(flags_in, corner),
+                                                             corner) };
+                    const __m128i is_bevel{ _mm_and_si128(
+                        is_corner, _mm_or_si128(_mm_castps_si128(over_miter), force_bevel)) };
+
+                    __m128i flags_out{ _mm_and_si128(flags_in, corner) };
+                    flags_out = _mm_or_si128(flags_out,
+                                             _mm_and_si128(_mm_castps_si128(is_left), left));
+                    flags_out = _mm_or_si128(flags_out,
+                                             _mm_and_si128(_mm_castps_si128(is_inner), inner));
+                    flags_out = _mm_or_si128(flags_out, _mm_and_si128(is_bevel, bevel));
+
+                    const __m128i packed_out{ _mm_packus_epi16(_mm_packus_epi32(flags_out, flags_out),
+                                                               _mm_setzero_si128()) };
+                    packed = _mm_cvtsi128_si32(packed_out);
+                    std::memcpy(pts.flags + p1, &packed, sizeof(packed));
+
+                    nleft += std::popcount(static_cast<u32>(_mm_movemask_ps(is_left)));
+                    *nbevel += std::popcount(static_cast<u32>(_mm_movemask_ps(
+                        _mm_or_ps(is_inner, _mm_castsi128_ps(is_bevel)))));
+                }
+
+                for (; p1 < end; ++p1) {
+                    const u8 tail{ join(pts, p1 - 1, p1, iw, miter_limit, bevel_corners) };
+                    nleft += (tail & NvgPtLeft) != 0;
+                    *nbevel += (tail & JoinFlags) != 0;
+                }
+
+                return nleft;
+            }
+
+            NVG_TARGET_SSE4 Vertex* extrude_sse4(Vertex* dst, const PointStreams& pts,
+                                                 const i32 begin, const i32 end, const f32 lw,
+                                                 const f32 rw, const f32 lu, const f32 ru) {
+                const __m128 lwv{ _mm_set1_ps(lw) };
+                const __m128 rwv{ _mm_set1_ps(rw) };
+                const __m128 luv{ _mm_setr_ps(lu, 1.0f, lu, 1.0f) };
+                const __m128 ruv{ _mm_setr_ps(ru, 1.0f, ru, 1.0f) };
+
+                i32 i{ begin };
+                for (; i + 4 <= end; i += 4) {
+                    const __m128 x{ _mm_loadu_ps(pts.x + i) };
+                    const __m128 y{ _mm_loadu_ps(pts.y + i) };
+                    const __m128 dmx{ _mm_loadu_ps(pts.dmx + i) };
+                    const __m128 dmy{ _mm_loadu_ps(pts.dmy + i) };
+                    const __m128 lx{ _mm_add_ps(x, _mm_mul_ps(dmx, lwv)) };
+                    const __m128 ly{ _mm_add_ps(y, _mm_mul_ps(dmy, lwv)) };
+                    const __m128 rx{ _mm_sub_ps(x, _mm_mul_ps(dmx, rwv)) };
+                    const __m128 ry{ _mm_sub_ps(y, _mm_mul_ps(dmy, rwv)) };
+
+                    const __m128 l01{ _mm_unpacklo_ps(lx, ly) };
+                    const __m128 l23{ _mm_unpackhi_ps(lx, ly) };
+                    const __m128 r01{ _mm_unpacklo_ps(rx, ry) };
+                    const __m128 r23{ _mm_unpackhi_ps(rx, ry) };
+
+                    f32* out{ &dst->x };
+                    _mm_storeu_ps(out + 0, _mm_shuffle_ps(l01, luv, _MM_SHUFFLE(1, 0, 1, 0)));
+                    _mm_storeu_ps(out + 4, _mm_shuffle_ps(r01, ruv, _MM_SHUFFLE(1, 0, 1, 0)));
+                    _mm_storeu_ps(out + 8, _mm_shuffle_ps(l01, luv, _MM_SHUFFLE(3, 2, 3, 2)));
+                    _mm_storeu_ps(out + 12, _mm_shuffle_ps(r01, ruv, _MM_SHUFFLE(3, 2, 3, 2)));
+                    _mm_storeu_ps(out + 16, _mm_shuffle_ps(l23, luv, _MM_SHUFFLE(1, 0, 1, 0)));
+                    _mm_storeu_ps(out + 20, _mm_shuffle_ps(r23, ruv, _MM_SHUFFLE(1, 0, 1, 0)));
+                    _mm_storeu_ps(out + 24, _mm_shuffle_ps(l23, luv, _MM_SHUFFLE(3, 2, 3, 2)));
+                    _mm_storeu_ps(out + 28, _mm_shuffle_ps(r23, ruv, _MM_SHUFFLE(3, 2, 3, 2)));
+                    dst += 8;
+                }
+
+                return extrude_scalar(dst, pts, i, end, lw, rw, lu, ru);
+            }
+
+            NVG_TARGET_SSE4 Vertex* store_fill_sse4(Vertex* dst, const __m128 x, const __m128 y) {
+                const __m128 uv{ _mm_setr_ps(0.5f, 1.0f, 0.5f, 1.0f) };
+                const __m128 p01{ _mm_unpacklo_ps(x, y) };
+                const __m128 p23{ _mm_unpackhi_ps(x, y) };
+
+                f32* out{ &dst->x };
+                _mm_storeu_ps(out + 0, _mm_shuffle_ps(p01, uv, _MM_SHUFFLE(1, 0, 1, 0)));
+                _mm_storeu_ps(out + 4, _mm_shuffle_ps(p01, uv, _MM_SHUFFLE(3, 2, 3, 2)));
+                _mm_storeu_ps(out + 8, _mm_shuffle_ps(p23, uv, _MM_SHUFFLE(1, 0, 1, 0)));
+                _mm_storeu_ps(out + 12, _mm_shuffle_ps(p23, uv, _MM_SHUFFLE(3, 2, 3, 2)));
+                return dst + 4;
+            }
+
+            NVG_TARGET_SSE4 Vertex* inset_sse4(Vertex* dst, const PointStreams& pts,
+                                               const i32 begin, const i32 end, const f32 w) {
+                const __m128 wv{ _mm_set1_ps(w) };
+
+                i32 i{ begin };
+                for (; i + 4 <= end; i += 4) {
+                    const __m128 x{ _mm_add_ps(_mm_loadu_ps(pts.x + i),
+                                               _mm_mul_ps(_mm_loadu_ps(pts.dmx + i), wv)) };
+                    const __m128 y{ _mm_add_ps(_mm_loadu_ps(pts.y + i),
+                                               _mm_mul_ps(_mm_loadu_ps(pts.dmy + i), wv)) };
+                    dst = store_fill_sse4(dst, x, y);
+                }
+
+                return inset_scalar(dst, pts, i, end, w);
+            }
+
+            NVG_TARGET_SSE4 Vertex* copy_sse4(Vertex* dst, const PointStreams& pts,
+                                              const i32 begin, const i32 end) {
+                i32 i{ begin };
+                for (; i + 4 <= end; i += 4)
+                    dst = store_fill_sse4(dst, _mm_loadu_ps(pts.x + i), _mm_loadu_ps(pts.y + i));
+
+                return copy_scalar(dst, pts, i, end);
+            }
+
+            // AVX2 kernels, 8 points per iteration
+
+            NVG_TARGET_AVX2 void segments_avx2(const PointStreams& pts, const i32 first,
+                                               const i32 count, f32* bounds) {
+                if (count <= 0)
+                    return;
+
+                __m256 bmin_x{ _mm256_set1_ps(bounds[0]) };
+                __m256 bmin_y{ _mm256_set1_ps(bounds[1]) };
+                __m256 bmax_x{ _mm256_set1_ps(bounds[2]) };
+                __m256 bmax_y{ _mm256_set1_ps(bounds[3]) };
+                const __m256 eps{ _mm256_set1_ps(1e-6f) };
+                const __m256 one{ _mm256_set1_ps(1.0f) };
+
+                const i32 last{ first + count - 1 };
+                i32 i{ first };
+                for (; i + 8 <= last; i += 8) {
+                    const __m256 x0{ _mm256_loadu_ps(pts.x + i) };
+                    const __m256 y0{ _mm256_loadu_ps(pts.y + i) };
+                    __m256 dx{ _mm256_sub_ps(_mm256_loadu_ps(pts.x + i + 1), x0) };
+                    __m256 dy{ _mm256_sub_ps(_mm256_loadu_ps(pts.y + i + 1), y0) };
+                    const __m256 d{ _mm256_sqrt_ps(
+                        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))) };
+                    const __m256 mask{ _mm256_cmp_ps(d, eps, _CMP_GT_OQ) };
+                    const __m256 id{ _mm256_div_ps(one, d) };
+                    dx = _mm256_blendv_ps(dx, _mm256_mul_ps(dx, id), mask);
+                    dy = _mm256_blendv_ps(dy, _mm256_mul_ps(dy, id), mask);
+
+                    _mm256_storeu_ps(pts.dx + i, dx);
+                    _mm256_storeu_ps(pts.dy + i, dy);
+                    _mm256_storeu_ps(pts.len + i, d);
+
+                    bmin_x = _mm256_min_ps(bmin_x, x0);
+                    bmin_y = _mm256_min_ps(bmin_y, y0);
+                    bmax_x = _mm256_max_ps(bmax_x, x0);
+                    bmax_y = _mm256_max_ps(bmax_y, y0);
+                }
+
+                alignas(32) f32 lanes[4][8];
+                _mm256_store_ps(lanes[0], bmin_x);
+                _mm256_store_ps(lanes[1], bmin_y);
+                _mm256_store_ps(lanes[2], bmax_x);
+                _mm256_store_ps(lanes[3], bmax_y);
+
+                // the scalar tails are built without VEX encoding, clear the upper register
+                // halves first so they don't pay for the AVX to SSE transition
+                _mm256_zeroupper();
+                for (i32 l = 0; l < 8; ++l) {
+                    bounds[0] = bounds[0] < lanes[0][l] ? bounds[0] : lanes[0][l];
+                    bounds[1] = bounds[1] < lanes[1][l] ? bounds[1] : lanes[1][l];
+                    bounds[2] = bounds[2] > lanes[2][l] ? bounds[2] : lanes[2][l];
+                    bounds[3] = bounds[3] > lanes[3][l] ? bounds[3] : lanes[3][l];
+                }
+
+                for (; i < last; ++i)
+                    segment(pts, i, i + 1, bounds);
+                segment(pts, last, first, bounds);
+            }
+
+            NVG_TARGET_AVX2 i32 joins_avx2(const PointStreams& pts, const i32 first,
+                                           const i32 count, const f32 iw, const f32 miter_limit,
+                                           const bool bevel_corners, i32* nbevel) {
+                if (count <= 0)
+                    return 0;
+
+                const u8 flags{ join(pts, first + count - 1, first, iw, miter_limit,
+                                     bevel_corners) };
+                i32 nleft{ (flags & NvgPtLeft) != 0 };
+                *nbevel += (flags & JoinFlags) != 0;
+
+                const __m256 sign{ _mm256_set1_ps(-0.0f) };
+                const __m256 half{ _mm256_set1_ps(0.5f) };
+                const __m256 eps{ _mm256_set1_ps(0.000001f) };
+                const __m256 one{ _mm256_set1_ps(1.0f) };
+                const __m256 max_scale{ _mm256_set1_ps(600.0f) };
+                const __m256 min_limit{ _mm256_set1_ps(1.01f) };
+                const __m256 inv_width{ _mm256_set1_ps(iw) };
+                const __m256 miter{ _mm256_set1_ps(miter_limit) };
+                const __m256i corner{ _mm256_set1_epi32(NvgPtCorner) };
+                const __m256i left{ _mm256_set1_epi32(NvgPtLeft) };
+                const __m256i bevel{ _mm256_set1_epi32(NvgPtBevel) };
+                const __m256i inner{ _mm256_set1_epi32(NvgPrInnerbevel) };
+                const __m256i force_bevel{ _mm256_set1_epi32(bevel_corners ? -1 : 0) };
+
+                const i32 end{ first + count };
+                i32 p1{ first + 1 };
+                for (; p1 + 8 <= end; p1 += 8) {
+                    const i32 p0{ p1 - 1 };
+                    const __m256 dx0{ _mm256_loadu_ps(pts.dx + p0) };
+                    const __m256 dy0{ _mm256_loadu_ps(pts.dy + p0) };
+                    const __m256 dx1{ _mm256_loadu_ps(pts.dx + p1) };
+                    const __m256 dy1{ _mm256_loadu_ps(pts.dy + p1) };
+
+                    __m256 dmx{ _mm256_mul_ps(_mm256_add_ps(dy0, dy1), half) };
+                    __m256 dmy{ _mm256_mul_ps(
+                        _mm256_add_ps(_mm256_xor_ps(dx0, sign), _mm256_xor_ps(dx1, sign)), half) };
+                    const __m256 dmr2{ _mm256_add_ps(_mm256_mul_ps(dmx, dmx),
+                                                     _mm256_mul_ps(dmy, dmy)) };
+                    const __m256 scale{ _mm256_min_ps(_mm256_div_ps(one, dmr2), max_scale) };
+                    const __m256 rescale{ _mm256_cmp_ps(dmr2, eps, _CMP_GT_OQ) };
+                    dmx = _mm256_blendv_ps(dmx, _mm256_mul_ps(dmx, scale), rescale);
+                    dmy = _mm256_blendv_ps(dmy, _mm256_mul_ps(dmy, scale), rescale);
+                    _mm256_storeu_ps(pts.dmx + p1, dmx);
+                    _mm256_storeu_ps(pts.dmy + p1, dmy);
+
+                    const __m256 cross{ _mm256_sub_ps(_mm256_mul_ps(dx1, dy0),
+                                                      _mm256_mul_ps(dx0, dy1)) };
+                    const __m256 is_left{ _mm256_cmp_ps(cross, _mm256_setzero_ps(), _CMP_GT_OQ) };
+
+                    const __m256 shortest{ _mm256_min_ps(_mm256_loadu_ps(pts.len + p0),
+                                                         _mm256_loadu_ps(pts.len + p1)) };
+                    const __m256 limit{ _mm256_max_ps(min_limit,
+                                                      _mm256_mul_ps(shortest, inv_width)) };
+                    const __m256 is_inner{ _mm256_cmp_ps(
+                        _mm256_mul_ps(_mm256_mul_ps(dmr2, limit), limit), one, _CMP_LT_OQ) };
+                    const __m256 over_miter{ _mm256_cmp_ps(
+                        _mm256_mul_ps(_mm256_mul_ps(dmr2, miter), miter), one, _CMP_LT_OQ) };
+
+                    const __m256i flags_in{ _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pts.flags + p1))) };
+                    const __m256i is_corner{ _mm256_cmpeq_epi32(
+                        _mm256_and_si256(flags_in, corner), corner) };
+                    const __m256i is_bevel{ _mm256_and_si256(
+                        is_corner, _mm256_or_si256(_mm256_castps_si256(over_miter), force_bevel)) };
+
+                    __m256i flags_out{ _mm256_and_si256(flags_in, corner) };
+                    flags_out = _mm256_or_si256(
+                        flags_out, _mm256_and_si256(_mm256_castps_si256(is_left), left));
+                    flags_out = _mm256_or_si256(
+                        flags_out, _mm256_and_si256(_mm256_castps_si256(is_inner), inner));
+                    flags_out = _mm256_or_si256(flags_out, _mm256_and_si256(is_bevel, bevel));
+
+                    const __m128i words{ _mm_packus_epi32(_mm256_castsi256_si128(flags_out),
+                                                          _mm256_extracti128_si256(flags_out, 1)) };
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(pts.flags + p1),
+                                     _mm_packus_epi16(words, words));
+
+                    nleft += std::popcount(static_cast<u32>(_mm256_movemask_ps(is_left)));
+                    *nbevel += std::popcount(static_cast<u32>(_mm256_movemask_ps(
+                        _mm256_or_ps(is_inner, _mm256_castsi256_ps(is_bevel)))));
+                }
+
+                _mm256_zeroupper();
+                for (; p1 < end; ++p1) {
+                    const u8 tail{ join(pts, p1 - 1, p1, iw, miter_limit, bevel_corners) };
+                    nleft += (tail & NvgPtLeft) != 0;
+                    *nbevel += (tail & JoinFlags) != 0;
+                }
+
+                return nleft;
+            }
+
+            NVG_TARGET_AVX2 Vertex* extrude_avx2(Vertex* dst, const PointStreams& pts,
+                                                 const i32 begin, const i32 end, const f32 lw,
+                                                 const f32 rw, const f32 lu, const f32 ru) {
+                const __m256 lwv{ _mm256_set1_ps(lw) };
+                const __m256 rwv{ _mm256_set1_ps(rw) };
+                const __m256 luv{ _mm256_setr_ps(lu, 1.0f, lu, 1.0f, lu, 1.0f, lu, 1.0f) };
+                const __m256 ruv{ _mm256_setr_ps(ru, 1.0f, ru, 1.0f, ru, 1.0f, ru, 1.0f) };
+
+                i32 i{ begin };
+                for (; i + 8 <= end; i += 8) {
+                    const __m256 x{ _mm256_loadu_ps(pts.x + i) };
+                    const __m256 y{ _mm256_loadu_ps(pts.y + i) };
+                    const __m256 dmx{ _mm256_loadu_ps(pts.dmx + i) };
+                    const __m256 dmy{ _mm256_loadu_ps(pts.dmy + i) };
+                    const __m256 lx{ _mm256_add_ps(x, _mm256_mul_ps(dmx, lwv)) };
+                    const __m256 ly{ _mm256_add_ps(y, _mm256_mul_ps(dmy, lwv)) };
+                    const __m256 rx{ _mm256_sub_ps(x, _mm256_mul_ps(dmx, rwv)) };
+                    const __m256 ry{ _mm256_sub_ps(y, _mm256_mul_ps(dmy, rwv)) };
+
+                    // per 128 bit lane: points 0,1 | 4,5 and 2,3 | 6,7
+                    const __m256 l_lo{ _mm256_unpacklo_ps(lx, ly) };
+                    const __m256 l_hi{ _mm256_unpackhi_ps(lx, ly) };
+                    const __m256 r_lo{ _mm256_unpacklo_ps(rx, ry) };
+                    const __m256 r_hi{ _mm256_unpackhi_ps(rx, ry) };
+
+                    const __m256 l0{ _mm256_shuffle_ps(l_lo, luv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                    const __m256 l1{ _mm256_shuffle_ps(l_lo, luv, _MM_SHUFFLE(3, 2, 3, 2)) };
+                    const __m256 l2{ _mm256_shuffle_ps(l_hi, luv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                    const __m256 l3{ _mm256_shuffle_ps(l_hi, luv, _MM_SHUFFLE(3, 2, 3, 2)) };
+                    const __m256 r0{ _mm256_shuffle_ps(r_lo, ruv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                    const __m256 r1{ _mm256_shuffle_ps(r_lo, ruv, _MM_SHUFFLE(3, 2, 3, 2)) };
+                    const __m256 r2{ _mm256_shuffle_ps(r_hi, ruv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                    const __m256 r3{ _mm256_shuffle_ps(r_hi, ruv, _MM_SHUFFLE(3, 2, 3, 2)) };
+
+                    f32* out{ &dst->x };
+                    _mm256_storeu_ps(out + 0, _mm256_permute2f128_ps(l0, r0, 0x20));
+                    _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(l1, r1, 0x20));
+                    _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(l2, r2, 0x20));
+                    _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(l3, r3, 0x20));
+                    _mm256_storeu_ps(out + 32, _mm256_permute2f128_ps(l0, r0, 0x31));
+                    _mm256_storeu_ps(out + 40, _mm256_permute2f128_ps(l1, r1, 0x31));
+                    _mm256_storeu_ps(out + 48, _mm256_permute2f128_ps(l2, r2, 0x31));
+                    _mm256_storeu_ps(out + 56, _mm256_permute2f128_ps(l3, r3, 0x31));
+                    dst += 16;
+                }
+
+                _mm256_zeroupper();
+                return extrude_scalar(dst, pts, i, end, lw, rw, lu, ru);
+            }
+
+            NVG_TARGET_AVX2 Vertex* store_fill_avx2(Vertex* dst, const __m256 x, const __m256 y) {
+                const __m256 uv{ _mm256_setr_ps(0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 1.0f) };
+                const __m256 p_lo{ _mm256_unpacklo_ps(x, y) };
+                const __m256 p_hi{ _mm256_unpackhi_ps(x, y) };
+                const __m256 v0{ _mm256_shuffle_ps(p_lo, uv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                const __m256 v1{ _mm256_shuffle_ps(p_lo, uv, _MM_SHUFFLE(3, 2, 3, 2)) };
+                const __m256 v2{ _mm256_shuffle_ps(p_hi, uv, _MM_SHUFFLE(1, 0, 1, 0)) };
+                const __m256 v3{ _mm256_shuffle_ps(p_hi, uv, _MM_SHUFFLE(3, 2, 3, 2)) };
+
+                f32* out{ &dst->x };
+                _mm256_storeu_ps(out + 0, _mm256_permute2f128_ps(v0, v1, 0x20));
+                _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(v2, v3, 0x20));
+                _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(v0, v1, 0x31));
+                _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(v2, v3, 0x31));
+                return dst + 8;
+            }
+
+            NVG_TARGET_AVX2 Vertex* inset_avx2(Vertex* dst, const PointStreams& pts,
+                                               const i32 begin, const i32 end, const f32 w) {
+                const __m256 wv{ _mm256_set1_ps(w) };
+
+                i32 i{ begin };
+                for (; i + 8 <= end; i += 8) {
+                    const __m256 x{ _mm256_add_ps(_mm256_loadu_ps(pts.x + i),
+                                                  _mm256_mul_ps(_mm256_loadu_ps(pts.dmx + i), wv)) };
+                    const __m256 y{ _mm256_add_ps(_mm256_loadu_ps(pts.y + i),
+                                                  _mm256_mul_ps(_mm256_loadu_ps(pts.dmy + i), wv)) };
+                    dst = store_fill_avx2(dst, x, y);
+                }
+
+                _mm256_zeroupper();
+                return inset_scalar(dst, pts, i, end, w);
+            }
+
+            NVG_TARGET_AVX2 Vertex* copy_avx2(Vertex* dst, const PointStreams& pts,
+                                              const i32 begin, const i32 end) {
+                i32 i{ begin };
+                for (; i + 8 <= end; i += 8)
+                    dst = store_fill_avx2(dst, _mm256_loadu_ps(pts.x + i),
+                                          _mm256_loadu_ps(pts.y + i));
+
+                _mm256_zeroupper();
+                return copy_scalar(dst, pts, i, end);
+            }
+
+            Level detect_level() {
+  #if defined(_MSC_VER) && !defined(__clang__)
+                i32 info[4]{};
+                __cpuid(info, 0);
+                const i32 max_leaf{ info[0] };
+
+                __cpuid(info, 1);
+                const bool sse41{ (info[2] & (1 << 19)) != 0 };
+                const bool os_avx{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                                   (_xgetbv(0) & 0x6) == 0x6 };
+
+                bool avx2{ false };
+                if (max_leaf >= 7) {
+                    __cpuidex(info, 7, 0);
+                    avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+                }
+  #else
+                __builtin_cpu_init();
+                const bool sse41{ __builtin_cpu_supports("sse4.1") != 0 };
+                const bool avx2{ __builtin_cpu_supports("avx2") != 0 };
+  #endif
+                if (avx2)
+                    return Level::AVX2;
+                if (sse41)
+                    return Level::SSE4;
+                return Level::Scalar;
+            }
+#else
+            Level detect_level() {
+                return Level::Scalar;
+            }
+#endif
+
+            constexpr Kernels KernelTable[]{
+                {
+                    &segments_scalar,
+                    &joins_scalar,
+                    &extrude_scalar,
+                    &inset_scalar,
+                    &copy_scalar,
+                },
+#if NVG_SIMD_X86
+                {
+                    &segments_sse4,
+                    &joins_sse4,
+                    &extrude_sse4,
+                    &inset_sse4,
+                    &copy_sse4,
+                },
+                {
+                    &segments_avx2,
+                    &joins_avx2,
+                    &extrude_avx2,
+                    &inset_avx2,
+                    &copy_avx2,
+                },
+#endif
+            };
+
+            std::atomic<Level>& level() {
+                static std::atomic<Level> level{ supported_level() };
+                return level;
+            }
+        }
+    }
+
+    Level supported_level() {
+        static const Level supported{ detail::detect_level() };
+        return supported;
+    }
+
+    Level active_level() {
+        return detail::level().load(std::memory_order_relaxed);
+    }
+
+    void set_level(const Level level) {
+        detail::level().store(level < supported_level() ? level : supported_level(),
+                              std::memory_order_relaxed);
+    }
+
+    const Kernels& kernels() {
+        return detail::KernelTable[static_cast<i32>(active_level())];
+    }
+
+    const Kernels& kernels(const Level level) {
+        return detail::KernelTable[static_cast<i32>(level < supported_level() ? level
+                                                                              : supported_level())];
+    }
+}
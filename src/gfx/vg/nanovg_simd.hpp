@@ -0,0 +1,50 @@
+#pragma once
+
+#include "gfx/vg/nanovg.hpp"
+
+namespace rl::nvg::simd {
+    // Instruction sets the tessellation kernels are compiled for. The
+    // highest one supported by the CPU is selected the first time a
+    // path is tessellated.
+    enum class Level {
+        Scalar,
+        SSE4,
+        AVX2,
+    };
+
+    // Kernels used by flatten_paths(), calculate_joins(), expand_stroke() and expand_fill().
+    // All point indices are absolute indices into the path cache's point streams. Every
+    // implementation produces the same output as the scalar one, vector versions only use
+    // exact IEEE operations (no FMA or reciprocal approximations) in the same order.
+    struct Kernels {
+        // Direction and length of the segment leaving each of the count points starting at
+        // first, wrapping around to the first point. Grows bounds to include the points.
+        void (*segments)(const PointStreams& pts, i32 first, i32 count, f32* bounds);
+
+        // Miter extrusion and join flags for each of the count points starting at first.
+        // Sets nbevel to the number of points needing bevel or inner bevel joins and
+        // returns the number of left turns.
+        i32 (*joins)(const PointStreams& pts, i32 first, i32 count, f32 iw, f32 miter_limit,
+                     bool bevel_corners, i32* nbevel);
+
+        // Left and right miter vertices for every point in [begin, end).
+        Vertex* (*extrude)(Vertex* dst, const PointStreams& pts, i32 begin, i32 end, f32 lw,
+                           f32 rw, f32 lu, f32 ru);
+
+        // Fill vertex offset along the miter extrusion for every point in [begin, end).
+        Vertex* (*inset)(Vertex* dst, const PointStreams& pts, i32 begin, i32 end, f32 w);
+
+        // Fill vertex at every point in [begin, end).
+        Vertex* (*copy)(Vertex* dst, const PointStreams& pts, i32 begin, i32 end);
+    };
+
+    // Highest level supported by the CPU and the build.
+    Level supported_level();
+
+    // Level currently used by nanovg, clamped to what's supported.
+    Level active_level();
+    void set_level(Level level);
+
+    const Kernels& kernels();
+    const Kernels& kernels(Level level);
+}
@@ -1,14 +1,20 @@
 #pragma once
 #include <array>
 #include <memory>
+#include <ranges>
 #include <utility>
 #include <vector>
 
 #include "ds/line.hpp"
 #include "ds/rect.hpp"
+#include "gfx/vg/nanovg.hpp"
 #include "utils/numeric.hpp"
 
 namespace rl::ui {
+    // Vector path front end for nanovg's retained paths. The path is recorded once in its own
+    // local space and tessellated by the renderer on first use, afterwards drawing it only
+    // submits the current transform and paint. Any edit to the path invalidates the cached
+    // geometry, which is rebuilt the next time the path is drawn.
     class path {
     public:
         // clang-format off
@@ -37,7 +43,8 @@ namespace rl::ui {
             reverse_difference,  //!< subtract the first path from the op path
         };
 
-        using step = std::pair<path::op, std::array<f32, 4>>;
+        // instruction followed by its points, beziers use all 3 (c1, c2, end)
+        using step = std::pair<path::instruction, std::array<f32, 6>>;
 
     public:
         explicit path() = default;
@@ -46,22 +53,172 @@ namespace rl::ui {
             : m_path_sequence{ std::move(sequence) } {
         }
 
-        auto& move_to(ds::point<f32> pos) {
-            m_path_sequence.emplace_back(op::move, { pos.x, pos.y });
+        path(const path&) = delete;
+        path& operator=(const path&) = delete;
+
+        path(path&& other) noexcept
+            : m_path_sequence{ std::move(other.m_path_sequence) }
+            , m_context{ std::exchange(other.m_context, nullptr) }
+            , m_handle{ std::exchange(other.m_handle, 0) }
+            , m_dirty{ other.m_dirty } {
+        }
+
+        path& operator=(path&& other) noexcept {
+            if (this != &other) {
+                this->release();
+                m_path_sequence = std::move(other.m_path_sequence);
+                m_context = std::exchange(other.m_context, nullptr);
+                m_handle = std::exchange(other.m_handle, 0);
+                m_dirty = other.m_dirty;
+            }
             return *this;
         }
 
+        ~path() {
+            this->release();
+        }
+
+        auto& move_to(ds::point<f32> pos) {
+            return this->push(instruction::move, { pos.x, pos.y });
+        }
+
         auto& line_to(ds::point<f32> pos) {
-            m_path_sequence.emplace_back(op::line, { pos.x, pos.y });
-            return *this;
+            return this->push(instruction::line, { pos.x, pos.y });
+        }
+
+        auto& bezier_to(ds::point<f32> c1, ds::point<f32> c2, ds::point<f32> pos) {
+            return this->push(instruction::bezier, { c1.x, c1.y, c2.x, c2.y, pos.x, pos.y });
+        }
+
+        auto& quad_to(ds::point<f32> c, ds::point<f32> pos) {
+            // elevated to a cubic bezier, same as nvg::quad_to()
+            const ds::point<f32> start{ this->last_point() };
+            return this->bezier_to(
+                ds::point<f32>{
+                    start.x + 2.0f / 3.0f * (c.x - start.x),
+                    start.y + 2.0f / 3.0f * (c.y - start.y),
+                },
+                ds::point<f32>{
+                    pos.x + 2.0f / 3.0f * (c.x - pos.x),
+                    pos.y + 2.0f / 3.0f * (c.y - pos.y),
+                },
+                pos);
+        }
+
+        auto& close() {
+            return this->push(instruction::close, {});
+        }
+
+        auto& winding(nvg::Solidity dir) {
+            return this->push(instruction::winding, { static_cast<f32>(dir) });
         }
 
         auto& add_rect(ds::rect<f32> rect) {
-            m_path_sequence.emplace_back(op::rect, { pos.x, pos.y });
+            this->move_to(rect.pt);
+            this->line_to({ rect.pt.x, rect.pt.y + rect.size.height });
+            this->line_to({ rect.pt.x + rect.size.width, rect.pt.y + rect.size.height });
+            this->line_to({ rect.pt.x + rect.size.width, rect.pt.y });
+            return this->close();
+        }
+
+        void clear() {
+            m_path_sequence.clear();
+            m_dirty = true;
+        }
+
+        bool empty() const {
+            return m_path_sequence.empty();
+        }
+
+        // Returns the nanovg retained path, recording it if the path changed since it was
+        // last drawn. Recording replaces the context's current path.
+        nvg::PathHandle handle(nvg::Context* context) {
+            if (m_handle != 0 && !m_dirty && m_context == context)
+                return m_handle;
+
+            if (m_context != context)
+                this->release();
+
+            // recorded without the current transform, it's applied when the path is drawn
+            nvg::save(context);
+            nvg::reset_transform(context);
+            nvg::begin_path(context);
+
+            for (const auto& [inst, pts] : m_path_sequence) {
+                switch (inst) {
+                    case instruction::move:
+                        nvg::move_to(context, pts[0], pts[1]);
+                        break;
+                    case instruction::line:
+                        nvg::line_to(context, pts[0], pts[1]);
+                        break;
+                    case instruction::bezier:
+                        nvg::bezier_to(context, pts[0], pts[1], pts[2], pts[3], pts[4], pts[5]);
+                        break;
+                    case instruction::close:
+                        nvg::close_path(context);
+                        break;
+                    case instruction::winding:
+                        nvg::path_winding(context,
+                                          static_cast<nvg::Solidity>(static_cast<i32>(pts[0])));
+                        break;
+                }
+            }
+
+            if (m_handle == 0) {
+                m_handle = nvg::create_path(context);
+                m_context = m_handle != 0 ? context : nullptr;
+            }
+            else
+                nvg::update_path(context, m_handle);
+
+            nvg::begin_path(context);
+            nvg::restore(context);
+
+            m_dirty = false;
+            return m_handle;
+        }
+
+        // Fills the path with the context's current fill style and transform.
+        void fill(nvg::Context* context) {
+            nvg::fill_path(context, this->handle(context));
+        }
+
+        // Strokes the path with the context's current stroke style and transform.
+        void stroke(nvg::Context* context) {
+            nvg::stroke_path(context, this->handle(context));
+        }
+
+    private:
+        path& push(instruction inst, std::array<f32, 6> pts) {
+            m_path_sequence.emplace_back(inst, pts);
+            m_dirty = true;
             return *this;
         }
 
+        ds::point<f32> last_point() const {
+            for (const auto& [inst, pts] : m_path_sequence | std::views::reverse) {
+                if (inst == instruction::bezier)
+                    return { pts[4], pts[5] };
+                if (inst == instruction::move || inst == instruction::line)
+                    return { pts[0], pts[1] };
+            }
+            return { 0.0f, 0.0f };
+        }
+
+        void release() {
+            if (m_context != nullptr && m_handle != 0)
+                nvg::delete_path(m_context, m_handle);
+
+            m_context = nullptr;
+            m_handle = 0;
+            m_dirty = true;
+        }
+
     private:
         std::vector<step> m_path_sequence{};
+        nvg::Context* m_context{ nullptr };
+        nvg::PathHandle m_handle{ 0 };
+        bool m_dirty{ true };
     };
 }
@@ -16,14 +16,23 @@
 
 #include <fmt/chrono.h>
 #include <fmt/format.h>
+#include <glad/gl.h>
 #include <nanobench.h>
 #include <pcg_random.hpp>
 
 #include "ds/rect.hpp"
+#include "gfx/stb/stb_truetype.hpp"
+#include "gfx/vg/nanosvg.hpp"
+#include "gfx/vg/nanovg.hpp"
+#include "gfx/vg/nanovg_gl.hpp"
+#include "gfx/vg/nanovg_simd.hpp"
+#include "utils/fs.hpp"
 #include "utils/generator.hpp"
 #include "utils/memory.hpp"
 #include "utils/numeric.hpp"
 #include "utils/random.hpp"
+#include "utils/utf.hpp"
+#include "utils/utf8_simd.hpp"
 
 namespace rl::bench {
     namespace fib {
@@ -396,6 +405,626 @@ namespace rl::bench {
             // ankerl::nanobench::doNotOptimizeAway(ret);
         });
     }
+
+    // nanovg backend that draws nothing, it only adds up the vertices
+    // of the tessellated fills and strokes in the u64 at nverts.
+    inline nvg::Params null_backend_params(u64* nverts) {
+        nvg::Params params{};
+        params.user_ptr = nverts;
+        params.render_create = [](void*) { return 1; };
+        params.render_create_texture = [](void*, nvg::TextureProperty, i32, i32, nvg::ImageFlags,
+                                          const u8*) { return 1; };
+        params.render_delete_texture = [](void*, i32) { return 1; };
+        params.render_update_texture = [](void*, i32, i32, i32, i32, i32, const u8*) { return 1; };
+        params.render_get_texture_size = [](void*, i32, f32* w, f32* h) {
+            *w = 512.0f;
+            *h = 512.0f;
+            return 1;
+        };
+        params.render_viewport = [](void*, f32, f32, f32) {};
+        params.render_cancel = [](void*) {};
+        params.render_flush = [](void*) {};
+        params.render_fill = [](void* uptr, const nvg::PaintStyle*, nvg::CompositeOperationState,
+                                const nvg::ScissorParams*, f32, const f32*,
+                                const nvg::NVGpath* paths, const i32 npaths) {
+            for (i32 i = 0; i < npaths; ++i)
+                *static_cast<u64*>(uptr) += static_cast<u64>(paths[i].nfill + paths[i].nstroke);
+        };
+        params.render_stroke = [](void* uptr, const nvg::PaintStyle*, nvg::CompositeOperationState,
+                                  const nvg::ScissorParams*, f32, f32, const nvg::NVGpath* paths,
+                                  const i32 npaths) {
+            for (i32 i = 0; i < npaths; ++i)
+                *static_cast<u64*>(uptr) += static_cast<u64>(paths[i].nstroke);
+        };
+        params.render_delete = [](void*) {};
+        return params;
+    }
+
+    inline void run_nanovg_tessellation_benchmarks() {
+        u64 nverts{ 0 };
+        const nvg::Params params{ null_backend_params(&nverts) };
+
+        nvg::Context* ctx{ nvg::create_internal(&params) };
+        nvg::svg::NSVGimage* tiger{ nvg::svg::nsvg_parse_from_file(
+            fs::to_absolute("../../../data/assets/svg/tiger.svg").c_str(), "px", 96.0f) };
+        if (ctx == nullptr || tiger == nullptr) {
+            fmt::println("nanovg tessellation benchmarks skipped, tiger.svg not found");
+            nvg::svg::nsvg_delete(tiger);
+            nvg::delete_internal(ctx);
+            return;
+        }
+
+        // fills and strokes every shape in the svg the same way the svg widgets draw it
+        const auto draw_tiger = [&](const f32 scale) {
+            nvg::begin_frame(ctx, 1920.0f, 1080.0f, 1.0f);
+            nvg::scale(ctx, scale, scale);
+            for (const nvg::svg::NSVGshape* shape = tiger->shapes; shape != nullptr;
+                 shape = shape->next) {
+                nvg::begin_path(ctx);
+                for (const nvg::svg::NSVGpath* path = shape->paths; path != nullptr;
+                     path = path->next) {
+                    nvg::move_to(ctx, path->pts[0], path->pts[1]);
+                    for (i32 i = 1; i < path->npts - 1; i += 3) {
+                        const f32* p{ &path->pts[i * 2] };
+                        nvg::bezier_to(ctx, p[0], p[1], p[2], p[3], p[4], p[5]);
+                    }
+                    if (path->closed)
+                        nvg::close_path(ctx);
+                }
+
+                if (shape->fill.type != nvg::svg::NSVGPaintNone)
+                    nvg::fill(ctx);
+
+                if (shape->stroke.type != nvg::svg::NSVGPaintNone) {
+                    nvg::stroke_width(ctx, shape->stroke_width);
+                    nvg::line_join(ctx, shape->stroke_line_join == nvg::svg::NSVGJoinRound
+                                            ? nvg::LineCap::Round
+                                        : shape->stroke_line_join == nvg::svg::NSVGJoinBevel
+                                            ? nvg::LineCap::Bevel
+                                            : nvg::LineCap::Miter);
+                    nvg::line_cap(ctx, shape->stroke_line_cap == nvg::svg::NSVGCapRound
+                                           ? nvg::LineCap::Round
+                                       : shape->stroke_line_cap == nvg::svg::NSVGCapSquare
+                                           ? nvg::LineCap::Square
+                                           : nvg::LineCap::Butt);
+                    nvg::miter_limit(ctx, shape->miter_limit);
+                    nvg::stroke(ctx);
+                }
+            }
+            nvg::cancel_frame(ctx);
+        };
+
+        constexpr std::array levels{
+            std::pair{ nvg::simd::Level::Scalar, "scalar" },
+            std::pair{ nvg::simd::Level::SSE4, "sse4.1" },
+            std::pair{ nvg::simd::Level::AVX2, "avx2" },
+        };
+
+        const nvg::simd::Level active_level{ nvg::simd::active_level() };
+        for (const f32 scale : { 0.5f, 1.0f, 2.5f }) {
+            ankerl::nanobench::Bench tessellation_benchmarks{};
+            tessellation_benchmarks.title(fmt::format("nanovg tessellation (tiger.svg, {}x)", scale))
+                .unit("frame")
+                .warmup(100)
+                .relative(true)
+                .performanceCounters(true)
+                .minEpochTime(250ms);
+
+            for (auto&& [level, name] : levels) {
+                if (level > nvg::simd::supported_level())
+                    continue;
+
+                nvg::simd::set_level(level);
+                tessellation_benchmarks.run(name, [&] {
+                    draw_tiger(scale);
+                    ankerl::nanobench::doNotOptimizeAway(nverts);
+                });
+            }
+        }
+
+        nvg::simd::set_level(active_level);
+        nvg::svg::nsvg_delete(tiger);
+        nvg::delete_internal(ctx);
+    }
+
+    // Needs a current OpenGL context. Draws gradient, solid and stroked widgets, half of them
+    // under a rotated scissor, and prints the GPU time spent in each fragment shader variant
+    // as measured by the backend's GL_TIME_ELAPSED queries.
+    inline void run_nanovg_shader_variant_benchmarks() {
+        constexpr f32 width{ 1920.0f };
+        constexpr f32 height{ 1080.0f };
+        constexpr i32 columns{ 40 };
+        constexpr i32 rows{ 25 };
+
+        nvg::Context* ctx{ nvg::gl::create_gl_context(nvg::gl::CreateFlags::AntiAlias |
+                                                      nvg::gl::CreateFlags::StencilStrokes |
+                                                      nvg::gl::CreateFlags::ShaderTimings) };
+        if (ctx == nullptr) {
+            fmt::println("nanovg shader variant benchmarks skipped, no GL context");
+            return;
+        }
+
+        const auto draw_widgets = [&] {
+            nvg::begin_frame(ctx, width, height, 1.0f);
+            for (i32 row = 0; row < rows; ++row) {
+                for (i32 col = 0; col < columns; ++col) {
+                    const f32 w{ width / columns };
+                    const f32 h{ height / rows };
+                    const f32 x{ col * w + 2.0f };
+                    const f32 y{ row * h + 2.0f };
+
+                    nvg::save(ctx);
+                    if (row % 2 != 0) {
+                        nvg::translate(ctx, x + w / 2.0f, y + h / 2.0f);
+                        nvg::rotate(ctx, 0.1f);
+                        nvg::scissor(ctx, -w / 2.0f, -h / 2.0f, w - 8.0f, h - 8.0f);
+                        nvg::reset_transform(ctx);
+                    }
+
+                    nvg::begin_path(ctx);
+                    nvg::rounded_rect(ctx, x, y, w - 4.0f, h - 4.0f, 4.0f);
+                    nvg::fill_paint(ctx, nvg::linear_gradient(ctx, x, y, x, y + h,
+                                                              ds::color<f32>{ 0.3f, 0.3f, 0.35f, 1.0f },
+                                                              ds::color<f32>{ 0.2f, 0.2f, 0.25f, 1.0f }));
+                    nvg::fill(ctx);
+                    nvg::stroke_color(ctx, ds::color<f32>{ 0.0f, 0.0f, 0.0f, 0.5f });
+                    nvg::stroke_width(ctx, 1.0f);
+                    nvg::stroke(ctx);
+
+                    nvg::begin_path(ctx);
+                    nvg::circle(ctx, x + 8.0f, y + h / 2.0f - 2.0f, 5.0f);
+                    nvg::fill_color(ctx, ds::color<f32>{ 0.9f, 0.6f, 0.1f, 1.0f });
+                    nvg::fill(ctx);
+                    nvg::restore(ctx);
+                }
+            }
+            nvg::end_frame(ctx);
+            glFinish();
+        };
+
+        ankerl::nanobench::Bench shader_variant_benchmarks{};
+        shader_variant_benchmarks.title("nanovg shader variants (1000 widgets)")
+            .unit("frame")
+            .warmup(10)
+            .minEpochTime(250ms);
+        shader_variant_benchmarks.run("frame", draw_widgets);
+
+        const nvg::gl::ShaderTiming* timings{ nullptr };
+        const i32 ntimings{ nvg::gl::shader_timings(ctx, &timings) };
+        for (i32 i = 0; i < ntimings; ++i) {
+            if (timings[i].draws == 0)
+                continue;
+            fmt::println("{:<32} {:>10} draws {:>12.3f} ms {:>10.3f} us/draw", timings[i].name,
+                         timings[i].draws, timings[i].gpu_time_ns / 1e6,
+                         timings[i].gpu_time_ns / 1e3 / timings[i].draws);
+        }
+
+        nvg::gl::delete_gl_context(ctx);
+    }
+
+    // Needs a current OpenGL context. Renders a canvas of 1000 widgets (gradient background,
+    // border, icon and label) with the float and the packed vertex formats.
+    inline void run_nanovg_vertex_format_benchmarks() {
+        constexpr f32 width{ 1920.0f };
+        constexpr f32 height{ 1080.0f };
+        constexpr i32 columns{ 40 };
+        constexpr i32 rows{ 25 };
+
+        const auto draw_widgets = [&](nvg::Context* ctx, const i32 font) {
+            nvg::begin_frame(ctx, width, height, 1.0f);
+            for (i32 row = 0; row < rows; ++row) {
+                for (i32 col = 0; col < columns; ++col) {
+                    const f32 w{ width / columns };
+                    const f32 h{ height / rows };
+                    const f32 x{ col * w + 2.0f };
+                    const f32 y{ row * h + 2.0f };
+
+                    nvg::begin_path(ctx);
+                    nvg::rounded_rect(ctx, x, y, w - 4.0f, h - 4.0f, 4.0f);
+                    nvg::fill_paint(ctx, nvg::linear_gradient(ctx, x, y, x, y + h,
+                                                              ds::color<f32>{ 0.3f, 0.3f, 0.35f, 1.0f },
+                                                              ds::color<f32>{ 0.2f, 0.2f, 0.25f, 1.0f }));
+                    nvg::fill(ctx);
+                    nvg::stroke_color(ctx, ds::color<f32>{ 0.0f, 0.0f, 0.0f, 0.5f });
+                    nvg::stroke_width(ctx, 1.0f);
+                    nvg::stroke(ctx);
+
+                    nvg::begin_path(ctx);
+                    nvg::circle(ctx, x + 8.0f, y + h / 2.0f - 2.0f, 5.0f);
+                    nvg::fill_color(ctx, ds::color<f32>{ 0.9f, 0.6f, 0.1f, 1.0f });
+                    nvg::fill(ctx);
+
+                    if (font != -1) {
+                        nvg::set_font_size(ctx, 12.0f);
+                        nvg::fill_color(ctx, ds::color<f32>{ 1.0f, 1.0f, 1.0f, 1.0f });
+                        nvg::draw_text(ctx, ds::point<f32>{ x + 16.0f, y + h / 2.0f + 2.0f },
+                                       fmt::format("w{}", row * columns + col));
+                    }
+                }
+            }
+            nvg::end_frame(ctx);
+            glFinish();
+        };
+
+        constexpr std::array formats{
+            std::pair{ nvg::gl::CreateFlags::None, "f32 x4 vertices" },
+            std::pair{ nvg::gl::CreateFlags::PackedVertices, "u16 x4 packed vertices" },
+        };
+
+        ankerl::nanobench::Bench vertex_format_benchmarks{};
+        vertex_format_benchmarks.title("nanovg vertex formats (1000 widgets)")
+            .unit("frame")
+            .warmup(10)
+            .relative(true)
+            .minEpochTime(250ms);
+
+        for (auto&& [format, name] : formats) {
+            nvg::Context* ctx{ nvg::gl::create_gl_context(nvg::gl::CreateFlags::AntiAlias |
+                                                          nvg::gl::CreateFlags::StencilStrokes |
+                                                          format) };
+            if (ctx == nullptr) {
+                fmt::println("nanovg vertex format benchmarks skipped, no GL context");
+                return;
+            }
+
+            const i32 font{ nvg::create_font(
+                ctx, "sans",
+                fs::to_absolute("../../../data/fonts/roboto_regular.ttf").c_str()) };
+            if (font != -1)
+                nvg::set_font_face(ctx, "sans");
+
+            vertex_format_benchmarks.run(name, [&] {
+                draw_widgets(ctx, font);
+            });
+
+            fmt::println("{}: {} bytes uploaded per frame", name,
+                         nvg::gl::frame_stats(ctx).bytes_uploaded);
+            nvg::gl::delete_gl_context(ctx);
+        }
+    }
+
+    // Needs a current OpenGL context. Renders a stroke heavy scene (polylines, curves and
+    // circles with every cap and join) into an offscreen framebuffer with strokes tessellated
+    // on the CPU and expanded by the geometry shader. The two images are compared against each
+    // other, and the CPU time spent submitting a frame is reported next to the frame times.
+    inline void run_nanovg_stroke_benchmarks() {
+        constexpr i32 width{ 1920 };
+        constexpr i32 height{ 1080 };
+        constexpr i32 shapes{ 1500 };
+        constexpr std::array caps{ nvg::LineCap::Butt, nvg::LineCap::Round, nvg::LineCap::Square };
+        constexpr std::array joins{ nvg::LineCap::Miter, nvg::LineCap::Round, nvg::LineCap::Bevel };
+
+        const auto draw_strokes = [&](nvg::Context* ctx) {
+            nvg::begin_frame(ctx, width, height, 1.0f);
+            for (i32 i = 0; i < shapes; ++i) {
+                const f32 x{ static_cast<f32>(i % 50) * (width / 50.0f) + 10.0f };
+                const f32 y{ static_cast<f32>(i / 50) * (height / 30.0f) + 10.0f };
+                const f32 phase{ static_cast<f32>(i) * 0.37f };
+
+                nvg::begin_path(ctx);
+                switch (i % 3) {
+                    case 0:
+                        nvg::move_to(ctx, x, y);
+                        for (i32 p = 1; p < 6; ++p)
+                            nvg::line_to(ctx, x + p * 5.0f, y + std::sin(phase + p) * 12.0f + 12.0f);
+                        break;
+                    case 1:
+                        nvg::move_to(ctx, x, y + 20.0f);
+                        nvg::bezier_to(ctx, x + 10.0f, y - 10.0f * std::cos(phase), x + 20.0f,
+                                       y + 40.0f, x + 30.0f, y + 10.0f);
+                        break;
+                    default:
+                        nvg::circle(ctx, x + 15.0f, y + 12.0f, 6.0f + 4.0f * std::sin(phase));
+                        break;
+                }
+
+                nvg::line_cap(ctx, caps[i / 9 % caps.size()]);
+                nvg::line_join(ctx, joins[i / 3 % joins.size()]);
+                nvg::stroke_width(ctx, 1.0f + static_cast<f32>(i % 4));
+                nvg::stroke_color(ctx, ds::color<f32>{ 0.2f + 0.6f * static_cast<f32>(i % 5) / 4.0f,
+                                                       0.8f, 0.4f, 1.0f });
+                nvg::stroke(ctx);
+            }
+            nvg::end_frame(ctx);
+        };
+
+        GLuint fbo{ 0 };
+        GLuint rbos[2]{};
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(2, rbos);
+        glBindRenderbuffer(GL_RENDERBUFFER, rbos[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, rbos[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbos[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbos[1]);
+        glViewport(0, 0, width, height);
+
+        constexpr std::array modes{
+            std::pair{ nvg::gl::CreateFlags::None, "cpu tessellated strokes" },
+            std::pair{ nvg::gl::CreateFlags::GeometryStrokes, "geometry shader strokes" },
+        };
+
+        ankerl::nanobench::Bench stroke_benchmarks{};
+        stroke_benchmarks.title("nanovg strokes (1500 paths)")
+            .unit("frame")
+            .warmup(10)
+            .relative(true)
+            .minEpochTime(250ms);
+
+        std::array<std::vector<u8>, modes.size()> images{};
+        for (u32 m = 0; m < modes.size(); ++m) {
+            const auto& [mode, name]{ modes[m] };
+            nvg::Context* ctx{ nvg::gl::create_gl_context(nvg::gl::CreateFlags::AntiAlias | mode) };
+            if (ctx == nullptr) {
+                fmt::println("nanovg stroke benchmarks skipped, no GL context");
+                break;
+            }
+
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            draw_strokes(ctx);
+            images[m].resize(static_cast<u64>(width) * height * 4);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, images[m].data());
+
+            // CPU side only, the frame is submitted but not waited on
+            std::chrono::nanoseconds submit_time{};
+            u32 frames{ 0 };
+            stroke_benchmarks.run(name, [&] {
+                const auto start{ std::chrono::steady_clock::now() };
+                draw_strokes(ctx);
+                submit_time += std::chrono::steady_clock::now() - start;
+                frames++;
+                glFinish();
+            });
+
+            fmt::println("{}: {:.3f} ms cpu per frame, {} bytes uploaded per frame", name,
+                         std::chrono::duration<f64, std::milli>(submit_time).count() / frames,
+                         nvg::gl::frame_stats(ctx).bytes_uploaded);
+            nvg::gl::delete_gl_context(ctx);
+        }
+
+        if (!images.back().empty()) {
+            u32 max_diff{ 0 };
+            u64 differing{ 0 };
+            for (u64 i = 0; i < images[0].size(); i += 4) {
+                u32 diff{ 0 };
+                for (u64 c = 0; c < 3; ++c)
+                    diff = std::max(diff, static_cast<u32>(std::abs(images[0][i + c] -
+                                                                    images[1][i + c])));
+                max_diff = std::max(max_diff, diff);
+                differing += diff > 8 ? 1 : 0;
+            }
+
+            fmt::println("geometry shader strokes: {:.3f}% of pixels differ by more than 8, "
+                         "max channel difference {}",
+                         100.0 * static_cast<f64>(differing) / (static_cast<f64>(width) * height),
+                         max_diff);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(2, rbos);
+        glDeleteFramebuffers(1, &fbo);
+    }
+
+    // Draws a 10k glyph paragraph through the null backend, one line per font size with icon
+    // glyphs from the fallback font mixed in, so every frame looks up glyphs for the same
+    // codepoints at several sizes. The warmup frames rasterize them, the timed ones only hit
+    // the glyph cache.
+    inline void run_fontstash_glyph_cache_benchmarks() {
+        constexpr i32 glyph_count{ 10000 };
+        constexpr u64 line_length{ 100 };
+        constexpr std::array sizes{ 12.0f, 14.0f, 16.0f, 20.0f, 24.0f, 32.0f, 48.0f };
+        constexpr std::array icons{ u8"\uf004", u8"\uf005", u8"\uf007", u8"\uf013", u8"\uf015" };
+        constexpr std::string_view words[]{
+            "lorem", "ipsum", "dolor", "sit",  "amet,", "consectetur", "adipiscing",
+            "elit,", "sed",   "do",    "EIUS", "MOD",   "tempor",      "1234567890",
+        };
+
+        u64 nverts{ 0 };
+        const nvg::Params params{ null_backend_params(&nverts) };
+        nvg::Context* ctx{ nvg::create_internal(&params) };
+        const i32 sans{ ctx != nullptr ? nvg::create_font(
+                                             ctx, "sans",
+                                             fs::to_absolute("../../../data/fonts/roboto_regular.ttf")
+                                                 .c_str())
+                                       : -1 };
+        const i32 icon{ ctx != nullptr ? nvg::create_font(
+                                             ctx, "icons",
+                                             fs::to_absolute("../../../data/fonts/fontawesome_solid.ttf")
+                                                 .c_str())
+                                       : -1 };
+        if (sans == -1 || icon == -1) {
+            fmt::println("fontstash glyph cache benchmarks skipped, fonts not found");
+            nvg::delete_internal(ctx);
+            return;
+        }
+        nvg::add_fallback_font_id(ctx, sans, icon);
+
+        std::vector<std::string> lines{ std::string{} };
+        for (i32 glyphs = 0, w = 0; glyphs < glyph_count; ++w) {
+            std::string& line{ lines.back() };
+            if (w % 7 == 6) {
+                line += reinterpret_cast<const char*>(icons[w % icons.size()]);
+                glyphs += 1;
+            }
+            else {
+                line += words[w % std::size(words)];
+                glyphs += static_cast<i32>(words[w % std::size(words)].size());
+            }
+            line += ' ';
+            glyphs += 1;
+            if (line.size() >= line_length)
+                lines.emplace_back();
+        }
+
+        const auto draw_paragraph = [&] {
+            nvg::begin_frame(ctx, 1920.0f, 1080.0f, 1.0f);
+            nvg::font_face_id_(ctx, sans);
+            for (u32 i = 0; i < lines.size(); ++i) {
+                nvg::set_font_size(ctx, sizes[i % sizes.size()]);
+                nvg::draw_text(ctx, ds::point<f32>{ 10.0f, 20.0f + static_cast<f32>(i % 40) * 26.0f },
+                               lines[i]);
+            }
+            nvg::cancel_frame(ctx);
+        };
+
+        ankerl::nanobench::Bench glyph_benchmarks{};
+        glyph_benchmarks.title("fontstash glyph cache")
+            .unit("glyph")
+            .batch(glyph_count)
+            .warmup(10)
+            .performanceCounters(true)
+            .minEpochTime(250ms);
+
+        glyph_benchmarks.run("10k glyph paragraph", [&] {
+            draw_paragraph();
+        });
+
+        nvg::delete_internal(ctx);
+    }
+
+    // Per glyph cost of what laying out a line of text looks up in the font, the glyph index,
+    // advance and kerning with the previous glyph: walking the font data through stbtt versus
+    // the tables built when the font is added.
+    inline void run_fontstash_glyph_lookup_benchmarks() {
+        constexpr std::u32string_view text{
+            U"The quick brown fox jumps over the lazy dog. AV To Wa Yo LT 1234567890 "
+            U"\u00e9\u00e8\u00fc\u00df\u00f1 \u2014 \u201cquoted\u201d, (parens) [brackets] {braces}"
+        };
+
+        u64 nverts{ 0 };
+        const nvg::Params params{ null_backend_params(&nverts) };
+        nvg::Context* ctx{ nvg::create_internal(&params) };
+        const i32 sans{ ctx != nullptr ? nvg::create_font(
+                                             ctx, "sans",
+                                             fs::to_absolute("../../../data/fonts/roboto_regular.ttf")
+                                                 .c_str())
+                                       : -1 };
+        if (sans == -1) {
+            fmt::println("fontstash glyph lookup benchmarks skipped, font not found");
+            nvg::delete_internal(ctx);
+            return;
+        }
+
+        const nvg::font::STTFontImpl* font{ &ctx->fs->fonts[sans]->font };
+
+        ankerl::nanobench::Bench lookup_benchmarks{};
+        lookup_benchmarks.title("fontstash glyph lookups")
+            .unit("glyph")
+            .batch(text.size())
+            .warmup(100)
+            .performanceCounters(true)
+            .minEpochTime(250ms);
+
+        lookup_benchmarks.run("stbtt", [&] {
+            i32 width{ 0 };
+            i32 prev{ -1 };
+            for (const char32_t c : text) {
+                const i32 glyph{ stb::stbtt_find_glyph_index(&font->font, static_cast<i32>(c)) };
+                i32 advance{ 0 };
+                i32 lsb{ 0 };
+                stb::stbtt_get_glyph_h_metrics(&font->font, glyph, &advance, &lsb);
+                if (prev != -1)
+                    width += stb::stbtt_get_glyph_kern_advance(&font->font, prev, glyph);
+                width += advance;
+                prev = glyph;
+            }
+            ankerl::nanobench::doNotOptimizeAway(width);
+        });
+
+        lookup_benchmarks.run("font tables", [&] {
+            i32 width{ 0 };
+            i32 prev{ -1 };
+            for (const char32_t c : text) {
+                const i32 glyph{ nvg::font::glyph_index(font, static_cast<u32>(c)) };
+                if (prev != -1)
+                    width += nvg::font::glyph_kerning(font, prev, glyph);
+                width += nvg::font::glyph_advance(font, glyph);
+                prev = glyph;
+            }
+            ankerl::nanobench::doNotOptimizeAway(width);
+        });
+
+        nvg::delete_internal(ctx);
+    }
+
+    inline void run_utf8_decode_benchmarks() {
+        const auto repeat = [](const std::string_view text, const u64 size) {
+            std::string out{};
+            while (out.size() < size)
+                out += text;
+            return out;
+        };
+
+        constexpr u64 size{ 64 * 1024 };
+        const std::array corpora{
+            std::pair{ repeat("The quick brown fox jumps over the lazy dog. 1234567890 ", size),
+                       "ascii" },
+            std::pair{ repeat("\u6587\u5b57\u5217\u3092\u6570\u3048\u308b\u3002"
+                              "\ud55c\uad6d\uc5b4 \u65e5\u672c\u8a9e\u3001",
+                              size),
+                       "cjk" },
+            std::pair{ repeat("caf\u00e9 \u2014 \u201cna\u00efve\u201d r\u00e9sum\u00e9, "
+                              "\u00fcber 42 \u65e5\u672c \U0001f600 ok. ",
+                              size),
+                       "mixed" },
+        };
+
+        constexpr std::array levels{
+            std::pair{ utf8::simd::Level::Scalar, "scalar" },
+            std::pair{ utf8::simd::Level::SSE2, "sse2" },
+            std::pair{ utf8::simd::Level::AVX2, "avx2" },
+            std::pair{ utf8::simd::Level::NEON, "neon" },
+        };
+
+        const utf8::simd::Level active_level{ utf8::simd::active_level() };
+        for (auto&& [text, corpus] : corpora) {
+            const char* begin{ text.data() };
+            const char* end{ text.data() + text.size() };
+
+            ankerl::nanobench::Bench decode_benchmarks{};
+            decode_benchmarks.title(fmt::format("utf8 validate + decode ({})", corpus))
+                .unit("byte")
+                .batch(text.size())
+                .warmup(10)
+                .relative(true)
+                .performanceCounters(true)
+                .minEpochTime(250ms);
+
+            decode_benchmarks.run("utf8DecodeRune", [&] {
+                u32 sum{ 0 };
+                for (const char* str = begin; str < end;) {
+                    u32 codepoint{ 0 };
+                    str = utf8DecodeRune(str, static_cast<size_t>(end - str), &codepoint);
+                    sum += codepoint;
+                }
+                ankerl::nanobench::doNotOptimizeAway(sum);
+            });
+
+            for (auto&& [level, name] : levels) {
+                if (!utf8::simd::supported(level))
+                    continue;
+
+                utf8::simd::set_level(level);
+                decode_benchmarks.run(name, [&] {
+                    std::array<u32, 64> codepoints{};
+                    u32 sum{ 0 };
+                    const char* valid{ utf8::simd::valid_prefix(begin, end) };
+                    for (const char* str = begin; str < valid;) {
+                        const u32 n{ utf8::simd::decode(str, valid, codepoints.data(), nullptr,
+                                                        static_cast<u32>(codepoints.size()), &str) };
+                        for (u32 i = 0; i < n; ++i)
+                            sum += codepoints[i];
+                    }
+                    ankerl::nanobench::doNotOptimizeAway(sum);
+                });
+            }
+        }
+
+        utf8::simd::set_level(active_level);
+    }
 }
 
 namespace rl::circular_nums {
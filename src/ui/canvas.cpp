@@ -28,7 +28,15 @@ namespace rl::ui {
             rect.size,
         });
 
-        Widget::set_theme(new Theme{});
+        Theme* theme{ new Theme{} };
+        m_renderer->resolve_fonts(*theme);
+        Widget::set_theme(theme);
+
+        // tooltip arrow, tip pointing up at the widget
+        m_tooltip_arrow.move_to({ 0.0f, -6.0f })
+            .line_to({ 3.8f, 0.0f })
+            .line_to({ -3.8f, 0.0f })
+            .close();
 
         m_last_interaction = m_timer.elapsed();
     }
@@ -51,7 +59,7 @@ namespace rl::ui {
     bool Canvas::draw_widgets() {
         const auto context{ m_renderer->context() };
         constexpr static f32 PIXEL_RATIO{ 1.0f };
-        nvg::begin_frame(context, m_rect.size.width, m_rect.size.height, PIXEL_RATIO);
+        m_renderer->begin_frame(m_rect.size, PIXEL_RATIO);
 
         this->draw();
 
@@ -75,7 +83,7 @@ namespace rl::ui {
                                     ds::point<f32>{ widget->width() / 2.0f,
                                                     widget->height() + 10.0f } };
 
-                nvg::set_font_face(context, text::font::style::Sans);
+                nvg::set_font_face(context, m_theme->font_handles.sans);
                 nvg::set_font_size(context, 20.0f);
                 nvg::set_text_align(context, Align::HLeft | Align::VTop);
                 nvg::text_line_height_(context, 1.125f);
@@ -99,17 +107,28 @@ namespace rl::ui {
                 nvg::global_alpha(context,
                                   std::min(1.0f, 2.0f * (elapsed - m_tooltip_delay)) * 0.8f);
 
-                nvg::begin_path(context);
                 nvg::fill_color(context, rl::Colors::DarkererGrey);
-                nvg::rounded_rect(context, bounds.pt.x - 4.0f - horiz, bounds.pt.y - 4.0f,
-                                  bounds.size.width + 8.0f, bounds.size.height + 8.0f, 3.0f);
-
+                nvg::fill_rounded_rect(context,
+                                       ds::rect<f32>{
+                                           ds::point<f32>{
+                                               bounds.pt.x - 4.0f - horiz,
+                                               bounds.pt.y - 4.0f,
+                                           },
+                                           ds::dims<f32>{
+                                               bounds.size.width + 8.0f,
+                                               bounds.size.height + 8.0f,
+                                           },
+                                       },
+                                       3.0f);
+
+                // The arrow is drawn separately from the box now, so it stops
+                // at the box's top edge to avoid blending the overlap twice.
                 const f32 px{ (bounds.size.width / 2.0f) - horiz + shift };
 
-                nvg::move_to(context, px, bounds.pt.y - 10);
-                nvg::line_to(context, px + 7, bounds.pt.y + 1);
-                nvg::line_to(context, px - 7, bounds.pt.y + 1);
-                nvg::fill(context);
+                nvg::save(context);
+                nvg::translate(context, px, bounds.pt.y - 4.0f);
+                m_tooltip_arrow.fill(context);
+                nvg::restore(context);
 
                 nvg::fill_color(context, rl::Colors::White);
                 nvg::font_blur_(context, 0.0f);
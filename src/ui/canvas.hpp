@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "ds/dims.hpp"
+#include "gfx/vg/vec_path.hpp"
 #include "utils/numeric.hpp"
 #include "utils/time.hpp"
 #include "widget.hpp"
@@ -105,6 +106,8 @@ namespace rl::ui {
         std::function<void(ds::dims<f32>)> m_resize_callback;
         std::vector<std::function<void()>> m_update_callbacks;
 
+        path m_tooltip_arrow{};
+
     private:
         MouseMode m_mouse_mode{ MouseMode::Propagate };
         ScrollableDialog* m_active_dialog{ nullptr };
@@ -13,8 +13,8 @@ namespace rl::ui {
         constexpr Theme() = default;
         constexpr ~Theme() = default;
 
-        std::string_view tooltip_font_name{ text::font::style::SansBold };
-        std::string_view form_group_font_name{ text::font::style::Mono };
+        text::font::id tooltip_font{ text::font::style::SansBold };
+        text::font::id form_group_font{ text::font::style::Mono };
 
         f32 icon_scale{ 1.0f };
         f32 tab_border_width{ 0.75f };
@@ -51,14 +51,14 @@ namespace rl::ui {
         ds::color<f32> text_shadow_color{ Colors::Black };
         ds::color<f32> icon_color{ Colors::LightGrey };
 
-        std::string_view label_font_name{ text::font::style::Sans };
+        text::font::id label_font{ text::font::style::Sans };
         ds::color<f32> label_font_color{ Colors::LightGrey };
 
         f32 button_font_size{ 24.0f };
         f32 button_corner_radius{ 2.5f };
         f32 button_outline_width_focused{ 2.5f };
         f32 button_outline_width_unfocused{ 2.5f };
-        std::string_view button_font_name{ text::font::style::Mono };
+        text::font::id button_font{ text::font::style::Mono };
         ds::color<f32> button_gradient_top_focused{ 64, 64, 64 };
         ds::color<f32> button_gradient_bot_focused{ 48, 48, 48, 255 };
         ds::color<f32> button_gradient_top_unfocused{ 100, 100, 100 };
@@ -72,7 +72,7 @@ namespace rl::ui {
         f32 dialog_header_height{ 40.0f };
         f32 dialog_corner_radius{ 5.0f };
         f32 dialog_drop_shadow_size{ 15.0f };
-        std::string_view dialog_title_font_name{ text::font::style::SansBold };
+        text::font::id dialog_title_font{ text::font::style::SansBold };
         ds::color<f32> dialog_fill_unfocused{ 43, 43, 43, 230 };
         ds::color<f32> dialog_fill_focused{ 45, 45, 45, 230 };
         ds::color<f32> dialog_title_unfocused{ 220, 220, 220, 160 };
@@ -86,8 +86,8 @@ namespace rl::ui {
 
         f32 check_box_font_size{ 32.0f };
         Icon::ID check_box_icon{ Icon::Check };
-        std::string_view checkbox_text_font{ text::font::style::Sans };
-        std::string_view checkbox_icon_font{ text::font::style::Icons };
+        text::font::id checkbox_text_font{ text::font::style::Sans };
+        text::font::id checkbox_icon_font{ text::font::style::Icons };
 
         Icon::ID message_information_icon{ Icon::InfoCircle };
         Icon::ID message_question_icon{ Icon::QuestionCircle };
@@ -98,5 +98,24 @@ namespace rl::ui {
         Icon::ID popup_chevron_left_icon{ Icon::ChevronLeft };
         Icon::ID text_box_up_icon{ Icon::ChevronUp };
         Icon::ID text_box_down_icon{ Icon::ChevronDown };
+
+        // Handles of the fonts above and of the font styles drawn directly, resolved once by
+        // NVGRenderer::resolve_fonts() when the theme is created. Drawing passes these to the
+        // renderer instead of looking the fonts up every frame.
+        struct FontHandles {
+            text::font::handle sans{ text::font::InvalidHandle };
+            text::font::handle sans_bold{ text::font::InvalidHandle };
+            text::font::handle icons{ text::font::InvalidHandle };
+            text::font::handle mono{ text::font::InvalidHandle };
+            text::font::handle tooltip{ text::font::InvalidHandle };
+            text::font::handle form_group{ text::font::InvalidHandle };
+            text::font::handle label{ text::font::InvalidHandle };
+            text::font::handle button{ text::font::InvalidHandle };
+            text::font::handle dialog_title{ text::font::InvalidHandle };
+            text::font::handle checkbox_text{ text::font::InvalidHandle };
+            text::font::handle checkbox_icon{ text::font::InvalidHandle };
+        };
+
+        FontHandles font_handles{};
     };
 }
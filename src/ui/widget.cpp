@@ -17,8 +17,11 @@ namespace rl::ui {
     Widget::Widget(Widget* parent)
         : m_parent{ parent } {
         // this->acquire_ref();
-        if (m_theme == nullptr)
+        if (m_theme == nullptr) {
             m_theme = new Theme{};
+            if (m_renderer != nullptr)
+                m_renderer->resolve_fonts(*m_theme);
+        }
         if (parent != nullptr)
             parent->add_child(this);
     }
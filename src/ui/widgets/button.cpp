@@ -119,7 +119,7 @@ namespace rl::ui {
         const auto context{ m_renderer->context() };
 
         const TextProperties props{
-            .font = m_theme->button_font_name,
+            .font = m_theme->font_handles.button,
             .align = Align::HCenter | Align::VMiddle,
             .color = m_enabled ? m_theme->button_text_color
                                : m_theme->button_disabled_text_color,
@@ -127,16 +127,15 @@ namespace rl::ui {
                                             : m_font_size
         };
 
-        m_renderer->set_text_properties(props);
         ds::dims<f32> icon_size{ 0.0f, props.font_size };
-        const f32 text_width{ nvg::text_bounds(context, ds::point<f32>{}, m_text) };
+        const f32 text_width{ m_renderer->get_text_width(m_text, props.font, props.font_size) };
 
         if (m_icon != Icon::ID::None) {
             if (Icon::is_font(m_icon)) {
                 icon_size.height *= this->icon_scale();
-                nvg::set_font_size(context, icon_size.height);
-                nvg::set_font_face(context, text::font::style::Icons);
-                icon_size.width = nvg::text_bounds(context, ds::point<f32>::zero(), utf8::codepoint_to_str(m_icon));
+                icon_size.width = m_renderer->get_text_width(utf8::codepoint_to_str(m_icon),
+                                                             m_theme->font_handles.icons,
+                                                             icon_size.height);
             }
             else {
                 icon_size.height *= 0.9f;
@@ -261,58 +260,47 @@ namespace rl::ui {
             grad_bot = m_theme->button_gradient_bot_focused;
         }
 
-        m_renderer->draw_path(false, [&] {
-            m_renderer->draw_rounded_rect(m_rect, m_theme->button_corner_radius);
-            if (math::equal(m_background_color.a, 0.0f)) {
-                nvg::fill_color(context, m_background_color);
-                nvg::fill(context);
+        if (math::equal(m_background_color.a, 0.0f)) {
+            m_renderer->fill_rounded_rect(m_rect, m_theme->button_corner_radius,
+                                          m_background_color);
 
-                if (m_pressed)
-                    grad_top.a = grad_bot.a = 0.8f;
-                else {
-                    const f32 v{ 1.0f - m_background_color.a };
-                    grad_top.a = m_enabled ? v : v * 0.5f + 0.5f;
-                    grad_bot.a = m_enabled ? v : v * 0.5f + 0.5f;
-                }
+            if (m_pressed)
+                grad_top.a = grad_bot.a = 0.8f;
+            else {
+                const f32 v{ 1.0f - m_background_color.a };
+                grad_top.a = m_enabled ? v : v * 0.5f + 0.5f;
+                grad_bot.a = m_enabled ? v : v * 0.5f + 0.5f;
             }
+        }
 
-            const ds::line<f32> line{
-                m_rect.pt,
-                ds::point<f32>{ m_rect.pt.x, m_rect.pt.y + m_rect.size.height }
-            };
-            const nvg::PaintStyle bg{ m_renderer->create_linear_gradient_paint_style(line, grad_top, grad_bot) };
-            nvg::fill_paint(context, bg);
-            nvg::fill(context);
-        });
+        const ds::line<f32> line{
+            m_rect.pt,
+            ds::point<f32>{ m_rect.pt.x, m_rect.pt.y + m_rect.size.height }
+        };
+        const nvg::PaintStyle bg{ m_renderer->create_linear_gradient_paint_style(line, grad_top, grad_bot) };
+        m_renderer->fill_rounded_rect(m_rect, m_theme->button_corner_radius, bg);
 
         // TODO: Add border weight to style
 
         // Light Border
-        m_renderer->draw_path(false, [&] {
-            ds::rect<f32> test_rect{ m_rect };
-            test_rect.size += m_pressed ? ds::margin<f32>{ -1.5f }
-                                        : ds::margin<f32>{ -0.5f };
-            nvg::stroke_width(context, 1.0f);
-            m_renderer->draw_rounded_rect(test_rect, m_theme->button_corner_radius);
-            nvg::stroke_color(context, m_theme->border_light);
-            nvg::stroke(context);
-        });
+        ds::rect<f32> light_border_rect{ m_rect };
+        light_border_rect.size += m_pressed ? ds::margin<f32>{ -1.5f }
+                                            : ds::margin<f32>{ -0.5f };
+        m_renderer->stroke_rounded_rect(light_border_rect, m_theme->button_corner_radius, 1.0f,
+                                        m_theme->border_light);
 
         // Dark border
-        m_renderer->draw_path(false, [&] {
-            ds::rect<f32> test_rect{ m_rect };
-            test_rect.size += ds::margin<f32>{ -0.5f };
-            m_renderer->draw_rounded_rect(test_rect, m_theme->button_corner_radius);
-            nvg::stroke_color(context, m_theme->border_dark);
-            nvg::stroke(context);
-        });
+        ds::rect<f32> dark_border_rect{ m_rect };
+        dark_border_rect.size += ds::margin<f32>{ -0.5f };
+        m_renderer->stroke_rounded_rect(dark_border_rect, m_theme->button_corner_radius, 1.0f,
+                                        m_theme->border_dark);
 
         const f32 font_size{ math::equal(m_font_size, -1.0f)
                                  ? m_theme->button_font_size
                                  : m_font_size };
 
         nvg::set_font_size(context, font_size);
-        nvg::set_font_face(context, text::font::style::SansBold);
+        nvg::set_font_face(context, m_theme->font_handles.sans_bold);
 
         const f32 text_width{
             nvg::text_bounds(context, ds::point<f32>::zero(), m_text)
@@ -336,7 +324,7 @@ namespace rl::ui {
             if (Icon::is_font(m_icon)) {
                 icon_size.height *= this->icon_scale();
                 nvg::set_font_size(context, icon_size.height);
-                nvg::set_font_face(context, text::font::style::Icons);
+                nvg::set_font_face(context, m_theme->font_handles.icons);
                 icon_size.width = nvg::text_bounds(context, ds::point<f32>::zero(), icon);
             }
             else {
@@ -385,7 +373,7 @@ namespace rl::ui {
         }
 
         nvg::set_font_size(context, font_size);
-        nvg::set_font_face(context, text::font::style::SansBold);
+        nvg::set_font_face(context, m_theme->font_handles.sans_bold);
         nvg::set_text_align(context, Align::HLeft | Align::VMiddle);
         nvg::fill_color(context, m_theme->text_shadow_color);
         nvg::draw_text(context, text_pos, m_text);
@@ -92,7 +92,7 @@ namespace rl::ui {
         const auto context{ m_renderer->context() };
         const f32 font_size{ m_theme->check_box_font_size };
         nvg::set_font_size(context, font_size);
-        nvg::set_font_face(context, m_theme->checkbox_text_font);
+        nvg::set_font_face(context, m_theme->font_handles.checkbox_text);
 
         const f32 text_width{ nvg::text_bounds(context, ds::point<f32>::zero(), m_text) };
         const ds::dims pref_size{
@@ -114,7 +114,7 @@ namespace rl::ui {
         };
 
         const TextProperties props{
-            .font = m_theme->checkbox_text_font,
+            .font = m_theme->font_handles.checkbox_text,
             .align = Align::VMiddle | Align::HLeft,
             .color = m_enabled ? m_theme->text_color
                                : m_theme->disabled_text_color,
@@ -153,18 +153,14 @@ namespace rl::ui {
         // draw the sunken checkbox square
         // -2 pixels in size so it's fully
         // contained by the widget's rect
-        m_renderer->draw_path(false, [&] {
-            m_renderer->draw_rounded_rect(
-                checkbox_rect.expanded(-2.0f),
-                CORNER_RADIUS);
-            nvg::fill_paint(context, bg);
-            nvg::fill(context);
-        });
+        m_renderer->fill_rounded_rect(
+            checkbox_rect.expanded(-2.0f),
+            CORNER_RADIUS, bg);
 
         if (m_checked) {
             // draw the check mark
             const f32 icon_scale{ m_icon_extra_scale * m_theme->icon_scale };
-            nvg::set_font_face(context, text::font::style::Icons);
+            nvg::set_font_face(context, m_theme->font_handles.checkbox_icon);
             nvg::set_font_size(context, checkbox_height * icon_scale);
             nvg::fill_color(context, m_enabled ? m_theme->icon_color : m_theme->disabled_text_color);
             nvg::set_text_align(context, Align::HCenter | Align::VMiddle);
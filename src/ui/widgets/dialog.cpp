@@ -122,7 +122,7 @@ namespace rl::ui {
                 });
 
                 nvg::set_font_size(context, m_theme->tooltip_font_size);
-                nvg::set_font_face(context, m_theme->tooltip_font_name.data());
+                nvg::set_font_face(context, m_theme->font_handles.tooltip);
                 nvg::set_text_align(context, Align::HCenter | Align::VMiddle);
 
                 // header text shadow
@@ -301,7 +301,7 @@ namespace rl::ui {
 
         const auto context{ m_renderer->context() };
         nvg::set_font_size(context, m_theme->dialog_title_font_size);
-        nvg::set_font_face(context, m_theme->dialog_title_font_name.data());
+        nvg::set_font_face(context, m_theme->font_handles.dialog_title);
 
         ds::rect bounds{ ds::rect<f32>::zero() };
         nvg::text_bounds(context, ds::point<f32>::zero(), m_title, bounds);
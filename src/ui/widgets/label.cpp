@@ -41,12 +41,15 @@ namespace rl::ui {
         debug_assert(Align::None != m_text_alignment,
                      "invalid text alignment value assigned in label");
 
-        const auto context{ m_renderer->context() };
         const bool is_fixed_size{ math::not_equal(m_fixed_size.width, 0.0f) &&
                                   m_fixed_size.width > 0.0f };
 
-        m_renderer->set_text_properties(m_font, m_font_size, m_text_alignment);
         if (is_fixed_size || (m_font_autosizing && !m_rect.contained_by(this->parent()->rect()))) {
+            // wrapped text is still measured through the context, it breaks the lines
+            const auto context{ m_renderer->context() };
+            m_renderer->set_text_properties(m_font_handle, m_font_size,
+                                            m_text_alignment);
+
             // using TL aligntment since the font size will be computed from the predefined width
             nvg::set_text_align(context, Align::HLeft | Align::VTop);
 
@@ -64,15 +67,15 @@ namespace rl::ui {
             return ds::dims{ bounds.size.width, bounds.size.height };
         }
 
-        nvg::set_text_align(context, m_text_alignment);
-        const f32 text_width{ nvg::text_bounds(context, ds::point<f32>{}, m_text) };
-        return ds::dims{ text_width + 2.0f, m_font_size };
+        return m_renderer->get_text_size(m_text, m_font_handle, m_font_size,
+                                         m_text_alignment);
     }
 
     void Label::draw() {
         Widget::draw();
 
-        m_renderer->set_text_properties(m_font, m_font_size, m_text_alignment);
+        m_renderer->set_text_properties(m_font_handle, m_font_size,
+                                        m_text_alignment);
 
         const auto context{ m_renderer->context() };
         if (math::not_equal(m_fixed_size.width, 0.0f) && m_fixed_size.width > 0.0f) {
@@ -101,7 +104,7 @@ namespace rl::ui {
         return m_text;
     }
 
-    std::string_view Label::font() const {
+    text::font::id Label::font() const {
         return m_font;
     }
 
@@ -117,8 +120,9 @@ namespace rl::ui {
         m_text = std::move(text);
     }
 
-    void Label::set_font(const std::string_view font) {
-        m_font = std::string{ font };
+    void Label::set_font(const text::font::id font) {
+        m_font = font;
+        m_font_handle = m_renderer->font_handle(font);
     }
 
     void Label::set_text_alignment(const Align alignment) {
@@ -21,13 +21,13 @@ namespace rl::ui {
             f32 font_size = text::font::InvalidSize,
             Align alignment = Align::HLeft | Align::VMiddle);
 
-        [[nodiscard]] std::string_view font() const;
+        [[nodiscard]] text::font::id font() const;
         [[nodiscard]] std::string_view text() const;
         [[nodiscard]] ds::color<f32> color() const;
         [[nodiscard]] Align text_alignment() const;
 
         void set_text(std::string text);
-        void set_font(std::string_view font);
+        void set_font(text::font::id font);
         void set_text_alignment(Align alignment);
         void set_color(ds::color<f32> color);
         void set_callback(const std::function<void()>& callable);
@@ -39,7 +39,8 @@ namespace rl::ui {
 
     protected:
         std::string m_text{};
-        std::string m_font{ m_theme->label_font_name };
+        text::font::id m_font{ m_theme->label_font };
+        text::font::handle m_font_handle{ m_theme->font_handles.label };
         bool m_font_autosizing{ false };
         Align m_text_alignment{ Align::HLeft | Align::VMiddle };
         ds::color<f32> m_text_color{ m_theme->label_font_color };
@@ -76,7 +76,7 @@ namespace rl::ui {
                                                   ? m_theme->text_color
                                                   : m_text_color };
 
-            nvg::set_font_face(context, text::font::style::Icons);
+            nvg::set_font_face(context, m_theme->font_handles.icons);
             nvg::set_font_size(context, text_size * this->icon_scale());
             nvg::fill_color(context, m_enabled ? text_color : m_theme->disabled_text_color);
             nvg::set_text_align(context, Align::HLeft | Align::VMiddle);
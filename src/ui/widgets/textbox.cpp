@@ -10,6 +10,7 @@
 #include "utils/numeric.hpp"
 #include "utils/sdl_defs.hpp"
 #include "utils/unicode.hpp"
+#include "utils/utf8_simd.hpp"
 
 SDL_C_LIB_BEGIN
 #include <SDL3/SDL_clipboard.h>
@@ -183,7 +184,7 @@ namespace rl::ui {
         nvg::stroke(context);
 
         nvg::set_font_size(context, this->font_size());
-        nvg::set_font_face(context, text::font::style::Sans);
+        nvg::set_font_face(context, m_theme->font_handles.sans);
 
         ds::point<f32> draw_pos{
             m_rect.pt.x,
@@ -238,7 +239,7 @@ namespace rl::ui {
         if (m_spinnable && !this->focused()) {
             spin_arrows_width = 14.0f;
 
-            nvg::set_font_face(context, "icons");
+            nvg::set_font_face(context, m_theme->font_handles.icons);
             nvg::set_font_size(context,
                                (m_font_size < 0.0f ? m_theme->button_font_size : m_font_size) *
                                    this->icon_scale());
@@ -282,7 +283,7 @@ namespace rl::ui {
             }
 
             nvg::set_font_size(context, this->font_size());
-            nvg::set_font_face(context, text::font::style::Sans);
+            nvg::set_font_face(context, m_theme->font_handles.sans);
         }
 
         switch (m_alignment) {
@@ -424,7 +425,7 @@ namespace rl::ui {
             if (time - m_last_click < 0.25f) {
                 // Double-click: select all text
                 m_selection_pos = 0;
-                m_cursor_pos = static_cast<i32>(m_value_temp.size());
+                m_cursor_pos = this->codepoint_count();
                 m_mouse_down_pos = { -1, -1 };
             }
 
@@ -561,7 +562,7 @@ namespace rl::ui {
                     m_selection_pos = -1;
                 }
 
-                if (m_cursor_pos < static_cast<int>(m_value_temp.length()))
+                if (m_cursor_pos < this->codepoint_count())
                     m_cursor_pos++;
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::Home)) {
@@ -584,20 +585,23 @@ namespace rl::ui {
                     m_selection_pos = -1;
                 }
 
-                m_cursor_pos = static_cast<i32>(m_value_temp.size());
+                m_cursor_pos = this->codepoint_count();
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::Backspace)) {
                 if (!this->delete_selection()) {
                     if (m_cursor_pos > 0) {
-                        m_value_temp.erase(m_value_temp.begin() + m_cursor_pos - 1);
+                        const u64 begin{ this->byte_offset(m_cursor_pos - 1) };
+                        m_value_temp.erase(begin, this->byte_offset(m_cursor_pos) - begin);
                         m_cursor_pos--;
                     }
                 }
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::Delete)) {
                 if (!this->delete_selection()) {
-                    if (m_cursor_pos < static_cast<i32>(m_value_temp.length()))
-                        m_value_temp.erase(m_value_temp.begin() + m_cursor_pos);
+                    if (m_cursor_pos < this->codepoint_count()) {
+                        const u64 begin{ this->byte_offset(m_cursor_pos) };
+                        m_value_temp.erase(begin, this->byte_offset(m_cursor_pos + 1) - begin);
+                    }
                 }
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::Return)) {
@@ -606,7 +610,7 @@ namespace rl::ui {
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::A) &&
                      kb.is_button_down(Keyboard::Scancode::LCtrl)) {
-                m_cursor_pos = static_cast<i32>(m_value_temp.length());
+                m_cursor_pos = this->codepoint_count();
                 m_selection_pos = 0;
             }
             else if (kb.is_button_pressed(Keyboard::Scancode::X) &&
@@ -643,10 +647,12 @@ namespace rl::ui {
         if (m_editable && this->focused()) {
             std::ostringstream convert;
             convert << kb.get_inputted_text();
+            const std::string input{ convert.str() };
 
             this->delete_selection();
-            m_value_temp.insert(m_cursor_pos, convert.str());
-            m_cursor_pos++;
+            m_value_temp.insert(this->byte_offset(m_cursor_pos), input);
+            m_cursor_pos += static_cast<i32>(
+                utf8::simd::count(input.data(), input.data() + input.size()));
 
             m_valid_format = m_value_temp.empty() || this->check_format(m_value_temp, m_format);
 
@@ -679,7 +685,9 @@ namespace rl::ui {
             if (begin > end)
                 std::swap(begin, end);
 
-            SDL3::SDL_SetClipboardText(m_value_temp.substr(begin, end).c_str());
+            const u64 offset{ this->byte_offset(begin) };
+            SDL3::SDL_SetClipboardText(
+                m_value_temp.substr(offset, this->byte_offset(end) - offset).c_str());
             return true;
         }
 
@@ -694,7 +702,7 @@ namespace rl::ui {
         if (SDL3::SDL_HasClipboardText()) {
             const char* cbstr{ SDL3::SDL_GetClipboardText() };
             if (cbstr != nullptr)
-                m_value_temp.insert(m_cursor_pos, std::string(cbstr));
+                m_value_temp.insert(this->byte_offset(m_cursor_pos), std::string(cbstr));
         }
     }
 
@@ -706,10 +714,8 @@ namespace rl::ui {
             if (begin > end)
                 std::swap(begin, end);
 
-            if (begin == end - 1)
-                m_value_temp.erase(m_value_temp.begin() + begin);
-            else
-                m_value_temp.erase(m_value_temp.begin() + begin, m_value_temp.begin() + end);
+            const u64 offset{ this->byte_offset(begin) };
+            m_value_temp.erase(offset, this->byte_offset(end) - offset);
 
             m_cursor_pos = begin;
             m_selection_pos = -1;
@@ -746,6 +752,16 @@ namespace rl::ui {
             m_selection_pos = -1;
     }
 
+    u64 TextBox::byte_offset(const i32 index) const {
+        const char* text{ m_value_temp.data() };
+        return utf8::simd::offset(text, text + m_value_temp.size(), static_cast<u64>(index));
+    }
+
+    i32 TextBox::codepoint_count() const {
+        const char* text{ m_value_temp.data() };
+        return static_cast<i32>(utf8::simd::count(text, text + m_value_temp.size()));
+    }
+
     f32 TextBox::cursor_index_to_position(const i32 index, const f32 last_x,
                                           const nvg::GlyphPosition* glyphs, const i32 size) const {
         f32 pos{ 0.0f };
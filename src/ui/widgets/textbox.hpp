@@ -82,6 +82,10 @@ namespace rl::ui {
         bool check_format(const std::string& input, const std::string& format) const;
         void update_cursor(f32 last_x, const nvg::GlyphPosition* glyphs, i32 size);
 
+        // The cursor and selection positions are codepoint indices into the edited text.
+        u64 byte_offset(i32 index) const;
+        i32 codepoint_count() const;
+
         f32 cursor_index_to_position(i32 index, f32 last_x, const nvg::GlyphPosition* glyphs,
                                      i32 size) const;
         i32 position_to_cursor_index(f32 pos_x, f32 last_x, const nvg::GlyphPosition* glyphs,
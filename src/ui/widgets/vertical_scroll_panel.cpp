@@ -206,74 +206,66 @@ namespace rl::ui {
         if (m_cont_prefsize.height <= m_rect.size.height)
             return;
 
-        m_renderer->draw_path(false, [&] {
-            ds::rect<f32> scrollbar_bg_rect{
-                ds::point<f32>{
-                    m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) + OutlineSize,
-                    m_rect.pt.y + Margin + OutlineSize,
-                },
-                ds::dims<f32>{
-                    ScrollbarWidth,
-                    m_rect.size.height - Margin * 2.0f,
-                },
-            };
-            ds::rect widget_body_rect{
-                ds::point<f32>{
-                    m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth),
-                    m_rect.pt.y + Margin,
-                },
-                ds::dims<f32>{
-                    ScrollbarWidth,
-                    m_rect.size.height - Margin * 2.0f,
-                },
-            };
-
-            nvg::PaintStyle brush{
-                m_renderer->create_rect_gradient_paint_style(
-                    std::move(scrollbar_bg_rect), ScrollBarBackgroundRadius, ShadowBlur,
-                    ScrollGuideColor, ScrollGuideShadowColor),
-            };
-
-            nvg::rounded_rect(context, widget_body_rect, ScrollBarBackgroundRadius);
-            nvg::fill_paint(context, std::move(brush));
-            nvg::fill(context);
-
-            // subpath
-            m_renderer->draw_path(false, [&] {
-                auto scrollbar_rect = ds::rect<f32>{
-                    ds::point<f32>{
-                        m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) - OutlineSize,
-                        m_rect.pt.y + Margin +
-                            (m_rect.size.height - Margin * 2.0f - scrollbar_height) *
-                                m_scrollbar_pos -
-                            OutlineSize,
-                    },
-                    ds::dims<f32>{
-                        ScrollbarWidth,
-                        scrollbar_height,
-                    },
-                };
-                auto scrollbar_border_rect = ds::rect<f32>{
-                    ds::point<f32>{
-                        m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) + OutlineSize,
-                        m_rect.pt.y + Margin + OutlineSize +
-                            (m_rect.size.height - Margin * 2.0f - scrollbar_height) *
-                                m_scrollbar_pos,
-                    },
-                    ds::dims<f32>{
-                        ScrollbarWidth - Margin / 2.0f,
-                        scrollbar_height - Margin / 2.0f,
-                    },
-                };
-
-                nvg::PaintStyle bgbrush{ m_renderer->create_rect_gradient_paint_style(
-                    scrollbar_rect, ScrollBarBackgroundRadius, ShadowBlur,
-                    ScrollbarColor, ScrollbarShadowColor) };
-
-                nvg::rounded_rect(context, scrollbar_border_rect, ScrollBarCornerRadius);
-                nvg::fill_paint(context, bgbrush);
-                nvg::fill(context);
-            });
-        });
+        ds::rect<f32> scrollbar_bg_rect{
+            ds::point<f32>{
+                m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) + OutlineSize,
+                m_rect.pt.y + Margin + OutlineSize,
+            },
+            ds::dims<f32>{
+                ScrollbarWidth,
+                m_rect.size.height - Margin * 2.0f,
+            },
+        };
+        ds::rect widget_body_rect{
+            ds::point<f32>{
+                m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth),
+                m_rect.pt.y + Margin,
+            },
+            ds::dims<f32>{
+                ScrollbarWidth,
+                m_rect.size.height - Margin * 2.0f,
+            },
+        };
+
+        nvg::PaintStyle brush{
+            m_renderer->create_rect_gradient_paint_style(
+                std::move(scrollbar_bg_rect), ScrollBarBackgroundRadius, ShadowBlur,
+                ScrollGuideColor, ScrollGuideShadowColor),
+        };
+
+        m_renderer->fill_rounded_rect(widget_body_rect, ScrollBarBackgroundRadius, brush);
+
+        auto scrollbar_rect = ds::rect<f32>{
+            ds::point<f32>{
+                m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) - OutlineSize,
+                m_rect.pt.y + Margin +
+                    (m_rect.size.height - Margin * 2.0f - scrollbar_height) *
+                        m_scrollbar_pos -
+                    OutlineSize,
+            },
+            ds::dims<f32>{
+                ScrollbarWidth,
+                scrollbar_height,
+            },
+        };
+        auto scrollbar_border_rect = ds::rect<f32>{
+            ds::point<f32>{
+                m_rect.pt.x + m_rect.size.width - (Margin + ScrollbarWidth) + OutlineSize,
+                m_rect.pt.y + Margin + OutlineSize +
+                    (m_rect.size.height - Margin * 2.0f - scrollbar_height) *
+                        m_scrollbar_pos,
+            },
+            ds::dims<f32>{
+                ScrollbarWidth - Margin / 2.0f,
+                scrollbar_height - Margin / 2.0f,
+            },
+        };
+
+        nvg::PaintStyle bgbrush{ m_renderer->create_rect_gradient_paint_style(
+            scrollbar_rect, ScrollBarBackgroundRadius, ShadowBlur,
+            ScrollbarColor, ScrollbarShadowColor) };
+
+        m_renderer->fill_rounded_rect(scrollbar_border_rect, ScrollBarCornerRadius,
+                                      bgbrush);
     }
 }
@@ -131,7 +131,7 @@ namespace rl {
 }
 
 namespace rl::test {
-    void test_hash() {
+    inline void test_hash() {
         constexpr static auto str{ "asdf" };
         fmt::println("ap hash   = {}", rl::hash<str>::ap());
         fmt::println("bp hash   = {}", rl::hash<str>::bp());
@@ -0,0 +1,819 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#include "utils/utf8_simd.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define UTF8_SIMD_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    #define UTF8_TARGET_SSE2
+    #define UTF8_TARGET_AVX2
+  #else
+    #define UTF8_TARGET_SSE2 __attribute__((target("sse2")))
+    #define UTF8_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#else
+  #define UTF8_SIMD_X86 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #define UTF8_SIMD_NEON 1
+  #include <arm_neon.h>
+#else
+  #define UTF8_SIMD_NEON 0
+#endif
+
+namespace rl::utf8::simd {
+    namespace {
+        namespace detail {
+            const u8* as_bytes(const char* str) {
+                return reinterpret_cast<const u8*>(str);
+            }
+
+            const char* as_chars(const u8* str) {
+                return reinterpret_cast<const char*>(str);
+            }
+
+            bool is_continuation(const u8 byte) {
+                return (byte & 0xC0) == 0x80;
+            }
+
+            // Size of the well formed sequence at s, 0 when it's malformed or cut off by end.
+            // These are the sequences the decoder fontstash used to read a byte at a time
+            // accepts, the vector kernels have to agree with it.
+            u32 sequence_length(const u8* s, const u8* end) {
+                const u8 lead{ s[0] };
+                if (lead < 0x80)
+                    return 1;
+                // continuation bytes and the leads of overlong 2 byte sequences
+                if (lead < 0xC2)
+                    return 0;
+
+                const i64 left{ end - s };
+                if (lead < 0xE0)
+                    return left >= 2 && is_continuation(s[1]) ? 2 : 0;
+
+                if (lead < 0xF0) {
+                    // no overlongs after E0, no surrogates after ED
+                    const u8 lo{ lead == 0xE0 ? u8{ 0xA0 } : u8{ 0x80 } };
+                    const u8 hi{ lead == 0xED ? u8{ 0x9F } : u8{ 0xBF } };
+                    return left >= 3 && s[1] >= lo && s[1] <= hi && is_continuation(s[2]) ? 3
+                                                                                           : 0;
+                }
+
+                if (lead < 0xF5) {
+                    // no overlongs after F0, nothing past U+10FFFF after F4
+                    const u8 lo{ lead == 0xF0 ? u8{ 0x90 } : u8{ 0x80 } };
+                    const u8 hi{ lead == 0xF4 ? u8{ 0x8F } : u8{ 0xBF } };
+                    return left >= 4 && s[1] >= lo && s[1] <= hi && is_continuation(s[2]) &&
+                                   is_continuation(s[3])
+                             ? 4
+                             : 0;
+                }
+
+                return 0;
+            }
+
+            // Decodes the sequence at s without checking it, returns its size.
+            u32 decode_sequence(const u8* s, u32* codepoint) {
+                const u8 lead{ s[0] };
+                if (lead < 0x80) {
+                    *codepoint = lead;
+                    return 1;
+                }
+                if (lead < 0xE0) {
+                    *codepoint = (static_cast<u32>(lead & 0x1F) << 6) | (s[1] & 0x3Fu);
+                    return 2;
+                }
+                if (lead < 0xF0) {
+                    *codepoint = (static_cast<u32>(lead & 0x0F) << 12) |
+                                 (static_cast<u32>(s[1] & 0x3F) << 6) | (s[2] & 0x3Fu);
+                    return 3;
+                }
+
+                *codepoint = (static_cast<u32>(lead & 0x07) << 18) |
+                             (static_cast<u32>(s[1] & 0x3F) << 12) |
+                             (static_cast<u32>(s[2] & 0x3F) << 6) | (s[3] & 0x3Fu);
+                return 4;
+            }
+
+            // Start of the sequence p is in the middle of, or p. Vector kernels hand the
+            // block that failed validation over to the scalar code from there.
+            const u8* sequence_start(const u8* begin, const u8* p) {
+                for (i64 i = 1; i <= 3 && p - i >= begin; ++i) {
+                    const u8 byte{ p[-i] };
+                    if (!is_continuation(byte))
+                        return byte >= 0xC0 ? p - i : p;
+                }
+
+                return p;
+            }
+
+            bool is_ascii8(const u8* p) {
+                u64 word{ 0 };
+                std::memcpy(&word, p, sizeof(word));
+                return (word & 0x8080808080808080ull) == 0;
+            }
+
+            const u8* scalar_prefix(const u8* p, const u8* end) {
+                while (p < end) {
+                    if (end - p >= 8 && is_ascii8(p)) {
+                        p += 8;
+                        continue;
+                    }
+
+                    const u32 len{ sequence_length(p, end) };
+                    if (len == 0)
+                        break;
+                    p += len;
+                }
+
+                return p;
+            }
+
+            // Decodes one sequence at a time until either max codepoints or end are reached.
+            u32 decode_tail(const u8** p, const u8* end, u32* codepoints, u8* lengths, u32 n,
+                            const u32 max) {
+                const u8* s{ *p };
+                for (; n < max && s < end; ++n) {
+                    const u32 len{ decode_sequence(s, &codepoints[n]) };
+                    if (lengths != nullptr)
+                        lengths[n] = static_cast<u8>(len);
+                    s += len;
+                }
+
+                *p = s;
+                return n;
+            }
+
+            // Copies count ASCII bytes to the codepoint buffer.
+            u32 copy_ascii(const u8** p, u32* codepoints, u8* lengths, const u32 n,
+                           const u32 count) {
+                for (u32 i = 0; i < count; ++i)
+                    codepoints[n + i] = (*p)[i];
+                if (lengths != nullptr)
+                    std::memset(lengths + n, 1, count);
+
+                *p += count;
+                return n + count;
+            }
+
+            u64 count_tail(const u8* p, const u8* end) {
+                u64 n{ 0 };
+                for (; p < end; ++p)
+                    n += is_continuation(*p) ? 0 : 1;
+                return n;
+            }
+
+            const char* valid_prefix_scalar(const char* str, const char* end) {
+                return as_chars(scalar_prefix(as_bytes(str), as_bytes(end)));
+            }
+
+            u32 decode_scalar(const char* str, const char* end, u32* codepoints, u8* lengths,
+                              const u32 max, const char** next) {
+                const u8* p{ as_bytes(str) };
+                const u32 n{ decode_tail(&p, as_bytes(end), codepoints, lengths, 0, max) };
+                if (next != nullptr)
+                    *next = as_chars(p);
+                return n;
+            }
+
+            u64 count_scalar(const char* str, const char* end) {
+                return count_tail(as_bytes(str), as_bytes(end));
+            }
+
+            // Error flags of Keiser and Lemire's lookup validation ("Validating UTF-8 In Less
+            // Than One Instruction Per Byte"). Every pair of bytes is classified by the high
+            // and low nibble of the first and the high nibble of the second byte, the three
+            // lookups only have a flag in common when the pair can't be valid UTF-8.
+            namespace lookup {
+                constexpr u8 TooShort{ 1 << 0 };      // 11______ 0_______, 11______ 11______
+                constexpr u8 TooLong{ 1 << 1 };       // 0_______ 10______
+                constexpr u8 Overlong3{ 1 << 2 };     // 11100000 100_____
+                constexpr u8 TooLarge{ 1 << 3 };      // 11110100 1001____, 11110100 101_____
+                constexpr u8 Surrogate{ 1 << 4 };     // 11101101 101_____
+                constexpr u8 Overlong2{ 1 << 5 };     // 1100000_ 10______
+                constexpr u8 TooLarge1000{ 1 << 6 };  // 11110101 1000____, 1111011_ 1000____
+                constexpr u8 Overlong4{ 1 << 6 };     // 11110000 1000____
+                constexpr u8 TwoConts{ 1 << 7 };      // 10______ 10______
+                constexpr u8 Carry{ TooShort | TooLong | TwoConts };
+
+                alignas(16) constexpr u8 Byte1High[16]{
+                    // 0_______ ________, ASCII
+                    TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+                    // 10______ ________, continuation
+                    TwoConts, TwoConts, TwoConts, TwoConts,
+                    // 1100____ ________, 2 byte lead
+                    TooShort | Overlong2,
+                    // 1101____ ________, 2 byte lead
+                    TooShort,
+                    // 1110____ ________, 3 byte lead
+                    TooShort | Overlong3 | Surrogate,
+                    // 1111____ ________, 4 byte lead
+                    TooShort | TooLarge | TooLarge1000 | Overlong4,
+                };
+
+                alignas(16) constexpr u8 Byte1Low[16]{
+                    // ____0000 ________
+                    Carry | Overlong3 | Overlong2 | Overlong4,
+                    // ____0001 ________
+                    Carry | Overlong2,
+                    // ____001_ ________
+                    Carry,
+                    Carry,
+                    // ____0100 ________
+                    Carry | TooLarge,
+                    // ____0101 ________
+                    Carry | TooLarge | TooLarge1000,
+                    // ____011_ ________
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                    // ____1___ ________
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                    // ____1101 ________
+                    Carry | TooLarge | TooLarge1000 | Surrogate,
+                    Carry | TooLarge | TooLarge1000,
+                    Carry | TooLarge | TooLarge1000,
+                };
+
+                alignas(16) constexpr u8 Byte2High[16]{
+                    // ________ 0_______, ASCII
+                    TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+                    TooShort,
+                    // ________ 1000____
+                    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+                    // ________ 1001____
+                    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+                    // ________ 101_____
+                    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+                    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+                    // ________ 11______
+                    TooShort, TooShort, TooShort, TooShort,
+                };
+
+                // Bytes of a block over these are the start of a sequence the block ends in
+                // the middle of.
+                alignas(32) constexpr u8 IncompleteMax[32]{
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+                };
+
+                // Moves the 3 bytes of the sequence starting at every third byte into a
+                // codepoint lane each, lead byte highest.
+                alignas(16) constexpr u8 Gather3[16]{
+                    2, 1, 0, 0x80, 5, 4, 3, 0x80, 8, 7, 6, 0x80, 11, 10, 9, 0x80,
+                };
+            }
+
+#if UTF8_SIMD_X86
+            UTF8_TARGET_SSE2 const char* valid_prefix_sse2(const char* str, const char* end) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                while (e - p >= 16) {
+                    const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+                    if (_mm_movemask_epi8(v) == 0) {
+                        p += 16;
+                        continue;
+                    }
+
+                    // sequences are checked one at a time until the next block
+                    const u8* stop{ p + 16 };
+                    while (p < stop) {
+                        const u32 len{ sequence_length(p, e) };
+                        if (len == 0)
+                            return as_chars(p);
+                        p += len;
+                    }
+                }
+
+                return as_chars(scalar_prefix(p, e));
+            }
+
+            UTF8_TARGET_SSE2 u32 decode_sse2(const char* str, const char* end, u32* codepoints,
+                                             u8* lengths, const u32 max, const char** next) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                const __m128i zero{ _mm_setzero_si128() };
+
+                u32 n{ 0 };
+                while (n < max && p < e) {
+                    if (e - p >= 16) {
+                        const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+                        const u32 mask{ static_cast<u32>(_mm_movemask_epi8(v)) };
+                        const u32 room{ max - n };
+                        if (mask == 0 && room >= 16) {
+                            const __m128i lo{ _mm_unpacklo_epi8(v, zero) };
+                            const __m128i hi{ _mm_unpackhi_epi8(v, zero) };
+                            auto* out{ reinterpret_cast<__m128i*>(codepoints + n) };
+                            _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+                            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+                            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+                            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+                            if (lengths != nullptr)
+                                std::memset(lengths + n, 1, 16);
+
+                            p += 16;
+                            n += 16;
+                            continue;
+                        }
+
+                        // the ASCII bytes before the first one that isn't
+                        const u32 ascii{ std::min<u32>(
+                            static_cast<u32>(std::countr_zero(mask | 0x10000u)), room) };
+                        if (ascii > 0) {
+                            n = copy_ascii(&p, codepoints, lengths, n, ascii);
+                            continue;
+                        }
+                    }
+
+                    n = decode_tail(&p, e, codepoints, lengths, n, n + 1);
+                }
+
+                if (next != nullptr)
+                    *next = as_chars(p);
+                return n;
+            }
+
+            UTF8_TARGET_SSE2 u64 count_sse2(const char* str, const char* end) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                // signed, continuation bytes are the ones from -128 to -65
+                const __m128i last_continuation{ _mm_set1_epi8(-65) };
+
+                u64 n{ 0 };
+                for (; e - p >= 16; p += 16) {
+                    const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+                    n += static_cast<u64>(std::popcount(static_cast<u32>(
+                        _mm_movemask_epi8(_mm_cmpgt_epi8(v, last_continuation)))));
+                }
+
+                return n + count_tail(p, e);
+            }
+
+            UTF8_TARGET_AVX2 __m256i broadcast_table(const u8* table) {
+                return _mm256_broadcastsi128_si256(
+                    _mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+            }
+
+            // Nonzero bytes wherever the block can't be valid, given the block before it.
+            UTF8_TARGET_AVX2 __m256i block_errors_avx2(const __m256i in, const __m256i prev) {
+                const __m256i nibble{ _mm256_set1_epi8(0x0F) };
+                const __m256i prev_in{ _mm256_permute2x128_si256(prev, in, 0x21) };
+                const __m256i prev1{ _mm256_alignr_epi8(in, prev_in, 16 - 1) };
+                const __m256i prev2{ _mm256_alignr_epi8(in, prev_in, 16 - 2) };
+                const __m256i prev3{ _mm256_alignr_epi8(in, prev_in, 16 - 3) };
+
+                const __m256i byte_1_high{ _mm256_shuffle_epi8(
+                    broadcast_table(lookup::Byte1High),
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)) };
+                const __m256i byte_1_low{ _mm256_shuffle_epi8(broadcast_table(lookup::Byte1Low),
+                                                              _mm256_and_si256(prev1, nibble)) };
+                const __m256i byte_2_high{ _mm256_shuffle_epi8(
+                    broadcast_table(lookup::Byte2High),
+                    _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble)) };
+                const __m256i special{ _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low),
+                                                        byte_2_high) };
+
+                // the 3rd and 4th bytes of a sequence have to be continuations, the lookups
+                // flag every two continuations in a row
+                const __m256i must_continue{ _mm256_or_si256(
+                    _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+                    _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80))) };
+                return _mm256_xor_si256(
+                    _mm256_and_si256(must_continue, _mm256_set1_epi8(static_cast<char>(0x80))),
+                    special);
+            }
+
+            UTF8_TARGET_AVX2 const char* valid_prefix_avx2(const char* str, const char* end) {
+                const u8* begin{ as_bytes(str) };
+                const u8* p{ begin };
+                const u8* e{ as_bytes(end) };
+                const __m256i incomplete_max{ _mm256_load_si256(
+                    reinterpret_cast<const __m256i*>(lookup::IncompleteMax)) };
+
+                __m256i prev{ _mm256_setzero_si256() };
+                __m256i prev_incomplete{ _mm256_setzero_si256() };
+                while (e - p >= 32) {
+                    const __m256i in{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) };
+                    __m256i errors;
+                    if (_mm256_movemask_epi8(in) == 0) {
+                        // ASCII is only wrong when the block before ends in a sequence
+                        errors = prev_incomplete;
+                        prev_incomplete = _mm256_setzero_si256();
+                    }
+                    else {
+                        errors = block_errors_avx2(in, prev);
+                        prev_incomplete = _mm256_subs_epu8(in, incomplete_max);
+                    }
+
+                    if (_mm256_testz_si256(errors, errors) == 0)
+                        break;
+
+                    prev = in;
+                    p += 32;
+                }
+
+                _mm256_zeroupper();
+                // the block with the error, or the bytes that don't fill a whole one
+                return as_chars(scalar_prefix(sequence_start(begin, p), e));
+            }
+
+            UTF8_TARGET_AVX2 u32 decode_avx2(const char* str, const char* end, u32* codepoints,
+                                             u8* lengths, const u32 max, const char** next) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                const __m256i gather3{ broadcast_table(lookup::Gather3) };
+
+                u32 n{ 0 };
+                while (n < max && p < e) {
+                    if (e - p >= 32) {
+                        const __m256i v{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) };
+                        const u32 mask{ static_cast<u32>(_mm256_movemask_epi8(v)) };
+                        const u32 room{ max - n };
+                        if (mask == 0 && room >= 32) {
+                            auto* out{ reinterpret_cast<__m256i*>(codepoints + n) };
+                            for (i32 i = 0; i < 4; ++i)
+                                _mm256_storeu_si256(
+                                    out + i, _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+                                                 reinterpret_cast<const __m128i*>(p + i * 8))));
+                            if (lengths != nullptr)
+                                std::memset(lengths + n, 1, 32);
+
+                            p += 32;
+                            n += 32;
+                            continue;
+                        }
+
+                        // the ASCII bytes before the first one that isn't
+                        const u32 ascii{ std::min<u32>(static_cast<u32>(std::countr_zero(mask)),
+                                                       room) };
+                        if (ascii > 0) {
+                            n = copy_ascii(&p, codepoints, lengths, n, ascii);
+                            continue;
+                        }
+
+                        // eight 3 byte sequences in a row, what CJK text is mostly made of
+                        if (room >= 8) {
+                            const __m256i bytes{ _mm256_inserti128_si256(
+                                _mm256_castsi128_si256(
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1) };
+                            const __m256i seq{ _mm256_shuffle_epi8(bytes, gather3) };
+                            const __m256i leads{ _mm256_cmpeq_epi32(
+                                _mm256_and_si256(seq, _mm256_set1_epi32(0x00F00000)),
+                                _mm256_set1_epi32(0x00E00000)) };
+                            if (_mm256_movemask_epi8(leads) == -1) {
+                                const __m256i cp{ _mm256_or_si256(
+                                    _mm256_or_si256(
+                                        _mm256_and_si256(seq, _mm256_set1_epi32(0x3F)),
+                                        _mm256_and_si256(_mm256_srli_epi32(seq, 2),
+                                                         _mm256_set1_epi32(0x0FC0))),
+                                    _mm256_and_si256(_mm256_srli_epi32(seq, 4),
+                                                     _mm256_set1_epi32(0xF000))) };
+                                _mm256_storeu_si256(reinterpret_cast<__m256i*>(codepoints + n),
+                                                    cp);
+                                if (lengths != nullptr)
+                                    std::memset(lengths + n, 3, 8);
+
+                                p += 24;
+                                n += 8;
+                                continue;
+                            }
+                        }
+                    }
+
+                    n = decode_tail(&p, e, codepoints, lengths, n, n + 1);
+                }
+
+                _mm256_zeroupper();
+                if (next != nullptr)
+                    *next = as_chars(p);
+                return n;
+            }
+
+            UTF8_TARGET_AVX2 u64 count_avx2(const char* str, const char* end) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                // signed, continuation bytes are the ones from -128 to -65
+                const __m256i last_continuation{ _mm256_set1_epi8(-65) };
+
+                u64 n{ 0 };
+                for (; e - p >= 32; p += 32) {
+                    const __m256i v{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) };
+                    n += static_cast<u64>(std::popcount(static_cast<u32>(
+                        _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, last_continuation)))));
+                }
+
+                _mm256_zeroupper();
+                return n + count_tail(p, e);
+            }
+
+            Level detect_level() {
+  #if defined(_MSC_VER) && !defined(__clang__)
+                i32 info[4]{};
+                __cpuid(info, 0);
+                const i32 max_leaf{ info[0] };
+
+                __cpuid(info, 1);
+                const bool sse2{ (info[3] & (1 << 26)) != 0 };
+                const bool os_avx{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                                   (_xgetbv(0) & 0x6) == 0x6 };
+
+                bool avx2{ false };
+                if (max_leaf >= 7) {
+                    __cpuidex(info, 7, 0);
+                    avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+                }
+  #else
+                __builtin_cpu_init();
+                const bool sse2{ __builtin_cpu_supports("sse2") != 0 };
+                const bool avx2{ __builtin_cpu_supports("avx2") != 0 };
+  #endif
+                if (avx2)
+                    return Level::AVX2;
+                if (sse2)
+                    return Level::SSE2;
+                return Level::Scalar;
+            }
+#elif UTF8_SIMD_NEON
+            // Nonzero bytes wherever the block can't be valid, given the block before it.
+            uint8x16_t block_errors_neon(const uint8x16_t in, const uint8x16_t prev) {
+                const uint8x16_t nibble{ vdupq_n_u8(0x0F) };
+                const uint8x16_t prev1{ vextq_u8(prev, in, 16 - 1) };
+                const uint8x16_t prev2{ vextq_u8(prev, in, 16 - 2) };
+                const uint8x16_t prev3{ vextq_u8(prev, in, 16 - 3) };
+
+                const uint8x16_t byte_1_high{ vqtbl1q_u8(vld1q_u8(lookup::Byte1High),
+                                                         vshrq_n_u8(prev1, 4)) };
+                const uint8x16_t byte_1_low{ vqtbl1q_u8(vld1q_u8(lookup::Byte1Low),
+                                                        vandq_u8(prev1, nibble)) };
+                const uint8x16_t byte_2_high{ vqtbl1q_u8(vld1q_u8(lookup::Byte2High),
+                                                         vshrq_n_u8(in, 4)) };
+                const uint8x16_t special{ vandq_u8(vandq_u8(byte_1_high, byte_1_low),
+                                                   byte_2_high) };
+
+                // the 3rd and 4th bytes of a sequence have to be continuations, the lookups
+                // flag every two continuations in a row
+                const uint8x16_t must_continue{ vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)),
+                                                         vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80))) };
+                return veorq_u8(vandq_u8(must_continue, vdupq_n_u8(0x80)), special);
+            }
+
+            // Index of the first byte that isn't ASCII, 16 if they all are.
+            u32 ascii_prefix_neon(const uint8x16_t v) {
+                const uint8x16_t high{ vcgeq_u8(v, vdupq_n_u8(0x80)) };
+                const u64 bits{ vget_lane_u64(
+                    vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(high), 4)), 0) };
+                return bits == 0 ? 16 : static_cast<u32>(std::countr_zero(bits)) / 4;
+            }
+
+            const char* valid_prefix_neon(const char* str, const char* end) {
+                const u8* begin{ as_bytes(str) };
+                const u8* p{ begin };
+                const u8* e{ as_bytes(end) };
+                const uint8x16_t incomplete_max{ vld1q_u8(lookup::IncompleteMax + 16) };
+
+                uint8x16_t prev{ vdupq_n_u8(0) };
+                uint8x16_t prev_incomplete{ vdupq_n_u8(0) };
+                while (e - p >= 16) {
+                    const uint8x16_t in{ vld1q_u8(p) };
+                    uint8x16_t errors;
+                    if (vmaxvq_u8(in) < 0x80) {
+                        // ASCII is only wrong when the block before ends in a sequence
+                        errors = prev_incomplete;
+                        prev_incomplete = vdupq_n_u8(0);
+                    }
+                    else {
+                        errors = block_errors_neon(in, prev);
+                        prev_incomplete = vqsubq_u8(in, incomplete_max);
+                    }
+
+                    if (vmaxvq_u8(errors) != 0)
+                        break;
+
+                    prev = in;
+                    p += 16;
+                }
+
+                // the block with the error, or the bytes that don't fill a whole one
+                return as_chars(scalar_prefix(sequence_start(begin, p), e));
+            }
+
+            u32 decode_neon(const char* str, const char* end, u32* codepoints, u8* lengths,
+                            const u32 max, const char** next) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                const uint8x16_t gather3{ vld1q_u8(lookup::Gather3) };
+
+                u32 n{ 0 };
+                while (n < max && p < e) {
+                    if (e - p >= 16) {
+                        const uint8x16_t v{ vld1q_u8(p) };
+                        const u32 room{ max - n };
+                        const u32 ascii{ std::min(ascii_prefix_neon(v), room) };
+                        if (ascii == 16) {
+                            const uint16x8_t lo{ vmovl_u8(vget_low_u8(v)) };
+                            const uint16x8_t hi{ vmovl_u8(vget_high_u8(v)) };
+                            vst1q_u32(codepoints + n + 0, vmovl_u16(vget_low_u16(lo)));
+                            vst1q_u32(codepoints + n + 4, vmovl_u16(vget_high_u16(lo)));
+                            vst1q_u32(codepoints + n + 8, vmovl_u16(vget_low_u16(hi)));
+                            vst1q_u32(codepoints + n + 12, vmovl_u16(vget_high_u16(hi)));
+                            if (lengths != nullptr)
+                                std::memset(lengths + n, 1, 16);
+
+                            p += 16;
+                            n += 16;
+                            continue;
+                        }
+
+                        if (ascii > 0) {
+                            n = copy_ascii(&p, codepoints, lengths, n, ascii);
+                            continue;
+                        }
+
+                        // four 3 byte sequences in a row, what CJK text is mostly made of
+                        if (room >= 4) {
+                            const uint32x4_t seq{ vreinterpretq_u32_u8(vqtbl1q_u8(v, gather3)) };
+                            const uint32x4_t leads{ vceqq_u32(
+                                vandq_u32(seq, vdupq_n_u32(0x00F00000)),
+                                vdupq_n_u32(0x00E00000)) };
+                            if (vminvq_u32(leads) == 0xFFFFFFFF) {
+                                const uint32x4_t cp{ vorrq_u32(
+                                    vorrq_u32(vandq_u32(seq, vdupq_n_u32(0x3F)),
+                                              vandq_u32(vshrq_n_u32(seq, 2),
+                                                        vdupq_n_u32(0x0FC0))),
+                                    vandq_u32(vshrq_n_u32(seq, 4), vdupq_n_u32(0xF000))) };
+                                vst1q_u32(codepoints + n, cp);
+                                if (lengths != nullptr)
+                                    std::memset(lengths + n, 3, 4);
+
+                                p += 12;
+                                n += 4;
+                                continue;
+                            }
+                        }
+                    }
+
+                    n = decode_tail(&p, e, codepoints, lengths, n, n + 1);
+                }
+
+                if (next != nullptr)
+                    *next = as_chars(p);
+                return n;
+            }
+
+            u64 count_neon(const char* str, const char* end) {
+                const u8* p{ as_bytes(str) };
+                const u8* e{ as_bytes(end) };
+                // signed, continuation bytes are the ones from -128 to -65
+                const int8x16_t last_continuation{ vdupq_n_s8(-65) };
+
+                u64 n{ 0 };
+                for (; e - p >= 16; p += 16) {
+                    const uint8x16_t leads{ vcgtq_s8(vreinterpretq_s8_u8(vld1q_u8(p)),
+                                                     last_continuation) };
+                    n += vaddvq_u8(vshrq_n_u8(leads, 7));
+                }
+
+                return n + count_tail(p, e);
+            }
+
+            Level detect_level() {
+                // Advanced SIMD is part of every AArch64 CPU
+                return Level::NEON;
+            }
+#else
+            Level detect_level() {
+                return Level::Scalar;
+            }
+#endif
+
+            constexpr Kernels ScalarKernels{
+                &valid_prefix_scalar,
+                &decode_scalar,
+                &count_scalar,
+            };
+
+            // indexed by Level, the ones the build doesn't have fall back to scalar
+            constexpr Kernels KernelTable[]{
+                ScalarKernels,
+#if UTF8_SIMD_X86
+                {
+                    &valid_prefix_sse2,
+                    &decode_sse2,
+                    &count_sse2,
+                },
+                {
+                    &valid_prefix_avx2,
+                    &decode_avx2,
+                    &count_avx2,
+                },
+#else
+                ScalarKernels,
+                ScalarKernels,
+#endif
+#if UTF8_SIMD_NEON
+                {
+                    &valid_prefix_neon,
+                    &decode_neon,
+                    &count_neon,
+                },
+#else
+                ScalarKernels,
+#endif
+            };
+
+            std::atomic<Level>& level() {
+                static std::atomic<Level> level{ supported_level() };
+                return level;
+            }
+        }
+    }
+
+    Level supported_level() {
+        static const Level supported{ detail::detect_level() };
+        return supported;
+    }
+
+    bool supported(const Level level) {
+        switch (level) {
+            case Level::Scalar:
+                return true;
+            case Level::SSE2:
+                return supported_level() == Level::SSE2 || supported_level() == Level::AVX2;
+            case Level::AVX2:
+            case Level::NEON:
+                return supported_level() == level;
+        }
+
+        return false;
+    }
+
+    Level active_level() {
+        return detail::level().load(std::memory_order_relaxed);
+    }
+
+    void set_level(const Level level) {
+        detail::level().store(supported(level) ? level : supported_level(),
+                              std::memory_order_relaxed);
+    }
+
+    const Kernels& kernels() {
+        return detail::KernelTable[static_cast<i32>(active_level())];
+    }
+
+    const Kernels& kernels(const Level level) {
+        return detail::KernelTable[static_cast<i32>(supported(level) ? level
+                                                                      : supported_level())];
+    }
+
+    const char* valid_prefix(const char* str, const char* end) {
+        return kernels().valid_prefix(str, end);
+    }
+
+    u32 decode(const char* str, const char* end, u32* codepoints, u8* lengths, const u32 max,
+               const char** next) {
+        return kernels().decode(str, end, codepoints, lengths, max, next);
+    }
+
+    u64 count(const char* str, const char* end) {
+        return kernels().count(str, end);
+    }
+
+    u64 offset(const char* str, const char* end, const u64 index) {
+        // whole blocks are skipped by counting their codepoints, the one with the codepoint
+        // is walked a byte at a time
+        constexpr i64 block_size{ 64 };
+        const Kernels& k{ kernels() };
+
+        const char* p{ str };
+        u64 n{ 0 };
+        while (end - p >= block_size) {
+            const u64 nblock{ k.count(p, p + block_size) };
+            if (n + nblock > index)
+                break;
+
+            n += nblock;
+            p += block_size;
+        }
+
+        for (; p < end; ++p) {
+            if (detail::is_continuation(static_cast<u8>(*p)))
+                continue;
+            if (n == index)
+                return static_cast<u64>(p - str);
+            ++n;
+        }
+
+        return static_cast<u64>(end - str);
+    }
+}
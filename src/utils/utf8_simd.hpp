@@ -0,0 +1,53 @@
+#pragma once
+
+#include "utils/numeric.hpp"
+
+namespace rl::utf8::simd {
+    // Instruction sets the decoding kernels are compiled for. The highest one supported by
+    // the CPU is selected the first time text is decoded.
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON,
+    };
+
+    // Kernels behind valid_prefix(), decode() and count(). Every vector version returns the
+    // same results as the scalar one. Runs of ASCII are handled a register at a time, AVX2
+    // and NEON also validate every block of text and bulk decode runs of 3 byte sequences.
+    struct Kernels {
+        const char* (*valid_prefix)(const char* str, const char* end);
+        u32 (*decode)(const char* str, const char* end, u32* codepoints, u8* lengths, u32 max,
+                      const char** next);
+        u64 (*count)(const char* str, const char* end);
+    };
+
+    // Highest level supported by the CPU and the build.
+    Level supported_level();
+    bool supported(Level level);
+
+    // Level currently used, levels that aren't supported fall back to supported_level().
+    Level active_level();
+    void set_level(Level level);
+
+    const Kernels& kernels();
+    const Kernels& kernels(Level level);
+
+    // End of the longest prefix of [str, end) made of whole, well formed sequences (no
+    // overlong encodings, surrogates or codepoints past U+10FFFF). It's where a decoder
+    // reading a byte at a time stops, anything from the first malformed byte on is dropped.
+    const char* valid_prefix(const char* str, const char* end);
+
+    // Decodes up to max codepoints from the start of [str, end), which has to be valid (see
+    // valid_prefix). The size in bytes of every codepoint goes to lengths unless it's null
+    // and next is set to the end of the decoded bytes. Returns the number of codepoints.
+    u32 decode(const char* str, const char* end, u32* codepoints, u8* lengths, u32 max,
+               const char** next = nullptr);
+
+    // Number of codepoints in the valid text [str, end).
+    u64 count(const char* str, const char* end);
+
+    // Byte offset of the codepoint at index in the valid text [str, end), the size of the
+    // text when it has fewer codepoints than that.
+    u64 offset(const char* str, const char* end, u64 index);
+}